@@ -66,6 +66,12 @@ Services.Renderer.__ptr = Polycore.CoreServices_getRenderer(Polycore.CoreService
 Services.Config = Config("__skip_ptr__")
 Services.Config.__ptr = Polycore.CoreServices_getConfig(Polycore.CoreServices_getInstance())
 
+Services.Profiler = Profiler("__skip_ptr__")
+Services.Profiler.__ptr = Polycore.CoreServices_getProfiler(Polycore.CoreServices_getInstance())
+
+Services.AssetLoader = AssetLoader("__skip_ptr__")
+Services.AssetLoader.__ptr = Polycore.CoreServices_getAssetLoader(Polycore.CoreServices_getInstance())
+
 Services.MaterialManager = MaterialManager("__skip_ptr__")
 Services.MaterialManager.__ptr = Polycore.CoreServices_getMaterialManager(Polycore.CoreServices_getInstance())
 
@@ -164,7 +164,7 @@ def createLUABindings(inputPath, prefix, mainInclude, libSmallName, libName, api
 			f = open(fileName) # Def: Input file handle
 			contents = f.read().replace("_PolyExport", "") # Def: Input file contents, strip out "_PolyExport"
 			cppHeader = CppHeaderParser.CppHeader(contents, "string") # Def: Input file contents, parsed structure
-			ignore_classes = ["PolycodeShaderModule", "Object", "Threaded", "OpenGLCubemap", "PolyBase"]
+			ignore_classes = ["PolycodeShaderModule", "Object", "Threaded", "OpenGLCubemap", "PolyBase", "ProfilerZone", "AssetLoaderWorker", "AtlasGlyph", "LabelGlyph", "SoundStream", "SoundStreamWorker", "SoundBufferEntry", "Job", "JobQueue", "JobWorker", "JobSystem", "BonePose", "SkeletonAnimationState"]
 
 			# Iterate, check each class in this file.
 			for ckey in cppHeader.classes: 
@@ -78,6 +78,11 @@ class _PolyExport OSBasics : public PolyBase {
 		static void removeItem(const Polycode::String& pathString);
 		static time_t getFileTime(const Polycode::String& pathString);
 		
+		/**
+		* Returns the number of processors available to the process.
+		*/
+		static int getProcessorCount();
+		
 	private:
 	
 };
@@ -0,0 +1,187 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyVector3.h"
+#include <vector>
+
+namespace Polycode {
+
+	class Camera;
+
+	/**
+	* Axis aligned bounding box.
+	*/
+	class _PolyExport AABB : public PolyBase {
+		public:
+			AABB();
+			AABB(const Vector3 &min, const Vector3 &max);
+			
+			/**
+			* Returns the smallest box containing a sphere.
+			* @param center Center of the sphere.
+			* @param radius Radius of the sphere.
+			*/
+			static AABB fromSphere(const Vector3 &center, Number radius);
+			
+			/**
+			* Returns the smallest box containing both this box and another one.
+			*/
+			AABB merged(const AABB &other) const;
+			
+			/**
+			* Returns a copy of the box grown by the specified amount on every side.
+			*/
+			AABB expanded(Number amount) const;
+			
+			bool contains(const AABB &other) const;
+			bool intersects(const AABB &other) const;
+			bool intersectsSphere(const Vector3 &center, Number radius) const;
+			
+			/**
+			* Tests a ray against the box.
+			* @param origin Origin of the ray.
+			* @param direction Direction of the ray. Distances are measured in multiples of this vector.
+			* @param maxDistance Farthest distance along the ray to test.
+			* @param entryDistance If not NULL, receives the distance at which the ray enters the box, or 0 if it starts inside.
+			* @return True if the ray hits the box before maxDistance.
+			*/
+			bool intersectsRay(const Vector3 &origin, const Vector3 &direction, Number maxDistance, Number *entryDistance) const;
+			
+			Vector3 getCenter() const;
+			
+			/**
+			* Returns the surface area of the box. Used as the insertion cost in AABBTree.
+			*/
+			Number getSurfaceArea() const;
+			
+			Vector3 min;
+			Vector3 max;
+	};
+
+	/**
+	* Dynamic bounding volume hierarchy of axis aligned boxes. Each proxy stores a box and a user data pointer, and the tree supports box, sphere, frustum and ray queries in logarithmic time. Proxies are stored with a slightly enlarged box, so objects that move a little do not need to be reinserted every time they are updated.
+	*/
+	class _PolyExport AABBTree : public PolyBase {
+		public:
+			AABBTree();
+			virtual ~AABBTree();
+			
+			/**
+			* Adds a new proxy to the tree.
+			* @param box Bounds of the proxy.
+			* @param userData Pointer returned by queries that hit this proxy.
+			* @return Id of the new proxy.
+			*/
+			int createProxy(const AABB &box, void *userData);
+			
+			/**
+			* Removes a proxy from the tree.
+			*/
+			void destroyProxy(int proxyId);
+			
+			/**
+			* Updates the bounds of a proxy. The proxy is only reinserted if the new bounds leave its enlarged box.
+			* @return True if the proxy had to be reinserted.
+			*/
+			bool moveProxy(int proxyId, const AABB &box);
+			
+			void *getUserData(int proxyId) const;
+			
+			/**
+			* Returns the bounds the proxy was last created or moved with.
+			*/
+			const AABB &getBounds(int proxyId) const;
+			
+			/**
+			* Removes all proxies.
+			*/
+			void clear();
+			
+			/**
+			* Appends the user data of all proxies intersecting a box to results.
+			*/
+			void queryBox(const AABB &box, std::vector<void*> &results) const;
+			
+			/**
+			* Appends the user data of all proxies intersecting a sphere to results.
+			*/
+			void querySphere(const Vector3 &center, Number radius, std::vector<void*> &results) const;
+			
+			/**
+			* Appends the user data of all proxies inside or intersecting the camera's frustum to results. The camera's frustum planes must be built.
+			*/
+			void queryFrustum(Camera *camera, std::vector<void*> &results) const;
+			
+			/**
+			* Appends the user data of all proxies hit by a ray to results.
+			* @param origin Origin of the ray.
+			* @param direction Direction of the ray. Distances are measured in multiples of this vector.
+			* @param maxDistance Farthest distance along the ray to test.
+			*/
+			void queryRay(const Vector3 &origin, const Vector3 &direction, Number maxDistance, std::vector<void*> &results) const;
+			
+			unsigned int getProxyCount() const;
+			
+			/**
+			* Returns the height of the tree, 0 for a single proxy.
+			*/
+			int getHeight() const;
+			
+			/**
+			* Minimum amount proxy boxes are enlarged by on every side. The box is additionally enlarged by a tenth of its size. Defaults to 0.1.
+			*/
+			Number margin;
+			
+		protected:
+		
+			class AABBTreeNode {
+				public:
+					AABB fatBox;
+					AABB box;
+					void *userData;
+					int parent;
+					int child1;
+					int child2;
+					// -1 for free nodes, 0 for leaves
+					int height;
+					
+					bool isLeaf() const { return child1 == -1; }
+			};
+			
+			int allocateNode();
+			void freeNode(int nodeId);
+			void insertLeaf(int leaf);
+			void removeLeaf(int leaf);
+			int balance(int nodeId);
+			void refit(int nodeId);
+			AABB fatten(const AABB &box) const;
+			
+			std::vector<AABBTreeNode> nodes;
+			int root;
+			int freeList;
+			unsigned int proxyCount;
+			
+			mutable std::vector<int> queryStack;
+	};
+}
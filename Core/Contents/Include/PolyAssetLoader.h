@@ -0,0 +1,369 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyString.h"
+#include "PolyEvent.h"
+#include "PolyEventDispatcher.h"
+#include "PolyThreaded.h"
+#include <vector>
+#include <deque>
+
+class TiXmlDocument;
+
+namespace Polycode {
+
+	class AssetLoader;
+	class AssetRequest;
+	class Core;
+	class CoreMutex;
+	class Image;
+	class Material;
+	class Mesh;
+	class Sound;
+	class Texture;
+	
+	/**
+	* Event dispatched by an asset request when it makes progress, finishes loading or fails.
+	*/
+	class _PolyExport AssetEvent : public Event {
+		public:
+			AssetEvent();
+			virtual ~AssetEvent();
+			
+			/**
+			* The request that dispatched the event.
+			*/
+			AssetRequest *request;
+			
+			/**
+			* Progress of the request, from 0 to 1.
+			*/
+			Number progress;
+			
+			static const int EVENTBASE_ASSETEVENT = 0xD00;
+			
+			/**
+			* Dispatched on the main thread when the request finished decoding and is waiting for its main thread stage.
+			*/
+			static const int EVENT_ASSET_PROGRESS = EVENTBASE_ASSETEVENT+0;
+			
+			/**
+			* Dispatched when the asset is loaded and ready to use.
+			*/
+			static const int EVENT_ASSET_LOADED = EVENTBASE_ASSETEVENT+1;
+			
+			/**
+			* Dispatched when the asset could not be loaded.
+			*/
+			static const int EVENT_ASSET_FAILED = EVENTBASE_ASSETEVENT+2;
+	};
+	
+	/**
+	* Handle to an asset that is being loaded by the AssetLoader. Add event listeners for the AssetEvent codes to be notified when the asset is loaded, or poll isDone(). All events are dispatched on the main thread.
+	*
+	* Requests are owned by the asset loader. Call AssetLoader::releaseRequest() when you no longer need the handle; the loaded asset itself is not deleted with it.
+	*/
+	class _PolyExport AssetRequest : public EventDispatcher {
+		public:
+			AssetRequest(int assetType, const String& path);
+			virtual ~AssetRequest();
+			
+			/**
+			* Returns the type of the requested asset, one of the ASSET_ constants.
+			*/
+			int getAssetType() const;
+			
+			/**
+			* Returns the path of the requested file.
+			*/
+			const String& getPath() const;
+			
+			/**
+			* Returns the loading state of the request, one of the STATE_ constants.
+			*/
+			int getState() const;
+			
+			/**
+			* Returns the loading progress of the request, from 0 to 1.
+			*/
+			Number getProgress() const;
+			
+			/**
+			* Returns true if the request has finished, whether it succeeded or failed.
+			*/
+			bool isDone() const;
+			
+			/**
+			* Returns true if the asset was loaded successfully.
+			*/
+			bool isLoaded() const;
+			
+			/**
+			* Returns the loaded texture for ASSET_TEXTURE requests. Failed texture requests return the default texture.
+			*/
+			Texture *getTexture();
+			
+			/**
+			* Returns the loaded mesh for ASSET_MESH requests. The mesh is not owned by the loader.
+			*/
+			Mesh *getMesh();
+			
+			/**
+			* Returns the loaded sound for ASSET_SOUND requests. The sound is not owned by the loader.
+			*/
+			Sound *getSound();
+			
+			/**
+			* Returns the number of materials loaded by an ASSET_MATERIALS request.
+			*/
+			unsigned int getNumMaterials();
+			
+			/**
+			* Returns a material loaded by an ASSET_MATERIALS request.
+			*/
+			Material *getMaterial(unsigned int index);
+			
+			/**
+			* Returns the decoded image of an ASSET_TEXTURE request that finished decoding but has not been uploaded yet. The image is deleted once the texture is created.
+			*/
+			Image *getDecodedImage();
+			
+			/**
+			* Returns the parsed material file of an ASSET_MATERIALS request that finished decoding but has not been turned into materials yet.
+			*/
+			TiXmlDocument *getDecodedDocument();
+			
+			/**
+			* Clamp the texture created by an ASSET_TEXTURE request.
+			*/
+			bool clamp;
+			
+			/**
+			* Create mipmaps for the texture created by an ASSET_TEXTURE request.
+			*/
+			bool createMipmaps;
+			
+			/**
+			* Create a vertex buffer for the mesh loaded by an ASSET_MESH request.
+			*/
+			bool useVertexBuffer;
+			
+			/**
+			* Premultiply the alpha of the image decoded by an ASSET_TEXTURE request. Set from MaterialManager::premultiplyAlphaOnLoad when the request is made.
+			*/
+			bool premultiplyAlpha;
+			
+			static const int ASSET_TEXTURE = 0;
+			static const int ASSET_MESH = 1;
+			static const int ASSET_SOUND = 2;
+			static const int ASSET_MATERIALS = 3;
+			
+			static const int STATE_QUEUED = 0;
+			static const int STATE_DECODING = 1;
+			static const int STATE_DECODED = 2;
+			static const int STATE_LOADED = 3;
+			static const int STATE_FAILED = 4;
+			
+			/**
+			* The file could not be decoded. The request is reported as failed, and becomes STATE_FAILED, when the main thread finishes it.
+			*/
+			static const int STATE_DECODE_FAILED = 5;
+			
+		protected:
+		
+			friend class AssetLoader;
+			
+			int assetType;
+			String path;
+			volatile int state;
+			bool released;
+			bool synchronous;
+			
+			// decoded on a worker thread
+			Image *image;
+			Mesh *mesh;
+			std::vector<char> soundData;
+			int soundChannels;
+			int soundFrequency;
+			TiXmlDocument *document;
+			
+			// created on the main thread
+			Texture *texture;
+			Sound *sound;
+			std::vector<Material*> materials;
+	};
+	
+	/**
+	* Worker thread of the asset loader.
+	*/
+	class _PolyExport AssetLoaderWorker : public Threaded {
+		public:
+			AssetLoaderWorker(AssetLoader *loader);
+			virtual ~AssetLoaderWorker();
+			
+			void runThread();
+			void updateThread();
+			
+			/**
+			* Set by the worker once its thread has stopped running.
+			*/
+			volatile bool threadStopped;
+			
+		protected:
+			AssetLoader *loader;
+	};
+	
+	/**
+	* Loads textures, meshes, sounds and material files in the background. Loading an asset has two stages. Reading and decoding the file (PNG decoding, mesh parsing, OGG decoding, XML parsing) runs on a pool of worker threads created with Core::createThread(). Creating the GPU and audio objects for decoded assets runs on the main thread in Update(), which stops starting new uploads once it has spent the upload budget of the frame, so loading a level does not freeze the game.
+	*
+	* The decode stage does not touch the renderer, so decodeRequest() can be called directly without a graphics context. If the worker count is 0, requests are decoded on the main thread in Update() instead.
+	*
+	* This class should be only accessed from the CoreServices singleton.
+	*/
+	class _PolyExport AssetLoader : public PolyBase {
+		public:
+			AssetLoader();
+			~AssetLoader();
+			
+			/**
+			* Starts loading a PNG texture. If a texture with the same path is already loaded, the request finishes with it without decoding the file again.
+			* @param fileName Path to the image file.
+			* @param clamp Clamp the texture.
+			* @param createMipmaps Create mipmaps for the texture.
+			* @return Handle to the request.
+			*/
+			AssetRequest *loadTexture(const String& fileName, bool clamp=false, bool createMipmaps=true);
+			
+			/**
+			* Starts loading a mesh file.
+			* @param fileName Path to the mesh file.
+			* @param useVertexBuffer If true, a vertex buffer is created for the mesh on the main thread.
+			* @return Handle to the request.
+			*/
+			AssetRequest *loadMesh(const String& fileName, bool useVertexBuffer=false);
+			
+			/**
+			* Starts loading a sound. OGG files are decoded on a worker thread, other sound files are loaded on the main thread.
+			* @param fileName Path to the sound file.
+			* @return Handle to the request.
+			*/
+			AssetRequest *loadSound(const String& fileName);
+			
+			/**
+			* Starts loading the materials of a material file. The materials are added to the resource manager and the material manager once loaded.
+			* @param fileName Path to the material file.
+			* @return Handle to the request.
+			*/
+			AssetRequest *loadMaterials(const String& fileName);
+			
+			/**
+			* Releases a request handle. A request that is still being decoded is deleted once its worker is done with it.
+			*/
+			void releaseRequest(AssetRequest *request);
+			
+			/**
+			* Runs the main thread stage of decoded requests until the upload budget is spent and dispatches their events. Called by CoreServices every frame.
+			*/
+			void Update();
+			
+			/**
+			* Reads and decodes the file of a request. This is the worker thread stage of loading and never uses the renderer or the sound device.
+			* @return True if the file was decoded.
+			*/
+			static bool decodeRequest(AssetRequest *request);
+			
+			/**
+			* Decodes a batch of requests on the worker threads and the calling thread, and returns once all of them are decoded. The requests are not finished by Update(); the caller uses the decoded data and deletes the requests itself.
+			* @param batch Requests to decode. They must not have been passed to the loader before.
+			*/
+			void decodeBatch(const std::vector<AssetRequest*> &batch);
+			
+			/**
+			* Sets the time in milliseconds the main thread may spend creating textures, vertex buffers, sounds and materials per frame. At least one request is finished every frame. Defaults to 4.
+			*/
+			void setUploadBudget(Number milliseconds);
+			Number getUploadBudget() const;
+			
+			/**
+			* Sets the number of worker threads. The workers are started with the first request, so this has to be called before that. Defaults to 2.
+			*/
+			void setNumWorkers(int numWorkers);
+			int getNumWorkers() const;
+			
+			/**
+			* Returns the number of requests that have not finished yet.
+			*/
+			unsigned int getPendingCount() const;
+			
+			/**
+			* Returns the combined progress of all requests made since the loader was last idle, from 0 to 1.
+			*/
+			Number getProgress() const;
+			
+			/**
+			* Returns the next queued request for a worker, or NULL if there is none. Called by the worker threads.
+			*/
+			AssetRequest *takeRequest();
+			
+			/**
+			* Hands a decoded request back to the main thread. Called by the worker threads.
+			*/
+			void finishDecode(AssetRequest *request, bool decoded);
+			
+			/**
+			* Blocks a worker thread until a request is queued or the loader shuts down. Called by the worker threads.
+			*/
+			void waitForRequest();
+			
+		protected:
+		
+			AssetRequest *queueRequest(AssetRequest *request);
+			void startWorkers();
+			void finishRequest(AssetRequest *request);
+			void dispatchRequestEvent(AssetRequest *request, int eventCode);
+			void lockQueue();
+			void unlockQueue();
+			void signalWorkers(unsigned int count);
+		
+			// the queued and decoded queues are shared with the workers and guarded by queueMutex
+			Core *core;
+			CoreMutex *queueMutex;
+			std::deque<AssetRequest*> queuedRequests;
+			std::deque<AssetRequest*> decodedRequests;
+			std::deque<AssetRequest*> uploadQueue;
+			std::vector<AssetRequest*> requests;
+			std::vector<AssetLoaderWorker*> workers;
+			
+			// counts queued requests the sleeping workers have not been woken for yet
+			void *wakeMutex;
+			void *wakeCondition;
+			unsigned int wakeCount;
+			
+			int numWorkers;
+			Number uploadBudget;
+			unsigned int pendingCount;
+			unsigned int batchTotal;
+			unsigned int batchFinished;
+	};
+}
@@ -28,11 +28,40 @@
 
 namespace Polycode {
 
+	class AABB;
 	class Scene;
 	class Material;
 	class ShaderBinding;
 	class Texture;
 
+	/**
+	* Frustum culling counters for a single render pass of a camera.
+	*/
+	class _PolyExport CullingStats : public PolyBase {
+		public:
+			CullingStats();
+			
+			/**
+			* Sets all counters to zero.
+			*/
+			void reset();
+			
+			/**
+			* Number of entities that were tested against the frustum.
+			*/
+			unsigned int entitiesVisited;
+			
+			/**
+			* Number of entities that were rejected by the frustum. An entity whose whole subtree is rejected counts once, and its children are not visited.
+			*/
+			unsigned int entitiesCulled;
+			
+			/**
+			* Number of entities that were rendered.
+			*/
+			unsigned int entitiesDrawn;
+	};
+
 	/**
 	* Camera in a 3D scene. Cameras can be added to a scene and changed between dynamically. You can also set a shader to a camera that will run as a screen shader for post-processing effects.
 	*/	
@@ -56,6 +85,14 @@ namespace Polycode {
 			* @see canSee()
 			*/								
 			bool isSphereInFrustum(Vector3 pos, Number fRadius);
+			
+			/**
+			* Checks if the camera can see an axis aligned box.
+			* @param box Box to check, in world space.
+			* @return Returns true if the box is inside or intersects the camera's frustum, or false if it isn't.
+			* @see isSphereInFrustum()
+			*/
+			bool isAABBInFrustum(const AABB &box);
 		
 			/**
 			* Checks if the camera can see an entity based on its bounding radius.
@@ -156,6 +193,11 @@ namespace Polycode {
 			* Toggles the frustum culling of the camera. (Defaults to true).
 			*/
 			bool frustumCulling;
+			
+			/**
+			* Culling counters from the last scene render pass with this camera.
+			*/
+			CullingStats cullingStats;
 		
 			/**
 			* Shifts camera frustum by factor of the frustum size. (x=-1 will shift the frustum to the left by a whole screen width).
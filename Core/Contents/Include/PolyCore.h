@@ -285,7 +285,7 @@ namespace Polycode {
 		* Returns the time elapsed since last frame.
 		* @return Time elapsed since last frame in floating point microseconds.
 		*/
-		Number getElapsed();	
+		virtual Number getElapsed();	
 		
 		/**
 		* Returns the total ticks elapsed since launch.
@@ -393,6 +393,7 @@ namespace Polycode {
 		unsigned int lastSleepFrameTicks;
 		
 		std::vector<Threaded*> threads;
+		std::vector<Threaded*> dispatchThreads;
 		CoreMutex *threadedEventMutex;
 		
 		int xRes;
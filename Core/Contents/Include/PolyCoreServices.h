@@ -38,10 +38,13 @@ namespace Polycode {
 	class TimerManager;
 	class TweenManager;
 	class ResourceManager;
+	class AssetLoader;
+	class JobSystem;
 	class SoundManager;
 	class Core;
 	class CoreMutex;
 	class Logger;
+	class Profiler;
 	
 	/**
 	* Global services singleton. CoreServices instantiates and provides global Singleton access to all of the main manager classes in Polycode as well as the Renderer and Config classes.
@@ -133,6 +136,20 @@ namespace Polycode {
 			*/																					
 			ResourceManager *getResourceManager();
 			
+			/**
+			* Returns the asset loader. The asset loader loads textures, meshes, sounds and materials in the background.
+			* @return Asset Loader
+			* @see AssetLoader
+			*/
+			AssetLoader *getAssetLoader();
+			
+			/**
+			* Returns the job system. The job system runs short jobs across its worker threads. Jobs created during a frame are waited for at the start of the next update.
+			* @return Job System
+			* @see JobSystem
+			*/
+			JobSystem *getJobSystem();
+			
 			/**
 			* Returns the sound manager. The sound manager is responsible for loading and playing sounds.
 			* @return Sound Manager
@@ -151,6 +168,13 @@ namespace Polycode {
 			* Returns the logger. It can log messages and broadcast them to listeners.
 			*/
 			Logger *getLogger();
+			
+			/**
+			* Returns the frame profiler. It is disabled by default and records how long the engine spends in each zone of a frame when enabled.
+			* @return Profiler.
+			* @see Profiler
+			*/
+			Profiler *getProfiler();
 
 			/**
 			* Returns the config. The config loads and saves data to disk.
@@ -185,9 +209,12 @@ namespace Polycode {
 			ScreenManager *screenManager;		
 			SceneManager *sceneManager;
 			Logger *logger;
+			Profiler *profiler;
 			TimerManager *timerManager;
 			TweenManager *tweenManager;
 			ResourceManager *resourceManager;
+			AssetLoader *assetLoader;
+			JobSystem *jobSystem;
 			SoundManager *soundManager;
 			FontManager *fontManager;
 			Renderer *renderer;
@@ -32,7 +32,9 @@
 
 namespace Polycode {
 
+	class Material;
 	class Renderer;
+	class Texture;
 
 	class _PolyExport EntityProp {
 	public:
@@ -76,6 +78,16 @@ namespace Polycode {
 			virtual void Update(){};			
 
 			virtual void transformAndRender();		
+			
+			/**
+			* Returns the material the entity renders with, if any. Render queues use it to group entities with the same material.
+			*/
+			virtual Material *getRenderMaterial() { return NULL; }
+			
+			/**
+			* Returns the texture the entity renders with, if any. Render queues use it to group entities with the same texture.
+			*/
+			virtual Texture *getRenderTexture() { return NULL; }
 
 			void renderChildren();					
 		
@@ -112,7 +124,7 @@ namespace Polycode {
 			void rebuildTransformMatrix();
 
 			/**
-			* Forces the matrix to be rebuilt if the matrix flag is dirty. This is also called on all of the entity's children.
+			* Forces the matrix to be rebuilt if the matrix flag is dirty. This is also called on all of the entity's children in a single top-down pass that refreshes their cached world matrix, combined color and compound scale. The world space bounds of the entity and its children are updated as well.
 			*/
 			void updateEntityMatrix();
 			
@@ -123,7 +135,7 @@ namespace Polycode {
 			const Matrix4& getTransformMatrix() const;
 			
 			/** 
-			* Returns the entity's matrix multiplied by its parent's concatenated matrix. This, in effect, returns the entity's actual world transformation.
+			* Returns the entity's matrix multiplied by its parent's concatenated matrix. This, in effect, returns the entity's actual world transformation. The result is cached and only recomputed when the entity's or one of its ancestors' transforms change.
 			@return Entity's concatenated matrix.
 			*/
 			Matrix4 getConcatenatedMatrix();
@@ -508,6 +520,21 @@ namespace Polycode {
 			*/
 			void setBBoxRadius(Number rad);		
 			
+			/**
+			* Returns the center of the entity's world space bounding sphere. This is the entity's world position, as of the last call to updateEntityMatrix().
+			*/
+			Vector3 getWorldBoundsCenter() const;
+			
+			/**
+			* Returns the radius of the entity's own world space bounding sphere, which is its bounding box radius scaled by its world transform.
+			*/
+			Number getWorldBoundsRadius() const;
+			
+			/**
+			* Returns the radius of a sphere around getWorldBoundsCenter() that contains the entity and all of its children. If this is 0, the subtree has no bounds and is never culled.
+			*/
+			Number getSubtreeBoundsRadius() const;
+			
 					
 
 			//@}			
@@ -677,6 +704,12 @@ namespace Polycode {
 			std::vector<String> *tags;
 		
 			void checkTransformSetters();
+			void updateWorldBounds();
+			
+			void dirtyWorldState(bool matrixChanged, bool colorChanged);
+			void updateWorldState();
+			void rebuildWorldState();
+			void rebuildWorldRollMatrix();
 		
 			void *userData;
 		
@@ -694,7 +727,27 @@ namespace Polycode {
 			bool lockMatrix;
 			bool matrixDirty;
 			Matrix4 transformMatrix;		
-			Number matrixAdj;		
+			Number matrixAdj;
+			
+			bool boundsDirty;
+			bool boundsFollowWorld;
+			Matrix4 boundsMatrix;
+			Vector3 worldBoundsCenter;
+			Number worldBoundsRadius;
+			Number subtreeBoundsRadius;
+			Number lastBBoxRadius;
+			
+			bool worldMatrixDirty;
+			bool worldRollDirty;
+			bool worldColorDirty;
+			Matrix4 worldMatrix;
+			Matrix4 worldRollMatrix;
+			Vector3 worldScale;
+			Vector3 worldPosition;
+			Color worldColor;
+			Color _color;
+			bool _colorAffectsChildren;
+		
 			Entity *parentEntity;
 		
 			Renderer *renderer;
@@ -23,6 +23,7 @@ THE SOFTWARE.
 #pragma once
 #include "PolyGlobals.h"
 #include "PolyString.h"
+#include <stddef.h>
 
 namespace Polycode {
 
@@ -45,6 +46,12 @@ namespace Polycode {
 			Event(int eventCode);
 			virtual ~Event();
 			
+			/**
+			* Events allocated on the heap are counted in the event stats of EventDispatcher. Events that are dispatched often should be created on the stack and dispatched with EventDispatcher::dispatchEventNoDelete() instead.
+			*/
+			static void *operator new(size_t size);
+			static void operator delete(void *pointer);
+			
 			/**
 			* Returns the event code for this event.
 			* @return Event code for the event.
@@ -76,6 +83,7 @@ namespace Polycode {
 			// PhysicsSceneEvent	0x900
 			// UIEvent		0xA00
 			// UITreeEvent	0xB00
+			// AssetEvent	0xD00
 		
 			static const int EVENTBASE_EVENT = 0x100;
 			static const int COMPLETE_EVENT = EVENTBASE_EVENT+0;
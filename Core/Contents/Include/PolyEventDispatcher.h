@@ -25,15 +25,39 @@ THE SOFTWARE.
 #include "PolyGlobals.h"
 #include "PolyEventHandler.h"
 #include <vector>
+#include <map>
 
 namespace Polycode {
 
 	class Event;
 
-typedef struct {
-	EventHandler *handler;
-	int eventCode;
-} EventEntry;
+	/**
+	* Event system counters for a frame.
+	*/
+	class _PolyExport EventStats : public PolyBase {
+		public:
+			EventStats();
+			
+			/**
+			* Sets all counters to zero.
+			*/
+			void reset();
+			
+			/**
+			* Number of events dispatched.
+			*/
+			unsigned int dispatches;
+			
+			/**
+			* Number of handler callbacks made.
+			*/
+			unsigned int handlerCalls;
+			
+			/**
+			* Number of events allocated on the heap.
+			*/
+			unsigned int eventAllocations;
+	};
 
 	/**
 	* Can dispatch events. The event dispatcher is base class which allows its subclass to dispatch custom events which EventHandler subclasses can then listen to. EventDispatcher and EventHandler are the two main classes in the Polycode event system. If you are familiar with ActionScript3's event system, you will find this to be very similar, except that it uses integers for event codes for speed, rather than strings.
@@ -83,11 +107,50 @@ typedef struct {
 			* @see EventHandler			
 			*/														
 			virtual void dispatchEvent(Event *event, int eventCode);
+			
+			/**
+			* Dispatches an event without deleting it afterwards. Use this to dispatch events that live on the stack or are reused, which avoids allocating an event for every dispatch.
+			* @param event Event to dispatch.
+			* @param eventCode The event code to dispatch the event for.
+			*/
 			virtual void dispatchEventNoDelete(Event *event, int eventCode);
+			
+			/**
+			* Returns true if any handler is listening for an event code.
+			* @param eventCode Event code to check.
+			*/
+			bool hasEventListener(int eventCode) const;
+			
+			/**
+			* Returns the event counters of the current frame. Only events on the main thread are counted reliably.
+			*/
+			static const EventStats &getFrameStats();
+			
+			/**
+			* Returns the event counters of the last completed frame.
+			*/
+			static const EventStats &getLastFrameStats();
+			
+			/**
+			* Completes the event counters of the current frame and starts counting the next frame. This is called by the core at the start of every update.
+			*/
+			static void endFrameStats();
+			
+			POLYIGNORE static void countEventAllocation();
 		
 		protected:
-	
-		std::vector<EventEntry> handlerEntries;
+		
+		/**
+		* Handlers by event code. Handlers removed during a dispatch are set to NULL and erased once the dispatch has finished.
+		*/
+		std::map<int, std::vector<EventHandler*> > handlerTables;
+		int dispatchDepth;
+		bool handlersRemoved;
+		
+		void compactHandlerTables();
+		
+		static EventStats frameStats;
+		static EventStats lastFrameStats;
 	
 	};
 }
@@ -24,12 +24,14 @@ THE SOFTWARE.
 #include "PolyGlobals.h"
 #include "ft2build.h"
 #include "PolyString.h"
+#include <map>
 
 #include FT_FREETYPE_H
 
 namespace Polycode {
 	
 	class String;
+	class GlyphAtlas;
 
 	class _PolyExport Font : public PolyBase {
 		public:
@@ -43,6 +45,14 @@ namespace Polycode {
 			String getFontName();			
 			String getFontPath();
 			
+			/**
+			* Returns the shared glyph atlas for a size and antialiasing mode, creating it on first use. The atlas is owned by the font.
+			* @param size Size in pixels.
+			* @param antiAliasMode Anti-aliasing mode, see Label.
+			* @param premultiplyAlpha If true, the atlas stores premultiplied pixels.
+			*/
+			GlyphAtlas *getGlyphAtlas(int size, int antiAliasMode, bool premultiplyAlpha);
+			
 			bool loaded;
 		protected:
 		
@@ -52,5 +62,7 @@ namespace Polycode {
 			unsigned char *buffer;
 			bool valid;
 			FT_Face ftFace;
+			
+			std::map<int, GlyphAtlas*> glyphAtlases;
 	};
 }
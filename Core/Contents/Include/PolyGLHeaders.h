@@ -115,3 +115,14 @@ typedef GLEEPFNGLGETACTIVEUNIFORMPROC PFNGLGETACTIVEUNIFORMPROC;
 #include <GL/wglext.h>
 #endif
 #endif
+
+// matrix entry points that take the precision of Number
+#ifdef POLYCODE_NUMBER_IS_SINGLE
+#define glLoadMatrixNumber glLoadMatrixf
+#define glMultMatrixNumber glMultMatrixf
+#define glGetNumberv glGetFloatv
+#else
+#define glLoadMatrixNumber glLoadMatrixd
+#define glMultMatrixNumber glMultMatrixd
+#define glGetNumberv glGetDoublev
+#endif
@@ -126,6 +126,7 @@ namespace Polycode {
 		void pushRenderDataArray(RenderDataArray *array);
 		RenderDataArray *createRenderDataArrayForMesh(Mesh *mesh, int arrayType);
 		RenderDataArray *createRenderDataArray(int arrayType);
+		void updateRenderDataArraysForMesh(Mesh *mesh, bool *updateMap);
 		void setRenderArrayData(RenderDataArray *array, Number *arrayData);
 		void drawArrays(int drawType);		
 				
@@ -201,6 +202,9 @@ namespace Polycode {
 		Number farPlane;
 		
 		int verticesToDraw;
+		int indicesToDraw;
+		int indexSize;
+		void *indexArrayPtr;
 		
 		GLdouble sceneProjectionMatrix[16];
 		GLdouble sceneProjectionMatrixOrtho[16];	
@@ -50,6 +50,7 @@ namespace Polycode {
 			virtual ~OpenGLTexture();
 			
 			void recreateFromImageData();
+			void setMipmaps(Image *image);
 
 			GLuint getTextureID();
 			GLuint getFrameBufferID();
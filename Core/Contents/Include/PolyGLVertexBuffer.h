@@ -50,14 +50,30 @@ namespace Polycode {
 		GLuint getNormalBufferID();
 		GLuint getColorBufferID();
 		GLuint getTangentBufferID();
+		GLuint getIndexBufferID();
+		
+		/**
+		* Returns the number of indices in the index buffer, or 0 if the buffer was created from a non-indexed mesh.
+		*/
+		int getIndexCount();
+		
+		/**
+		* Returns the GL type of the indices in the index buffer.
+		*/
+		GLenum getIndexType();
 				
 	protected:
 		
+		void createIndexedBuffers(Mesh *mesh);
+		
 		GLuint vertexBufferID;
 		GLuint texCoordBufferID;
 		GLuint normalBufferID;
 		GLuint colorBufferID;	
 		GLuint tangentBufferID;				
+		GLuint indexBufferID;
+		int indexCount;
+		GLenum indexType;
 	};
 	
 }
@@ -78,7 +78,12 @@ THE SOFTWARE.
 	#define PLATFORM PLATFORM_UNIX
 #endif
 
+// Number is the scalar type of the math classes. Define POLYCODE_NUMBER_IS_SINGLE (the POLYCODE_NUMBER_IS_SINGLE CMake option) to use single precision, which also enables the SIMD math paths.
+#ifdef POLYCODE_NUMBER_IS_SINGLE
+typedef float Number;
+#else
 typedef double Number;
+#endif
 
 #define RANDOM_NUMBER ((Number)rand()/(Number)RAND_MAX)
 
@@ -0,0 +1,138 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyFont.h"
+#include <map>
+
+#include FT_GLYPH_H
+
+namespace Polycode {
+
+	class Image;
+	class Texture;
+
+	/**
+	* A glyph stored in a GlyphAtlas. All values are in pixels.
+	*/
+	class _PolyExport AtlasGlyph {
+		public:
+			AtlasGlyph();
+			
+			/**
+			* FreeType glyph index.
+			*/
+			FT_UInt glyphIndex;
+			
+			/**
+			* Horizontal pen advance.
+			*/
+			int advance;
+			
+			/**
+			* Grid fitted outline box relative to the pen position, with y pointing up.
+			*/
+			int xMin, yMin, xMax, yMax;
+			
+			/**
+			* Offset of the bitmap's top left corner from the pen position, with y pointing up.
+			*/
+			int left, top;
+			
+			/**
+			* Size of the bitmap. Blank glyphs like the space have a size of 0.
+			*/
+			int width, height;
+			
+			/**
+			* Bottom left corner of the bitmap in the atlas image.
+			*/
+			int x, y;
+			
+			bool loaded;
+	};
+
+	/**
+	* Texture atlas of rendered glyphs for one font, size and antialiasing mode. Each glyph is rasterized once, the first time a label asks for it, and all labels using the same settings draw textured quads from the shared atlas texture. Atlases are owned by their font, use Font::getGlyphAtlas() to get one.
+	*/
+	class _PolyExport GlyphAtlas : public PolyBase {
+		public:
+			GlyphAtlas(Font *font, int size, int antiAliasMode, bool premultiplyAlpha);
+			virtual ~GlyphAtlas();
+			
+			/**
+			* Returns the glyph for a character, rasterizing it into the atlas if it is not there yet.
+			* @param charCode Unicode character code.
+			* @return The glyph or NULL if the font could not load it.
+			*/
+			const AtlasGlyph *getGlyph(FT_ULong charCode);
+			
+			/**
+			* Returns the horizontal kerning between two glyphs in pixels.
+			*/
+			int getKerning(FT_UInt leftGlyph, FT_UInt rightGlyph);
+			
+			/**
+			* Returns the atlas texture, uploading any glyphs added since the last call. The texture is owned by the MaterialManager and must not be deleted by labels.
+			*/
+			Texture *getTexture();
+			
+			/**
+			* Returns the atlas image.
+			*/
+			Image *getImage();
+			
+			/**
+			* Returns a counter that changes every time the atlas image grows. Growing changes the texture coordinates of every glyph, so meshes built from an earlier generation need to be rebuilt.
+			*/
+			unsigned int getGeneration() const;
+			
+			int getSize() const;
+			int getAntialiasMode() const;
+			bool getPremultiplyAlpha() const;
+			
+		protected:
+		
+			bool packGlyph(AtlasGlyph *glyph, FT_Bitmap *bitmap);
+			bool growImage();
+		
+			Font *font;
+			int size;
+			int antiAliasMode;
+			bool premultiplyAlpha;
+			bool useKerning;
+			
+			Image *image;
+			Texture *texture;
+			bool textureDirty;
+			unsigned int generation;
+			
+			int shelfX;
+			int shelfY;
+			int shelfHeight;
+			
+			std::map<FT_ULong, AtlasGlyph> glyphs;
+			std::map<std::pair<FT_UInt, FT_UInt>, int> kerning;
+	};
+
+}
@@ -0,0 +1,119 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyCore.h"
+#include <vector>
+
+namespace Polycode {
+
+	class _PolyExport HeadlessCoreMutex : public CoreMutex {
+	public:
+		void *nativeMutex;
+	};
+
+	/**
+	* A core without a window, input or graphics API. It advances time by a fixed timestep on every update instead of reading the system clock and never sleeps, so each run steps CoreServices through exactly the same sequence of frames no matter how fast the machine is. Use it with a NullRenderer or RecordingRenderer to run, test and benchmark scenes and screens on machines without a GPU or a display.
+	*
+	* @see NullRenderer
+	*/
+	class _PolyExport HeadlessCore : public Core {
+	public:
+		/**
+		* Constructor.
+		* @param xRes Horizontal resolution of the renderer.
+		* @param yRes Vertical resolution of the renderer.
+		* @param frameRate Frames per second of simulated time. The fixed timestep is 1/frameRate seconds.
+		* @param renderer Renderer to use. The core takes ownership of it. If NULL, a RecordingRenderer is created.
+		*/
+		HeadlessCore(int xRes, int yRes, int frameRate = 60, Renderer *renderer = NULL);
+		virtual ~HeadlessCore();
+		
+		/**
+		* Advances the simulated time by one timestep and updates the core services.
+		*/
+		bool Update();
+		
+		/**
+		* Renders a frame with the core services.
+		*/
+		void Render();
+		
+		/**
+		* Updates and renders a number of frames.
+		* @param frameCount Number of frames to run.
+		* @return False if the core was shut down before all frames ran.
+		*/
+		bool runFrames(int frameCount);
+		
+		/**
+		* Sets the amount of simulated time each update advances.
+		* @param timestep Timestep in seconds.
+		*/
+		void setFixedTimestep(Number timestep);
+		
+		/**
+		* Returns the amount of simulated time each update advances, in seconds.
+		*/
+		Number getFixedTimestep() const;
+		
+		/**
+		* Returns the number of updates since the core was created.
+		*/
+		unsigned int getFrameCount() const;
+		
+		/**
+		* Returns the simulated time since the core was created, in milliseconds.
+		*/
+		unsigned int getTicks();
+		
+		/**
+		* Returns the fixed timestep once the first update ran. The millisecond ticks are rounded down, so the time between them alternates around the timestep.
+		*/
+		Number getElapsed();
+		
+		void setCursor(int cursorType);
+		void createThread(Threaded *target);
+		void lockMutex(CoreMutex *mutex);
+		void unlockMutex(CoreMutex *mutex);
+		CoreMutex *createMutex();
+		void copyStringToClipboard(const String& str);
+		String getClipboardString();
+		void createFolder(const String& folderPath);
+		void copyDiskItem(const String& itemPath, const String& destItemPath);
+		void moveDiskItem(const String& itemPath, const String& destItemPath);
+		void removeDiskItem(const String& itemPath);
+		String openFolderPicker();
+		std::vector<String> openFilePicker(std::vector<CoreFileExtension> extensions, bool allowMultiple);
+		void setVideoMode(int xRes, int yRes, bool fullScreen, bool vSync, int aaLevel, int anisotropyLevel);
+		void resizeTo(int xRes, int yRes);
+		void openURL(String url);
+		String executeExternalCommand(String command, String args, String inDirectory);
+		
+	protected:
+		Number fixedTimestep;
+		double simulatedTime;
+		unsigned int frameCount;
+		String clipboardString;
+	};
+}
@@ -82,6 +82,23 @@ namespace Polycode {
 			bool loadImage(const String& fileName);
 			bool loadPNG(const String& fileName);
 			
+			/**
+			* Loads a cooked texture file written by saveCooked(). Cooked files hold raw pixels and mipmaps, so no decoding is needed. Files on disk are memory mapped.
+			* @param fileName Path to the cooked file.
+			* @param sourceFileName If not empty and the file is on disk, loading fails if it has changed since the cooked file was written.
+			* @return True if successfully loaded, false otherwise.
+			*/
+			bool loadCooked(const String& fileName, const String& sourceFileName = "");
+			
+			/**
+			* Saves the image and its mipmaps as a cooked texture file.
+			* @param fileName Path to file to save to.
+			* @param sourceFileName File the image was decoded from. Its size and modification time are stored so that loadCooked() can detect stale files.
+			* @param compress If true, the pixel data is deflate compressed.
+			* @return True if successfully saved, false otherwise.
+			*/
+			bool saveCooked(const String& fileName, const String& sourceFileName = "", bool compress = false);
+			
 			/**
 			* Saves the image to a file. Currently only PNG files are supported.
 			* @param fileName Path to image file to load.	
@@ -262,7 +279,46 @@ namespace Polycode {
 			*/						
 			char *getPixels();
 			
+			/**
+			* Multiplies the color of every pixel and mipmap by its alpha. Only works on RGBA images.
+			*/
 			void premultiplyAlpha();
+			
+			/**
+			* Returns true if premultiplyAlpha() was applied to the pixels.
+			*/
+			bool isPremultiplied() const;
+			
+			/**
+			* Builds a box filtered mipmap chain down to 1x1 pixels. Only works on RGBA images. The mipmaps are not updated if the image is changed afterwards.
+			*/
+			void generateMipmaps();
+			
+			/**
+			* Removes the mipmap chain.
+			*/
+			void clearMipmaps();
+			
+			/**
+			* Returns the number of mipmap levels, not counting the image itself.
+			*/
+			int getNumMipmaps() const;
+			
+			/**
+			* Returns the raw pixels of a mipmap level.
+			* @param level Mipmap level. Level 0 is half the size of the image.
+			*/
+			char *getMipmap(int level);
+			
+			/**
+			* Returns the width of a mipmap level.
+			*/
+			int getMipmapWidth(int level) const;
+			
+			/**
+			* Returns the height of a mipmap level.
+			*/
+			int getMipmapHeight(int level) const;
 		
 			static const int IMAGE_RGB = 0;
 			static const int IMAGE_RGBA = 1;
@@ -271,6 +327,7 @@ namespace Polycode {
 		protected:
 		
 			void setPixelType(int type);
+			bool loadCookedData(const char *data, unsigned int size, const String& sourceFileName);
 
 			// transform coordinates from external topleft position mode
 			// to internal bottomleft position mode
@@ -291,6 +348,10 @@ namespace Polycode {
 		char *imageData;
 		int width;
 		int height;
+		
+		bool premultiplied;
+		char *mipmapData;
+		int numMipmaps;
 	};
 
 }
@@ -0,0 +1,192 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#pragma once
+#include "PolyGlobals.h"
+#include <vector>
+#include <deque>
+
+namespace Polycode {
+
+	class JobSystem;
+
+	typedef void (*JobFunction)(void *data);
+	typedef void (*JobRangeFunction)(void *data, unsigned int start, unsigned int end);
+
+	/**
+	* A unit of work run by the JobSystem. Jobs are created by the job system and stay valid until the next call to JobSystem::endFrame().
+	*/
+	class _PolyExport Job {
+		public:
+			Job();
+			
+			/**
+			* Returns true once the job and all of its children have finished.
+			*/
+			bool isFinished() const;
+			
+		protected:
+			friend class JobSystem;
+			
+			void reset();
+			
+			JobFunction function;
+			JobRangeFunction rangeFunction;
+			void *data;
+			unsigned int rangeStart;
+			unsigned int rangeEnd;
+			unsigned int grainSize;
+			
+			Job *parent;
+			volatile long unfinishedJobs;
+			volatile long pendingDependencies;
+			volatile long lock;
+			volatile long finished;
+			std::vector<Job*> dependents;
+	};
+	
+	/**
+	* Per worker queue of jobs ready to run. The owning thread pushes and pops at the back, other threads steal from the front.
+	*/
+	class _PolyExport JobQueue {
+		public:
+			JobQueue();
+			
+			std::deque<Job*> jobs;
+			volatile long lock;
+	};
+	
+	/**
+	* Thread of the job system.
+	*/
+	class _PolyExport JobWorker {
+		public:
+			JobSystem *jobSystem;
+			int queueIndex;
+			void *thread;
+	};
+	
+	/**
+	* Fixed-size work-stealing job scheduler. The job system starts its worker threads once and runs short jobs on them, instead of starting a thread per task. Jobs can have children, which they wait for before they count as finished, and dependencies, which have to finish before they are started. Threads waiting for a job run other queued jobs while they wait.
+	*
+	* Jobs are allocated from a pool that is recycled by endFrame(), so a job must not be used after the frame it was created in. CoreServices owns a job system and calls endFrame() at the start of every update. The job system does not depend on the core, so it can also be created and used on its own.
+	*/
+	class _PolyExport JobSystem : public PolyBase {
+		public:
+			/**
+			* Constructor.
+			* @param numWorkers Number of worker threads to start. If -1, one less than the number of processors is used, since the thread waiting for the jobs also runs them.
+			*/
+			JobSystem(int numWorkers = -1);
+			virtual ~JobSystem();
+			
+			/**
+			* Creates a job. The job is not run until it is passed to run().
+			* @param function Function to call.
+			* @param data Data passed to the function.
+			* @param parent If not NULL, the parent job does not finish before this job has finished. The child has to be created before the parent finishes.
+			* @return The new job.
+			*/
+			Job *createJob(JobFunction function, void *data, Job *parent = NULL);
+			
+			/**
+			* Creates a job that calls a function over a range of indices. The range is split in halves across the workers until the parts are no larger than the grain size.
+			* @param count Number of indices, the function is called with ranges between 0 and count.
+			* @param grainSize Smallest range worth running as a job of its own.
+			* @param function Function to call for each part of the range.
+			* @param data Data passed to the function.
+			* @param parent Optional parent job.
+			* @return The new job.
+			*/
+			Job *createRangeJob(unsigned int count, unsigned int grainSize, JobRangeFunction function, void *data, Job *parent = NULL);
+			
+			/**
+			* Makes a job wait for another job to finish before it is started. Must be called before the job is run.
+			* @param job Job that has to wait.
+			* @param dependency Job to wait for.
+			*/
+			void addDependency(Job *job, Job *dependency);
+			
+			/**
+			* Queues a job. It starts once all of its dependencies have finished.
+			*/
+			void run(Job *job);
+			
+			/**
+			* Runs queued jobs on the calling thread until the job has finished.
+			*/
+			void wait(Job *job);
+			
+			/**
+			* Calls a function over a range of indices across the workers and waits for it to finish.
+			* @see createRangeJob()
+			*/
+			void parallelFor(unsigned int count, unsigned int grainSize, JobRangeFunction function, void *data);
+			
+			/**
+			* Waits for all jobs that have been run and recycles the jobs created since the last call. Must be called from the thread that owns the job system, at a point where no other thread is creating jobs.
+			*/
+			void endFrame();
+			
+			/**
+			* Returns the number of worker threads.
+			*/
+			int getNumWorkers() const;
+			
+			/**
+			* Worker thread loop. Called by the job system's threads.
+			*/
+			void runWorker(JobWorker *worker);
+			
+			static const int JOB_BLOCK_SIZE = 1024;
+			static const int MAX_JOB_BLOCKS = 256;
+			static const int WORKER_SPIN_COUNT = 64;
+			
+		protected:
+		
+			Job *allocateJob();
+			void queueJob(Job *job);
+			Job *findJob(int queueIndex);
+			void executeJob(Job *job);
+			void finishJob(Job *job);
+			int getQueueIndex();
+			
+			std::vector<JobWorker*> workers;
+			JobQueue *queues;
+			int numQueues;
+			
+			Job *jobBlocks[MAX_JOB_BLOCKS];
+			volatile long numJobBlocks;
+			volatile long numAllocatedJobs;
+			volatile long jobPoolLock;
+			std::vector<Job*> overflowJobs;
+			
+			volatile long activeJobs;
+			volatile long queuedJobs;
+			volatile long sleepingWorkers;
+			volatile bool running;
+			
+			void *wakeMutex;
+			void *wakeCondition;
+			void *workerKey;
+	};
+}
@@ -33,6 +33,9 @@ THE SOFTWARE.
 namespace Polycode {
 
 	class Font;	
+	class Mesh;
+	class GlyphAtlas;
+	class AtlasGlyph;
 	
 	class GlyphData {
 		public:
@@ -56,10 +59,35 @@ namespace Polycode {
 			unsigned int rangeEnd;			
 	};
 
+	/**
+	* Position of one character in a label laid out from a GlyphAtlas.
+	*/
+	class LabelGlyph {
+		public:
+			FT_ULong charCode;
+			const AtlasGlyph *glyph;
+			unsigned int colorIndex;
+			int penX;
+			int advanceMultiplier;
+			
+			int nextPenX;
+			FT_UInt nextPrevious;
+			unsigned int nextColorIndex;
+	};
+
 	class _PolyExport Label : public Image {
 		public:
 			
-			Label(Font *font, const String& text, int size, int antiAliasMode, bool premultiplyAlpha = false);
+			/**
+			* Constructor.
+			* @param font Font to render with.
+			* @param text Text to display.
+			* @param size Size in pixels.
+			* @param antiAliasMode Anti-aliasing mode.
+			* @param premultiplyAlpha If true, rendered pixels are premultiplied.
+			* @param useGlyphAtlas If true, the label does not rasterize its text into its own image. Instead, it lays the text out from the font's shared GlyphAtlas and can be drawn as a mesh of textured quads, see updateGlyphMesh().
+			*/
+			Label(Font *font, const String& text, int size, int antiAliasMode, bool premultiplyAlpha = false, bool useGlyphAtlas = false);
 			virtual ~Label();
 			void setText(const String& text);
 			const String& getText() const;
@@ -99,8 +127,39 @@ namespace Polycode {
 			
 			int getBaselineAdjust();
 			
+			/**
+			* Returns the horizontal offset of the text's left edge from the pen origin in pixels.
+			*/
+			int getXAdjust();
+			
+			/**
+			* Returns true if the label lays out its text from a GlyphAtlas.
+			*/
+			bool usesGlyphAtlas() const;
+			
+			/**
+			* Returns the glyph atlas the current text was laid out with, or NULL if the label does not use one.
+			*/
+			GlyphAtlas *getGlyphAtlas();
+			
+			/**
+			* Writes the laid out text into an indexed quad mesh with one quad per character, textured from the glyph atlas. The mesh remembers what it was built from, so after setText() only the quads of characters past the unchanged start of the text are rewritten, and nothing is rewritten if nothing changed. Vertices are in pixels relative to the pen origin on the baseline, multiplied by scale and moved by the offset.
+			* @param mesh Mesh to write to. Its previous contents are replaced.
+			* @param scale Scale to multiply pixel positions by.
+			* @param offsetX Horizontal offset added after scaling.
+			* @param offsetY Vertical offset added after scaling.
+			* @param yUp If true, y points up like in 3D scenes, otherwise down like on the screen.
+			* @param tint Color multiplied with the color ranges. Only used if the label has color ranges, in which case the mesh uses vertex colors.
+			* @return True if the mesh was changed.
+			*/
+			bool updateGlyphMesh(Mesh *mesh, Number scale, Number offsetX, Number offsetY, bool yUp, Color tint);
+			
 		protected:
 		
+			void layoutGlyphs(GlyphAtlas *atlas, const std::wstring &wstr, std::vector<LabelGlyph> &glyphs, unsigned int start);
+			void computeLayoutBbox(const std::vector<LabelGlyph> &glyphs, FT_BBox *abbox);
+			void writeGlyphQuad(Mesh *mesh, unsigned int index, Number scale, Number offsetX, Number offsetY, bool yUp);
+		
 			bool _optionsChanged;
 			GlyphData labelData;
 	
@@ -115,6 +174,21 @@ namespace Polycode {
 			int size;
 			String text;
 			Font *font;
+			
+			bool useGlyphAtlas;
+			GlyphAtlas *glyphAtlas;
+			std::vector<LabelGlyph> glyphLayout;
+			
+			Mesh *glyphMesh;
+			unsigned int meshQuadCount;
+			unsigned int meshValidCount;
+			unsigned int meshGeneration;
+			Number meshScale;
+			Number meshOffsetX;
+			Number meshOffsetY;
+			bool meshYUp;
+			Color meshTint;
+			bool meshColorsDirty;
 	};
 
 }
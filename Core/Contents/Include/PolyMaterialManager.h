@@ -27,6 +27,7 @@ THE SOFTWARE.
 #include <vector>
 
 class TiXmlNode;
+class TiXmlDocument;
 
 namespace Polycode {
 	
@@ -57,6 +58,25 @@ namespace Polycode {
 			Texture *createNewTexture(int width, int height, bool clamp=false, bool createMipmaps = true, int type=Image::IMAGE_RGBA);
 			Texture *createTextureFromImage(Image *image, bool clamp=false, bool createMipmaps = true);
 			Texture *createTextureFromFile(const String& fileName, bool clamp=false, bool createMipmaps = true);
+			
+			/**
+			* Loads the image of a texture file. A cooked texture (.ptex) next to the file, as written by polybuild, is used in place of the file. If a texture cache folder is set, an up to date cooked copy from the cache is used, or the decoded image is cooked into the cache for the next load. Safe to call from worker threads.
+			* @param fileName Path to the image file.
+			* @param premultiply If true, the returned image has premultiplied alpha.
+			* @param createMipmaps If true, the image is cooked into the cache with a precomputed mipmap chain.
+			* @return The loaded image. Check Image::isLoaded() for errors.
+			*/
+			Image *loadTextureImage(const String& fileName, bool premultiply, bool createMipmaps);
+			
+			/**
+			* Sets the folder textures are cooked into by loadTextureImage(). The folder is created if needed. An empty string disables the cache, which is the default.
+			*/
+			void setTextureCacheFolder(const String& folder);
+			
+			/**
+			* Returns the texture cache folder.
+			*/
+			String getTextureCacheFolder() const;
 			void deleteTexture(Texture *texture);
 		
 			void reloadTextures();
@@ -87,6 +107,21 @@ namespace Polycode {
 			std::vector<Material*> loadMaterialsFromFile(String fileName);
 			std::vector<Shader*> loadShadersFromFile(String fileName);		
 			std::vector<Cubemap*> loadCubemapsFromFile(String fileName);	
+			
+			/**
+			* Creates the materials described by an already parsed material file.
+			*/
+			std::vector<Material*> materialsFromXMLDocument(TiXmlDocument *doc);
+			
+			/**
+			* Creates the shaders described by an already parsed material file.
+			*/
+			std::vector<Shader*> shadersFromXMLDocument(TiXmlDocument *doc);
+			
+			/**
+			* Creates the cubemaps described by an already parsed material file.
+			*/
+			std::vector<Cubemap*> cubemapsFromXMLDocument(TiXmlDocument *doc);
 						
 			void addMaterial(Material *material);
 			void addShader(Shader *shader);
@@ -102,6 +137,8 @@ namespace Polycode {
 			std::vector<Texture*> textures;
 			std::vector<Material*> materials;
 			std::vector<Shader*> shaders;
+			
+			String textureCacheFolder;
 		
 			std::vector <PolycodeShaderModule*> shaderModules;
 	};
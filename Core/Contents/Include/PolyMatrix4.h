@@ -25,6 +25,23 @@ THE SOFTWARE.
 #include "PolyGlobals.h"
 #include "PolyVector3.h"
 
+// SIMD instruction set for the math classes. The Matrix4 and Quaternion operations only use it when Number is single precision, the batch functions on float arrays use it either way.
+#if !defined(POLYCODE_NO_SIMD)
+	#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+		#define POLYCODE_SIMD_SSE
+		#include <xmmintrin.h>
+	#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+		#define POLYCODE_SIMD_NEON
+		#include <arm_neon.h>
+	#endif
+#endif
+
+#if defined(POLYCODE_NUMBER_IS_SINGLE) && defined(POLYCODE_SIMD_SSE)
+	#define POLYCODE_MATH_SSE
+#elif defined(POLYCODE_NUMBER_IS_SINGLE) && defined(POLYCODE_SIMD_NEON)
+	#define POLYCODE_MATH_NEON
+#endif
+
 namespace Polycode {
 
 	class Vector3;
@@ -117,9 +134,22 @@ namespace Polycode {
 
 			inline Vector3 operator * ( const Vector3 &v2 ) const
 			{
+#if defined(POLYCODE_MATH_SSE)
+				__m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(v2.x), _mm_loadu_ps(ml)), _mm_mul_ps(_mm_set1_ps(v2.y), _mm_loadu_ps(ml+4)));
+				r = _mm_add_ps(r, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(v2.z), _mm_loadu_ps(ml+8)), _mm_loadu_ps(ml+12)));
+				float out[4];
+				_mm_storeu_ps(out, r);
+				return Vector3(out[0], out[1], out[2]);
+#elif defined(POLYCODE_MATH_NEON)
+				float32x4_t r = vmlaq_n_f32(vld1q_f32(ml+12), vld1q_f32(ml), v2.x);
+				r = vmlaq_n_f32(r, vld1q_f32(ml+4), v2.y);
+				r = vmlaq_n_f32(r, vld1q_f32(ml+8), v2.z);
+				return Vector3(vgetq_lane_f32(r, 0), vgetq_lane_f32(r, 1), vgetq_lane_f32(r, 2));
+#else
 				return Vector3(v2.x*m[0][0] + v2.y*m[1][0] + v2.z*m[2][0] + m[3][0],
 								v2.x*m[0][1] + v2.y*m[1][1] + v2.z*m[2][1] + m[3][1],
 								v2.x*m[0][2] + v2.y*m[1][2] + v2.z*m[2][2] + m[3][2]);
+#endif
 			}			
 			
 			inline Number* operator [] ( int row ) { return m[row];}
@@ -179,6 +209,35 @@ namespace Polycode {
 			
 			inline Matrix4 operator * (const Matrix4 &m2) const {
            Matrix4 r;
+#if defined(POLYCODE_MATH_SSE)
+			__m128 b0 = _mm_loadu_ps(m2.ml);
+			__m128 b1 = _mm_loadu_ps(m2.ml+4);
+			__m128 b2 = _mm_loadu_ps(m2.ml+8);
+			__m128 b3 = _mm_loadu_ps(m2.ml+12);
+			for(int i=0; i < 4; i++) {
+				__m128 row = _mm_loadu_ps(ml+(i*4));
+				__m128 sum = _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(0,0,0,0)), b0);
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(1,1,1,1)), b1));
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(2,2,2,2)), b2));
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(3,3,3,3)), b3));
+				_mm_storeu_ps(r.ml+(i*4), sum);
+			}
+			return r;
+#elif defined(POLYCODE_MATH_NEON)
+			float32x4_t b0 = vld1q_f32(m2.ml);
+			float32x4_t b1 = vld1q_f32(m2.ml+4);
+			float32x4_t b2 = vld1q_f32(m2.ml+8);
+			float32x4_t b3 = vld1q_f32(m2.ml+12);
+			for(int i=0; i < 4; i++) {
+				float32x4_t row = vld1q_f32(ml+(i*4));
+				float32x4_t sum = vmulq_lane_f32(b0, vget_low_f32(row), 0);
+				sum = vmlaq_lane_f32(sum, b1, vget_low_f32(row), 1);
+				sum = vmlaq_lane_f32(sum, b2, vget_high_f32(row), 0);
+				sum = vmlaq_lane_f32(sum, b3, vget_high_f32(row), 1);
+				vst1q_f32(r.ml+(i*4), sum);
+			}
+			return r;
+#else
             r.m[0][0] = m[0][0] * m2.m[0][0] + m[0][1] * m2.m[1][0] + m[0][2] * m2.m[2][0] + m[0][3] * m2.m[3][0];
             r.m[0][1] = m[0][0] * m2.m[0][1] + m[0][1] * m2.m[1][1] + m[0][2] * m2.m[2][1] + m[0][3] * m2.m[3][1];
             r.m[0][2] = m[0][0] * m2.m[0][2] + m[0][1] * m2.m[1][2] + m[0][2] * m2.m[2][2] + m[0][3] * m2.m[3][2];
@@ -200,6 +259,7 @@ namespace Polycode {
             r.m[3][3] = m[3][0] * m2.m[0][3] + m[3][1] * m2.m[1][3] + m[3][2] * m2.m[2][3] + m[3][3] * m2.m[3][3];
 
             return r;
+#endif
 
 					}
 			
@@ -300,6 +360,39 @@ namespace Polycode {
 			 * @param n The number of dimensions in matrix A.
 			 */
 			static Number generalDeterminant(Number const* const*a, int n);
+			
+			/**
+			* Transforms an array of points by a matrix. The input and output arrays can be the same.
+			* @param matrix Matrix to transform by.
+			* @param points Points to transform.
+			* @param out Array receiving the transformed points.
+			* @param count Number of points.
+			*/
+			static void transformPoints(const Matrix4 &matrix, const Vector3 *points, Vector3 *out, unsigned int count);
+			
+			/**
+			* Transforms packed xyz float positions, as stored in the vertex arrays of meshes, by a matrix. The input and output arrays can be the same.
+			* @param matrix Matrix to transform by.
+			* @param positions Positions to transform, 3 floats each.
+			* @param out Array receiving the transformed positions.
+			* @param count Number of positions.
+			*/
+			static void transformPositions(const Matrix4 &matrix, const float *positions, float *out, unsigned int count);
+			
+			/**
+			* Rotates packed xyz float directions by a matrix, ignoring its translation. The input and output arrays can be the same.
+			* @see transformPositions()
+			*/
+			static void transformDirections(const Matrix4 &matrix, const float *directions, float *out, unsigned int count);
+			
+			/**
+			* Multiplies pairs of matrices, setting out[i] to a[i] * b[i]. The output array can be one of the inputs.
+			* @param a Left hand matrices.
+			* @param b Right hand matrices.
+			* @param out Array receiving the products.
+			* @param count Number of matrix pairs.
+			*/
+			static void multiplyMatrices(const Matrix4 *a, const Matrix4 *b, Matrix4 *out, unsigned int count);
 		
 		protected:
 		
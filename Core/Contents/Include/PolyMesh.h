@@ -30,6 +30,7 @@ class OSFILE;
 namespace Polycode {
 	
 	class String;
+	class MeshFaceCorners;
 
 	class _PolyExport VertexSorter : public PolyBase {
 		public:
@@ -63,6 +64,11 @@ namespace Polycode {
 		void *rendererData;
 		int count;
 		
+		/**
+		* Number of bytes currently allocated at arrayPtr. Renderers reuse the buffer in place when a dirty array is rebuilt and only grow it when the new data does not fit.
+		*/
+		unsigned int capacity;
+		
 		/**
 		* Vertex position array.
 		*/
@@ -87,6 +93,11 @@ namespace Polycode {
 		* Tangent vector array.
 		*/				
 		static const int TANGENT_DATA_ARRAY = 4;				
+
+		/**
+		* Index array for indexed meshes. For this array type, size is the width of a single index in bytes (2 or 4).
+		*/
+		static const int INDEX_DATA_ARRAY = 5;
 		
 		
 	};
@@ -112,6 +123,8 @@ namespace Polycode {
 	
 	/**
 	* A polygonal mesh. The mesh is assembled from Polygon instances, which in turn contain Vertex instances. This structure is provided for convenience and when the mesh is rendered, it is cached into vertex arrays with no notions of separate polygons. When data in the mesh changes, arrayDirtyMap must be set to true for the appropriate array types (color, position, normal, etc). Available types are defined in RenderDataArray.
+	*
+	* A mesh can also use indexed storage, in which case the vertex attributes are kept in flat, contiguous arrays shared between faces and the faces are described by an index array. Meshes loaded from file are indexed. For indexed meshes, the Polygon API is a compatibility view built from the arrays on demand: it can be read, but changes made to the returned polygons are not written back. Modify the vertex arrays directly and flag them in arrayDirtyMap instead.
 	*/
 	class _PolyExport Mesh : public PolyBase {
 		public:
@@ -138,13 +151,13 @@ namespace Polycode {
 			virtual ~Mesh();
 			
 			/**
-			* Adds a polygon to the mesh.
-			* @param newPolygon Polygon to add.
+			* Adds a polygon to the mesh. On an indexed mesh the polygon's vertices are appended to the vertex and index arrays and the polygon is deleted, so the pointer must not be used after this call.
+			* @param newPolygon Polygon to add. The mesh takes ownership of it.
 			*/
 			void addPolygon(Polygon *newPolygon);
 
 			/**
-			* Loads a mesh from a file.
+			* Loads a mesh from a file. Both mesh file formats are supported. Version 2 files on disk are memory mapped and copied straight into the vertex arrays.
 			* @param fileName Path to mesh file.
 			*/			
 			void loadMesh(const String& fileName);
@@ -158,11 +171,20 @@ namespace Polycode {
 			/**
 			* Saves mesh to a file.
 			* @param fileName Path to file to save to.
+			* @param fileFormat File format to save in. Can be MESH_FORMAT_V1 or MESH_FORMAT_V2.
 			*/			
-			void saveToFile(const String& fileName);
+			void saveToFile(const String& fileName, int fileFormat = MESH_FORMAT_V1);
 
 			void loadFromFile(OSFILE *inFile);
-			void saveToFile(OSFILE *outFile);
+			void saveToFile(OSFILE *outFile, int fileFormat = MESH_FORMAT_V1);
+			
+			/**
+			* Loads a version 2 mesh from memory. The data is appended to the mesh like loadMesh() does.
+			* @param data Mesh file contents. Must be 4 byte aligned.
+			* @param size Size of the data in bytes.
+			* @return True if the data was a valid version 2 mesh.
+			*/
+			bool loadFromMemory(const char *data, unsigned int size);
 			
 			/**
 			* Returns the number of polygons in the mesh.
@@ -171,13 +193,53 @@ namespace Polycode {
 			unsigned int getPolygonCount();
 			
 			/**
-			* Returns the total vertex count in the mesh.
+			* Returns the total vertex count in the mesh. For indexed meshes, this is the number of unique vertices.
 			* @return Number of vertices in the mesh.
 			*/
 			unsigned int getVertexCount();
+
+			/**
+			* Returns true if the mesh uses indexed vertex storage.
+			*/
+			bool isIndexedMesh() { return indexedMesh; }
+
+			/**
+			* Adds a vertex to the indexed vertex arrays and switches the mesh to indexed storage. The vertex is not drawn until it is referenced by the index array.
+			* @param position Vertex position.
+			* @param normal Vertex normal.
+			* @param texCoord Vertex texture coordinates.
+			* @return Index of the new vertex.
+			*/
+			unsigned int addIndexedVertex(const Vector3 &position, const Vector3 &normal, const Vector2 &texCoord);
+
+			/**
+			* Appends an index to the index array. Every getVerticesPerFace() indices make up one face.
+			* @param index Index of a vertex previously added with addIndexedVertex.
+			*/
+			void addIndex(unsigned int index);
+
+			/**
+			* Returns the number of indices in the index array.
+			*/
+			unsigned int getIndexCount();
+
+			/**
+			* Returns the width of a single index in bytes when the index array is sent to the renderer. Meshes with up to 65536 vertices use 16-bit indices, larger meshes use 32-bit indices.
+			*/
+			unsigned int getIndexSize();
+
+			/**
+			* Returns the number of vertices that make up a face for the current mesh type.
+			*/
+			unsigned int getVerticesPerFace();
+
+			/**
+			* Converts a polygon based mesh into indexed storage, sharing vertices that have identical attributes. The existing polygons are replaced by the compatibility view.
+			*/
+			void convertToIndexedMesh();
 			
 			/**
-			* Returns a polygon at specified index.
+			* Returns a polygon at specified index. On an indexed mesh this is a copy rebuilt from the vertex arrays, changes made to it are not written back to the mesh.
 			* @param index Index of polygon.
 			* @return Polygon at index.
 			*/									
@@ -270,14 +332,14 @@ namespace Polycode {
 			Number getRadius();
 			
 			/**
-			* Recalculates the mesh normals
+			* Recalculates the mesh normals. Smooth normals are area weighted averages of the faces sharing a vertex position, grouped into clusters of faces within the smoothing angle of each other. Vertices at the same position are welded together with a spatial hash, so this runs in linear time.
 			* @param smooth If true, will use smooth normals.
-			* @param smoothAngle If smooth, this parameter sets the angle tolerance for the approximation function.
+			* @param smoothAngle If smooth, faces meeting at an angle larger than this (in degrees) are not smoothed together. For indexed meshes, vertices along such hard edges are split.
 			*/
 			void calculateNormals(bool smooth=true, Number smoothAngle=90.0);	
 
 			/**
-			* Recalculates the tangent space vector for all vertices.
+			* Recalculates the tangent space vector for all vertices. Tangents are smoothed across the same faces as the last call to calculateNormals, except across texture seams.
 			*/ 
 			void calculateTangents();
 			
@@ -362,11 +424,96 @@ namespace Polycode {
 			bool useVertexColors;
 			
 		
+			/**
+			* Maximum number of bone weights stored per vertex in indexed meshes.
+			*/
+			static const int MAX_BONE_WEIGHTS = 4;
+			
+			/**
+			* Original mesh file format, stores the unindexed polygon data.
+			*/
+			static const int MESH_FORMAT_V1 = 1;
+			
+			/**
+			* Indexed mesh file format. Stores a header with the bounds, the vertex streams including tangents and packed bone weights, and the index array, so that it can be loaded with a single read.
+			*/
+			static const int MESH_FORMAT_V2 = 2;
+
+			/**
+			* Indexed vertex positions, 3 floats per vertex.
+			*/
+			std::vector<float> vertexPositionArray;
+
+			/**
+			* Indexed vertex normals, 3 floats per vertex.
+			*/
+			std::vector<float> vertexNormalArray;
+
+			/**
+			* Indexed vertex tangents, 3 floats per vertex.
+			*/
+			std::vector<float> vertexTangentArray;
+
+			/**
+			* Indexed vertex colors, 4 floats (RGBA) per vertex.
+			*/
+			std::vector<float> vertexColorArray;
+
+			/**
+			* Indexed vertex texture coordinates, 2 floats per vertex.
+			*/
+			std::vector<float> vertexTexCoordArray;
+
+			/**
+			* Indexed rest pose positions, 3 floats per vertex. Only filled for skinned meshes.
+			*/
+			std::vector<float> vertexRestPositionArray;
+
+			/**
+			* Indexed rest pose normals, 3 floats per vertex. Only filled for skinned meshes.
+			*/
+			std::vector<float> vertexRestNormalArray;
+
+			/**
+			* Bone ids of the indexed vertices, MAX_BONE_WEIGHTS per vertex. Only filled for skinned meshes.
+			*/
+			std::vector<unsigned int> vertexBoneIndexArray;
+
+			/**
+			* Normalized bone weights of the indexed vertices, MAX_BONE_WEIGHTS per vertex. Unused slots have a weight of 0. Only filled for skinned meshes.
+			*/
+			std::vector<float> vertexBoneWeightArray;
+
+			/**
+			* Index array of the indexed mesh.
+			*/
+			std::vector<unsigned int> indexArray;
+		
 		protected:
+
+		void buildPolygonView();
+		void clearPolygons();
+		unsigned int duplicateIndexedVertex(unsigned int index);
+		void setIndexedCornerNormals(const std::vector<Vector3> &cornerNormals);
+		void buildFaceCorners(MeshFaceCorners &corners);
+		
+		void saveToFileV1(OSFILE *outFile);
+		void saveToFileV2(OSFILE *outFile);
+		void loadFromFileV1(unsigned int meshType, OSFILE *inFile);
+		bool hasCachedBounds();
 					
 		VertexBuffer *vertexBuffer;
 		bool meshHasVertexBuffer;
 		int meshType;
+		bool indexedMesh;
+		bool polygonViewDirty;
+		bool smoothNormals;
+		Number normalSmoothAngle;
 		std::vector <Polygon*> polygons;
+		
+		static const unsigned int NO_CACHED_BOUNDS = 0xFFFFFFFF;
+		unsigned int boundsVertexCount;
+		Vector3 cachedBBox;
+		Number cachedRadius;
 	};
 }
@@ -0,0 +1,294 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyRenderer.h"
+#include "PolyTexture.h"
+#include "PolyMesh.h"
+#include <vector>
+
+namespace Polycode {
+
+	/**
+	* Texture created by the NullRenderer. It keeps its pixel data in memory, but is never uploaded anywhere.
+	*/
+	class _PolyExport NullTexture : public Texture {
+		public:
+			NullTexture(unsigned int width, unsigned int height, char *textureData, bool clamp, bool createMipmaps, int type=Image::IMAGE_RGBA);
+			virtual ~NullTexture();
+			
+			void setTextureData(char *data);
+			void recreateFromImageData();
+	};
+	
+	/**
+	* Vertex buffer created by the NullRenderer. It only remembers how many vertices and indices a draw of the buffer submits.
+	*/
+	class _PolyExport NullVertexBuffer : public VertexBuffer {
+		public:
+			NullVertexBuffer(Mesh *mesh);
+			virtual ~NullVertexBuffer();
+			
+			/**
+			* Returns the number of indices in the buffer, or 0 if the buffer was created from a non-indexed mesh.
+			*/
+			int getIndexCount() const;
+			
+		protected:
+			int indexCount;
+	};
+
+	/**
+	* A renderer that does not draw anything. It implements the full Renderer interface without a graphics API: the modelview and projection matrices and the matrix stack are kept in software, render states are tracked and filtered like in the OpenGL renderer, mesh render data arrays are built as usual and draw calls are counted in the frame statistics. This makes it possible to run and profile scenes, screens and all of their update and render code on machines without a GPU or a display.
+	*
+	* @see RecordingRenderer
+	* @see HeadlessCore
+	*/
+	class _PolyExport NullRenderer : public Renderer {
+	public:
+		NullRenderer();
+		virtual ~NullRenderer();
+		
+		void Resize(int xRes, int yRes);
+		void BeginRender();
+		void EndRender();
+		
+		Cubemap *createCubemap(Texture *t0, Texture *t1, Texture *t2, Texture *t3, Texture *t4, Texture *t5);
+		Texture *createTexture(unsigned int width, unsigned int height, char *textureData, bool clamp, bool createMipmaps, int type=Image::IMAGE_RGBA);
+		void destroyTexture(Texture *texture);
+		void createRenderTextures(Texture **colorBuffer, Texture **depthBuffer, int width, int height, bool floatingPointBuffer);
+		Texture *createFramebufferTexture(unsigned int width, unsigned int height);
+		void bindFrameBufferTexture(Texture *texture);
+		void bindFrameBufferTextureDepth(Texture *texture);
+		void unbindFramebuffers();
+		
+		/**
+		* Returns a blank image the size of the screen.
+		*/
+		Image *renderScreenToImage();
+		
+		void resetViewport();
+		
+		void loadIdentity();
+		void setOrthoMode(Number xSize=0.0f, Number ySize=0.0f, bool centered = false);
+		void _setOrthoMode(Number orthoSizeX, Number orthoSizeY);
+		void setPerspectiveMode();
+		
+		void setTexture(Texture *texture);
+		void enableBackfaceCulling(bool val);
+		
+		void clearScreen();
+		
+		void translate2D(Number x, Number y);
+		void rotate2D(Number angle);
+		void scale2D(Vector2 *scale);
+		
+		void setVertexColor(Number r, Number g, Number b, Number a);
+		
+		void pushRenderDataArray(RenderDataArray *array);
+		RenderDataArray *createRenderDataArrayForMesh(Mesh *mesh, int arrayType);
+		RenderDataArray *createRenderDataArray(int arrayType);
+		void updateRenderDataArraysForMesh(Mesh *mesh, bool *updateMap);
+		void setRenderArrayData(RenderDataArray *array, Number *arrayData);
+		void drawArrays(int drawType);
+		
+		void translate3D(Vector3 *position);
+		void translate3D(Number x, Number y, Number z);
+		void scale3D(Vector3 *scale);
+		
+		void pushMatrix();
+		void popMatrix();
+		
+		void setLineSmooth(bool val);
+		void setLineSize(Number lineSize);
+		
+		void enableLighting(bool enable);
+		void enableFog(bool enable);
+		void setFogProperties(int fogMode, Color color, Number density, Number startDepth, Number endDepth);
+		
+		void multModelviewMatrix(Matrix4 m);
+		void setModelviewMatrix(Matrix4 m);
+		
+		void setBlendingMode(int blendingMode);
+		
+		void applyMaterial(Material *material, ShaderBinding *localOptions, unsigned int shaderIndex);
+		void clearShader();
+		
+		void setDepthFunction(int depthFunction);
+		
+		void createVertexBufferForMesh(Mesh *mesh);
+		void drawVertexBuffer(VertexBuffer *buffer, bool enableColorBuffer);
+		
+		void enableDepthTest(bool val);
+		void enableDepthWrite(bool val);
+		void setClippingPlanes(Number nearPlane, Number farPlane);
+		void enableAlphaTest(bool val);
+		
+		void clearBuffer(bool colorBuffer, bool depthBuffer);
+		void drawToColorBuffer(bool val);
+		void drawScreenQuad(Number qx, Number qy);
+		
+		void cullFrontFaces(bool val);
+		
+		Vector3 projectRayFrom2DCoordinate(Number x, Number y, Matrix4 cameraMatrix, Matrix4 projectionMatrix);
+		
+		Matrix4 getProjectionMatrix();
+		Matrix4 getModelviewMatrix();
+		
+		/**
+		* Returns the point on the near plane below a screen coordinate. There is no depth buffer to read back, so the depth of the scene under the point is not taken into account.
+		*/
+		Vector3 Unproject(Number x, Number y);
+		
+		/**
+		* Returns the number of matrices currently pushed on the matrix stack.
+		*/
+		int getMatrixStackDepth() const;
+		
+		static const int COMMAND_DRAW_ARRAYS = 0;
+		static const int COMMAND_DRAW_VERTEX_BUFFER = 1;
+		static const int COMMAND_STATE_CHANGE = 2;
+		static const int COMMAND_SET_TEXTURE = 3;
+		static const int COMMAND_APPLY_MATERIAL = 4;
+		static const int COMMAND_CLEAR_SHADER = 5;
+		static const int COMMAND_PUSH_MATRIX = 6;
+		static const int COMMAND_POP_MATRIX = 7;
+		static const int COMMAND_CLEAR = 8;
+		static const int COMMAND_BIND_FRAMEBUFFER = 9;
+		static const int COMMAND_UNBIND_FRAMEBUFFERS = 10;
+		
+	protected:
+		
+		/**
+		* Called for every command the renderer executes. Does nothing by default; the RecordingRenderer logs the commands.
+		* @param type Command type, one of the COMMAND_* constants.
+		* @param param For draws, the mesh type; for state changes, the RENDER_STATE_* constant.
+		* @param value For state changes, the new state value.
+		* @param vertexCount For draws, the number of vertices submitted.
+		* @param data Texture, material or vertex buffer the command uses, if any.
+		*/
+		virtual void logCommand(int type, int param, int value, unsigned int vertexCount, void *data) {}
+		
+		/**
+		* Passes a render state change through the state filter and logs it if it was not redundant.
+		*/
+		void applyRenderState(int state, int value);
+		
+		Number nearPlane;
+		Number farPlane;
+		
+		Matrix4 modelviewMatrix;
+		Matrix4 projectionMatrix;
+		std::vector<Matrix4> matrixStack;
+		
+		int verticesToDraw;
+		int indicesToDraw;
+	};
+	
+	/**
+	* A single command executed by a RecordingRenderer.
+	*/
+	class _PolyExport RenderCommand {
+		public:
+			/**
+			* Command type, one of the NullRenderer::COMMAND_* constants.
+			*/
+			int type;
+			
+			/**
+			* For draws, the mesh type; for state changes, the Renderer::RENDER_STATE_* constant.
+			*/
+			int param;
+			
+			/**
+			* For state changes, the new state value.
+			*/
+			int value;
+			
+			/**
+			* For draws, the number of vertices submitted.
+			*/
+			unsigned int vertexCount;
+			
+			/**
+			* Depth of the matrix stack when the command was executed.
+			*/
+			int matrixDepth;
+			
+			/**
+			* Texture, material or vertex buffer the command used, if any.
+			*/
+			void *data;
+	};
+	
+	/**
+	* A NullRenderer that logs every draw call, state change, texture and material change and matrix stack operation into a per frame command log. Tests and benchmarks can inspect the log of the last frame to check what a scene submitted, in what order, and at which matrix stack depth.
+	*/
+	class _PolyExport RecordingRenderer : public NullRenderer {
+	public:
+		RecordingRenderer();
+		virtual ~RecordingRenderer();
+		
+		void BeginRender();
+		void EndRender();
+		
+		/**
+		* Returns the commands recorded so far in the current frame.
+		*/
+		const std::vector<RenderCommand> &getFrameCommands() const;
+		
+		/**
+		* Returns the commands recorded in the last completed frame.
+		*/
+		const std::vector<RenderCommand> &getLastFrameCommands() const;
+		
+		/**
+		* Returns the number of commands of a type in the last completed frame.
+		* @param type Command type, one of the COMMAND_* constants.
+		*/
+		unsigned int getLastFrameCommandCount(int type) const;
+		
+		/**
+		* Returns the deepest the matrix stack got in the last completed frame.
+		*/
+		int getLastFrameMaxMatrixDepth() const;
+		
+		/**
+		* Writes the command log of the last completed frame to the Logger.
+		*/
+		void dumpLastFrame() const;
+		
+		/**
+		* If set to false, no commands are recorded. Defaults to true.
+		*/
+		bool recording;
+		
+	protected:
+		void logCommand(int type, int param, int value, unsigned int vertexCount, void *data);
+		
+		std::vector<RenderCommand> frameCommands;
+		std::vector<RenderCommand> lastFrameCommands;
+		int maxMatrixDepth;
+		int lastFrameMaxMatrixDepth;
+	};
+}
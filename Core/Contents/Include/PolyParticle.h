@@ -23,38 +23,88 @@ THE SOFTWARE.
 #pragma once
 #include "PolyGlobals.h"
 #include "PolyVector3.h"
+#include <vector>
 
 namespace Polycode {
 
-	class Entity;
-	class Material;
-	class Mesh;
-	class Texture;
-
+	/**
+	* Particle types. Particles themselves are not objects, they are stored by their emitter in a ParticleStore.
+	* @see ParticleEmitter
+	*/
 	class _PolyExport Particle : public PolyBase {
 		public:
-			Particle(int particleType, bool isScreenParticle, Material *material, Texture *texture, Mesh *particleMesh);
-			~Particle();
-			void Reset(bool continuious);
+			/**
+			* Camera facing textured quad.
+			*/
+			static const int BILLBOARD_PARTICLE = 0;
+			
+			/**
+			* Copy of a mesh per particle.
+			*/
+			static const int MESH_PARTICLE = 1;
+	};
+	
+	/**
+	* Structure of arrays holding the state of all particles of an emitter. Every array has one entry per particle, so the emitter can update all particles in tight loops over contiguous memory.
+	*/
+	class _PolyExport ParticleStore : public PolyBase {
+		public:
+			ParticleStore();
+			~ParticleStore();
+			
+			/**
+			* Resizes all arrays to hold the specified number of particles. Existing particles are kept, new ones are zeroed.
+			* @param count New number of particles.
+			*/
+			void resize(unsigned int count);
+			
+			/**
+			* Returns the number of particles in the store.
+			*/
+			unsigned int size() const;
 			
-			void createSceneParticle(int particleType, Material *material, Mesh *particleMesh);
-			void createScreenParticle(int particleType, Texture *texture, Mesh *particleMesh);
+			/**
+			* Returns the position of a particle.
+			* @param index Particle index.
+			*/
+			Vector3 getPosition(unsigned int index) const;
+			
+			/**
+			* Returns the velocity of a particle.
+			* @param index Particle index.
+			*/			
+			Vector3 getVelocity(unsigned int index) const;
 		
-			Entity *particleBody;						
+			std::vector<float> positionX;
+			std::vector<float> positionY;
+			std::vector<float> positionZ;
 			
-			Vector3 velVector;
-			Vector3 dirVector;	
-			Vector3 deviation;		
-			Number life;
-			Number lifespan;
-			Number brightnessDeviation;
-			Number perlinPosX;
-			Number perlinPosY;
-			Number perlinPosZ;
+			std::vector<float> velocityX;
+			std::vector<float> velocityY;
+			std::vector<float> velocityZ;
 			
-			static Mesh* billboardMesh;
+			std::vector<float> life;
+			std::vector<float> lifespan;
 			
-			static const int BILLBOARD_PARTICLE = 0;
-			static const int MESH_PARTICLE = 1;
+			std::vector<float> colorR;
+			std::vector<float> colorG;
+			std::vector<float> colorB;
+			std::vector<float> colorA;
+			
+			/**
+			* Edge length of each particle.
+			*/
+			std::vector<float> particleSize;
+			
+			/**
+			* Rotation of each particle in degrees.
+			*/
+			std::vector<float> rotation;
+			
+			std::vector<float> brightnessDeviation;
+			
+			std::vector<float> perlinPosX;
+			std::vector<float> perlinPosY;
+			std::vector<float> perlinPosZ;
 	};
 }
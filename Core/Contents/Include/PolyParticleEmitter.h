@@ -28,23 +28,26 @@ THE SOFTWARE.
 #include "PolyBezierCurve.h"
 #include "PolySceneEntity.h"
 #include "PolyScreenEntity.h"
+#include "PolyParticle.h"
+#include "PolyMesh.h"
 
 namespace Polycode {
 
 	class Entity;
 	class Material;
 	class Mesh;
-	class Particle;
 	class Perlin;
+	class Renderer;
 	class Scene;
 	class SceneMesh;
 	class Screen;
 	class ScreenMesh;
+	class ShaderBinding;
 	class Texture;
 	class Timer;
 
 	/** 
-	* Particle emitter base.
+	* Particle emitter base. Particles are not entities, the emitter keeps their state in a ParticleStore, updates it in place every frame and renders all of its particles as a single batched vertex stream with one draw call.
 	*/
 	class _PolyExport ParticleEmitter {
 		public:
@@ -126,26 +129,30 @@ namespace Polycode {
 			
 
 			unsigned int getNumParticles() const;
-
-			Particle *getParticleAtIndex(unsigned int index) const;
-
+			
 			/**
-			* If emitter mode is TRIGGERED_EMITTER, calling this method will trigger particle emission.
-			*/ 
+			* Returns the particle store holding the state of every particle of this emitter.
+			*/
+			ParticleStore *getParticleStore();
 			
 			void resetAll();
 	
+			/**
+			* If emitter mode is TRIGGERED_EMITTER, calling this method will trigger particle emission.
+			*/ 
 			void Trigger();
 			
-			void resetParticle(Particle *particle);
+			/**
+			* Respawns a particle at the emitter.
+			* @param index Index of the particle to respawn.
+			*/
+			void resetParticle(unsigned int index);
 			
 			/**
 			* Changes the particle count in the emitter.
 			*/ 																													
 			void setParticleCount(int count);
 		
-			virtual Vector3 getParticleCompoundScale();
-			virtual void addParticleBody(Entity *particleBody);
 			virtual Matrix4 getBaseMatrix();
 		
 			/**
@@ -158,6 +165,9 @@ namespace Polycode {
 			*/ 																																										
 			Number brightnessDeviation;
 			
+			/**
+			* Advances all particles by the time elapsed since the last update.
+			*/
 			void updateEmitter();
 
 			/**
@@ -247,9 +257,24 @@ namespace Polycode {
 											
 		protected:
 		
+			void spawnParticle(unsigned int index, const Vector3 &origin);
+			void updateParticleBounds();
+			void buildMeshTemplate();
+			
+			/**
+			* Fills the particle vertex stream. Corner offsets are built from the right and up axes, normals point along facing. Positions are converted into emitter space with toLocal if ignoreParentMatrix is set.
+			*/
+			void buildParticleStream(const Vector3 &right, const Vector3 &up, const Vector3 &facing, const Color &baseColor, const Matrix4 &toLocal);
+			void renderParticleStream(Renderer *renderer, const Color &baseColor);
+		
 			bool ignoreParentMatrix;
 		
 			int blendingMode;
+			bool particleDepthWrite;
+			bool particleDepthTest;
+			bool particleAlphaTest;
+			bool particlesVisible;
+			bool particleBillboardMode;
 		
 			bool isScreenEmitter;
 			Mesh *pMesh;
@@ -257,6 +282,7 @@ namespace Polycode {
 			bool allAtOnce;
 			int particleType;
 			Material *particleMaterial;
+			ShaderBinding *particleShaderBinding;
 			Texture *particleTexture;
 		
 			String textureFile;
@@ -266,8 +292,25 @@ namespace Polycode {
 						
 			Perlin *motionPerlin;
 			
-			Number numParticles;
-			std::vector<Particle*> particles;
+			unsigned int numParticles;
+			ParticleStore particles;
+			
+			Vector3 particleBoundsMin;
+			Vector3 particleBoundsMax;
+			
+			// batched vertex stream all particles are drawn with
+			int streamMeshType;
+			unsigned int streamVertexCount;
+			std::vector<float> streamPositions;
+			std::vector<float> streamColors;
+			std::vector<float> streamTexCoords;
+			std::vector<float> streamNormals;
+			RenderDataArray streamArrays[4];
+			
+			// mesh particle template, triangulated
+			std::vector<float> templatePositions;
+			std::vector<float> templateNormals;
+			std::vector<float> templateTexCoords;
 			
 			Number emitSpeed;
 			Timer *timer;
@@ -301,11 +344,9 @@ namespace Polycode {
 		ParticleEmitter *getEmitter() { return this; }
 		
 		void respawnSceneParticles();
-		void addParticleBody(Entity *particleBody);
 		Matrix4 getBaseMatrix();
 		void Update();
-		
-		Vector3 getParticleCompoundScale();
+		void Render();
 		
 		void dispatchTriggerCompleteEvent();
 		
@@ -325,7 +366,7 @@ namespace Polycode {
 	};	
 		
 	/**
-	* 3D particle emitter.
+	* 2D particle emitter.
 	*/
 	class _PolyExport ScreenParticleEmitter : public ScreenEntity, public ParticleEmitter {
 	public:
@@ -342,11 +383,9 @@ namespace Polycode {
 		
 		void dispatchTriggerCompleteEvent();
 		
-		void addParticleBody(Entity *particleBody);
 		Matrix4 getBaseMatrix();
 		void Update();
-		
-		Vector3 getParticleCompoundScale();
+		void Render();
 		
 			/**
 			* Continuous emitter setting.
@@ -0,0 +1,235 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyString.h"
+#include <vector>
+#include <set>
+
+namespace Polycode {
+
+	/**
+	* Timing of a single profiler zone in a frame.
+	*/
+	class _PolyExport ProfilerZoneRecord {
+		public:
+			/**
+			* Name of the zone.
+			*/
+			const char *name;
+			
+			/**
+			* Time the zone was entered, in microseconds.
+			*/
+			double startTime;
+			
+			/**
+			* Time spent in the zone, in microseconds.
+			*/
+			double duration;
+			
+			/**
+			* Nesting depth of the zone, 0 for zones that are not inside another zone.
+			*/
+			int depth;
+	};
+	
+	/**
+	* Zone timings of one frame.
+	*/
+	class _PolyExport ProfilerFrame {
+		public:
+			/**
+			* Number of the frame since profiling was enabled.
+			*/
+			unsigned int frameNumber;
+			
+			/**
+			* Time the frame started, in microseconds.
+			*/
+			double startTime;
+			
+			/**
+			* Duration of the frame, in microseconds.
+			*/
+			double duration;
+			
+			/**
+			* Zones entered during the frame, in the order they were entered.
+			*/
+			std::vector<ProfilerZoneRecord> zones;
+	};
+
+	/**
+	* Frame profiler. The profiler records how long named zones of code take in each frame and keeps the timings of the most recent frames in a ring buffer. Zones are marked with ProfilerZone objects, which time the scope they are declared in. The core services, scene and screen managers, physics modules and the player are instrumented with zones.
+	*
+	* The profiler is disabled by default, in which case zones cost a single flag check. Timings can be read per frame, summarized with getSummary() or exported with saveChromeTrace() and opened in the trace viewer of Chrome (chrome://tracing). Zones must only be entered on the main thread.
+	*
+	* The profiler is owned by CoreServices and can be accessed with CoreServices::getProfiler().
+	*/
+	class _PolyExport Profiler : public PolyBase {
+		public:
+			Profiler();
+			~Profiler();
+			
+			/**
+			* Enables or disables profiling. Enabling the profiler clears the recorded frames.
+			* @param enabled True to enable, false to disable.
+			*/
+			void setEnabled(bool enabled);
+			
+			/**
+			* Returns true if profiling is enabled.
+			*/
+			bool isEnabled() const { return enabled; }
+			
+			/**
+			* Sets the number of frames kept in the ring buffer and clears the recorded frames. Defaults to 300.
+			* @param frameCount Number of frames to keep.
+			*/
+			void setFrameCapacity(int frameCount);
+			
+			/**
+			* Ends the current frame and starts the next one. This is called by the core at the start of every update.
+			*/
+			void newFrame();
+			
+			/**
+			* Enters a zone. Every call must be matched by a call to endZone(); use ProfilerZone to do this automatically.
+			* @param name Name of the zone. The string is not copied and must stay valid while the profiler is in use, e.g. a string literal.
+			*/
+			POLYIGNORE void beginZone(const char *name);
+			
+			/**
+			* Enters a zone with a name that is not a string literal, such as zones entered from scripts. Must be matched by a call to endZone().
+			* @param name Name of the zone.
+			*/
+			void beginNamedZone(const String &name);
+			
+			/**
+			* Leaves the zone that was entered last.
+			*/
+			void endZone();
+			
+			/**
+			* Clears all recorded frames.
+			*/
+			void clear();
+			
+			/**
+			* Returns the number of completed frames in the ring buffer.
+			*/
+			int getFrameCount() const;
+			
+			/**
+			* Returns a completed frame from the ring buffer.
+			* @param index Index of the frame, 0 being the oldest frame in the buffer.
+			*/
+			POLYIGNORE const ProfilerFrame *getFrame(int index) const;
+			
+			/**
+			* Returns the average frame time of the recorded frames, in milliseconds.
+			*/
+			Number getAverageFrameTime() const;
+			
+			/**
+			* Returns the longest frame time of the recorded frames, in milliseconds.
+			*/
+			Number getMaxFrameTime() const;
+			
+			/**
+			* Returns the average time per frame spent in all zones with a name, in milliseconds.
+			* @param name Name of the zone.
+			*/
+			Number getAverageZoneTime(const String &name) const;
+			
+			/**
+			* Returns the longest time a frame spent in all zones with a name, in milliseconds.
+			* @param name Name of the zone.
+			*/
+			Number getMaxZoneTime(const String &name) const;
+			
+			/**
+			* Returns the average number of times per frame a zone was entered.
+			* @param name Name of the zone.
+			*/
+			Number getAverageZoneCount(const String &name) const;
+			
+			/**
+			* Returns a text table of the average and maximum time per frame and the average number of calls of every zone in the recorded frames.
+			*/
+			String getSummary() const;
+			
+			/**
+			* Returns the recorded frames in the Chrome trace event JSON format.
+			*/
+			String getChromeTrace() const;
+			
+			/**
+			* Writes the recorded frames to a file in the Chrome trace event JSON format.
+			* @param fileName Path of the file to write.
+			* @return True if the file was written.
+			*/
+			bool saveChromeTrace(const String &fileName) const;
+			
+			/**
+			* Returns the time of a monotonic high resolution clock, in microseconds.
+			*/
+			static double getMicroseconds();
+			
+		protected:
+		
+			void collectZoneTime(const String &name, double *totalTime, double *maxTime, double *calls) const;
+			
+			bool enabled;
+			std::vector<ProfilerFrame> frames;
+			int frameCapacity;
+			int completedFrames;
+			int currentFrame;
+			unsigned int frameNumber;
+			std::vector<int> openZones;
+			std::set<std::string> zoneNames;
+	};
+	
+	/**
+	* Times the scope it is declared in as a profiler zone. Declare a ProfilerZone at the start of a block, and the zone is left when the block ends:
+	* <pre>
+	* void MyManager::Update() {
+	*     ProfilerZone zone("MyManager::Update");
+	*     ...
+	* }
+	* </pre>
+	*/
+	class _PolyExport ProfilerZone {
+		public:
+			/**
+			* Enters a zone, if profiling is enabled.
+			* @param name Name of the zone. The string is not copied and must stay valid while the profiler is in use, e.g. a string literal.
+			*/
+			ProfilerZone(const char *name);
+			~ProfilerZone();
+			
+		protected:
+			Profiler *profiler;
+	};
+}
@@ -0,0 +1,115 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#pragma once
+#include "PolyGlobals.h"
+#include "PolyMatrix4.h"
+#include "PolyColor.h"
+#include "PolyRectangle.h"
+#include <vector>
+
+namespace Polycode {
+
+	class Entity;
+	class Material;
+	class Renderer;
+	class Shader;
+	class Texture;
+
+	/**
+	* A single deferred Render() call, with the matrices and render states the entity had when it was queued.
+	*/
+	class _PolyExport RenderQueueItem {
+		public:
+			Entity *entity;
+			
+			Matrix4 modelviewMatrix;
+			Matrix4 modelMatrix;
+			Color color;
+			
+			int blendingMode;
+			bool depthWrite;
+			bool depthTest;
+			bool alphaTest;
+			bool backfaceCulled;
+			bool depthOnly;
+			int renderMode;
+			bool scissorEnabled;
+			Polycode::Rectangle scissorBox;
+			
+			int pass;
+			Shader *shader;
+			Material *material;
+			Texture *texture;
+			Number depth;
+			unsigned int sequence;
+	};
+
+	/**
+	* Collects the Render() calls of a scene pass and submits them sorted by pass, shader, material, texture and depth, so entities sharing render states are drawn together. Opaque items are drawn front to back, transparent items back to front, and items that do not depth test are drawn last in the order they were queued.
+	*
+	* Scenes use a render queue by setting it on the Renderer for the duration of their pass. Entity::transformAndRender() then queues its Render() call instead of making it.
+	*/
+	class _PolyExport RenderQueue : public PolyBase {
+		public:
+			RenderQueue();
+			virtual ~RenderQueue();
+			
+			/**
+			* Removes all queued items.
+			*/
+			void clear();
+			
+			/**
+			* Queues an entity's Render() call with the renderer's current matrices, and the entity's render states and color.
+			* @param entity Entity to queue.
+			* @param renderer Renderer to read the current matrices and scissor state from.
+			*/
+			void addEntity(Entity *entity, Renderer *renderer);
+			
+			/**
+			* Sorts the queued items and renders them.
+			* @param renderer Renderer to submit to.
+			*/
+			void render(Renderer *renderer);
+			
+			unsigned int getItemCount() const;
+			
+			/**
+			* If set to false, items are rendered in the order they were queued. Defaults to true.
+			*/
+			bool sortingEnabled;
+			
+			static const int PASS_DEPTH_ONLY = 0;
+			static const int PASS_OPAQUE = 1;
+			static const int PASS_TRANSPARENT = 2;
+			static const int PASS_OVERLAY = 3;
+			
+		protected:
+		
+			static bool compareItems(const RenderQueueItem *a, const RenderQueueItem *b);
+			
+			std::vector<RenderQueueItem> items;
+			std::vector<RenderQueueItem*> sortedItems;
+			unsigned int itemCount;
+	};
+}
@@ -31,6 +31,7 @@ THE SOFTWARE.
 
 namespace Polycode {
 	
+	class Camera;
 	class Cubemap;
 	class Material;
 	class Mesh;
@@ -38,6 +39,7 @@ namespace Polycode {
 	class PolycodeShaderModule;
 	class Polygon;
 	class RenderDataArray;
+	class RenderQueue;
 	class ShaderBinding;
 	class Texture;
 	class VertexBuffer;
@@ -74,6 +76,49 @@ namespace Polycode {
 			}
 	};
 
+	/**
+	* Per frame renderer counters.
+	*/
+	class _PolyExport RenderStats : public PolyBase {
+		public:
+			RenderStats();
+			
+			/**
+			* Sets all counters to zero.
+			*/
+			void reset();
+			
+			/**
+			* Number of draw calls issued.
+			*/
+			unsigned int drawCalls;
+			
+			/**
+			* Number of vertices submitted by draw calls.
+			*/
+			unsigned int verticesDrawn;
+			
+			/**
+			* Number of render state changes that were passed on to the graphics API.
+			*/
+			unsigned int stateChanges;
+			
+			/**
+			* Number of render state changes that were skipped because the state was already set.
+			*/
+			unsigned int redundantStateChanges;
+			
+			/**
+			* Number of texture binds.
+			*/
+			unsigned int textureBinds;
+			
+			/**
+			* Number of materials applied.
+			*/
+			unsigned int materialChanges;
+	};
+
 	/**
 	* Provides low-level settings for the main renderer.
 	*
@@ -141,6 +186,14 @@ namespace Polycode {
 		virtual void pushRenderDataArray(RenderDataArray *array) = 0;
 		virtual RenderDataArray *createRenderDataArrayForMesh(Mesh *mesh, int arrayType) = 0;
 		virtual RenderDataArray *createRenderDataArray(int arrayType) = 0;
+		
+		/**
+		* Rebuilds the render data arrays of a mesh from its current vertex data. The mesh's existing arrays are reused where possible, arrays that do not exist yet are created.
+		* @param mesh Mesh to rebuild the arrays of.
+		* @param updateMap Array of 16 flags, indexed by render data array type, marking which arrays to rebuild.
+		*/
+		virtual void updateRenderDataArraysForMesh(Mesh *mesh, bool *updateMap);
+		
 		virtual void setRenderArrayData(RenderDataArray *array, Number *arrayData) = 0;
 		virtual void drawArrays(int drawType) = 0;
 		
@@ -219,6 +272,17 @@ namespace Polycode {
 		void setCameraMatrix(const Matrix4& matrix);
 		void setCameraPosition(Vector3 pos);
 		
+		/**
+		* Sets the camera that entities are frustum culled against while they render. Scenes set this for the duration of their render pass; when it is NULL, nothing is culled.
+		* @param camera Camera to cull against, or NULL to disable culling.
+		*/
+		void setCullingCamera(Camera *camera);
+		
+		/**
+		* Returns the camera entities are currently culled against, or NULL if culling is disabled.
+		*/
+		Camera *getCullingCamera() const;
+		
 		virtual void drawScreenQuad(Number qx, Number qy) = 0;
 		
 		int getXRes();
@@ -262,6 +326,41 @@ namespace Polycode {
 		virtual Matrix4 getProjectionMatrix() = 0;
 		virtual Matrix4 getModelviewMatrix() = 0;
 		
+		/**
+		* Sets the render queue entities add themselves to instead of drawing immediately. Scenes set this for the duration of their render pass; when it is NULL, entities draw immediately.
+		* @param queue Render queue to collect draw items in, or NULL.
+		*/
+		void setRenderQueue(RenderQueue *queue);
+		
+		/**
+		* Returns the current render queue, or NULL if entities draw immediately.
+		*/
+		RenderQueue *getRenderQueue() const;
+		
+		/**
+		* Returns the counters of the frame currently being rendered.
+		*/
+		const RenderStats &getFrameStats() const;
+		
+		/**
+		* Returns the counters of the last completed frame.
+		*/
+		const RenderStats &getLastFrameStats() const;
+		
+		/**
+		* Forgets the cached render states, so the next change of each state is always passed on to the graphics API. Call this after changing graphics API state outside of the renderer.
+		*/
+		void invalidateRenderStates();
+		
+		static const int RENDER_STATE_BLENDING_MODE = 0;
+		static const int RENDER_STATE_DEPTH_WRITE = 1;
+		static const int RENDER_STATE_DEPTH_TEST = 2;
+		static const int RENDER_STATE_ALPHA_TEST = 3;
+		static const int RENDER_STATE_BACKFACE_CULLING = 4;
+		static const int RENDER_STATE_LINE_SMOOTH = 5;
+		static const int RENDER_STATE_TEXTURE_ENABLED = 6;
+		static const int RENDER_STATE_COUNT = 7;
+		
 		static const int RENDER_MODE_NORMAL = 0;
 		static const int RENDER_MODE_WIREFRAME = 1;
 		
@@ -306,6 +405,35 @@ namespace Polycode {
 				
 	protected:
 		virtual void initOSSpecific() {};
+		
+		/**
+		* Records a render state change. Returns false, and counts a redundant change, if the state already has this value. Backends call this before touching the graphics API.
+		*/
+		bool changeRenderState(int state, int value);
+		
+		/**
+		* Starts a new frame of render statistics. Backends call this from BeginRender().
+		*/
+		void beginFrameStats();
+		
+		/**
+		* Makes the counters of the current frame the last frame's counters. Backends call this from EndRender().
+		*/
+		void endFrameStats();
+		
+		/**
+		* Fills the flagged render data arrays from a mesh's vertex data, walking the vertices once for all of them. The arrays must already exist; their buffers are grown as needed.
+		* @param mesh Mesh to read the vertex data from.
+		* @param arrays Array of 16 render data arrays, indexed by type.
+		* @param updateMap Array of 16 flags, indexed by type, marking which arrays to fill.
+		*/
+		void fillRenderDataArrays(Mesh *mesh, RenderDataArray **arrays, bool *updateMap);
+		
+		int renderStateValues[RENDER_STATE_COUNT];
+		bool renderStateValid[RENDER_STATE_COUNT];
+		RenderStats frameStats;
+		RenderStats lastFrameStats;
+		RenderQueue *renderQueue;
 	
 		bool scissorEnabled;
 		
@@ -329,6 +457,7 @@ namespace Polycode {
 		int renderMode;
 		
 		Matrix4 cameraMatrix;
+		Camera *cullingCamera;
 	
 		PolycodeShaderModule* currentShaderModule;
 		std::vector <PolycodeShaderModule*> shaderModules;
@@ -28,6 +28,8 @@ THE SOFTWARE.
 
 namespace Polycode {
 
+	class ResourceManager;
+	
 	/**
 	* Base class for resources. All resources that are managed by the ResourceManager subclass this.
 	*/
@@ -66,8 +68,10 @@ namespace Polycode {
 			//@}
 			
 		protected:
-
+		
+			friend class ResourceManager;
 			
+			int resourceIndex;
 			int type;
 			String resourcePath;
 			String name;
@@ -23,18 +23,24 @@ THE SOFTWARE.
 
 #pragma once
 #include "PolyGlobals.h"
+#include "PolyString.h"
 #include <vector>
+#include <map>
+#include <string>
 
 #define RESOURCE_CHECK_INTERVAL	2000
 
+class OSFileEntry;
+
 namespace Polycode {
 
 	class Resource;
 	class PolycodeShaderModule;
-	class String;
 
 	/**
 	* Manages loading and unloading of resources from directories and archives. Should only be accessed via the CoreServices singleton. 
+	*
+	* Resources are indexed by a hash of their type and name and by a hash of their path, so lookups, adding and removing resources take constant time regardless of how many resources are loaded.
 	*/ 
 	class _PolyExport ResourceManager : public PolyBase {
 		public:
@@ -55,12 +61,12 @@ namespace Polycode {
 			
 			
 			/**
-			* Returns true if the following resource has been adde to the resource manager.
+			* Returns true if the following resource has been added to the resource manager.
 			* @param resource Resource to check.
 			*/
 			bool hasResource(Resource *resource);
 			/**
-			* Loads resources from a directory.
+			* Loads resources from a directory. The directory tree is scanned once, the image and material files found are read and parsed once each on the worker threads of the AssetLoader, and the resources are then created in dependency order: textures, shader programs, shaders, cubemaps, materials and fonts.
 			* @param dirPath Path to directory to load resources from.
 			* @param recursive If true, will recurse into subdirectories.
 			*/
@@ -93,6 +99,10 @@ namespace Polycode {
 			*/
 			Resource *getResource(int resourceType, const String& resourceName) const;
 
+			/**
+			* Request a loaded resource by the path it was loaded from.
+			* @param resourcePath Path of the resource.
+			*/
 			Resource *getResourceByPath(const String& resourcePath) const;
 
 		
@@ -104,16 +114,52 @@ namespace Polycode {
 		
 			void addShaderModule(PolycodeShaderModule *module);
 		
+			/**
+			* Reloads the resources marked with reloadOnFileModify whose files changed since they were loaded, by comparing the modification time of every resource's file.
+			*/
 			void checkForChangedFiles();
 		
 			void Update(int elapsed);
 			
+			/**
+			* If true, resources marked with reloadOnFileModify are reloaded when their files change. On Linux, the directories of the resources are watched with inotify and only the changed resources are reloaded. On other platforms, checkForChangedFiles() is called every RESOURCE_CHECK_INTERVAL milliseconds.
+			*/
 			bool reloadResourcesOnModify;
+			
+			/**
+			* If true, resource lookups are logged. Defaults to false.
+			*/
+			bool logLookups;
 		
 		private:
+		
+			friend class Resource;
+			
+			void indexResource(Resource *resource);
+			void unindexResource(Resource *resource);
+			
+			static unsigned int hashKey(int resourceType, const String& key);
+			
+			void collectDirEntries(const String& dirPath, bool recursive, const String& basePath, std::vector<OSFileEntry> &files, std::vector<String> &basePaths);
+			
+			static String getRealPath(const String& path);
+			void startWatching();
+			void stopWatching();
+			void watchResource(Resource *resource);
+			void unwatchResource(Resource *resource);
+			void readWatchEvents();
+			
 			int ticksSinceCheck;
+			
+			int watchDescriptor;
+			bool watchFailed;
+			std::map<int, String> watchedDirectories;
+			std::map<std::string, int> watchedDirectoryIDs;
+			std::multimap<unsigned int, Resource*> watchedFiles;
 		
 			std::vector <Resource*> resources;
+			std::multimap<unsigned int, Resource*> nameIndex;
+			std::multimap<unsigned int, Resource*> pathIndex;
 			std::vector <PolycodeShaderModule*> shaderModules;
 	};
 }
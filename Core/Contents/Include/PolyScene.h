@@ -33,7 +33,9 @@ class OSFILE;
 
 namespace Polycode {
 		
+	class AABBTree;
 	class Camera;
+	class RenderQueue;
 	class SceneEntity;
 	class SceneLight;
 	class SceneMesh;
@@ -124,13 +126,56 @@ namespace Polycode {
 		SceneEntity *getEntity(int index) { return entities[index]; }
 		
 		/**
-		* Returns the entity at the specified screen position. This is currently very slow and not super reliable.
+		* Returns the entity at the specified screen position, by casting a ray from the active camera against the world bounds of the scene's entities.
 		* @param x X position.
 		* @param y Y position.
-		* @return Entity at specified screen position.		
+		* @return Nearest entity at specified screen position, or NULL if there is none.
 		*/
 		SceneEntity *getEntityAtScreenPosition(Number x, Number y);
 		
+		/**
+		* Enables or disables the scene's spatial index. When enabled, the scene keeps the world bounds of its entities in an AABBTree, which is updated as entities move and is used for rendering, picking and the entity queries below. Recommended for scenes with many entities. Disabled by default.
+		* @param enabled If true, builds the spatial index, if false, removes it.
+		*/
+		void setSpatialIndexEnabled(bool enabled);
+		
+		/**
+		* Returns true if the scene's spatial index is enabled.
+		*/
+		bool isSpatialIndexEnabled() const;
+		
+		/**
+		* Returns the entities whose world bounds intersect a sphere. Entities without bounds are treated as points.
+		* @param center Center of the sphere.
+		* @param radius Radius of the sphere.
+		*/
+		std::vector<SceneEntity*> getEntitiesInSphere(const Vector3 &center, Number radius);
+		
+		/**
+		* Returns the entities whose world bounds intersect an axis aligned box. Entities without bounds are treated as points.
+		* @param boxMin Minimum corner of the box.
+		* @param boxMax Maximum corner of the box.
+		*/
+		std::vector<SceneEntity*> getEntitiesInBox(const Vector3 &boxMin, const Vector3 &boxMax);
+		
+		/**
+		* Returns the entities whose world bounds are inside or intersect a camera's frustum. Entities without bounds are always included. The camera's frustum planes must be built.
+		* @param camera Camera to test against.
+		*/
+		std::vector<SceneEntity*> getEntitiesInFrustum(Camera *camera);
+		
+		/**
+		* Returns the entity whose world bounds are hit first along a line segment.
+		* @param origin Start of the segment.
+		* @param dest End of the segment.
+		* @return The nearest entity hit, or NULL if there is none.
+		*/
+		SceneEntity *getEntityAlongRay(const Vector3 &origin, const Vector3 &dest);
+		
+		/**
+		* Renders the scene. Entities and their children are frustum culled against the camera by their world space bounds, and the camera's cullingStats are reset and filled in during the pass.
+		* @param targetCamera Camera to render with. If NULL, the active camera is used.
+		*/
 		void Render(Camera *targetCamera = NULL);
 		void RenderDepthOnly(Camera *targetCamera);
 		
@@ -166,6 +211,11 @@ namespace Polycode {
 		* If set to true, the renderer will use the scene's clear color when rendering the scene.
 		*/
 		bool useClearColor;
+		
+		/**
+		* If set to true, the scene collects the Render() calls of its entities in a RenderQueue and draws them sorted by render state instead of in scene graph order. This cuts state changes in scenes with many materials, but changes the draw order, so scenes that depend on entities being drawn in the order they were added should leave it off (defaults to false).
+		*/
+		bool useRenderQueue;
 
 		/**
 		* Ambient color, passed to lighting shaders
@@ -189,6 +239,37 @@ namespace Polycode {
 		
 	protected:
 		
+		class SceneSpatialEntry {
+			public:
+				SceneEntity *entity;
+				unsigned int index;
+				int proxyId;
+				// false while the entry is in unboundedEntries
+				bool bounded;
+				// true while the entry is in dirtySpatialEntries
+				bool queued;
+				// bounds the proxy was last fit to
+				Vector3 center;
+				Number radius;
+		};
+		
+		void addSpatialEntry(SceneEntity *entity);
+		void removeUnboundedEntry(SceneSpatialEntry *entry);
+		void queueSpatialUpdate(unsigned int index);
+		void updateSpatialIndex();
+		void collectEntitiesInFrustum(Camera *camera, std::vector<SceneEntity*> &results);
+		SceneEntity *pickEntity(const Vector3 &origin, const Vector3 &direction, Number maxDistance);
+		
+		RenderQueue *renderQueue;
+		AABBTree *spatialIndex;
+		// one entry per entity, in the same order as entities
+		std::vector<SceneSpatialEntry*> spatialEntries;
+		std::vector<SceneSpatialEntry*> unboundedEntries;
+		std::vector<SceneSpatialEntry*> dirtySpatialEntries;
+		std::vector<unsigned int> visibleMask;
+		std::vector<void*> spatialQueryResults;
+		std::vector<SceneEntity*> visibleEntities;
+		
 		bool hasLightmaps;
 		
 		std::vector <SceneLight*> lights;
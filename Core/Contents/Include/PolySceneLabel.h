@@ -33,7 +33,7 @@ namespace Polycode {
 	class ShaderBinding;
 
 	/**
-	* 3D text label. Creates a 3D text label.
+	* 3D text label. Creates a 3D text label. The text is drawn as textured quads from the font's shared GlyphAtlas.
 	*/
 	class _PolyExport SceneLabel : public ScenePrimitive {
 		public:
@@ -57,9 +57,12 @@ namespace Polycode {
 			
 			Label *getLabel();
 			
+			void Render();
+			
 		protected:
 			
 			void updateFromLabel();
+			bool updateGlyphMesh();
 			
 			Number scale;
 			Label *label;
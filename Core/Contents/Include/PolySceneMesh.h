@@ -87,6 +87,9 @@ namespace Polycode {
 			*/							
 			Material *getMaterial();
 			
+			Material *getRenderMaterial();
+			Texture *getRenderTexture();
+			
 			/**
 			* Loads a simple texture from a file name and applies it to the mesh.
 			* @param fileName Filename to load the mesh from.
@@ -164,9 +167,18 @@ namespace Polycode {
 			* If true, will delete its Skeleton upon destruction. (defaults to true)
 			*/ 			
 			bool ownsSkeleton;
+			
+			/**
+			* Maximum number of parts an indexed mesh is split into when it is skinned on the CPU. (defaults to 1) Large meshes are split into ranges of at least MIN_VERTICES_PER_SKINNING_THREAD vertices, which are skinned in parallel on the job system.
+			*/
+			int skinningThreadCount;
+			
+			static const int MIN_VERTICES_PER_SKINNING_THREAD = 4096;
 		
 		protected:
 		
+			void skinIndexedMesh();
+		
 			bool useVertexBuffer;
 			Mesh *mesh;
 			Texture *texture;
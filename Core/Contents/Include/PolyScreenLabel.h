@@ -30,7 +30,7 @@ namespace Polycode {
 	class ScreenImage;
 
 	/**
-	* 2D screen label display. Displays 2d text in a specified font.
+	* 2D screen label display. Displays 2d text in a specified font. The text is drawn as textured quads from the font's shared GlyphAtlas, so changing the text does not create a new texture.
 	*/ 
 	class _PolyExport ScreenLabel : public ScreenShape {
 		public:
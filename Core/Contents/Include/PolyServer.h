@@ -52,7 +52,7 @@ namespace Polycode {
 		ServerClient();
 		~ServerClient();
 		
-		ServerClientEvent *handlePacket(Packet *packet);
+		void handlePacket(Packet *packet);
 		
 		unsigned int clientID;
 		PeerConnection *connection;
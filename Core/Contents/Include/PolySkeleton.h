@@ -27,6 +27,7 @@ THE SOFTWARE.
 #include "PolyColor.h"
 #include "PolyVector3.h"
 #include "PolyQuaternion.h"
+#include "PolyMatrix4.h"
 #include "PolySceneEntity.h"
 #include <vector>
 
@@ -34,9 +35,22 @@ namespace Polycode {
 	
 	class BezierCurve;
 	class Bone;
+	class QuaternionCurve;
 	class QuaternionTween;
 	class BezierPathTween;
 	
+	/**
+	* Local position, rotation and scale of a bone. Used by the skeleton animation runtime to sample and blend animations.
+	*/
+	class _PolyExport BonePose {
+		public:
+			BonePose();
+			
+			Vector3 position;
+			Quaternion rotation;
+			Vector3 scale;
+	};
+	
 	class _PolyExport BoneTrack : public PolyBase {
 		public:
 			BoneTrack(Bone *bone, Number length);
@@ -47,6 +61,18 @@ namespace Polycode {
 		
 			void setSpeed(Number speed);
 			
+			/**
+			* Evaluates the track's curves at a position in the animation and writes the channels the track animates into a bone pose. Channels without curves are left unchanged.
+			* @param a Normalized (0-1) position in the animation.
+			* @param pose Pose to write the sampled values to.
+			*/
+			void samplePose(Number a, BonePose *pose);
+			
+			/**
+			* Returns the bone the track animates.
+			*/
+			Bone *getTargetBone() const;
+			
 			BezierCurve *scaleX;
 			BezierCurve *scaleY;
 			BezierCurve *scaleZ;
@@ -81,6 +107,7 @@ namespace Polycode {
 			Number length;
 		
 			bool initialized;
+			QuaternionCurve *quatCurve;
 		
 			Bone *targetBone;
 			std::vector <BezierPathTween*> pathTweens;
@@ -123,12 +150,73 @@ namespace Polycode {
 			*/					
 			void setSpeed(Number speed);
 			
+			/**
+			* Returns the animation multiplier speed.
+			*/
+			Number getSpeed() const;
+			
+			/**
+			* Returns the animation duration in seconds.
+			*/
+			Number getDuration() const;
+			
+			/**
+			* Returns the number of bone tracks in the animation.
+			*/
+			unsigned int getNumBoneTracks() const;
+			
+			/**
+			* Returns a bone track by index.
+			* @param index Index of the bone track.
+			*/
+			BoneTrack *getBoneTrack(unsigned int index) const;
+			
 		protected:
 			
 			String name;
 			Number duration;
+			Number speed;
 			std::vector<BoneTrack*> boneTracks;
 	};
+	
+	/**
+	* Playback state of an animation on a skeleton. The skeleton creates one for every animation it plays, crossfades or layers.
+	*/
+	class _PolyExport SkeletonAnimationState : public PolyBase {
+		public:
+			SkeletonAnimationState(SkeletonAnimation *animation);
+			
+			SkeletonAnimation *animation;
+			
+			/**
+			* Playback time in seconds.
+			*/
+			Number time;
+			
+			/**
+			* Current blend weight.
+			*/
+			Number weight;
+			
+			/**
+			* Weight the state is fading towards.
+			*/
+			Number targetWeight;
+			
+			/**
+			* Weight change per second while fading.
+			*/
+			Number fadeRate;
+			
+			int layer;
+			bool additive;
+			bool once;
+			
+			/**
+			* Index of the skeleton bone each of the animation's tracks animates, or -1.
+			*/
+			std::vector<int> trackBones;
+	};
 
 	/**
 	* 3D skeleton. Skeletons are applied to scene meshes and can be animated with loaded animations.
@@ -161,7 +249,7 @@ namespace Polycode {
 			virtual ~Skeleton();
 		
 			/**
-			* Play back a loaded animation.
+			* Play back a loaded animation. The animation replaces the animations on the base layer immediately.
 			* @param animName Name of animation to play.
 			* @param once If true, will only play the animation once.
 			*/
@@ -169,6 +257,51 @@ namespace Polycode {
 						
 			void playAnimationByIndex(int index, bool once = false);		
 			
+			/**
+			* Fades from the animations playing on the base layer to a loaded animation.
+			* @param animName Name of animation to play.
+			* @param fadeTime Duration of the crossfade in seconds.
+			* @param once If true, will only play the animation once.
+			*/
+			void crossfadeAnimation(const String& animName, Number fadeTime, bool once = false);
+			
+			/**
+			* Plays a loaded animation on a layer above the base animations. Layers only affect the bones their animation has tracks for and are applied in ascending order. Playing an animation on a layer fades out the animation already on that layer.
+			* @param animName Name of animation to play.
+			* @param layer Layer to play the animation on, 1 or higher.
+			* @param weight Blend weight of the layer, from 0 to 1.
+			* @param additive If true, the animation's offset from the bind pose is added to the pose below it instead of replacing it.
+			* @param once If true, will only play the animation once.
+			* @param fadeTime Time in seconds to fade the layer in.
+			*/
+			void playAnimationLayer(const String& animName, int layer, Number weight, bool additive = false, bool once = false, Number fadeTime = 0.0);
+			
+			/**
+			* Stops the animations on a layer. Layer 0 is the base layer.
+			* @param layer Layer to stop.
+			* @param fadeTime Time in seconds to fade the layer out.
+			*/
+			void stopAnimationLayer(int layer, Number fadeTime = 0.0);
+			
+			/**
+			* Stops all animations on the skeleton.
+			*/
+			void stopAnimations();
+			
+			/**
+			* Sets how often the skeleton samples its animations. Animation time still advances by the full elapsed time, so distant or small skeletons can be given a longer interval to save time without slowing down. Defaults to 0, which samples every frame.
+			* @param interval Interval in seconds.
+			*/
+			void setAnimationUpdateInterval(Number interval);
+			
+			Number getAnimationUpdateInterval() const;
+			
+			/**
+			* Advances the playing animations and rebuilds the bone matrices from them. Update() calls this with the frame's elapsed time.
+			* @param elapsed Elapsed time in seconds.
+			*/
+			void updateAnimations(Number elapsed);
+			
 			/**
 			* Loads in a new animation from a file and adds it to the skeleton.
 			* @param name Name of the new animation.
@@ -216,15 +349,44 @@ namespace Polycode {
 			Bone *getBone(int index) const;
 		
 			/**
-			* Returns the current animation.
+			* Returns the animation last played or crossfaded to on the base layer.
 			*/
 			SkeletonAnimation *getCurrentAnimation() const { return currentAnimation; }
+			
+			/**
+			* Returns the skinning matrix palette of the skeleton. The palette holds one 4x4 matrix of 16 floats per bone, in bone index order. Each matrix is the bone's rest matrix multiplied by its final matrix, so it takes a vertex from the bind pose straight to its animated position. The palette is rebuilt from the bone matrices at most once per frame, the first time it is requested after Update().
+			* @return Pointer to getNumBones()*16 floats, or NULL if the skeleton has no bones.
+			*/
+			POLYIGNORE const float *getSkinningPalette();
+			
+			/**
+			* Rebuilds the skinning palette from the current bone matrices. You only need to call this if you change bone matrices after the skeleton was updated for the frame.
+			*/
+			void updateSkinningPalette();
 		
 		protected:
 		
+			void buildBoneOrder();
+			void startAnimationState(SkeletonAnimation *animation, int layer, Number weight, bool additive, bool once, Number fadeTime);
+			void composeBoneMatrices();
+		
 			SceneEntity *bonesEntity;
+			
+			bool skinningPaletteDirty;
+			std::vector<unsigned int> boneOrder;
+			std::vector<Matrix4> finalMatrices;
+			std::vector<Matrix4> restMatrices;
+			std::vector<Matrix4> skinMatrices;
+			std::vector<float> skinningPalette;
 		
 			SkeletonAnimation *currentAnimation;
+			std::vector<SkeletonAnimationState*> animationStates;
+			std::vector<BonePose> bindPoses;
+			std::vector<BonePose> blendPoses;
+			std::vector<BonePose> samplePoses;
+			Number animationUpdateInterval;
+			Number animationTimeAccumulator;
+			
 			std::vector<Bone*> bones;
 			std::vector<SkeletonAnimation*> animations;
 	};
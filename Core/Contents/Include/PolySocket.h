@@ -170,6 +170,7 @@ namespace Polycode {
 		
 		private:
 			
+			SocketEvent receiveEvent;
 			
 			int sockId;
 	};
@@ -24,6 +24,8 @@
 #include "PolyGlobals.h"
 #include "PolyVector3.h"
 #include "PolyString.h"
+#include <vector>
+#include <deque>
 
 #if defined(__APPLE__) && defined(__MACH__)
     #include <OpenAL/al.h>
@@ -43,12 +45,85 @@
 
 #define BUFFER_SIZE 32768
 
+#define STREAM_BUFFER_COUNT 4
+#define STREAM_BUFFER_SIZE 65536
+
 namespace Polycode {
 	
 	class String;
+	class SoundManager;
+
+	/**
+	* Decoder state of a streamed Sound. The sound manager's stream thread decodes the file a chunk at a time into a small ring of PCM buffers ahead of playback, and the sound hands finished chunks to OpenAL on the main thread. All members below the file information are shared between the two threads and guarded by the sound manager's stream lock.
+	*/
+	class _PolyExport SoundStream {
+		public:
+			SoundStream();
+			~SoundStream();
+			
+			/**
+			* Opens an OGG file for streaming.
+			* @return True if the file could be opened.
+			*/
+			bool open(const String& fileName);
+			
+			/**
+			* Claims the stream for decoding its next chunk. Called on the stream thread with the stream lock held.
+			* @return True if the stream has a free chunk to decode into.
+			*/
+			bool beginDecode();
+			
+			/**
+			* Decodes the chunk claimed by beginDecode(). Called on the stream thread without the stream lock.
+			*/
+			void decode();
+			
+			/**
+			* Publishes the decoded chunk, unless the sound was seeked in the meantime. Called on the stream thread with the stream lock held.
+			*/
+			void endDecode();
+			
+			/**
+			* Discards all decoded chunks and makes the stream thread continue from a new position. Called with the stream lock held.
+			* @param sample Sample frame to continue from.
+			*/
+			void seek(long sample);
+			
+			int channels;
+			int frequency;
+			long totalSamples;
+			Number duration;
+			
+			std::vector<char> chunkData[STREAM_BUFFER_COUNT];
+			long chunkStart[STREAM_BUFFER_COUNT];
+			bool chunkReady[STREAM_BUFFER_COUNT];
+			unsigned int readIndex;
+			unsigned int writeIndex;
+			
+			bool loop;
+			bool finished;
+			bool decoding;
+			
+		protected:
+		
+			void *oggFile;
+			
+			unsigned int generation;
+			bool seekPending;
+			long seekSample;
+			
+			unsigned int decodeGeneration;
+			unsigned int decodeIndex;
+			bool decodeSeek;
+			long decodeSeekSample;
+			bool decodeLoop;
+			bool decodeEnded;
+			long decodeStart;
+			std::vector<char> decodeData;
+	};
 
 	/**
-	* Loads and plays a sound. This class can load and play an OGG or WAV sound file.
+	* Loads and plays a sound. This class can load and play an OGG or WAV sound file. Sounds loaded from files share their decoded samples through the SoundManager, so creating many sounds from the same file decodes it only once. Long OGG files like music can be streamed instead, see createStreamed().
 	*/
 	class _PolyExport Sound : public PolyBase {
 	public:
@@ -61,7 +136,42 @@ namespace Polycode {
 		Sound(const char *data, int size, int channels = 1, ALsizei freq = 44100, int bps = 16);
 		virtual ~Sound();
 		
-		void loadFile(String fileName);
+		/**
+		* Creates a sound that streams an OGG file instead of decoding all of it up front. Only a few chunks are held in memory at a time, and they are decoded on a background thread while the sound plays. Files other than OGG are loaded normally.
+		* @param fileName Path to the OGG file.
+		*/
+		static Sound *createStreamed(const String& fileName);
+		
+		/**
+		* Creates a sound from the 16 bit samples decoded from a file, for example by decodeOGG() on another thread. The sound shares its buffer with the other sounds of the file, so the samples are only uploaded if no sound has loaded the file yet.
+		* @param fileName Path of the file the samples were decoded from.
+		* @param data Decoded samples.
+		* @param channels Number of channels of the samples.
+		* @param frequency Sampling rate of the samples.
+		*/
+		static Sound *createFromSamples(const String& fileName, const std::vector<char> &data, int channels, int frequency);
+		
+		/**
+		* Loads a sound file, replacing the current sound.
+		* @param fileName Path to an OGG or WAV file to load.
+		* @param streamed If true, OGG files are streamed, see createStreamed().
+		*/
+		void loadFile(String fileName, bool streamed = false);
+		
+		/**
+		* Returns true if the sound streams its file.
+		*/
+		bool isStreamed();
+		
+		/**
+		* Returns the decoder state of a streamed sound, or NULL if the sound is not streamed.
+		*/
+		SoundStream *getStream();
+		
+		/**
+		* Queues newly decoded chunks of a streamed sound. Called every frame by the SoundManager.
+		*/
+		void updateStream();
 		
 		void reloadProperties();
 		
@@ -141,6 +251,16 @@ namespace Polycode {
 		ALuint loadWAV(const String& fileName);
 		ALuint loadOGG(const String& fileName);
 		
+		/**
+		* Decodes an OGG file into 16 bit PCM samples without using the sound device, so it can be called from any thread.
+		* @param fileName Path to the OGG file.
+		* @param data Vector the samples are appended to.
+		* @param channels Set to the number of channels of the file.
+		* @param frequency Set to the sampling rate of the file.
+		* @return True if the file was decoded.
+		*/
+		static bool decodeOGG(const String& fileName, std::vector<char> &data, int *channels, int *frequency);
+		
 		ALuint GenSource(ALuint buffer);
 		ALuint GenSource();
 	
@@ -152,6 +272,10 @@ namespace Polycode {
 
 	protected:
 	
+		Sound();
+		void unloadSound();
+		void resetStream(long sample);
+	
 		Number referenceDistance;
 		Number maxDistance;
 			
@@ -164,8 +288,20 @@ namespace Polycode {
 	
 		bool isPositional;
 		ALuint buffer; // Kept around only for deletion purposes
+		bool bufferCached;
 		ALuint soundSource;
 		int sampleLength;
 		
+		SoundManager *soundManager;
+		SoundStream *stream;
+		ALenum streamFormat;
+		bool streamPlaying;
+		bool streamRewound;
+		long streamPosition;
+		std::vector<ALuint> streamBuffers;
+		std::vector<ALuint> freeStreamBuffers;
+		// start and length in sample frames of each chunk queued on the source
+		std::deque<std::pair<long, long> > queuedStreamChunks;
+		
 	};
 }
@@ -23,6 +23,9 @@
 #pragma once
 #include "PolyGlobals.h"
 #include "PolyVector3.h"
+#include "PolyString.h"
+#include "PolyThreaded.h"
+#include <vector>
 
 #if defined(__APPLE__) && defined(__MACH__)
     #include <OpenAL/al.h>
@@ -34,14 +37,55 @@
 
 namespace Polycode {
 	
+	class Sound;
+	class SoundManager;
+	
+	/**
+	* Decoded sound file shared by all sounds loaded from it.
+	*/
+	class _PolyExport SoundBufferEntry {
+		public:
+			String fileName;
+			ALuint buffer;
+			int sampleLength;
+			unsigned int size;
+			int refCount;
+			unsigned int lastUsed;
+	};
+	
+	/**
+	* Thread that decodes streamed sounds ahead of their playback.
+	*/
+	class _PolyExport SoundStreamWorker : public Threaded {
+		public:
+			SoundStreamWorker(SoundManager *manager);
+			virtual ~SoundStreamWorker();
+			
+			void runThread();
+			void updateThread();
+			
+			/**
+			* Set by the worker once its thread has stopped running.
+			*/
+			volatile bool threadStopped;
+			
+		protected:
+			SoundManager *manager;
+	};
+	
 	/**
-	* Controls global sound settings.
+	* Controls global sound settings. The sound manager also keeps the decoded samples of sound files that are shared between sounds, and runs the thread that decodes streamed sounds.
 	*/
 	class _PolyExport SoundManager : public PolyBase{
 	public:
 		SoundManager();
 		~SoundManager();
 		
+		/**
+		* Feeds decoded chunks to streamed sounds. Called every frame by CoreServices.
+		*/
+		void Update();
+		
 		void setListenerPosition(Vector3 position);
 		void setListenerOrientation(Vector3 orientation, Vector3 upVector);	
 		void initAL();
@@ -51,10 +95,73 @@ namespace Polycode {
 		*/ 
 		void setGlobalVolume(Number globalVolume);
 		
+		/**
+		* Returns the shared buffer of a sound file and adds a reference to it.
+		* @param fileName Path of the sound file.
+		* @param sampleLength Set to the sample length of the buffer.
+		* @return The buffer or AL_NONE if the file has not been loaded.
+		*/
+		ALuint getCachedBuffer(const String& fileName, int *sampleLength);
+		
+		/**
+		* Adds a newly decoded buffer to the cache with one reference.
+		*/
+		void addCachedBuffer(const String& fileName, ALuint buffer, int sampleLength);
+		
+		/**
+		* Removes a reference from a shared buffer. Buffers nobody uses are kept until the unused buffers exceed the cache size.
+		*/
+		void releaseCachedBuffer(ALuint buffer);
+		
+		/**
+		* Sets how many bytes of buffers that are no longer used by any sound are kept around for reuse. Defaults to 8 MB.
+		*/
+		void setSoundCacheSize(unsigned int bytes);
+		
+		/**
+		* Deletes all cached buffers that are not used by any sound.
+		*/
+		void clearUnusedBuffers();
+		
+		void addStreamedSound(Sound *sound);
+		void removeStreamedSound(Sound *sound);
+		
+		/**
+		* Locks the state shared between streamed sounds and the stream thread.
+		*/
+		void lockStreams();
+		void unlockStreams();
+		
+		/**
+		* Wakes the stream thread after a streamed sound consumed a chunk, seeked or started playing. Call with the streams locked.
+		*/
+		void notifyStreams();
+		
+		/**
+		* Decodes one chunk of a streamed sound that needs more data, or waits until notifyStreams() is called if none does. Called by the stream thread.
+		* @return True if a chunk was decoded.
+		*/
+		bool decodeStreams();
 		
 	protected:
 		
+		void evictUnusedBuffers();
+		
 		ALCdevice* device;
 		ALCcontext* context;		
+		
+		std::vector<SoundBufferEntry> cachedBuffers;
+		unsigned int unusedBufferBytes;
+		unsigned int soundCacheSize;
+		unsigned int bufferUseCounter;
+		
+		std::vector<Sound*> streamedSounds;
+		unsigned int nextStream;
+		SoundStreamWorker *streamWorker;
+		
+		void *streamMutex;
+		void *streamCondition;
+		void *decodeCondition;
+		bool streamsChanged;
 	};
 }
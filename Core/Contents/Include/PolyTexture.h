@@ -42,6 +42,9 @@ namespace Polycode {
 			virtual void setTextureData(char *data) = 0;
 
 			virtual void recreateFromImageData() = 0;
+			
+			// replaces generated mipmaps with the precomputed ones of the image
+			virtual void setMipmaps(Image *image);
 
 			Number getScrollOffsetX() const;
 			Number getScrollOffsetY() const;
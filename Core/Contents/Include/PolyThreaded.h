@@ -27,12 +27,65 @@ THE SOFTWARE.
 namespace Polycode{
 
 	class Core;
-	class CoreMutex;
+	
+	/**
+	* Bounded single producer, single consumer ring buffer of events. The Threaded thread pushes its events and the main thread pops them, without either side taking a lock. When the queue is full, new events are dropped and counted.
+	*/
+	class _PolyExport ThreadedEventQueue {
+	public:
+		/**
+		* Constructor.
+		* @param capacity Maximum number of queued events. Rounded up to a power of two.
+		*/
+		ThreadedEventQueue(unsigned int capacity);
+		~ThreadedEventQueue();
+		
+		/**
+		* Adds an event to the queue. Must only be called by the producing thread.
+		* @return False if the queue was full and the event was dropped.
+		*/
+		bool push(Event *event);
+		
+		/**
+		* Removes the oldest event from the queue. Must only be called by the consuming thread.
+		* @return The event or NULL if the queue is empty.
+		*/
+		Event *pop();
+		
+		/**
+		* Returns the number of events currently in the queue.
+		*/
+		unsigned int getDepth() const;
+		
+		/**
+		* Returns the largest number of events that were in the queue at once.
+		*/
+		unsigned int getMaxDepth() const;
+		
+		/**
+		* Returns the number of events that were dropped because the queue was full.
+		*/
+		unsigned int getDroppedCount() const;
+		
+		unsigned int getCapacity() const;
+		
+	protected:
+		Event **events;
+		unsigned int capacity;
+		unsigned int mask;
+		
+		volatile unsigned int head;
+		volatile unsigned int tail;
+		volatile unsigned int maxDepth;
+		volatile unsigned int droppedCount;
+	};
 	
 	/**
 	* An easy way to create threaded processes. If you subclass this class, you can implement the updateThread method, which will be called in its own thread repeatedly until threadRunning is false once the thread is created. If you only need to run through something once, make sure to set threadRunning to avoid it being called again. 
 	
 		To create the thread, pass your Threaded subclass to createThread method of Core.
+		
+		Events dispatched by the thread are put in its event queue and delivered to listeners on the main thread once per frame by Core. The queue is bounded, events dispatched while it is full are dropped.
 		@see Core
 	*/
 	class _PolyExport Threaded : public EventDispatcher {
@@ -51,17 +104,33 @@ namespace Polycode{
 		*/
 		virtual void updateThread() {};
 		
+		/**
+		* Queues an event for delivery on the main thread. Must only be called from the thread itself.
+		*/
 		void dispatchEvent(Event *event, int eventCode);		
 		void dispatchEventNoDelete(Event *event, int eventCode);
 		
+		/**
+		* Replaces the event queue with one of a different capacity. Must be called before the thread is created.
+		* @param capacity Maximum number of queued events. (defaults to DEFAULT_EVENT_QUEUE_CAPACITY)
+		*/
+		void setEventQueueCapacity(unsigned int capacity);
+		
+		/**
+		* Returns the event queue, which also holds the queue depth and drop counts.
+		*/
+		ThreadedEventQueue *getEventQueue();
+		
 		bool threadRunning;
 		
 		Core *core;
 		
 		bool scheduledForRemoval;
 		
-		CoreMutex *eventMutex;		
-		std::vector<Event*> eventQueue;
+		static const unsigned int DEFAULT_EVENT_QUEUE_CAPACITY = 1024;
+		
+	protected:
+		ThreadedEventQueue *eventQueue;
 	};
 	
 }
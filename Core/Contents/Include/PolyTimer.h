@@ -24,11 +24,14 @@ THE SOFTWARE.
 #pragma once
 #include "PolyGlobals.h"
 #include "PolyEventDispatcher.h"
+#include "PolyEvent.h"
 
 namespace Polycode {
 	
+	class TimerManager;
+	
 	/** 
-	* A timer that dispatches trigger events.
+	* A timer that dispatches trigger events. Timers are scheduled by the TimerManager and only cost time when they trigger.
 	*/ 
 	class _PolyExport Timer : public EventDispatcher {
 		public:
@@ -52,6 +55,11 @@ namespace Polycode {
 		bool isPaused();
 		
 		unsigned int getTicks();
+		
+		/**
+		* Triggers the timer if its interval has passed. This is called by the timer manager when the timer is due.
+		* @param ticks Current core ticks.
+		*/
 		void Update(unsigned int ticks);
 		
 		/**
@@ -70,6 +78,8 @@ namespace Polycode {
 		static const int EVENT_TRIGGER = 0;
 		
 		protected:
+		
+			friend class TimerManager;
 			
 			int elapsed;
 			bool paused;
@@ -77,5 +87,12 @@ namespace Polycode {
 			bool triggerMode;
 			unsigned int last;
 			unsigned int ticks;
+			
+			Event triggerEvent;
+			
+			unsigned int expires;
+			Timer *wheelPrev;
+			Timer *wheelNext;
+			Timer **wheelList;
 	};
 }
@@ -22,12 +22,16 @@ THE SOFTWARE.
 
 #pragma once
 #include "PolyGlobals.h"
-#include <vector>
 
 namespace Polycode {
 
 	class Timer;
 
+	/**
+	* Schedules and triggers timers. Trigger timers are kept in a hierarchical timer wheel, so an update only touches the timers that are due and idle timers cost nothing per frame. Adding, rescheduling and removing a timer take constant time and do not allocate memory.
+	*
+	* Timers register themselves with the manager, so you should never need to call the timer methods of the manager yourself.
+	*/
 	class _PolyExport TimerManager : public PolyBase{
 		public:
 		TimerManager();
@@ -35,10 +39,56 @@ namespace Polycode {
 		
 		void removeTimer(Timer *timer);
 		void addTimer(Timer *timer);
+		
+		/**
+		* Reschedules a timer after its interval, pause state or start time changed.
+		*/
+		void rescheduleTimer(Timer *timer);
+		
+		/**
+		* Restarts a timer. The timer starts counting from the next update.
+		*/
+		void resetTimer(Timer *timer);
+		
 		void Update();
 		
+		/**
+		* Returns the core ticks of the last update, in milliseconds.
+		*/
+		unsigned int getTicks() const;
+		
+		/**
+		* Returns the number of timers registered with the manager.
+		*/
+		int getTimerCount() const;
+		
+		/**
+		* Returns the number of trigger timers waiting in the timer wheel.
+		*/
+		int getScheduledTimerCount() const;
+		
+		static const int ROOT_BITS = 8;
+		static const int LEVEL_BITS = 6;
+		static const int ROOT_SIZE = 1 << ROOT_BITS;
+		static const int LEVEL_SIZE = 1 << LEVEL_BITS;
+		static const int LEVEL_COUNT = 3;
+		
 		private:
 		
-		std::vector <Timer*> timers;
+		void insertTimer(Timer *timer, unsigned int expires);
+		void linkTimer(Timer *timer, Timer **list);
+		void unlinkTimer(Timer *timer);
+		void cascade(int level, int index);
+		
+		Timer *rootWheel[ROOT_SIZE];
+		Timer *levelWheels[LEVEL_COUNT][LEVEL_SIZE];
+		Timer *pendingTimers;
+		
+		unsigned int wheelTime;
+		unsigned int currentTicks;
+		bool started;
+		
+		int timerCount;
+		int scheduledCount;
 	};
 }
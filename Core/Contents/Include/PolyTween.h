@@ -28,12 +28,12 @@ THE SOFTWARE.
 namespace Polycode {
 	
 	class BezierCurve;
-	class Timer;
 	class Quaternion;
 	class QuaternionCurve;
+	class TweenManager;
 	
 	/**
-	* Tween animation class. This class lets you tween a floating point value over a period of time with different easing types.
+	* Tween animation class. This class lets you tween a floating point value over a period of time with different easing types. Tweens are advanced by the TweenManager, which keeps their state.
 	*/	
 	class _PolyExport Tween : public EventDispatcher {
 	public:
@@ -50,8 +50,18 @@ namespace Polycode {
 		Tween(Number *target, int easeType, Number startVal, Number endVal, Number time, bool repeat=false, bool deleteOnComplete=false, Number waitTime = 0.0);
 		virtual ~Tween();
 		
-		void handleEvent(Event *event);
 		Number interpolateTween();
+		
+		/**
+		* Returns the eased value of a tween at a point in time.
+		* @param easeType Easing type.
+		* @param time Time since the start of the tween.
+		* @param startVal Value at the start of the tween.
+		* @param changeVal Difference between the end and start values.
+		* @param duration Duration of the tween.
+		*/
+		static Number interpolate(int easeType, Number time, Number startVal, Number changeVal, Number duration);
+		
 		virtual void updateCustomTween() {}
 		void doOnComplete();
 		
@@ -105,18 +115,10 @@ namespace Polycode {
 
 	protected:
 	
-		Number waitTime;
-		int easeType;
-		bool complete;
-		Number endVal;
-		Number cVal;
-		Number startVal;
+		friend class TweenManager;
+	
 		Number actEndTime;
-		Number endTime;
-		Number *targetVal;
-		Number localTargetVal;
-		Number tweenTime;
-		Timer *tweenTimer;
+		int tweenIndex;
 	};
 	
 	/**
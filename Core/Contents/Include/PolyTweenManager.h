@@ -28,15 +28,62 @@ namespace Polycode {
 
 	class Tween;
 
+	/**
+	* Per-frame state of a tween. The tween manager keeps the state of all tweens in one array, so advancing them is a single pass over contiguous memory.
+	*/
+	class _PolyExport TweenState {
+		public:
+			Tween *tween;
+			Number *target;
+			Number startVal;
+			Number changeVal;
+			Number endVal;
+			Number time;
+			Number waitTime;
+			Number duration;
+			int easeType;
+			bool paused;
+			bool complete;
+	};
+
+	/**
+	* Updates all tweens. The tween manager owns the state of every tween and advances all running tweens once per frame from the frame's elapsed time, then dispatches the completion events of the tweens that finished. Running tweens are kept at the front of the state array, so paused and completed tweens cost nothing per frame.
+	*
+	* Tweens add and remove themselves from the manager, so you should never need to call addTween() or removeTween() yourself.
+	*/
 	class _PolyExport TweenManager : public PolyBase {
 		public:
 			TweenManager();
 			~TweenManager();
 			void addTween(Tween *tween);
 			void removeTween(Tween *tween);	
-			void Update();
+			
+			/**
+			* Advances all running tweens and completes the ones that have finished.
+			* @param elapsed Elapsed time since the last update, in milliseconds.
+			*/
+			void Update(int elapsed);
+			
+			/**
+			* Returns the number of tweens registered with the manager.
+			*/
+			int getTweenCount() const;
+			
+			/**
+			* Returns the number of tweens that are neither paused nor complete.
+			*/
+			int getActiveTweenCount() const;
+			
+			TweenState *getTweenState(Tween *tween);
+			void setTweenActive(Tween *tween, bool active);
 		
 		private:
-			std::vector <Tween*> tweens;
+		
+			void swapStates(int indexA, int indexB);
+			
+			std::vector<TweenState> states;
+			int activeCount;
+			
+			std::vector<Tween*> completedTweens;
 	};
 }
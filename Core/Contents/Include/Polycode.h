@@ -29,16 +29,22 @@
 #include "PolyLogger.h"
 #include "PolyConfig.h"
 #include "PolyPerlin.h"
+#include "PolyProfiler.h"
 #include "PolyEntity.h"
+#include "PolyAABBTree.h"
 #include "PolyPolygon.h"
 #include "PolyEvent.h"
 #include "PolyEventDispatcher.h"
 #include "PolyEventHandler.h"
 #include "PolyTimer.h"
+#include "PolyTimerManager.h"
 #include "PolyTween.h"
 #include "PolyTweenManager.h"
 #include "PolyResourceManager.h"
+#include "PolyAssetLoader.h"
+#include "PolyJobSystem.h"
 #include "PolyCore.h"
+#include "PolyHeadlessCore.h"
 #include "PolyCoreInput.h"
 #include "PolyInputKeys.h"
 #include "PolyInputEvent.h"
@@ -47,6 +53,8 @@
 #include "PolyQuaternionCurve.h"
 #include "PolyRectangle.h"
 #include "PolyRenderer.h"
+#include "PolyRenderQueue.h"
+#include "PolyNullRenderer.h"
 #include "PolyCoreServices.h"
 #include "PolyScreen.h"
 #include "PolyScreenEntity.h"
@@ -57,6 +65,7 @@
 #include "PolyLabel.h"
 #include "PolyFont.h"
 #include "PolyFontManager.h"
+#include "PolyGlyphAtlas.h"
 #include "PolyScreenImage.h"
 #include "PolyScreenSprite.h"
 #include "PolyScreenLabel.h"
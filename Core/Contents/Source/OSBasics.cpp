@@ -433,3 +433,14 @@ bool OSBasics::isFolder(const String& pathString) {
 #endif
 	return retVal;
 }
+
+int OSBasics::getProcessorCount() {
+#ifdef _WINDOWS
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? count : 1;
+#endif
+}
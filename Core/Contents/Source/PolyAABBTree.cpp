@@ -0,0 +1,478 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+#include "PolyAABBTree.h"
+#include "PolyCamera.h"
+
+using namespace Polycode;
+
+AABB::AABB() {
+}
+
+AABB::AABB(const Vector3 &min, const Vector3 &max) : min(min), max(max) {
+}
+
+AABB AABB::fromSphere(const Vector3 &center, Number radius) {
+	return AABB(Vector3(center.x - radius, center.y - radius, center.z - radius), Vector3(center.x + radius, center.y + radius, center.z + radius));
+}
+
+AABB AABB::merged(const AABB &other) const {
+	return AABB(Vector3(std::min(min.x, other.min.x), std::min(min.y, other.min.y), std::min(min.z, other.min.z)),
+				Vector3(std::max(max.x, other.max.x), std::max(max.y, other.max.y), std::max(max.z, other.max.z)));
+}
+
+AABB AABB::expanded(Number amount) const {
+	return AABB(Vector3(min.x - amount, min.y - amount, min.z - amount), Vector3(max.x + amount, max.y + amount, max.z + amount));
+}
+
+bool AABB::contains(const AABB &other) const {
+	return (min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+			max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z);
+}
+
+bool AABB::intersects(const AABB &other) const {
+	return (min.x <= other.max.x && max.x >= other.min.x &&
+			min.y <= other.max.y && max.y >= other.min.y &&
+			min.z <= other.max.z && max.z >= other.min.z);
+}
+
+bool AABB::intersectsSphere(const Vector3 &center, Number radius) const {
+	// squared distance from the center to the closest point of the box
+	Number distance = 0;
+	Number point[3] = {center.x, center.y, center.z};
+	Number boxMin[3] = {min.x, min.y, min.z};
+	Number boxMax[3] = {max.x, max.y, max.z};
+	for(int i=0; i < 3; i++) {
+		if(point[i] < boxMin[i]) {
+			distance += (boxMin[i] - point[i]) * (boxMin[i] - point[i]);
+		} else if(point[i] > boxMax[i]) {
+			distance += (point[i] - boxMax[i]) * (point[i] - boxMax[i]);
+		}
+	}
+	return distance <= radius * radius;
+}
+
+bool AABB::intersectsRay(const Vector3 &origin, const Vector3 &direction, Number maxDistance, Number *entryDistance) const {
+	Number tMin = 0;
+	Number tMax = maxDistance;
+	Number rayOrigin[3] = {origin.x, origin.y, origin.z};
+	Number rayDirection[3] = {direction.x, direction.y, direction.z};
+	Number boxMin[3] = {min.x, min.y, min.z};
+	Number boxMax[3] = {max.x, max.y, max.z};
+	
+	for(int i=0; i < 3; i++) {
+		if(rayDirection[i] == 0) {
+			if(rayOrigin[i] < boxMin[i] || rayOrigin[i] > boxMax[i])
+				return false;
+			continue;
+		}
+		Number inverse = 1.0 / rayDirection[i];
+		Number t1 = (boxMin[i] - rayOrigin[i]) * inverse;
+		Number t2 = (boxMax[i] - rayOrigin[i]) * inverse;
+		if(t1 > t2) {
+			Number swap = t1;
+			t1 = t2;
+			t2 = swap;
+		}
+		if(t1 > tMin)
+			tMin = t1;
+		if(t2 < tMax)
+			tMax = t2;
+		if(tMin > tMax)
+			return false;
+	}
+	
+	if(entryDistance)
+		*entryDistance = tMin;
+	return true;
+}
+
+Vector3 AABB::getCenter() const {
+	return Vector3((min.x + max.x) * 0.5, (min.y + max.y) * 0.5, (min.z + max.z) * 0.5);
+}
+
+Number AABB::getSurfaceArea() const {
+	Number x = max.x - min.x;
+	Number y = max.y - min.y;
+	Number z = max.z - min.z;
+	return 2.0 * (x*y + y*z + z*x);
+}
+
+AABBTree::AABBTree() {
+	root = -1;
+	freeList = -1;
+	proxyCount = 0;
+	margin = 0.1;
+}
+
+AABBTree::~AABBTree() {
+}
+
+int AABBTree::allocateNode() {
+	if(freeList == -1) {
+		AABBTreeNode node;
+		node.parent = -1;
+		nodes.push_back(node);
+		freeList = nodes.size() - 1;
+	}
+	
+	int nodeId = freeList;
+	freeList = nodes[nodeId].parent;
+	
+	AABBTreeNode &node = nodes[nodeId];
+	node.userData = NULL;
+	node.parent = -1;
+	node.child1 = -1;
+	node.child2 = -1;
+	node.height = 0;
+	return nodeId;
+}
+
+void AABBTree::freeNode(int nodeId) {
+	// free nodes are chained through their parent index
+	nodes[nodeId].parent = freeList;
+	nodes[nodeId].height = -1;
+	freeList = nodeId;
+}
+
+AABB AABBTree::fatten(const AABB &box) const {
+	Number size = std::max(box.max.x - box.min.x, std::max(box.max.y - box.min.y, box.max.z - box.min.z));
+	return box.expanded(margin + size * 0.1);
+}
+
+int AABBTree::createProxy(const AABB &box, void *userData) {
+	int proxyId = allocateNode();
+	nodes[proxyId].box = box;
+	nodes[proxyId].fatBox = fatten(box);
+	nodes[proxyId].userData = userData;
+	insertLeaf(proxyId);
+	proxyCount++;
+	return proxyId;
+}
+
+void AABBTree::destroyProxy(int proxyId) {
+	if(proxyId < 0 || proxyId >= nodes.size() || !nodes[proxyId].isLeaf() || nodes[proxyId].height != 0)
+		return;
+	removeLeaf(proxyId);
+	freeNode(proxyId);
+	proxyCount--;
+}
+
+bool AABBTree::moveProxy(int proxyId, const AABB &box) {
+	AABBTreeNode &node = nodes[proxyId];
+	node.box = box;
+	if(node.fatBox.contains(box))
+		return false;
+	
+	removeLeaf(proxyId);
+	nodes[proxyId].fatBox = fatten(box);
+	insertLeaf(proxyId);
+	return true;
+}
+
+void *AABBTree::getUserData(int proxyId) const {
+	return nodes[proxyId].userData;
+}
+
+const AABB &AABBTree::getBounds(int proxyId) const {
+	return nodes[proxyId].box;
+}
+
+void AABBTree::clear() {
+	nodes.clear();
+	root = -1;
+	freeList = -1;
+	proxyCount = 0;
+}
+
+unsigned int AABBTree::getProxyCount() const {
+	return proxyCount;
+}
+
+int AABBTree::getHeight() const {
+	if(root == -1)
+		return 0;
+	return nodes[root].height;
+}
+
+void AABBTree::insertLeaf(int leaf) {
+	if(root == -1) {
+		root = leaf;
+		nodes[root].parent = -1;
+		return;
+	}
+	
+	// walk down to the sibling that increases the total surface area the least
+	AABB leafBox = nodes[leaf].fatBox;
+	int index = root;
+	while(!nodes[index].isLeaf()) {
+		int child1 = nodes[index].child1;
+		int child2 = nodes[index].child2;
+		
+		Number area = nodes[index].fatBox.getSurfaceArea();
+		Number combinedArea = nodes[index].fatBox.merged(leafBox).getSurfaceArea();
+		
+		// cost of making a new parent for this node and the leaf
+		Number cost = 2.0 * combinedArea;
+		// minimum cost of pushing the leaf further down
+		Number inheritanceCost = 2.0 * (combinedArea - area);
+		
+		Number cost1 = nodes[child1].fatBox.merged(leafBox).getSurfaceArea() + inheritanceCost;
+		if(!nodes[child1].isLeaf())
+			cost1 -= nodes[child1].fatBox.getSurfaceArea();
+		
+		Number cost2 = nodes[child2].fatBox.merged(leafBox).getSurfaceArea() + inheritanceCost;
+		if(!nodes[child2].isLeaf())
+			cost2 -= nodes[child2].fatBox.getSurfaceArea();
+		
+		if(cost < cost1 && cost < cost2)
+			break;
+		
+		index = (cost1 < cost2) ? child1 : child2;
+	}
+	
+	int sibling = index;
+	int oldParent = nodes[sibling].parent;
+	int newParent = allocateNode();
+	nodes[newParent].parent = oldParent;
+	nodes[newParent].fatBox = leafBox.merged(nodes[sibling].fatBox);
+	nodes[newParent].height = nodes[sibling].height + 1;
+	nodes[newParent].child1 = sibling;
+	nodes[newParent].child2 = leaf;
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+	
+	if(oldParent != -1) {
+		if(nodes[oldParent].child1 == sibling) {
+			nodes[oldParent].child1 = newParent;
+		} else {
+			nodes[oldParent].child2 = newParent;
+		}
+	} else {
+		root = newParent;
+	}
+	
+	refit(nodes[leaf].parent);
+}
+
+void AABBTree::removeLeaf(int leaf) {
+	if(leaf == root) {
+		root = -1;
+		return;
+	}
+	
+	int parent = nodes[leaf].parent;
+	int grandParent = nodes[parent].parent;
+	int sibling = (nodes[parent].child1 == leaf) ? nodes[parent].child2 : nodes[parent].child1;
+	
+	if(grandParent != -1) {
+		if(nodes[grandParent].child1 == parent) {
+			nodes[grandParent].child1 = sibling;
+		} else {
+			nodes[grandParent].child2 = sibling;
+		}
+		nodes[sibling].parent = grandParent;
+		freeNode(parent);
+		refit(grandParent);
+	} else {
+		root = sibling;
+		nodes[sibling].parent = -1;
+		freeNode(parent);
+	}
+	nodes[leaf].parent = -1;
+}
+
+void AABBTree::refit(int nodeId) {
+	while(nodeId != -1) {
+		nodeId = balance(nodeId);
+		
+		int child1 = nodes[nodeId].child1;
+		int child2 = nodes[nodeId].child2;
+		nodes[nodeId].height = 1 + std::max(nodes[child1].height, nodes[child2].height);
+		nodes[nodeId].fatBox = nodes[child1].fatBox.merged(nodes[child2].fatBox);
+		
+		nodeId = nodes[nodeId].parent;
+	}
+}
+
+int AABBTree::balance(int a) {
+	// rotates a grandchild up if the subtrees of a differ in height by more
+	// than one, and returns the node now at a's position
+	if(nodes[a].isLeaf() || nodes[a].height < 2)
+		return a;
+	
+	int b = nodes[a].child1;
+	int c = nodes[a].child2;
+	int heightDifference = nodes[c].height - nodes[b].height;
+	
+	if(heightDifference > 1) {
+		// rotate c up
+		int f = nodes[c].child1;
+		int g = nodes[c].child2;
+		
+		nodes[c].child1 = a;
+		nodes[c].parent = nodes[a].parent;
+		nodes[a].parent = c;
+		
+		if(nodes[c].parent != -1) {
+			if(nodes[nodes[c].parent].child1 == a) {
+				nodes[nodes[c].parent].child1 = c;
+			} else {
+				nodes[nodes[c].parent].child2 = c;
+			}
+		} else {
+			root = c;
+		}
+		
+		if(nodes[f].height > nodes[g].height) {
+			nodes[c].child2 = f;
+			nodes[a].child2 = g;
+			nodes[g].parent = a;
+			nodes[a].fatBox = nodes[b].fatBox.merged(nodes[g].fatBox);
+			nodes[c].fatBox = nodes[a].fatBox.merged(nodes[f].fatBox);
+			nodes[a].height = 1 + std::max(nodes[b].height, nodes[g].height);
+			nodes[c].height = 1 + std::max(nodes[a].height, nodes[f].height);
+		} else {
+			nodes[c].child2 = g;
+			nodes[a].child2 = f;
+			nodes[f].parent = a;
+			nodes[a].fatBox = nodes[b].fatBox.merged(nodes[f].fatBox);
+			nodes[c].fatBox = nodes[a].fatBox.merged(nodes[g].fatBox);
+			nodes[a].height = 1 + std::max(nodes[b].height, nodes[f].height);
+			nodes[c].height = 1 + std::max(nodes[a].height, nodes[g].height);
+		}
+		return c;
+	}
+	
+	if(heightDifference < -1) {
+		// rotate b up
+		int d = nodes[b].child1;
+		int e = nodes[b].child2;
+		
+		nodes[b].child1 = a;
+		nodes[b].parent = nodes[a].parent;
+		nodes[a].parent = b;
+		
+		if(nodes[b].parent != -1) {
+			if(nodes[nodes[b].parent].child1 == a) {
+				nodes[nodes[b].parent].child1 = b;
+			} else {
+				nodes[nodes[b].parent].child2 = b;
+			}
+		} else {
+			root = b;
+		}
+		
+		if(nodes[d].height > nodes[e].height) {
+			nodes[b].child2 = d;
+			nodes[a].child1 = e;
+			nodes[e].parent = a;
+			nodes[a].fatBox = nodes[c].fatBox.merged(nodes[e].fatBox);
+			nodes[b].fatBox = nodes[a].fatBox.merged(nodes[d].fatBox);
+			nodes[a].height = 1 + std::max(nodes[c].height, nodes[e].height);
+			nodes[b].height = 1 + std::max(nodes[a].height, nodes[d].height);
+		} else {
+			nodes[b].child2 = e;
+			nodes[a].child1 = d;
+			nodes[d].parent = a;
+			nodes[a].fatBox = nodes[c].fatBox.merged(nodes[d].fatBox);
+			nodes[b].fatBox = nodes[a].fatBox.merged(nodes[e].fatBox);
+			nodes[a].height = 1 + std::max(nodes[c].height, nodes[d].height);
+			nodes[b].height = 1 + std::max(nodes[a].height, nodes[e].height);
+		}
+		return b;
+	}
+	
+	return a;
+}
+
+void AABBTree::queryBox(const AABB &box, std::vector<void*> &results) const {
+	if(root == -1)
+		return;
+	queryStack.clear();
+	queryStack.push_back(root);
+	while(queryStack.size() > 0) {
+		const AABBTreeNode &node = nodes[queryStack.back()];
+		queryStack.pop_back();
+		if(node.isLeaf()) {
+			if(node.box.intersects(box))
+				results.push_back(node.userData);
+		} else if(node.fatBox.intersects(box)) {
+			queryStack.push_back(node.child1);
+			queryStack.push_back(node.child2);
+		}
+	}
+}
+
+void AABBTree::querySphere(const Vector3 &center, Number radius, std::vector<void*> &results) const {
+	if(root == -1)
+		return;
+	queryStack.clear();
+	queryStack.push_back(root);
+	while(queryStack.size() > 0) {
+		const AABBTreeNode &node = nodes[queryStack.back()];
+		queryStack.pop_back();
+		if(node.isLeaf()) {
+			if(node.box.intersectsSphere(center, radius))
+				results.push_back(node.userData);
+		} else if(node.fatBox.intersectsSphere(center, radius)) {
+			queryStack.push_back(node.child1);
+			queryStack.push_back(node.child2);
+		}
+	}
+}
+
+void AABBTree::queryFrustum(Camera *camera, std::vector<void*> &results) const {
+	if(root == -1)
+		return;
+	queryStack.clear();
+	queryStack.push_back(root);
+	while(queryStack.size() > 0) {
+		const AABBTreeNode &node = nodes[queryStack.back()];
+		queryStack.pop_back();
+		if(node.isLeaf()) {
+			if(camera->isAABBInFrustum(node.box))
+				results.push_back(node.userData);
+		} else if(camera->isAABBInFrustum(node.fatBox)) {
+			queryStack.push_back(node.child1);
+			queryStack.push_back(node.child2);
+		}
+	}
+}
+
+void AABBTree::queryRay(const Vector3 &origin, const Vector3 &direction, Number maxDistance, std::vector<void*> &results) const {
+	if(root == -1)
+		return;
+	queryStack.clear();
+	queryStack.push_back(root);
+	while(queryStack.size() > 0) {
+		const AABBTreeNode &node = nodes[queryStack.back()];
+		queryStack.pop_back();
+		if(node.isLeaf()) {
+			if(node.box.intersectsRay(origin, direction, maxDistance, NULL))
+				results.push_back(node.userData);
+		} else if(node.fatBox.intersectsRay(origin, direction, maxDistance, NULL)) {
+			queryStack.push_back(node.child1);
+			queryStack.push_back(node.child2);
+		}
+	}
+}
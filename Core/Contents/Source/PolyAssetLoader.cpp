@@ -0,0 +1,632 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+#include "PolyAssetLoader.h"
+#include "PolyCore.h"
+#include "PolyCoreServices.h"
+#include "PolyImage.h"
+#include "PolyLogger.h"
+#include "PolyMaterial.h"
+#include "PolyMaterialManager.h"
+#include "PolyMesh.h"
+#include "PolyProfiler.h"
+#include "PolyRenderer.h"
+#include "PolyResourceManager.h"
+#include "PolySound.h"
+#include "PolyTexture.h"
+#include "OSBasics.h"
+#include "tinyxml.h"
+
+#if defined(_WINDOWS)
+	#include <windows.h>
+#else
+	#include <pthread.h>
+	#include <unistd.h>
+#endif
+
+using namespace Polycode;
+
+#define DEFAULT_TEXTURE "default/default.png"
+
+static void sleepWorker() {
+#if defined(_WINDOWS)
+	Sleep(1);
+#else
+	usleep(1000);
+#endif
+}
+
+AssetEvent::AssetEvent() : Event() {
+	request = NULL;
+	progress = 0.0;
+}
+
+AssetEvent::~AssetEvent() {
+
+}
+
+AssetRequest::AssetRequest(int assetType, const String& path) : EventDispatcher() {
+	this->assetType = assetType;
+	this->path = path;
+	state = STATE_QUEUED;
+	released = false;
+	synchronous = false;
+	clamp = false;
+	createMipmaps = true;
+	premultiplyAlpha = false;
+	useVertexBuffer = false;
+	image = NULL;
+	mesh = NULL;
+	soundChannels = 0;
+	soundFrequency = 0;
+	document = NULL;
+	texture = NULL;
+	sound = NULL;
+}
+
+AssetRequest::~AssetRequest() {
+	// decoded data that never reached the main thread stage
+	delete image;
+	delete document;
+	if(state != STATE_LOADED)
+		delete mesh;
+}
+
+int AssetRequest::getAssetType() const {
+	return assetType;
+}
+
+const String& AssetRequest::getPath() const {
+	return path;
+}
+
+int AssetRequest::getState() const {
+	return state;
+}
+
+Number AssetRequest::getProgress() const {
+	switch(state) {
+		case STATE_QUEUED:
+			return 0.0;
+		case STATE_DECODING:
+			return 0.25;
+		case STATE_DECODED:
+		case STATE_DECODE_FAILED:
+			return 0.5;
+		default:
+			return 1.0;
+	}
+}
+
+bool AssetRequest::isDone() const {
+	return state == STATE_LOADED || state == STATE_FAILED;
+}
+
+bool AssetRequest::isLoaded() const {
+	return state == STATE_LOADED;
+}
+
+Texture *AssetRequest::getTexture() {
+	return texture;
+}
+
+Mesh *AssetRequest::getMesh() {
+	if(state != STATE_LOADED)
+		return NULL;
+	return mesh;
+}
+
+Sound *AssetRequest::getSound() {
+	return sound;
+}
+
+unsigned int AssetRequest::getNumMaterials() {
+	return materials.size();
+}
+
+Material *AssetRequest::getMaterial(unsigned int index) {
+	if(index < materials.size())
+		return materials[index];
+	return NULL;
+}
+
+Image *AssetRequest::getDecodedImage() {
+	return image;
+}
+
+TiXmlDocument *AssetRequest::getDecodedDocument() {
+	return document;
+}
+
+AssetLoaderWorker::AssetLoaderWorker(AssetLoader *loader) : Threaded() {
+	this->loader = loader;
+	threadStopped = false;
+}
+
+AssetLoaderWorker::~AssetLoaderWorker() {
+
+}
+
+void AssetLoaderWorker::runThread() {
+	Threaded::runThread();
+	threadStopped = true;
+}
+
+void AssetLoaderWorker::updateThread() {
+	AssetRequest *request = loader->takeRequest();
+	if(request) {
+		loader->finishDecode(request, AssetLoader::decodeRequest(request));
+	} else {
+		loader->waitForRequest();
+	}
+}
+
+AssetLoader::AssetLoader() {
+	core = NULL;
+	queueMutex = NULL;
+	numWorkers = 2;
+	uploadBudget = 4.0;
+	pendingCount = 0;
+	batchTotal = 0;
+	batchFinished = 0;
+	wakeCount = 0;
+	
+#if defined(_WINDOWS)
+	wakeMutex = new CRITICAL_SECTION;
+	InitializeCriticalSection((CRITICAL_SECTION*)wakeMutex);
+	wakeCondition = new CONDITION_VARIABLE;
+	InitializeConditionVariable((CONDITION_VARIABLE*)wakeCondition);
+#else
+	wakeMutex = new pthread_mutex_t;
+	pthread_mutex_init((pthread_mutex_t*)wakeMutex, NULL);
+	wakeCondition = new pthread_cond_t;
+	pthread_cond_init((pthread_cond_t*)wakeCondition, NULL);
+#endif
+}
+
+AssetLoader::~AssetLoader() {
+	for(int i=0; i < workers.size(); i++) {
+		workers[i]->killThread();
+	}
+	signalWorkers(workers.size());
+	for(int i=0; i < workers.size(); i++) {
+		while(!workers[i]->threadStopped) {
+			sleepWorker();
+		}
+		delete workers[i];
+	}
+	
+	// released requests are only referenced by the queues, the others are
+	// in requests as well and must still be alive when the queues are read
+	std::deque<AssetRequest*> remaining;
+	remaining.insert(remaining.end(), queuedRequests.begin(), queuedRequests.end());
+	remaining.insert(remaining.end(), decodedRequests.begin(), decodedRequests.end());
+	remaining.insert(remaining.end(), uploadQueue.begin(), uploadQueue.end());
+	for(int i=0; i < remaining.size(); i++) {
+		if(remaining[i]->released)
+			delete remaining[i];
+	}
+	for(int i=0; i < requests.size(); i++) {
+		delete requests[i];
+	}
+	
+#if defined(_WINDOWS)
+	DeleteCriticalSection((CRITICAL_SECTION*)wakeMutex);
+	delete (CRITICAL_SECTION*)wakeMutex;
+	delete (CONDITION_VARIABLE*)wakeCondition;
+#else
+	pthread_mutex_destroy((pthread_mutex_t*)wakeMutex);
+	delete (pthread_mutex_t*)wakeMutex;
+	pthread_cond_destroy((pthread_cond_t*)wakeCondition);
+	delete (pthread_cond_t*)wakeCondition;
+#endif
+}
+
+void AssetLoader::signalWorkers(unsigned int count) {
+#if defined(_WINDOWS)
+	EnterCriticalSection((CRITICAL_SECTION*)wakeMutex);
+	wakeCount += count;
+	WakeAllConditionVariable((CONDITION_VARIABLE*)wakeCondition);
+	LeaveCriticalSection((CRITICAL_SECTION*)wakeMutex);
+#else
+	pthread_mutex_lock((pthread_mutex_t*)wakeMutex);
+	wakeCount += count;
+	pthread_cond_broadcast((pthread_cond_t*)wakeCondition);
+	pthread_mutex_unlock((pthread_mutex_t*)wakeMutex);
+#endif
+}
+
+void AssetLoader::waitForRequest() {
+#if defined(_WINDOWS)
+	EnterCriticalSection((CRITICAL_SECTION*)wakeMutex);
+	while(wakeCount == 0) {
+		SleepConditionVariableCS((CONDITION_VARIABLE*)wakeCondition, (CRITICAL_SECTION*)wakeMutex, INFINITE);
+	}
+	wakeCount--;
+	LeaveCriticalSection((CRITICAL_SECTION*)wakeMutex);
+#else
+	pthread_mutex_lock((pthread_mutex_t*)wakeMutex);
+	while(wakeCount == 0) {
+		pthread_cond_wait((pthread_cond_t*)wakeCondition, (pthread_mutex_t*)wakeMutex);
+	}
+	wakeCount--;
+	pthread_mutex_unlock((pthread_mutex_t*)wakeMutex);
+#endif
+}
+
+void AssetLoader::lockQueue() {
+	if(queueMutex)
+		core->lockMutex(queueMutex);
+}
+
+void AssetLoader::unlockQueue() {
+	if(queueMutex)
+		core->unlockMutex(queueMutex);
+}
+
+void AssetLoader::startWorkers() {
+	core = CoreServices::getInstance()->getCore();
+	queueMutex = core->createMutex();
+	for(int i=0; i < numWorkers; i++) {
+		AssetLoaderWorker *worker = new AssetLoaderWorker(this);
+		workers.push_back(worker);
+		core->createThread(worker);
+	}
+}
+
+AssetRequest *AssetLoader::queueRequest(AssetRequest *request) {
+	if(!queueMutex && numWorkers > 0) {
+		startWorkers();
+	}
+	
+	requests.push_back(request);
+	pendingCount++;
+	batchTotal++;
+	
+	lockQueue();
+	queuedRequests.push_back(request);
+	unlockQueue();
+	signalWorkers(1);
+	return request;
+}
+
+AssetRequest *AssetLoader::loadTexture(const String& fileName, bool clamp, bool createMipmaps) {
+	MaterialManager *materialManager = CoreServices::getInstance()->getMaterialManager();
+	AssetRequest *request = new AssetRequest(AssetRequest::ASSET_TEXTURE, fileName);
+	request->clamp = clamp;
+	request->createMipmaps = createMipmaps;
+	request->premultiplyAlpha = materialManager->premultiplyAlphaOnLoad;
+	
+	if(materialManager->getTextureByResourcePath(fileName)) {
+		// already loaded, only the main thread stage is left
+		requests.push_back(request);
+		pendingCount++;
+		batchTotal++;
+		request->state = AssetRequest::STATE_DECODED;
+		uploadQueue.push_back(request);
+		return request;
+	}
+	return queueRequest(request);
+}
+
+AssetRequest *AssetLoader::loadMesh(const String& fileName, bool useVertexBuffer) {
+	AssetRequest *request = new AssetRequest(AssetRequest::ASSET_MESH, fileName);
+	request->useVertexBuffer = useVertexBuffer;
+	return queueRequest(request);
+}
+
+AssetRequest *AssetLoader::loadSound(const String& fileName) {
+	return queueRequest(new AssetRequest(AssetRequest::ASSET_SOUND, fileName));
+}
+
+AssetRequest *AssetLoader::loadMaterials(const String& fileName) {
+	return queueRequest(new AssetRequest(AssetRequest::ASSET_MATERIALS, fileName));
+}
+
+void AssetLoader::releaseRequest(AssetRequest *request) {
+	for(int i=0; i < requests.size(); i++) {
+		if(requests[i] == request) {
+			requests.erase(requests.begin()+i);
+			break;
+		}
+	}
+	
+	// only the main thread finishes requests, so a request that is not
+	// done yet is still referenced by one of the queues
+	lockQueue();
+	bool done = request->isDone();
+	if(!done)
+		request->released = true;
+	unlockQueue();
+	
+	if(done) {
+		delete request;
+	}
+}
+
+AssetRequest *AssetLoader::takeRequest() {
+	AssetRequest *request = NULL;
+	lockQueue();
+	if(queuedRequests.size() > 0) {
+		request = queuedRequests.front();
+		queuedRequests.pop_front();
+		request->state = AssetRequest::STATE_DECODING;
+	}
+	unlockQueue();
+	return request;
+}
+
+void AssetLoader::finishDecode(AssetRequest *request, bool decoded) {
+	lockQueue();
+	if(decoded)
+		request->state = AssetRequest::STATE_DECODED;
+	else
+		request->state = AssetRequest::STATE_DECODE_FAILED;
+	if(!request->synchronous)
+		decodedRequests.push_back(request);
+	unlockQueue();
+}
+
+void AssetLoader::decodeBatch(const std::vector<AssetRequest*> &batch) {
+	if(!queueMutex && numWorkers > 0) {
+		startWorkers();
+	}
+	
+	lockQueue();
+	for(int i=0; i < batch.size(); i++) {
+		batch[i]->synchronous = true;
+		queuedRequests.push_back(batch[i]);
+	}
+	unlockQueue();
+	signalWorkers(batch.size());
+	
+	// the calling thread decodes alongside the workers until the batch is done
+	while(true) {
+		AssetRequest *request = takeRequest();
+		if(request) {
+			finishDecode(request, decodeRequest(request));
+			continue;
+		}
+		
+		bool done = true;
+		lockQueue();
+		for(int i=0; i < batch.size(); i++) {
+			if(batch[i]->state == AssetRequest::STATE_QUEUED || batch[i]->state == AssetRequest::STATE_DECODING) {
+				done = false;
+				break;
+			}
+		}
+		unlockQueue();
+		
+		if(done)
+			break;
+		sleepWorker();
+	}
+}
+
+bool AssetLoader::decodeRequest(AssetRequest *request) {
+	switch(request->assetType) {
+		case AssetRequest::ASSET_TEXTURE:
+		{
+			Image *image = CoreServices::getInstance()->getMaterialManager()->loadTextureImage(request->path, request->premultiplyAlpha, request->createMipmaps);
+			if(!image->isLoaded()) {
+				delete image;
+				return false;
+			}
+			request->image = image;
+		}
+		break;
+		case AssetRequest::ASSET_MESH:
+		{
+			if(!OSBasics::fileExists(request->path)) {
+				Logger::log("Error opening mesh file %s\n", request->path.c_str());
+				return false;
+			}
+			Mesh *mesh = new Mesh(Mesh::TRI_MESH);
+			mesh->loadMesh(request->path);
+			request->mesh = mesh;
+		}
+		break;
+		case AssetRequest::ASSET_SOUND:
+		{
+			OSFileEntry entry(request->path, OSFileEntry::TYPE_FILE);
+			if(entry.extension == "ogg" || entry.extension == "OGG") {
+				if(!Sound::decodeOGG(request->path, request->soundData, &request->soundChannels, &request->soundFrequency) || request->soundData.size() == 0) {
+					return false;
+				}
+			}
+		}
+		break;
+		case AssetRequest::ASSET_MATERIALS:
+		{
+			TiXmlDocument *document = new TiXmlDocument(request->path.c_str());
+			document->LoadFile();
+			if(document->Error() || !document->RootElement()) {
+				Logger::log("XML Error in %s: %s\n", request->path.c_str(), document->ErrorDesc());
+				delete document;
+				return false;
+			}
+			request->document = document;
+		}
+		break;
+		default:
+			return false;
+	}
+	return true;
+}
+
+void AssetLoader::finishRequest(AssetRequest *request) {
+	pendingCount--;
+	batchFinished++;
+	
+	if(request->released) {
+		delete request;
+		return;
+	}
+	
+	bool loaded = (request->state == AssetRequest::STATE_DECODED);
+	MaterialManager *materialManager = CoreServices::getInstance()->getMaterialManager();
+	
+	switch(request->assetType) {
+		case AssetRequest::ASSET_TEXTURE:
+		{
+			request->texture = materialManager->getTextureByResourcePath(request->path);
+			if(!request->texture && loaded) {
+				Image *image = request->image;
+				request->texture = materialManager->createTextureFromImage(image, request->clamp, request->createMipmaps);
+				request->texture->setResourcePath(request->path);
+				CoreServices::getInstance()->getResourceManager()->addResource(request->texture);
+			}
+			delete request->image;
+			request->image = NULL;
+			
+			if(!request->texture) {
+				Logger::log("Error loading image (\"%s\"), using default texture.\n", request->path.c_str());
+				request->texture = materialManager->getTextureByResourcePath(DEFAULT_TEXTURE);
+				loaded = false;
+			} else {
+				loaded = true;
+			}
+		}
+		break;
+		case AssetRequest::ASSET_MESH:
+			if(loaded && request->useVertexBuffer) {
+				CoreServices::getInstance()->getRenderer()->createVertexBufferForMesh(request->mesh);
+			}
+		break;
+		case AssetRequest::ASSET_SOUND:
+			if(loaded) {
+				if(request->soundData.size() > 0) {
+					request->sound = Sound::createFromSamples(request->path, request->soundData, request->soundChannels, request->soundFrequency);
+					std::vector<char>().swap(request->soundData);
+				} else {
+					request->sound = new Sound(request->path);
+				}
+			}
+		break;
+		case AssetRequest::ASSET_MATERIALS:
+			if(loaded) {
+				request->materials = materialManager->materialsFromXMLDocument(request->document);
+				for(int m=0; m < request->materials.size(); m++) {
+					Material *material = request->materials[m];
+					material->setResourceName(material->getName());
+					CoreServices::getInstance()->getResourceManager()->addResource(material);
+					materialManager->addMaterial(material);
+				}
+			}
+			delete request->document;
+			request->document = NULL;
+		break;
+	}
+	
+	if(loaded) {
+		request->state = AssetRequest::STATE_LOADED;
+		dispatchRequestEvent(request, AssetEvent::EVENT_ASSET_LOADED);
+	} else {
+		request->state = AssetRequest::STATE_FAILED;
+		dispatchRequestEvent(request, AssetEvent::EVENT_ASSET_FAILED);
+	}
+}
+
+void AssetLoader::dispatchRequestEvent(AssetRequest *request, int eventCode) {
+	AssetEvent event;
+	event.request = request;
+	event.progress = request->getProgress();
+	request->dispatchEventNoDelete(&event, eventCode);
+}
+
+void AssetLoader::Update() {
+	// collect what the workers decoded since the last frame
+	lockQueue();
+	for(int i=0; i < decodedRequests.size(); i++) {
+		uploadQueue.push_back(decodedRequests[i]);
+	}
+	int numDecoded = decodedRequests.size();
+	decodedRequests.clear();
+	unlockQueue();
+	
+	for(int i=uploadQueue.size()-numDecoded; i < uploadQueue.size(); i++) {
+		if(!uploadQueue[i]->released && uploadQueue[i]->state == AssetRequest::STATE_DECODED) {
+			dispatchRequestEvent(uploadQueue[i], AssetEvent::EVENT_ASSET_PROGRESS);
+		}
+	}
+	
+	double startTime = Profiler::getMicroseconds();
+	while(true) {
+		AssetRequest *request = NULL;
+		if(uploadQueue.size() > 0) {
+			request = uploadQueue.front();
+			uploadQueue.pop_front();
+		} else if(numWorkers == 0) {
+			// no workers, decode on the main thread
+			request = takeRequest();
+			if(request) {
+				if(decodeRequest(request))
+					request->state = AssetRequest::STATE_DECODED;
+				else
+					request->state = AssetRequest::STATE_DECODE_FAILED;
+			}
+		}
+		if(!request)
+			break;
+		
+		finishRequest(request);
+		
+		if(Profiler::getMicroseconds() - startTime >= uploadBudget * 1000.0)
+			break;
+	}
+	
+	if(pendingCount == 0) {
+		batchTotal = 0;
+		batchFinished = 0;
+	}
+}
+
+void AssetLoader::setUploadBudget(Number milliseconds) {
+	uploadBudget = milliseconds;
+}
+
+Number AssetLoader::getUploadBudget() const {
+	return uploadBudget;
+}
+
+void AssetLoader::setNumWorkers(int numWorkers) {
+	if(workers.size() > 0) {
+		Logger::log("AssetLoader: workers are already running, ignoring setNumWorkers\n");
+		return;
+	}
+	this->numWorkers = numWorkers;
+}
+
+int AssetLoader::getNumWorkers() const {
+	return numWorkers;
+}
+
+unsigned int AssetLoader::getPendingCount() const {
+	return pendingCount;
+}
+
+Number AssetLoader::getProgress() const {
+	if(batchTotal == 0)
+		return 1.0;
+	return ((Number)batchFinished) / ((Number)batchTotal);
+}
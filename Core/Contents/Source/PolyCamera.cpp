@@ -21,6 +21,7 @@
 */
 
 #include "PolyCamera.h"
+#include "PolyAABBTree.h"
 #include "PolyCore.h"
 #include "PolyCoreServices.h"
 #include "PolyMaterial.h"
@@ -33,6 +34,16 @@
 
 using namespace Polycode;
 			
+CullingStats::CullingStats() {
+	reset();
+}
+
+void CullingStats::reset() {
+	entitiesVisited = 0;
+	entitiesCulled = 0;
+	entitiesDrawn = 0;
+}
+
 Camera::Camera(Scene *parentScene) : SceneEntity() {
 	setParentScene(parentScene);
 	orthoMode = false;
@@ -87,6 +98,20 @@ bool Camera::isSphereInFrustum(Vector3 pos, Number fRadius) {
     return true;
 }
 
+bool Camera::isAABBInFrustum(const AABB &box) {
+	if(!frustumCulling)
+		return true;
+	for(int i = 0; i < 6; ++i) {
+		// test the corner furthest along the plane normal
+		Number x = frustumPlanes[i][0] >= 0 ? box.max.x : box.min.x;
+		Number y = frustumPlanes[i][1] >= 0 ? box.max.y : box.min.y;
+		Number z = frustumPlanes[i][2] >= 0 ? box.max.z : box.min.z;
+		if(frustumPlanes[i][0] * x + frustumPlanes[i][1] * y + frustumPlanes[i][2] * z + frustumPlanes[i][3] < 0)
+			return false;
+	}
+	return true;
+}
+
 void Camera::setOrthoMode(bool mode, Number orthoSizeX, Number orthoSizeY) {
 	this->orthoSizeX = orthoSizeX;
 	this->orthoSizeY = orthoSizeY;
@@ -253,7 +278,7 @@ void Camera::buildFrustumPlanes() {
 }
 
 bool Camera::canSee(SceneEntity *entity) {
-	return isSphereInFrustum(entity->getPosition(), entity->getBBoxRadius());
+	return isSphereInFrustum(entity->getWorldBoundsCenter(), entity->getSubtreeBoundsRadius());
 }
 
 void Camera::setParentScene(Scene *parentScene) {
@@ -37,7 +37,7 @@ Client::Client(unsigned int port, int rate) : Peer(port) {
 }
 
 Client::~Client() {
-	
+	delete rateTimer;
 }
 
 void Client::handleEvent(Event *event) {
@@ -23,6 +23,7 @@
 #include "PolyCore.h"
 #include "PolyCoreInput.h"
 #include "PolyCoreServices.h"
+#include "PolyProfiler.h"
 
 #ifdef _WINDOWS
 #include <windows.h>
@@ -137,7 +138,6 @@ namespace Polycode {
 		if(!threadedEventMutex) {
 			threadedEventMutex = createMutex();
 		}
-		target->eventMutex = threadedEventMutex;
 		target->core = this;
 		
 		lockMutex(threadedEventMutex);
@@ -172,7 +172,13 @@ namespace Polycode {
 			for(int i=0; i < threads.size(); i++) {
 				if(threads[i] == thread) {
 					threads.erase(threads.begin() + i);
-					return;
+					break;
+				}
+			}
+			// a thread deleted by one of its own event handlers must not be drained any further
+			for(int i=0; i < dispatchThreads.size(); i++) {
+				if(dispatchThreads[i] == thread) {
+					dispatchThreads[i] = NULL;
 				}
 			}
 			unlockMutex(threadedEventMutex);			
@@ -186,6 +192,9 @@ namespace Polycode {
 	}
 							
 	void Core::updateCore() {
+		services->getProfiler()->newFrame();
+		EventDispatcher::endFrameStats();
+		
 		frames++;
 		frameTicks = getTicks();
 		elapsed = frameTicks - lastFrameTicks;
@@ -203,24 +212,39 @@ namespace Polycode {
 		lastFrameTicks = frameTicks;
 		
 		if(threadedEventMutex){ 
+		ProfilerZone zone("Core::dispatchThreadedEvents");
+		
+		// the lock only guards the thread list, handlers run without it so they never block the threads
 		lockMutex(threadedEventMutex);
-
-		std::vector<Threaded*>::iterator iter = threads.begin();
-		while (iter != threads.end()) {		
-			for(int j=0; j < (*iter)->eventQueue.size(); j++) {
-				Event *event = (*iter)->eventQueue[j];
-				(*iter)->__dispatchEvent(event, event->getEventCode());
+		dispatchThreads = threads;
+		unlockMutex(threadedEventMutex);
+		
+		for(int i=0; i < dispatchThreads.size(); i++) {
+			if(!dispatchThreads[i])
+				continue;
+			ThreadedEventQueue *queue = dispatchThreads[i]->getEventQueue();
+			// only deliver what was queued when the frame started, so a busy thread cannot stall the frame
+			unsigned int count = queue->getDepth();
+			for(unsigned int j=0; j < count && dispatchThreads[i]; j++) {
+				Event *event = queue->pop();
+				if(!event)
+					break;
+				dispatchThreads[i]->__dispatchEvent(event, event->getEventCode());
 				if(event->deleteOnDispatch)
 					delete event;
 			}
-			(*iter)->eventQueue.clear();
+		}
+		
+		lockMutex(threadedEventMutex);
+		std::vector<Threaded*>::iterator iter = threads.begin();
+		while (iter != threads.end()) {		
 			if((*iter)->scheduledForRemoval) {
 				iter = threads.erase(iter);
 			} else {
 				++iter;
 			}
 		}
-		
+		dispatchThreads.clear();
 		unlockMutex(threadedEventMutex);
 		}
 	}
@@ -93,20 +93,20 @@ namespace Polycode {
 		JoystickInfo joystick;
 		joystick.deviceID = deviceID;
 		joysticks.push_back(joystick);
-		InputEvent *evt = new InputEvent();
-		evt->joystickDeviceID = deviceID;
-		evt->joystickIndex = joysticks.size()-1;
-		dispatchEvent(evt, InputEvent::EVENT_JOYDEVICE_ATTACHED);				
+		InputEvent evt;
+		evt.joystickDeviceID = deviceID;
+		evt.joystickIndex = joysticks.size()-1;
+		dispatchEventNoDelete(&evt, InputEvent::EVENT_JOYDEVICE_ATTACHED);				
 	}
 	
 	void CoreInput::removeJoystick(unsigned int deviceID) {
 		for(int i=0;i<joysticks.size();i++) {
 			if(joysticks[i].deviceID == deviceID) {
 				joysticks.erase(joysticks.begin()+i);
-				InputEvent *evt = new InputEvent();
-				evt->joystickDeviceID = deviceID;
-				evt->joystickIndex = i;
-				dispatchEvent(evt, InputEvent::EVENT_JOYDEVICE_DETACHED);
+				InputEvent evt;
+				evt.joystickDeviceID = deviceID;
+				evt.joystickIndex = i;
+				dispatchEventNoDelete(&evt, InputEvent::EVENT_JOYDEVICE_DETACHED);
 				return;
 			}
 		}	
@@ -116,12 +116,12 @@ namespace Polycode {
 		JoystickInfo *info = getJoystickInfoByID(deviceID);
 		if(info) {
 			info->joystickAxisState[axisID] = value;
-			InputEvent *evt = new InputEvent();
-			evt->joystickDeviceID = deviceID;
-			evt->joystickAxis = axisID;
-			evt->joystickAxisValue = value;
-			evt->joystickIndex = info->deviceIndex;
-			dispatchEvent(evt, InputEvent::EVENT_JOYAXIS_MOVED);
+			InputEvent evt;
+			evt.joystickDeviceID = deviceID;
+			evt.joystickAxis = axisID;
+			evt.joystickAxisValue = value;
+			evt.joystickIndex = info->deviceIndex;
+			dispatchEventNoDelete(&evt, InputEvent::EVENT_JOYAXIS_MOVED);
 		}	
 	}
 	
@@ -129,11 +129,11 @@ namespace Polycode {
 		JoystickInfo *info = getJoystickInfoByID(deviceID);
 		if(info) {
 			info->joystickButtonState[buttonID] = true;
-			InputEvent *evt = new InputEvent();
-			evt->joystickDeviceID = deviceID;
-			evt->joystickButton = buttonID;
-			evt->joystickIndex = info->deviceIndex;			
-			dispatchEvent(evt, InputEvent::EVENT_JOYBUTTON_DOWN);
+			InputEvent evt;
+			evt.joystickDeviceID = deviceID;
+			evt.joystickButton = buttonID;
+			evt.joystickIndex = info->deviceIndex;			
+			dispatchEventNoDelete(&evt, InputEvent::EVENT_JOYBUTTON_DOWN);
 		}		
 	}
 	
@@ -141,11 +141,11 @@ namespace Polycode {
 		JoystickInfo *info = getJoystickInfoByID(deviceID);
 		if(info) {
 			info->joystickButtonState[buttonID] = false;
-			InputEvent *evt = new InputEvent();
-			evt->joystickDeviceID = deviceID;
-			evt->joystickButton = buttonID;
-			evt->joystickIndex = info->deviceIndex;			
-			dispatchEvent(evt, InputEvent::EVENT_JOYBUTTON_UP);
+			InputEvent evt;
+			evt.joystickDeviceID = deviceID;
+			evt.joystickButton = buttonID;
+			evt.joystickIndex = info->deviceIndex;			
+			dispatchEventNoDelete(&evt, InputEvent::EVENT_JOYBUTTON_UP);
 		}	
 	}
 	
@@ -155,12 +155,12 @@ namespace Polycode {
 	}
 	
 	void CoreInput::setMouseButtonState(int mouseButton, bool state, int ticks) {
-		InputEvent *evt = new InputEvent(mousePosition, ticks);
-		evt->mouseButton = mouseButton;		
+		InputEvent evt(mousePosition, ticks);
+		evt.mouseButton = mouseButton;		
 		if(state)
-			dispatchEvent(evt, InputEvent::EVENT_MOUSEDOWN);
+			dispatchEventNoDelete(&evt, InputEvent::EVENT_MOUSEDOWN);
 		else
-			dispatchEvent(evt, InputEvent::EVENT_MOUSEUP);
+			dispatchEventNoDelete(&evt, InputEvent::EVENT_MOUSEUP);
 		mouseButtons[mouseButton] = state;
 				
 		if(simulateTouchWithMouse && mouseButton == MOUSE_BUTTON1) {
@@ -179,20 +179,20 @@ namespace Polycode {
 	}
 	
 	void CoreInput::mouseWheelDown(int ticks) {
-		InputEvent *evt = new InputEvent(mousePosition, ticks);
-		dispatchEvent(evt, InputEvent::EVENT_MOUSEWHEEL_DOWN);				
+		InputEvent evt(mousePosition, ticks);
+		dispatchEventNoDelete(&evt, InputEvent::EVENT_MOUSEWHEEL_DOWN);				
 	}
 	
 	void CoreInput::mouseWheelUp(int ticks) {
-		InputEvent *evt = new InputEvent(mousePosition, ticks);
-		dispatchEvent(evt, InputEvent::EVENT_MOUSEWHEEL_UP);		
+		InputEvent evt(mousePosition, ticks);
+		dispatchEventNoDelete(&evt, InputEvent::EVENT_MOUSEWHEEL_UP);		
 	}
 	
 	void CoreInput::setMousePosition(int x, int y, int ticks) {
 		mousePosition.x = x;
 		mousePosition.y = y;
-		InputEvent *evt = new InputEvent(mousePosition, ticks);
-		dispatchEvent(evt, InputEvent::EVENT_MOUSEMOVE);
+		InputEvent evt(mousePosition, ticks);
+		dispatchEventNoDelete(&evt, InputEvent::EVENT_MOUSEMOVE);
 		
 		if(simulateTouchWithMouse && mouseButtons[MOUSE_BUTTON1]) {
 			TouchInfo touch;
@@ -226,38 +226,38 @@ namespace Polycode {
 	}
 	
 	void CoreInput::setKeyState(PolyKEY keyCode, wchar_t code, bool newState, int ticks) {
-		InputEvent *evt = new InputEvent(keyCode, code, ticks);
+		InputEvent evt(keyCode, code, ticks);
 		if(keyCode < 512)
 			keyboardState[keyCode] = newState;
 		if(newState) {
-			dispatchEvent(evt, InputEvent::EVENT_KEYDOWN);
+			dispatchEventNoDelete(&evt, InputEvent::EVENT_KEYDOWN);
 		} else {
-			dispatchEvent(evt, InputEvent::EVENT_KEYUP);
+			dispatchEventNoDelete(&evt, InputEvent::EVENT_KEYUP);
 		}
 	}
 	
 	void CoreInput::touchesBegan(TouchInfo touch, std::vector<TouchInfo> touches, int ticks) {
-		InputEvent *evt = new InputEvent();
-		evt->touch = touch;		
-		evt->touches = touches;
-		evt->timestamp = ticks;
-		dispatchEvent(evt, InputEvent::EVENT_TOUCHES_BEGAN);
+		InputEvent evt;
+		evt.touch = touch;		
+		evt.touches = touches;
+		evt.timestamp = ticks;
+		dispatchEventNoDelete(&evt, InputEvent::EVENT_TOUCHES_BEGAN);
 	}
 	
 	void CoreInput::touchesMoved(TouchInfo touch, std::vector<TouchInfo> touches, int ticks) {
-		InputEvent *evt = new InputEvent();
-		evt->touch = touch;
-		evt->touches = touches;
-		evt->timestamp = ticks;		
-		dispatchEvent(evt, InputEvent::EVENT_TOUCHES_MOVED);	
+		InputEvent evt;
+		evt.touch = touch;
+		evt.touches = touches;
+		evt.timestamp = ticks;		
+		dispatchEventNoDelete(&evt, InputEvent::EVENT_TOUCHES_MOVED);	
 	}
 	
 	void CoreInput::touchesEnded(TouchInfo touch, std::vector<TouchInfo> touches, int ticks) {
-		InputEvent *evt = new InputEvent();
-		evt->touch = touch;		
-		evt->touches = touches;
-		evt->timestamp = ticks;		
-		dispatchEvent(evt, InputEvent::EVENT_TOUCHES_ENDED);	
+		InputEvent evt;
+		evt.touch = touch;		
+		evt.touches = touches;
+		evt.timestamp = ticks;		
+		dispatchEventNoDelete(&evt, InputEvent::EVENT_TOUCHES_ENDED);	
 	}
 	
 }
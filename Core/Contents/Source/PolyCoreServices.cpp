@@ -27,6 +27,8 @@
 #include "PolyLogger.h"
 #include "PolyModule.h"
 #include "PolyResourceManager.h"
+#include "PolyAssetLoader.h"
+#include "PolyJobSystem.h"
 #include "PolyMaterialManager.h"
 #include "PolyRenderer.h"
 #include "PolyConfig.h"
@@ -36,6 +38,7 @@
 #include "PolyTimerManager.h"
 #include "PolyTweenManager.h"
 #include "PolySoundManager.h"
+#include "PolyProfiler.h"
 
 using namespace Polycode;
 
@@ -100,6 +103,10 @@ Logger *CoreServices::getLogger() {
 	return logger;
 }
 
+Profiler *CoreServices::getProfiler() {
+	return profiler;
+}
+
 void CoreServices::installModule(PolycodeModule *module)  {
 	modules.push_back(module);
 	if(module->requiresUpdate()) {
@@ -122,7 +129,10 @@ void CoreServices::setupBasicListeners() {
 
 CoreServices::CoreServices() : EventDispatcher() {
 	logger = new Logger();
+	profiler = new Profiler();
+	jobSystem = new JobSystem();
 	resourceManager = new ResourceManager();	
+	assetLoader = new AssetLoader();
 	config = new Config();
 	materialManager = new MaterialManager();
 	screenManager = new ScreenManager();
@@ -146,6 +156,7 @@ CoreServices::CoreServices() : EventDispatcher() {
 }
 
 CoreServices::~CoreServices() {
+	delete assetLoader;
 	delete materialManager;
 	delete screenManager;
 	delete sceneManager;
@@ -154,6 +165,8 @@ CoreServices::~CoreServices() {
 	delete resourceManager;
 	delete soundManager;
 	delete fontManager;
+	delete jobSystem;
+	delete profiler;
 	instanceMap.clear();
 	overrideInstance = NULL;
 	
@@ -179,22 +192,27 @@ void CoreServices::handleEvent(Event *event) {
 		switch(event->getEventCode()) {
 			case InputEvent::EVENT_KEYDOWN:
 			case InputEvent::EVENT_KEYUP:
-				dispatchEvent(new InputEvent(inputEvent->key, inputEvent->charCode, inputEvent->timestamp), inputEvent->getEventCode());			
+			{
+				InputEvent keyEvent(inputEvent->key, inputEvent->charCode, inputEvent->timestamp);
+				dispatchEventNoDelete(&keyEvent, inputEvent->getEventCode());			
+			}
 			break;
 			case InputEvent::EVENT_TOUCHES_BEGAN:
 			case InputEvent::EVENT_TOUCHES_ENDED:
 			case InputEvent::EVENT_TOUCHES_MOVED:						
 			{
-				InputEvent *event = new InputEvent();
-				event->touches = inputEvent->touches;
-				event->timestamp = inputEvent->timestamp;
-				dispatchEvent(event, inputEvent->getEventCode());
+				InputEvent touchEvent;
+				touchEvent.touches = inputEvent->touches;
+				touchEvent.timestamp = inputEvent->timestamp;
+				dispatchEventNoDelete(&touchEvent, inputEvent->getEventCode());
 			}
 			break;
 			default:
-				InputEvent *_inputEvent = new InputEvent(inputEvent->mousePosition, inputEvent->timestamp);
-				_inputEvent->mouseButton = inputEvent->mouseButton;
-				dispatchEvent(_inputEvent, inputEvent->getEventCode());			
+			{
+				InputEvent mouseEvent(inputEvent->mousePosition, inputEvent->timestamp);
+				mouseEvent.mouseButton = inputEvent->mouseButton;
+				dispatchEventNoDelete(&mouseEvent, inputEvent->getEventCode());			
+			}
 			break;
 		}
 	}
@@ -214,6 +232,8 @@ Renderer *CoreServices::getRenderer() {
 }
 
 void CoreServices::Render() {
+	ProfilerZone zone("CoreServices::Render");
+	
 	if(renderer->doClearBuffer)		
 		renderer->clearScreen();
 
@@ -235,14 +255,42 @@ void CoreServices::Render() {
 }
 
 void CoreServices::Update(int elapsed) {
+	ProfilerZone zone("CoreServices::Update");
 	
-	for(int i=0; i < updateModules.size(); i++) {
-		updateModules[i]->Update(elapsed);
+	{
+		ProfilerZone jobZone("JobSystem::endFrame");
+		jobSystem->endFrame();
+	}
+	{
+		ProfilerZone moduleZone("Modules::Update");
+		for(int i=0; i < updateModules.size(); i++) {
+			updateModules[i]->Update(elapsed);
+		}
+	}
+	{
+		ProfilerZone resourceZone("ResourceManager::Update");
+		resourceManager->Update(elapsed);
+	}
+	{
+		ProfilerZone assetZone("AssetLoader::Update");
+		assetLoader->Update();
+	}
+	{
+		ProfilerZone soundZone("SoundManager::Update");
+		soundManager->Update();
+	}
+	{
+		ProfilerZone timerZone("TimerManager::Update");
+		timerManager->Update();	
+	}
+	{
+		ProfilerZone tweenZone("TweenManager::Update");
+		tweenManager->Update(elapsed);
+	}
+	{
+		ProfilerZone materialZone("MaterialManager::Update");
+		materialManager->Update(elapsed);		
 	}
-	resourceManager->Update(elapsed);
-	timerManager->Update();	
-	tweenManager->Update();	
-	materialManager->Update(elapsed);		
 	sceneManager->Update();
 	screenManager->Update();	
 }
@@ -267,3 +315,11 @@ ResourceManager *CoreServices::getResourceManager() {
 	return resourceManager;
 }
 
+AssetLoader *CoreServices::getAssetLoader() {
+	return assetLoader;
+}
+
+JobSystem *CoreServices::getJobSystem() {
+	return jobSystem;
+}
+
@@ -20,7 +20,9 @@
  THE SOFTWARE.
 */
 #include "PolyEntity.h"
+#include "PolyCamera.h"
 #include "PolyRenderer.h"
+#include "PolyRenderQueue.h"
 
 using namespace Polycode;
 
@@ -41,6 +43,14 @@ Entity::Entity() : EventDispatcher() {
 	color.setColor(1.0f,1.0f,1.0f,1.0f);
 	parentEntity = NULL;
 	matrixDirty = true;
+	boundsDirty = true;
+	boundsFollowWorld = true;
+	worldBoundsRadius = 0;
+	subtreeBoundsRadius = 0;
+	lastBBoxRadius = 0;
+	worldMatrixDirty = true;
+	worldRollDirty = true;
+	worldColorDirty = true;
 	matrixAdj = 1.0f;
 	billboardMode = false;
 	billboardRoll = false;
@@ -54,6 +64,8 @@ Entity::Entity() : EventDispatcher() {
 	lockMatrix = false;
 	renderWireframe  = false;
 	colorAffectsChildren = true;
+	_color = color;
+	_colorAffectsChildren = colorAffectsChildren;
 	visibilityAffectsChildren = true;
 	ownsChildren = false;
 	enableScissor = false;
@@ -171,14 +183,8 @@ Entity *Entity::getParentEntity() const {
 }
 
 Color Entity::getCombinedColor() const {
-	if(parentEntity) {
-		if(parentEntity->colorAffectsChildren)
-			return color * parentEntity->getCombinedColor();
-		else
-			return color;			
-	} else {
-		return color;
-	}
+	const_cast<Entity*>(this)->updateWorldState();
+	return worldColor;
 }
 
 Matrix4 Entity::getLookAtMatrix(const Vector3 &loc, const Vector3 &upVector) {
@@ -330,6 +336,45 @@ void Entity::setBBoxRadius(Number rad) {
 	bBoxRadius = rad;
 }
 
+Vector3 Entity::getWorldBoundsCenter() const {
+	return worldBoundsCenter;
+}
+
+Number Entity::getWorldBoundsRadius() const {
+	return worldBoundsRadius;
+}
+
+Number Entity::getSubtreeBoundsRadius() const {
+	return subtreeBoundsRadius;
+}
+
+void Entity::updateWorldBounds() {
+	if(boundsDirty || lastBBoxRadius != bBoxRadius) {
+		// bounds are spheres around the entity origin, so only the
+		// largest axis scale of the world matrix affects the radius
+		Number scaleX = Vector3(boundsMatrix.m[0][0], boundsMatrix.m[0][1], boundsMatrix.m[0][2]).length();
+		Number scaleY = Vector3(boundsMatrix.m[1][0], boundsMatrix.m[1][1], boundsMatrix.m[1][2]).length();
+		Number scaleZ = Vector3(boundsMatrix.m[2][0], boundsMatrix.m[2][1], boundsMatrix.m[2][2]).length();
+		Number maxScale = scaleX;
+		if(scaleY > maxScale)
+			maxScale = scaleY;
+		if(scaleZ > maxScale)
+			maxScale = scaleZ;
+		
+		worldBoundsCenter = boundsMatrix.getPosition();
+		worldBoundsRadius = bBoxRadius * maxScale;
+		lastBBoxRadius = bBoxRadius;
+	}
+	boundsDirty = false;
+	
+	subtreeBoundsRadius = worldBoundsRadius;
+	for(int i=0; i < children.size(); i++) {
+		Number childRadius = children[i]->worldBoundsCenter.distance(worldBoundsCenter) + children[i]->subtreeBoundsRadius;
+		if(childRadius > subtreeBoundsRadius)
+			subtreeBoundsRadius = childRadius;
+	}
+}
+
 Entity::~Entity() {
 	if(ownsChildren) {
 		for(int i=0; i < children.size(); i++) {	
@@ -371,6 +416,8 @@ void Entity::rebuildTransformMatrix() {
 
 	transformMatrix = scaleMatrix*transformMatrix*posMatrix;
 	matrixDirty = false;
+	boundsDirty = true;
+	dirtyWorldState(true, false);
 }
 
 void Entity::doUpdates() {
@@ -396,47 +443,143 @@ void Entity::checkTransformSetters() {
 		rebuildRotation();
 		matrixDirty = true;
 	}
+	
+	if(_color != color || _colorAffectsChildren != colorAffectsChildren) {
+		_color = color;
+		_colorAffectsChildren = colorAffectsChildren;
+		dirtyWorldState(false, true);
+	}
+}
+
+void Entity::dirtyWorldState(bool matrixChanged, bool colorChanged) {
+	// a dirty entity always has dirty descendants, so the walk can stop
+	// at the first entity that is already marked
+	if((!matrixChanged || (worldMatrixDirty && worldRollDirty)) && (!colorChanged || worldColorDirty))
+		return;
+	if(matrixChanged) {
+		worldMatrixDirty = true;
+		worldRollDirty = true;
+	}
+	if(colorChanged)
+		worldColorDirty = true;
+	for(int i=0; i < children.size(); i++) {
+		children[i]->dirtyWorldState(matrixChanged, colorChanged);
+	}
+}
+
+void Entity::updateWorldState() {
+	if(parentEntity)
+		parentEntity->updateWorldState();
+	checkTransformSetters();
+	if(matrixDirty)
+		rebuildTransformMatrix();
+	rebuildWorldState();
+}
+
+void Entity::rebuildWorldState() {
+	if(worldMatrixDirty) {
+		if(parentEntity) {
+			worldMatrix = transformMatrix * parentEntity->worldMatrix;
+			worldScale = Vector3(scale.x * parentEntity->worldScale.x, scale.y * parentEntity->worldScale.y, scale.z * parentEntity->worldScale.z);
+			worldPosition = parentEntity->worldPosition + position;
+		} else {
+			worldMatrix = transformMatrix;
+			worldScale = scale;
+			worldPosition = position;
+		}
+		worldMatrixDirty = false;
+	}
+	
+	if(worldColorDirty) {
+		if(parentEntity && parentEntity->colorAffectsChildren)
+			worldColor = color * parentEntity->worldColor;
+		else
+			worldColor = color;
+		worldColorDirty = false;
+	}
+}
+
+void Entity::rebuildWorldRollMatrix() {
+	if(!worldRollDirty)
+		return;
+	Quaternion q;
+	q.createFromAxisAngle(0.0f, 0.0f, 1.0f, _rotation.roll*matrixAdj);
+	worldRollMatrix = q.createMatrix();
+	if(parentEntity) {
+		parentEntity->rebuildWorldRollMatrix();
+		worldRollMatrix = worldRollMatrix * parentEntity->worldRollMatrix;
+	}
+	worldRollDirty = false;
 }
 
 void Entity::updateEntityMatrix() {	
+	// children are reached from here with an up to date parent, so only
+	// the entity the pass starts at may need to refresh its ancestors
+	if(parentEntity && (parentEntity->worldMatrixDirty || parentEntity->worldColorDirty))
+		parentEntity->updateWorldState();
+	
 	checkTransformSetters();
 
 	if(matrixDirty)
 		rebuildTransformMatrix();
 	
+	rebuildWorldState();
+	
+	if(boundsDirty) {
+		// the bounds only drift from the world matrix below an entity
+		// that ignores its parent, so only that part of the tree needs
+		// its own product
+		boundsFollowWorld = !ignoreParentMatrix && (!parentEntity || parentEntity->boundsFollowWorld);
+		if(boundsFollowWorld) {
+			boundsMatrix = worldMatrix;
+		} else if(parentEntity && !ignoreParentMatrix) {
+			boundsMatrix = transformMatrix * parentEntity->boundsMatrix;
+		} else {
+			boundsMatrix = transformMatrix;
+		}
+	}
+	
 	for(int i=0; i < children.size(); i++) {
+		if(boundsDirty)
+			children[i]->boundsDirty = true;
 		children[i]->updateEntityMatrix();
 	}
+	
+	updateWorldBounds();
 }
 
 Vector3 Entity::getCompoundScale() const {
-	if(parentEntity != NULL) {
-		Vector3 parentScale = parentEntity->getCompoundScale();
-		return Vector3(scale.x * parentScale.x, scale.y * parentScale.y,scale.z * parentScale.z);
-		
-	}
-	else
-		return scale;	
+	const_cast<Entity*>(this)->updateWorldState();
+	return worldScale;
 }
 
 
 Matrix4 Entity::getConcatenatedRollMatrix() const {
-	Quaternion q;
-	q.createFromAxisAngle(0.0f, 0.0f, 1.0f, _rotation.roll*matrixAdj);
-	Matrix4 transformMatrix = q.createMatrix();	
-	
-	if(parentEntity != NULL) 
-		return transformMatrix * parentEntity->getConcatenatedRollMatrix();
-	else
-		return transformMatrix;	
+	Entity *self = const_cast<Entity*>(this);
+	self->updateWorldState();
+	self->rebuildWorldRollMatrix();
+	return worldRollMatrix;
 }
 
 
 void Entity::transformAndRender() {
 	if(!renderer || !enabled)
 		return;
+	
+	Camera *cullingCamera = renderer->getCullingCamera();
+	if(cullingCamera) {
+		cullingCamera->cullingStats.entitiesVisited++;
+		if(subtreeBoundsRadius > 0 && !cullingCamera->isSphereInFrustum(worldBoundsCenter, subtreeBoundsRadius)) {
+			cullingCamera->cullingStats.entitiesCulled++;
+			return;
+		}
+	}
+	
+	// when a render queue is set, Render() is queued with the current
+	// matrices and states and the queue applies them when it draws
+	RenderQueue *renderQueue = renderer->getRenderQueue();
 
-	if(depthOnly) {
+	if(depthOnly && !renderQueue) {
 		renderer->drawToColorBuffer(false);
 	}
 	
@@ -480,23 +623,27 @@ void Entity::transformAndRender() {
 		}
 	}
 	
-	if(!depthWrite)
-		renderer->enableDepthWrite(false);
-	else
-		renderer->enableDepthWrite(true);
-	
-	if(!depthTest) 
-		renderer->enableDepthTest(false);
-	else
-		renderer->enableDepthTest(true);
-		 
-	renderer->enableAlphaTest(alphaTest);
-	
-	Color combined = getCombinedColor();
-	renderer->setVertexColor(combined.r,combined.g,combined.b,combined.a);
-	
-	renderer->setBlendingMode(blendingMode);
-	renderer->enableBackfaceCulling(backfaceCulled);
+	if(!renderQueue) {
+		if(!depthWrite)
+			renderer->enableDepthWrite(false);
+		else
+			renderer->enableDepthWrite(true);
+		
+		if(!depthTest) 
+			renderer->enableDepthTest(false);
+		else
+			renderer->enableDepthTest(true);
+			 
+		renderer->enableAlphaTest(alphaTest);
+		
+		// updateEntityMatrix() runs right before rendering, so the cached
+		// combined color is current unless something dirtied it since
+		Color combined = worldColorDirty ? getCombinedColor() : worldColor;
+		renderer->setVertexColor(combined.r,combined.g,combined.b,combined.a);
+		
+		renderer->setBlendingMode(blendingMode);
+		renderer->enableBackfaceCulling(backfaceCulled);
+	}
 	
 	int mode = renderer->getRenderMode();
 	if(renderWireframe)
@@ -504,7 +651,17 @@ void Entity::transformAndRender() {
 	else
 		renderer->setRenderMode(Renderer::RENDER_MODE_NORMAL);	
 	if(visible) {
-		Render();
+		if(cullingCamera && worldBoundsRadius > 0 && subtreeBoundsRadius > worldBoundsRadius && !cullingCamera->isSphereInFrustum(worldBoundsCenter, worldBoundsRadius)) {
+			// only the children are in view
+			cullingCamera->cullingStats.entitiesCulled++;
+		} else {
+			if(renderQueue)
+				renderQueue->addEntity(this, renderer);
+			else
+				Render();
+			if(cullingCamera)
+				cullingCamera->cullingStats.entitiesDrawn++;
+		}
 	}
 		
 	if(visible || (!visible && !visibilityAffectsChildren)) {
@@ -516,11 +673,11 @@ void Entity::transformAndRender() {
 	renderer->setRenderMode(mode);	
 	renderer->popMatrix();
 		
-	if(!depthWrite)
+	if(!depthWrite && !renderQueue)
 		renderer->enableDepthWrite(true);
 	
 	
-	if(depthOnly) {
+	if(depthOnly && !renderQueue) {
 		renderer->drawToColorBuffer(true);
 	}	
 	
@@ -583,14 +740,8 @@ Matrix4 Entity::getConcatenatedMatrixRelativeTo(Entity *relativeEntity) {
 }
 
 Matrix4 Entity::getConcatenatedMatrix() {
-	checkTransformSetters();
-	if(matrixDirty)
-		rebuildTransformMatrix();
-
-	if(parentEntity != NULL) 
-		return transformMatrix * parentEntity->getConcatenatedMatrix();
-	else
-		return transformMatrix;
+	updateWorldState();
+	return worldMatrix;
 }
 
 const Matrix4& Entity::getTransformMatrix() const {
@@ -657,14 +808,14 @@ String Entity::getEntityProp(const String& propName) {
 }
 
 Vector3 Entity::getCombinedPosition() const {
-	if(parentEntity != NULL)
-		return (parentEntity->getCombinedPosition())+position;
-	else
-		return position;
+	const_cast<Entity*>(this)->updateWorldState();
+	return worldPosition;
 }
 
 void Entity::setParentEntity(Entity *entity) {
 	parentEntity = entity;
+	boundsDirty = true;
+	dirtyWorldState(true, true);
 }
 
 Number Entity::getPitch() const {
@@ -681,6 +832,8 @@ Number Entity::getRoll() const {
 
 void Entity::setTransformByMatrixPure(const Matrix4& matrix) {
 	transformMatrix = matrix;
+	boundsDirty = true;
+	dirtyWorldState(true, false);
 }
 
 void Entity::setPosition(const Vector3 &posVec) {
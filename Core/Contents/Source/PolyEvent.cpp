@@ -21,17 +21,31 @@
 */
 
 #include "PolyEvent.h"
+#include "PolyEventDispatcher.h"
 
 namespace Polycode {
 	
 	Event::Event() {
 			deleteOnDispatch = true;
+			dispatcher = NULL;
+			eventCode = 0;
 	}
 	
 	Event::Event(int eventCode) {	
+		deleteOnDispatch = true;
+		dispatcher = NULL;
 		setEventCode(eventCode);
 	}
 	
+	void *Event::operator new(size_t size) {
+		EventDispatcher::countEventAllocation();
+		return ::operator new(size);
+	}
+	
+	void Event::operator delete(void *pointer) {
+		::operator delete(pointer);
+	}
+	
 	Event::~Event() {
 		
 	}
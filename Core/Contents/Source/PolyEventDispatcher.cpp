@@ -25,7 +25,22 @@
 
 namespace Polycode {
 	
+	EventStats EventDispatcher::frameStats;
+	EventStats EventDispatcher::lastFrameStats;
+	
+	EventStats::EventStats() {
+		reset();
+	}
+	
+	void EventStats::reset() {
+		dispatches = 0;
+		handlerCalls = 0;
+		eventAllocations = 0;
+	}
+	
 	EventDispatcher::EventDispatcher() : EventHandler() {
+		dispatchDepth = 0;
+		handlersRemoved = false;
 	}
 	
 	EventDispatcher::~EventDispatcher() {
@@ -33,52 +48,109 @@ namespace Polycode {
 	}
 	
 	void EventDispatcher::addEventListener(EventHandler *handler, int eventCode) {
-		EventEntry newEntry;
-		newEntry.handler = handler;
-		newEntry.eventCode = eventCode;
-		handlerEntries.push_back(newEntry);
+		handlerTables[eventCode].push_back(handler);
 	}
 
 	void EventDispatcher::removeAllHandlers() {
-		handlerEntries.clear();
+		if(dispatchDepth > 0) {
+			std::map<int, std::vector<EventHandler*> >::iterator it;
+			for(it = handlerTables.begin(); it != handlerTables.end(); ++it) {
+				for(int i=0; i < it->second.size(); i++) {
+					it->second[i] = NULL;
+				}
+			}
+			handlersRemoved = true;
+		} else {
+			handlerTables.clear();
+		}
 	}
 	
 	void EventDispatcher::removeAllHandlersForListener(EventHandler *handler) {
-		std::vector<EventEntry>::iterator iter = handlerEntries.begin();
-		while (iter != handlerEntries.end()) {	
-			if((*iter).handler == handler) {
-				iter = handlerEntries.erase(iter);
-			} else {	
-				++iter;						
+		std::map<int, std::vector<EventHandler*> >::iterator it;
+		for(it = handlerTables.begin(); it != handlerTables.end(); ++it) {
+			for(int i=0; i < it->second.size(); i++) {
+				if(it->second[i] == handler) {
+					it->second[i] = NULL;
+					handlersRemoved = true;
+				}
 			}
 		}
-		
+		if(dispatchDepth == 0)
+			compactHandlerTables();
 	}
 
 	void EventDispatcher::removeEventListener(EventHandler *handler, int eventCode) {
-		for(int i=0;i<handlerEntries.size();i++) {
-			if(handlerEntries[i].eventCode == eventCode && handlerEntries[i].handler == handler) {
-				handlerEntries.erase(handlerEntries.begin()+i);
+		std::map<int, std::vector<EventHandler*> >::iterator it = handlerTables.find(eventCode);
+		if(it == handlerTables.end())
+			return;
+		for(int i=0; i < it->second.size(); i++) {
+			if(it->second[i] == handler) {
+				it->second[i] = NULL;
+				handlersRemoved = true;
 			}
 		}
+		if(dispatchDepth == 0)
+			compactHandlerTables();
+	}
+	
+	void EventDispatcher::compactHandlerTables() {
+		if(!handlersRemoved)
+			return;
+		std::map<int, std::vector<EventHandler*> >::iterator it = handlerTables.begin();
+		while(it != handlerTables.end()) {
+			std::vector<EventHandler*> &handlers = it->second;
+			int count = 0;
+			for(int i=0; i < handlers.size(); i++) {
+				if(handlers[i])
+					handlers[count++] = handlers[i];
+			}
+			handlers.resize(count);
+			if(count == 0) {
+				handlerTables.erase(it++);
+			} else {
+				++it;
+			}
+		}
+		handlersRemoved = false;
+	}
+	
+	bool EventDispatcher::hasEventListener(int eventCode) const {
+		std::map<int, std::vector<EventHandler*> >::const_iterator it = handlerTables.find(eventCode);
+		if(it == handlerTables.end())
+			return false;
+		for(int i=0; i < it->second.size(); i++) {
+			if(it->second[i])
+				return true;
+		}
+		return false;
 	}
 	
 	void EventDispatcher::__dispatchEvent(Event *event, int eventCode) {
-		//		event->setDispatcher(dynamic_cast<void*>(this));
 		event->setDispatcher(this);
 		event->setEventCode(eventCode);
-		for(int i=0;i<handlerEntries.size();i++) {
-			if(handlerEntries[i].eventCode == eventCode) {
-				//				if(handlerEntries[i].handler->onEvent != NULL) {
-				//					handlerEntries[i].handler->onEvent(event);
-				//				}
-				handlerEntries[i].handler->handleEvent(event);
-				handlerEntries[i].handler->secondaryHandler(event);
+		frameStats.dispatches++;
+		
+		std::map<int, std::vector<EventHandler*> >::iterator it = handlerTables.find(eventCode);
+		if(it == handlerTables.end())
+			return;
+		
+		// handlers may add and remove listeners, so the table is indexed rather than iterated, and handlers added during the dispatch are not called
+		std::vector<EventHandler*> &handlers = it->second;
+		int handlerCount = handlers.size();
+		dispatchDepth++;
+		for(int i=0; i < handlerCount; i++) {
+			EventHandler *handler = handlers[i];
+			if(handler) {
+				frameStats.handlerCalls++;
+				handler->handleEvent(event);
 			}
 		}
+		dispatchDepth--;
 		
+		if(dispatchDepth == 0)
+			compactHandlerTables();
 	}
-	
+
 	void EventDispatcher::dispatchEventNoDelete(Event *event, int eventCode) {
 		__dispatchEvent(event,eventCode);
 	}
@@ -87,4 +159,21 @@ namespace Polycode {
 		__dispatchEvent(event,eventCode);
 		delete event;
 	}
+	
+	const EventStats &EventDispatcher::getFrameStats() {
+		return frameStats;
+	}
+	
+	const EventStats &EventDispatcher::getLastFrameStats() {
+		return lastFrameStats;
+	}
+	
+	void EventDispatcher::endFrameStats() {
+		lastFrameStats = frameStats;
+		frameStats.reset();
+	}
+	
+	void EventDispatcher::countEventAllocation() {
+		frameStats.eventAllocations++;
+	}
 }
@@ -21,6 +21,7 @@
 */
 
 #include "PolyFont.h"
+#include "PolyGlyphAtlas.h"
 #include "OSBasics.h"
 #include "PolyLogger.h"
 
@@ -75,7 +76,21 @@ bool Font::isValid() const {
 	return valid;
 }
 
+GlyphAtlas *Font::getGlyphAtlas(int size, int antiAliasMode, bool premultiplyAlpha) {
+	int key = (size * 8) + (antiAliasMode * 2) + (premultiplyAlpha ? 1 : 0);
+	std::map<int, GlyphAtlas*>::iterator it = glyphAtlases.find(key);
+	if(it != glyphAtlases.end())
+		return it->second;
+	
+	GlyphAtlas *atlas = new GlyphAtlas(this, size, antiAliasMode, premultiplyAlpha);
+	glyphAtlases[key] = atlas;
+	return atlas;
+}
+
 Font::~Font() {
+	for(std::map<int, GlyphAtlas*>::iterator it = glyphAtlases.begin(); it != glyphAtlases.end(); it++) {
+		delete it->second;
+	}
 	if(buffer) {
 		free(buffer);
 	}
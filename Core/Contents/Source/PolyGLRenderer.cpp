@@ -90,6 +90,9 @@ OpenGLRenderer::OpenGLRenderer() : Renderer() {
 	nearPlane = 0.1f;
 	farPlane = 100.0f;
 	verticesToDraw = 0;
+	indicesToDraw = 0;
+	indexSize = 2;
+	indexArrayPtr = NULL;
 
 }
 
@@ -203,6 +206,8 @@ void OpenGLRenderer::setDepthFunction(int depthFunction) {
 }
 
 void OpenGLRenderer::enableAlphaTest(bool val) {
+	if(!changeRenderState(RENDER_STATE_ALPHA_TEST, val))
+		return;
 	if(val) {
 		glAlphaFunc ( GL_GREATER, 0.01) ;
 		glEnable ( GL_ALPHA_TEST ) ;		
@@ -212,6 +217,8 @@ void OpenGLRenderer::enableAlphaTest(bool val) {
 }
 
 void OpenGLRenderer::setLineSmooth(bool val) {
+	if(!changeRenderState(RENDER_STATE_LINE_SMOOTH, val))
+		return;
 	if(val)
 		glEnable(GL_LINE_SMOOTH);
 	else
@@ -293,6 +300,8 @@ Vector3 OpenGLRenderer::projectRayFrom2DCoordinate(Number x, Number y, Matrix4 c
 }
 
 void OpenGLRenderer::enableDepthWrite(bool val) {
+	if(!changeRenderState(RENDER_STATE_DEPTH_WRITE, val))
+		return;
 	if(val)
 		glDepthMask(GL_TRUE);
 	else
@@ -300,6 +309,8 @@ void OpenGLRenderer::enableDepthWrite(bool val) {
 }
 
 void OpenGLRenderer::enableDepthTest(bool val) {
+	if(!changeRenderState(RENDER_STATE_DEPTH_TEST, val))
+		return;
 	if(val)
 		glEnable(GL_DEPTH_TEST);
 	else
@@ -307,12 +318,12 @@ void OpenGLRenderer::enableDepthTest(bool val) {
 }
 
 void OpenGLRenderer::setModelviewMatrix(Matrix4 m) {
-	glLoadMatrixd(m.ml);
+	glLoadMatrixNumber(m.ml);
 }
 
 void OpenGLRenderer::multModelviewMatrix(Matrix4 m) {
 //	glMatrixMode(GL_MODELVIEW);
-	glMultMatrixd(m.ml);
+	glMultMatrixNumber(m.ml);
 }
 
 void OpenGLRenderer::enableLighting(bool enable) {
@@ -401,7 +412,16 @@ void OpenGLRenderer::drawVertexBuffer(VertexBuffer *buffer, bool enableColorBuff
 			break;
 	}	
 	
-	glDrawArrays( mode, 0, buffer->getVertexCount() );
+	if(glVertexBuffer->getIndexCount() > 0) {
+		glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, glVertexBuffer->getIndexBufferID());
+		glDrawElements(mode, glVertexBuffer->getIndexCount(), glVertexBuffer->getIndexType(), (char *) NULL);
+		frameStats.verticesDrawn += glVertexBuffer->getIndexCount();
+		glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+	} else {
+		glDrawArrays( mode, 0, buffer->getVertexCount() );
+		frameStats.verticesDrawn += buffer->getVertexCount();
+	}
+	frameStats.drawCalls++;
 	
 	glDisableClientState( GL_VERTEX_ARRAY);	
 	glDisableClientState( GL_TEXTURE_COORD_ARRAY );		
@@ -436,6 +456,10 @@ void OpenGLRenderer::enableFog(bool enable) {
 }
 
 void OpenGLRenderer::setBlendingMode(int blendingMode) {
+	// the normal mode maps to different functions depending on blendNormalAsPremultiplied
+	int blendState = (blendingMode * 2) + (blendNormalAsPremultiplied ? 1 : 0);
+	if(!changeRenderState(RENDER_STATE_BLENDING_MODE, blendState))
+		return;
 	switch(blendingMode) {
 		case BLEND_MODE_NORMAL:
 			if(blendNormalAsPremultiplied) {
@@ -465,13 +489,13 @@ void OpenGLRenderer::setBlendingMode(int blendingMode) {
 
 Matrix4 OpenGLRenderer::getProjectionMatrix() {
 	Number m[16];
-	glGetDoublev( GL_PROJECTION_MATRIX, m);
+	glGetNumberv( GL_PROJECTION_MATRIX, m);
 	return Matrix4(m);
 }
 
 Matrix4 OpenGLRenderer::getModelviewMatrix() {
 	Number m[16];
-    glGetDoublev( GL_MODELVIEW_MATRIX, m);
+    glGetNumberv( GL_MODELVIEW_MATRIX, m);
 	return Matrix4(m);
 }
 
@@ -536,7 +560,7 @@ void OpenGLRenderer::setOrthoMode(Number xSize, Number ySize, bool centered) {
 	setBlendingMode(BLEND_MODE_NORMAL);
 	glDisable(GL_LIGHTING);
 	glMatrixMode(GL_PROJECTION);
-	glDisable(GL_CULL_FACE);
+	enableBackfaceCulling(false);
 	glLoadIdentity();
 		
 	if(centered) {
@@ -550,6 +574,8 @@ void OpenGLRenderer::setOrthoMode(Number xSize, Number ySize, bool centered) {
 }
 
 void OpenGLRenderer::enableBackfaceCulling(bool val) {
+	if(!changeRenderState(RENDER_STATE_BACKFACE_CULLING, val))
+		return;
 	if(val)
 		glEnable(GL_CULL_FACE);
 	else
@@ -561,8 +587,8 @@ void OpenGLRenderer::setPerspectiveMode() {
 	if(orthoMode) {
 		if(lightingEnabled) {
 		}
-		glEnable (GL_DEPTH_TEST);
-		glEnable(GL_CULL_FACE);
+		enableDepthTest(true);
+		enableBackfaceCulling(true);
 		glMatrixMode( GL_PROJECTION );
 		glMatrixMode( GL_MODELVIEW );
 		orthoMode = false;
@@ -580,6 +606,8 @@ void OpenGLRenderer::BeginRender() {
 	}
 	glLoadIdentity();
 	currentTexture = NULL;
+	invalidateRenderStates();
+	beginFrameStats();
 }
 
 void OpenGLRenderer::translate3D(Vector3 *position) {
@@ -747,6 +775,7 @@ void OpenGLRenderer::clearBuffer(bool colorBuffer, bool depthBuffer) {
 }
 
 void OpenGLRenderer::applyMaterial(Material *material,  ShaderBinding *localOptions,unsigned int shaderIndex) {
+	frameStats.materialChanges++;
 	if(!material->getShader(shaderIndex) || !shadersEnabled) {
 		setTexture(NULL);
 		return;
@@ -774,6 +803,9 @@ void OpenGLRenderer::applyMaterial(Material *material,  ShaderBinding *localOpti
 				PolycodeShaderModule *shaderModule = (PolycodeShaderModule*)material->shaderModule;
 				shaderModule->applyShaderMaterial(this, material, localOptions, shaderIndex);
 				currentShaderModule = shaderModule;
+				// shader modules bind their own textures
+				currentTexture = NULL;
+				renderStateValid[RENDER_STATE_TEXTURE_ENABLED] = false;
 			}
 		break;
 	}
@@ -791,6 +823,8 @@ void OpenGLRenderer::clearShader() {
 		glActiveTexture(GL_TEXTURE0+i);		
 		glDisable(GL_TEXTURE_2D);
 	}
+	renderStateValues[RENDER_STATE_TEXTURE_ENABLED] = false;
+	renderStateValid[RENDER_STATE_TEXTURE_ENABLED] = true;
 		
 	if(currentShaderModule) {
 		currentShaderModule->clearShader();
@@ -802,21 +836,30 @@ void OpenGLRenderer::clearShader() {
 void OpenGLRenderer::setTexture(Texture *texture) {
 
 	if(texture == NULL) {
-		glActiveTexture(GL_TEXTURE0);		
-		glDisable(GL_TEXTURE_2D);
+		if(changeRenderState(RENDER_STATE_TEXTURE_ENABLED, false)) {
+			glActiveTexture(GL_TEXTURE0);		
+			glDisable(GL_TEXTURE_2D);
+		}
 		return;
 	}
 	
 	if(renderMode == RENDER_MODE_NORMAL) {
-		glActiveTexture(GL_TEXTURE0);	
-		glEnable (GL_TEXTURE_2D);
+		if(changeRenderState(RENDER_STATE_TEXTURE_ENABLED, true)) {
+			glActiveTexture(GL_TEXTURE0);	
+			glEnable (GL_TEXTURE_2D);
+		}
 				
 		if(currentTexture != texture) {			
 			OpenGLTexture *glTexture = (OpenGLTexture*)texture;
+			glActiveTexture(GL_TEXTURE0);	
 			glBindTexture (GL_TEXTURE_2D, glTexture->getTextureID());
+			frameStats.textureBinds++;
 		}
 	} else {
-		glDisable(GL_TEXTURE_2D);
+		if(changeRenderState(RENDER_STATE_TEXTURE_ENABLED, false)) {
+			glActiveTexture(GL_TEXTURE0);	
+			glDisable(GL_TEXTURE_2D);
+		}
 	}
 	
 	currentTexture = texture;
@@ -858,112 +901,36 @@ void OpenGLRenderer::pushRenderDataArray(RenderDataArray *array) {
 			glEnableVertexAttribArrayARB(6);		
 			glVertexAttribPointer(6, array->size, GL_FLOAT, 0, 0, array->arrayPtr);
 		break;
+		case RenderDataArray::INDEX_DATA_ARRAY:
+			indexArrayPtr = array->arrayPtr;
+			indexSize = array->size;
+			indicesToDraw = array->count;
+		break;
 		
 	}
 }
 
-RenderDataArray *OpenGLRenderer::createRenderDataArrayForMesh(Mesh *mesh, int arrayType) {
-	RenderDataArray *newArray = createRenderDataArray(arrayType);
-		
-	newArray->count = 0;
-	long bufferSize = 0;
-	long newBufferSize = 0;		
-	GLfloat* buffer = NULL;
-	
-	switch (arrayType) {
-		case RenderDataArray::VERTEX_DATA_ARRAY:
-		{		
-			buffer = (GLfloat*)malloc(1);							
-			for(int i=0; i < mesh->getPolygonCount(); i++) {
-				for(int j=0; j < mesh->getPolygon(i)->getVertexCount(); j++) {
-					newArray->count++;			
-					newBufferSize = bufferSize + 3;
-					buffer = (GLfloat*)realloc(buffer, newBufferSize * sizeof(GLfloat));
-					buffer[bufferSize+0] = mesh->getPolygon(i)->getVertex(j)->x;
-					buffer[bufferSize+1] = mesh->getPolygon(i)->getVertex(j)->y;
-					buffer[bufferSize+2] = mesh->getPolygon(i)->getVertex(j)->z;			
-					bufferSize = newBufferSize;	
-				}		   
-			}
-		}
-		break;
-		case RenderDataArray::COLOR_DATA_ARRAY:
-		{
-			buffer = (GLfloat*)malloc(1);			
-			for(int i=0; i < mesh->getPolygonCount(); i++) {
-				for(int j=0; j < mesh->getPolygon(i)->getVertexCount(); j++) {
-					newBufferSize = bufferSize + 4;			
-					buffer = (GLfloat*)realloc(buffer, newBufferSize * sizeof(GLfloat));
-					buffer[bufferSize+0] = mesh->getPolygon(i)->getVertex(j)->vertexColor.r;
-					buffer[bufferSize+1] = mesh->getPolygon(i)->getVertex(j)->vertexColor.g;
-					buffer[bufferSize+2] = mesh->getPolygon(i)->getVertex(j)->vertexColor.b;
-					buffer[bufferSize+3] = mesh->getPolygon(i)->getVertex(j)->vertexColor.a;			
-					bufferSize = newBufferSize;					
-				}		   
-			}
-		}
-		break;
-		case RenderDataArray::NORMAL_DATA_ARRAY:
-		{
-			buffer = (GLfloat*)malloc(1);	
-			
-			for(int i=0; i < mesh->getPolygonCount(); i++) {
-				for(int j=0; j < mesh->getPolygon(i)->getVertexCount(); j++) {
-					newBufferSize = bufferSize + 3;			
-					buffer = (GLfloat*)realloc(buffer, newBufferSize * sizeof(GLfloat));		
-					if(mesh->getPolygon(i)->useVertexNormals) {
-						buffer[bufferSize+0] = mesh->getPolygon(i)->getVertex(j)->normal.x;
-						buffer[bufferSize+1] = mesh->getPolygon(i)->getVertex(j)->normal.y;
-						buffer[bufferSize+2] = mesh->getPolygon(i)->getVertex(j)->normal.z;				
-					} else {
-						buffer[bufferSize+0] = mesh->getPolygon(i)->getFaceNormal().x;
-						buffer[bufferSize+1] = mesh->getPolygon(i)->getFaceNormal().y;
-						buffer[bufferSize+2] = mesh->getPolygon(i)->getFaceNormal().z;
-					}
-					bufferSize = newBufferSize;					
-				}		   
-			}			
-		}
-		break;
-		case RenderDataArray::TANGENT_DATA_ARRAY:
-		{
-			buffer = (GLfloat*)malloc(1);	
-			
-			for(int i=0; i < mesh->getPolygonCount(); i++) {
-				for(int j=0; j < mesh->getPolygon(i)->getVertexCount(); j++) {
-					newBufferSize = bufferSize + 3;			
-					buffer = (GLfloat*)realloc(buffer, newBufferSize * sizeof(GLfloat));		
-					buffer[bufferSize+0] = mesh->getPolygon(i)->getVertex(j)->tangent.x;
-					buffer[bufferSize+1] = mesh->getPolygon(i)->getVertex(j)->tangent.y;
-					buffer[bufferSize+2] = mesh->getPolygon(i)->getVertex(j)->tangent.z;				
-					bufferSize = newBufferSize;					
-				}		   
-			}			
-		}
-		break;		
-		case RenderDataArray::TEXCOORD_DATA_ARRAY:
-		{
-			buffer = (GLfloat*)malloc(1);				
-			for(int i=0; i < mesh->getPolygonCount(); i++) {
-				for(int j=0; j < mesh->getPolygon(i)->getVertexCount(); j++) {
-					newBufferSize = bufferSize + 2;			
-					buffer = (GLfloat*)realloc(buffer, newBufferSize * sizeof(GLfloat));		
-					buffer[bufferSize+0] = mesh->getPolygon(i)->getVertex(j)->getTexCoord().x;											
-					buffer[bufferSize+1] = mesh->getPolygon(i)->getVertex(j)->getTexCoord().y;							
-					bufferSize = newBufferSize;					
-				}		   
-			}			
+void OpenGLRenderer::updateRenderDataArraysForMesh(Mesh *mesh, bool *updateMap) {
+	for(int i=0; i < 16; i++) {
+		if(updateMap[i] && mesh->renderDataArrays[i] == NULL) {
+			mesh->renderDataArrays[i] = createRenderDataArray(i);
 		}
-		break;
-		default:
-		break;
 	}
-	
-	if(buffer != NULL) {
-		free(newArray->arrayPtr);
-		newArray->arrayPtr = buffer;		
+	fillRenderDataArrays(mesh, mesh->renderDataArrays, updateMap);
+}
+
+RenderDataArray *OpenGLRenderer::createRenderDataArrayForMesh(Mesh *mesh, int arrayType) {
+	RenderDataArray *arrays[16];
+	bool updateMap[16];
+	for(int i=0; i < 16; i++) {
+		arrays[i] = NULL;
+		updateMap[i] = false;
 	}
 	
+	RenderDataArray *newArray = createRenderDataArray(arrayType);
+	arrays[arrayType] = newArray;
+	updateMap[arrayType] = true;
+	fillRenderDataArrays(mesh, arrays, updateMap);
 	return newArray;
 }
 
@@ -971,8 +938,10 @@ RenderDataArray *OpenGLRenderer::createRenderDataArray(int arrayType) {
 	RenderDataArray *newArray = new RenderDataArray();
 	newArray->arrayType = arrayType;
 	newArray->arrayPtr = malloc(1);
+	newArray->capacity = 1;
 	newArray->stride = 0;
 	newArray->count = 0;
+	newArray->rendererData = NULL;
 	
 	switch (arrayType) {
 		case RenderDataArray::VERTEX_DATA_ARRAY:
@@ -990,6 +959,9 @@ RenderDataArray *OpenGLRenderer::createRenderDataArray(int arrayType) {
 		case RenderDataArray::TEXCOORD_DATA_ARRAY:
 			newArray->size = 2;
 			break;									
+		case RenderDataArray::INDEX_DATA_ARRAY:
+			newArray->size = 2;
+			break;
 		default:
 			break;
 	}
@@ -1050,9 +1022,19 @@ void OpenGLRenderer::drawArrays(int drawType) {
 		break;
 	}
 	
-	glDrawArrays( mode, 0, verticesToDraw);	
+	if(indexArrayPtr) {
+		glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+		glDrawElements(mode, indicesToDraw, indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT, indexArrayPtr);
+		frameStats.verticesDrawn += indicesToDraw;
+	} else {
+		glDrawArrays( mode, 0, verticesToDraw);	
+		frameStats.verticesDrawn += verticesToDraw;
+	}
+	frameStats.drawCalls++;
 	
 	verticesToDraw = 0;
+	indicesToDraw = 0;
+	indexArrayPtr = NULL;
 		
 	glDisableClientState( GL_VERTEX_ARRAY);	
 	glDisableClientState( GL_TEXTURE_COORD_ARRAY );		
@@ -1122,6 +1104,7 @@ void OpenGLRenderer::setVertexColor(Number r, Number g, Number b, Number a) {
 }
 
 void OpenGLRenderer::EndRender() {
+	endFrameStats();
 ///	glFlush();
 //	glFinish();	
 }
@@ -109,6 +109,23 @@ void OpenGLTexture::recreateFromImageData() {
 	glTextureLoaded = true;
 }
 
+void OpenGLTexture::setMipmaps(Image *image) {
+	if(filteringMode != Renderer::TEX_FILTERING_LINEAR || image->getWidth() != width || image->getHeight() != height || image->getType() != Image::IMAGE_RGBA) {
+		return;
+	}
+	if(image->getNumMipmaps() == 0) {
+		Texture::setMipmaps(image);
+		return;
+	}
+	
+	createMipmaps = true;
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	for(int i=0; i < image->getNumMipmaps(); i++) {
+		glTexImage2D(GL_TEXTURE_2D, i+1, glTextureFormat, image->getMipmapWidth(i), image->getMipmapHeight(i), 0, glTextureType, pixelType, image->getMipmap(i));
+	}
+}
+
 OpenGLTexture::OpenGLTexture(unsigned int width, unsigned int height) : Texture(width, height, NULL ,true, true) {
 
 }
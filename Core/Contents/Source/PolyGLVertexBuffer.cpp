@@ -47,7 +47,51 @@ extern PFNGLGETBUFFERPARAMETERIVARBPROC glGetBufferParameterivARB;
 extern PFNGLGETBUFFERPOINTERVARBPROC glGetBufferPointervARB;
 #endif
 
+static void uploadArrayBuffer(GLuint bufferID, const std::vector<float> &data) {
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB, bufferID);
+	glBufferDataARB(GL_ARRAY_BUFFER_ARB, data.size()*sizeof(GLfloat), data.empty() ? NULL : &data[0], GL_STATIC_DRAW_ARB);
+}
+
+void OpenGLVertexBuffer::createIndexedBuffers(Mesh *mesh) {
+	glGenBuffersARB(1, &vertexBufferID);
+	uploadArrayBuffer(vertexBufferID, mesh->vertexPositionArray);
+	glGenBuffersARB(1, &texCoordBufferID);
+	uploadArrayBuffer(texCoordBufferID, mesh->vertexTexCoordArray);
+	glGenBuffersARB(1, &normalBufferID);
+	uploadArrayBuffer(normalBufferID, mesh->vertexNormalArray);
+	glGenBuffersARB(1, &tangentBufferID);
+	uploadArrayBuffer(tangentBufferID, mesh->vertexTangentArray);
+	glGenBuffersARB(1, &colorBufferID);
+	uploadArrayBuffer(colorBufferID, mesh->vertexColorArray);
+	glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+	
+	vertexCount = mesh->getVertexCount();
+	indexCount = mesh->getIndexCount();
+	
+	glGenBuffersARB(1, &indexBufferID);
+	glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, indexBufferID);
+	if(mesh->getIndexSize() == 2) {
+		indexType = GL_UNSIGNED_SHORT;
+		std::vector<GLushort> shortIndices(mesh->indexArray.begin(), mesh->indexArray.end());
+		glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, indexCount*sizeof(GLushort), shortIndices.empty() ? NULL : &shortIndices[0], GL_STATIC_DRAW_ARB);
+	} else {
+		indexType = GL_UNSIGNED_INT;
+		glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, indexCount*sizeof(GLuint), &mesh->indexArray[0], GL_STATIC_DRAW_ARB);
+	}
+	glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+}
+
 OpenGLVertexBuffer::OpenGLVertexBuffer(Mesh *mesh) : VertexBuffer() {
+	indexBufferID = 0;
+	indexCount = 0;
+	indexType = GL_UNSIGNED_SHORT;
+	
+	if(mesh->isIndexedMesh()) {
+		meshType = mesh->getMeshType();
+		createIndexedBuffers(mesh);
+		return;
+	}
+	
 	glGenBuffersARB(1, &vertexBufferID);
 	glBindBufferARB(GL_ARRAY_BUFFER_ARB, vertexBufferID);
 	
@@ -173,6 +217,10 @@ OpenGLVertexBuffer::~OpenGLVertexBuffer() {
 	glDeleteBuffersARB(1, &texCoordBufferID);
 	glDeleteBuffersARB(1, &normalBufferID);
 	glDeleteBuffersARB(1, &colorBufferID);	
+	glDeleteBuffersARB(1, &tangentBufferID);
+	if(indexBufferID) {
+		glDeleteBuffersARB(1, &indexBufferID);
+	}
 }
 
 GLuint OpenGLVertexBuffer::getColorBufferID() {
@@ -194,3 +242,15 @@ GLuint OpenGLVertexBuffer::getVertexBufferID() {
 GLuint OpenGLVertexBuffer::getTangentBufferID() {
 	return tangentBufferID;
 }
+
+GLuint OpenGLVertexBuffer::getIndexBufferID() {
+	return indexBufferID;
+}
+
+int OpenGLVertexBuffer::getIndexCount() {
+	return indexCount;
+}
+
+GLenum OpenGLVertexBuffer::getIndexType() {
+	return indexType;
+}
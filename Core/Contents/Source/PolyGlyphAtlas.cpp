@@ -0,0 +1,279 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+#include "PolyGlyphAtlas.h"
+#include "PolyCoreServices.h"
+#include "PolyImage.h"
+#include "PolyLabel.h"
+#include "PolyLogger.h"
+#include "PolyMaterialManager.h"
+#include "PolyTexture.h"
+
+using namespace Polycode;
+
+#define GLYPH_ATLAS_MAX_SIZE 4096
+
+AtlasGlyph::AtlasGlyph() {
+	glyphIndex = 0;
+	advance = 0;
+	xMin = yMin = xMax = yMax = 0;
+	left = top = 0;
+	width = height = 0;
+	x = y = 0;
+	loaded = false;
+}
+
+GlyphAtlas::GlyphAtlas(Font *font, int size, int antiAliasMode, bool premultiplyAlpha) {
+	this->font = font;
+	this->size = size;
+	this->antiAliasMode = antiAliasMode;
+	this->premultiplyAlpha = premultiplyAlpha;
+	useKerning = FT_HAS_KERNING(font->getFace());
+	
+	int imageWidth = 256;
+	if(size > 64) {
+		imageWidth = 1024;
+	} else if(size > 24) {
+		imageWidth = 512;
+	}
+	
+	image = new Image(imageWidth, imageWidth/4);
+	if(!premultiplyAlpha) {
+		// transparent white keeps filtered glyph edges from darkening
+		image->fill(Color(1.0f, 1.0f, 1.0f, 0.0f));
+	}
+	
+	texture = NULL;
+	textureDirty = false;
+	generation = 0;
+	
+	shelfX = 0;
+	shelfY = 0;
+	shelfHeight = 0;
+}
+
+GlyphAtlas::~GlyphAtlas() {
+	// the texture belongs to the MaterialManager, which may already be gone at shutdown
+	delete image;
+}
+
+int GlyphAtlas::getSize() const {
+	return size;
+}
+
+int GlyphAtlas::getAntialiasMode() const {
+	return antiAliasMode;
+}
+
+bool GlyphAtlas::getPremultiplyAlpha() const {
+	return premultiplyAlpha;
+}
+
+unsigned int GlyphAtlas::getGeneration() const {
+	return generation;
+}
+
+Image *GlyphAtlas::getImage() {
+	return image;
+}
+
+Texture *GlyphAtlas::getTexture() {
+	if(!texture) {
+		texture = CoreServices::getInstance()->getMaterialManager()->createTextureFromImage(image, true, false);
+		textureDirty = false;
+	} else if(textureDirty) {
+		texture->setImageData(image);
+		texture->recreateFromImageData();
+		textureDirty = false;
+	}
+	return texture;
+}
+
+const AtlasGlyph *GlyphAtlas::getGlyph(FT_ULong charCode) {
+	std::map<FT_ULong, AtlasGlyph>::iterator it = glyphs.find(charCode);
+	if(it != glyphs.end()) {
+		if(it->second.loaded)
+			return &it->second;
+		return NULL;
+	}
+	
+	AtlasGlyph *glyph = &glyphs[charCode];
+	
+	FT_Face face = font->getFace();
+	FT_Set_Pixel_Sizes(face, 0, size);
+	glyph->glyphIndex = FT_Get_Char_Index(face, charCode);
+	
+	FT_Error error;
+	switch(antiAliasMode) {
+		case Label::ANTIALIAS_FULL:
+		case Label::ANTIALIAS_STRONG:
+			error = FT_Load_Glyph(face, glyph->glyphIndex, FT_LOAD_TARGET_LIGHT);
+		break;
+		default:
+			error = FT_Load_Glyph(face, glyph->glyphIndex, FT_LOAD_DEFAULT);
+		break;
+	}
+	if(error)
+		return NULL;
+	
+	FT_Glyph ftGlyph;
+	if(FT_Get_Glyph(face->glyph, &ftGlyph))
+		return NULL;
+	
+	glyph->advance = face->glyph->advance.x >> 6;
+	
+	FT_BBox cbox;
+	FT_Glyph_Get_CBox(ftGlyph, ft_glyph_bbox_pixels, &cbox);
+	glyph->xMin = cbox.xMin;
+	glyph->yMin = cbox.yMin;
+	glyph->xMax = cbox.xMax;
+	glyph->yMax = cbox.yMax;
+	
+	if(antiAliasMode == Label::ANTIALIAS_FULL || antiAliasMode == Label::ANTIALIAS_STRONG) {
+		error = FT_Glyph_To_Bitmap(&ftGlyph, FT_RENDER_MODE_LIGHT, NULL, 1);
+	} else {
+		error = FT_Glyph_To_Bitmap(&ftGlyph, FT_RENDER_MODE_MONO, NULL, 1);
+	}
+	
+	if(!error) {
+		FT_BitmapGlyph bit = (FT_BitmapGlyph)ftGlyph;
+		glyph->left = bit->left;
+		glyph->top = bit->top;
+		glyph->width = bit->bitmap.width;
+		glyph->height = bit->bitmap.rows;
+		if(!packGlyph(glyph, &bit->bitmap)) {
+			glyph->width = 0;
+			glyph->height = 0;
+		}
+	}
+	FT_Done_Glyph(ftGlyph);
+	
+	glyph->loaded = true;
+	return glyph;
+}
+
+int GlyphAtlas::getKerning(FT_UInt leftGlyph, FT_UInt rightGlyph) {
+	if(!useKerning || !leftGlyph || !rightGlyph)
+		return 0;
+	
+	std::pair<FT_UInt, FT_UInt> key(leftGlyph, rightGlyph);
+	std::map<std::pair<FT_UInt, FT_UInt>, int>::iterator it = kerning.find(key);
+	if(it != kerning.end())
+		return it->second;
+	
+	FT_Face face = font->getFace();
+	FT_Set_Pixel_Sizes(face, 0, size);
+	FT_Vector delta;
+	FT_Get_Kerning(face, leftGlyph, rightGlyph, FT_KERNING_DEFAULT, &delta);
+	int value = delta.x >> 6;
+	kerning[key] = value;
+	return value;
+}
+
+bool GlyphAtlas::growImage() {
+	int imageWidth = image->getWidth();
+	int imageHeight = image->getHeight();
+	if(imageHeight >= GLYPH_ATLAS_MAX_SIZE) {
+		Logger::log("Glyph atlas for %s at size %d is full\n", font->getFontName().c_str(), size);
+		return false;
+	}
+	
+	// rows are stored bottom up, so existing glyphs keep their pixel positions
+	Image *newImage = new Image(imageWidth, imageHeight * 2);
+	if(!premultiplyAlpha) {
+		newImage->fill(Color(1.0f, 1.0f, 1.0f, 0.0f));
+	}
+	memcpy(newImage->getPixels(), image->getPixels(), imageWidth * imageHeight * 4);
+	delete image;
+	image = newImage;
+	
+	generation++;
+	textureDirty = true;
+	return true;
+}
+
+bool GlyphAtlas::packGlyph(AtlasGlyph *glyph, FT_Bitmap *bitmap) {
+	int glyphWidth = bitmap->width;
+	int glyphHeight = bitmap->rows;
+	if(glyphWidth == 0 || glyphHeight == 0)
+		return true;
+	
+	// one pixel of padding on every side keeps filtering from picking up neighbours
+	if(glyphWidth + 2 > image->getWidth())
+		return false;
+	
+	if(shelfX + glyphWidth + 2 > image->getWidth()) {
+		shelfY += shelfHeight + 1;
+		shelfX = 0;
+		shelfHeight = 0;
+	}
+	
+	while(shelfY + glyphHeight + 2 > image->getHeight()) {
+		if(!growImage())
+			return false;
+	}
+	
+	glyph->x = shelfX + 1;
+	glyph->y = shelfY + 1;
+	shelfX += glyphWidth + 1;
+	if(glyphHeight > shelfHeight)
+		shelfHeight = glyphHeight;
+	
+	// strong antialiasing boosts coverage by 1.2
+	int alphaMultiplier = 10;
+	if(antiAliasMode == Label::ANTIALIAS_STRONG) {
+		alphaMultiplier = 12;
+	}
+	
+	unsigned char *pixels = (unsigned char*)image->getPixels();
+	int imageWidth = image->getWidth();
+	
+	for(int row = 0; row < glyphHeight; row++) {
+		unsigned char *src = bitmap->buffer + (row * bitmap->pitch);
+		unsigned char *dst = pixels + (((glyph->y + glyphHeight - 1 - row) * imageWidth) + glyph->x) * 4;
+		for(int col = 0; col < glyphWidth; col++) {
+			int alpha;
+			if(bitmap->pixel_mode == FT_PIXEL_MODE_MONO) {
+				alpha = (src[col >> 3] & (0x80 >> (col & 7))) ? 255 : 0;
+			} else {
+				alpha = (src[col] * alphaMultiplier) / 10;
+				if(alpha > 255)
+					alpha = 255;
+			}
+			
+			if(premultiplyAlpha) {
+				dst[0] = alpha;
+				dst[1] = alpha;
+				dst[2] = alpha;
+			} else {
+				dst[0] = 255;
+				dst[1] = 255;
+				dst[2] = 255;
+			}
+			dst[3] = alpha;
+			dst += 4;
+		}
+	}
+	
+	textureDirty = true;
+	return true;
+}
@@ -0,0 +1,292 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+#include "PolyHeadlessCore.h"
+#include "PolyCoreServices.h"
+#include "PolyNullRenderer.h"
+#include "PolyThreaded.h"
+#include "OSBasics.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WINDOWS
+#include <windows.h>
+#include <direct.h>
+#define popen _popen
+#define pclose _pclose
+#define getcwd _getcwd
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+using namespace Polycode;
+
+#ifdef _WINDOWS
+static DWORD WINAPI headlessThreadFunc(LPVOID data) {
+	((Threaded*)data)->runThread();
+	return 1;
+}
+#else
+static void *headlessThreadFunc(void *data) {
+	((Threaded*)data)->runThread();
+	return NULL;
+}
+#endif
+
+static void copyFile(const String& itemPath, const String& destItemPath) {
+	OSFILE *inFile = OSBasics::open(itemPath, "rb");
+	if(!inFile)
+		return;
+	OSFILE *outFile = OSBasics::open(destItemPath, "wb");
+	if(!outFile) {
+		OSBasics::close(inFile);
+		return;
+	}
+	
+	char buffer[4096];
+	size_t bytesRead;
+	while((bytesRead = OSBasics::read(buffer, 1, sizeof(buffer), inFile)) > 0) {
+		OSBasics::write(buffer, 1, bytesRead, outFile);
+	}
+	OSBasics::close(inFile);
+	OSBasics::close(outFile);
+}
+
+HeadlessCore::HeadlessCore(int xRes, int yRes, int frameRate, Renderer *renderer) : Core(xRes, yRes, false, false, 0, 0, frameRate, -1) {
+	
+	char *buffer = getcwd(NULL, 0);
+	if(buffer) {
+		defaultWorkingDirectory = String(buffer);
+		free(buffer);
+	}
+	
+	const char *homedir = getenv("HOME");
+	if(homedir) {
+		userHomeDirectory = String(homedir);
+	}
+	
+	defaultScreenWidth = xRes;
+	defaultScreenHeight = yRes;
+	
+	if(frameRate == 0)
+		frameRate = 60;
+	fixedTimestep = 1.0 / (Number)frameRate;
+	simulatedTime = 0;
+	frameCount = 0;
+	
+	eventMutex = createMutex();
+	
+	if(!renderer) {
+		renderer = new RecordingRenderer();
+	}
+	this->renderer = renderer;
+	services->setRenderer(renderer);
+	renderer->Init();
+	renderer->Resize(xRes, yRes);
+}
+
+HeadlessCore::~HeadlessCore() {
+	HeadlessCoreMutex *hMutex = (HeadlessCoreMutex*)eventMutex;
+#ifdef _WINDOWS
+	CloseHandle((HANDLE)hMutex->nativeMutex);
+#else
+	pthread_mutex_destroy((pthread_mutex_t*)hMutex->nativeMutex);
+	delete (pthread_mutex_t*)hMutex->nativeMutex;
+#endif
+	delete hMutex;
+	eventMutex = NULL;
+}
+
+bool HeadlessCore::Update() {
+	if(!running)
+		return false;
+	simulatedTime += fixedTimestep * 1000.0;
+	frameCount++;
+	updateCore();
+	return running;
+}
+
+void HeadlessCore::Render() {
+	renderer->BeginRender();
+	services->Render();
+	renderer->EndRender();
+}
+
+bool HeadlessCore::runFrames(int frameCount) {
+	for(int i=0; i < frameCount; i++) {
+		if(!updateAndRender())
+			return false;
+	}
+	return true;
+}
+
+void HeadlessCore::setFixedTimestep(Number timestep) {
+	fixedTimestep = timestep;
+}
+
+Number HeadlessCore::getFixedTimestep() const {
+	return fixedTimestep;
+}
+
+unsigned int HeadlessCore::getFrameCount() const {
+	return frameCount;
+}
+
+unsigned int HeadlessCore::getTicks() {
+	return (unsigned int)simulatedTime;
+}
+
+Number HeadlessCore::getElapsed() {
+	if(frameCount == 0)
+		return 0;
+	return fixedTimestep;
+}
+
+void HeadlessCore::setCursor(int cursorType) {
+}
+
+void HeadlessCore::createThread(Threaded *target) {
+	Core::createThread(target);
+#ifdef _WINDOWS
+	DWORD threadID;
+	CreateThread(NULL, 0, headlessThreadFunc, target, 0, &threadID);
+#else
+	pthread_t thread;
+	pthread_create(&thread, NULL, headlessThreadFunc, target);
+	pthread_detach(thread);
+#endif
+}
+
+void HeadlessCore::lockMutex(CoreMutex *mutex) {
+	HeadlessCoreMutex *hMutex = (HeadlessCoreMutex*)mutex;
+#ifdef _WINDOWS
+	WaitForSingleObject((HANDLE)hMutex->nativeMutex, INFINITE);
+#else
+	pthread_mutex_lock((pthread_mutex_t*)hMutex->nativeMutex);
+#endif
+}
+
+void HeadlessCore::unlockMutex(CoreMutex *mutex) {
+	HeadlessCoreMutex *hMutex = (HeadlessCoreMutex*)mutex;
+#ifdef _WINDOWS
+	ReleaseMutex((HANDLE)hMutex->nativeMutex);
+#else
+	pthread_mutex_unlock((pthread_mutex_t*)hMutex->nativeMutex);
+#endif
+}
+
+CoreMutex *HeadlessCore::createMutex() {
+	HeadlessCoreMutex *mutex = new HeadlessCoreMutex();
+#ifdef _WINDOWS
+	mutex->nativeMutex = (void*)CreateMutex(NULL, FALSE, NULL);
+#else
+	pthread_mutex_t *nativeMutex = new pthread_mutex_t;
+	pthread_mutex_init(nativeMutex, NULL);
+	mutex->nativeMutex = (void*)nativeMutex;
+#endif
+	return mutex;
+}
+
+void HeadlessCore::copyStringToClipboard(const String& str) {
+	clipboardString = str;
+}
+
+String HeadlessCore::getClipboardString() {
+	return clipboardString;
+}
+
+void HeadlessCore::createFolder(const String& folderPath) {
+	OSBasics::createFolder(folderPath);
+}
+
+void HeadlessCore::copyDiskItem(const String& itemPath, const String& destItemPath) {
+	if(!OSBasics::isFolder(itemPath)) {
+		copyFile(itemPath, destItemPath);
+		return;
+	}
+	
+	OSBasics::createFolder(destItemPath);
+	std::vector<OSFileEntry> entries = OSBasics::parseFolder(itemPath, true);
+	for(int i=0; i < entries.size(); i++) {
+		copyDiskItem(entries[i].fullPath, destItemPath + "/" + entries[i].name);
+	}
+}
+
+void HeadlessCore::moveDiskItem(const String& itemPath, const String& destItemPath) {
+	rename(itemPath.c_str(), destItemPath.c_str());
+}
+
+void HeadlessCore::removeDiskItem(const String& itemPath) {
+	if(OSBasics::isFolder(itemPath)) {
+		std::vector<OSFileEntry> entries = OSBasics::parseFolder(itemPath, true);
+		for(int i=0; i < entries.size(); i++) {
+			removeDiskItem(entries[i].fullPath);
+		}
+	}
+	OSBasics::removeItem(itemPath);
+}
+
+String HeadlessCore::openFolderPicker() {
+	return "";
+}
+
+std::vector<String> HeadlessCore::openFilePicker(std::vector<CoreFileExtension> extensions, bool allowMultiple) {
+	std::vector<String> r;
+	return r;
+}
+
+void HeadlessCore::setVideoMode(int xRes, int yRes, bool fullScreen, bool vSync, int aaLevel, int anisotropyLevel) {
+	this->xRes = xRes;
+	this->yRes = yRes;
+	this->fullScreen = fullScreen;
+	this->aaLevel = aaLevel;
+	renderer->Resize(xRes, yRes);
+	dispatchEvent(new Event(), EVENT_CORE_RESIZE);
+}
+
+void HeadlessCore::resizeTo(int xRes, int yRes) {
+	setVideoMode(xRes, yRes, fullScreen, false, aaLevel, 0);
+}
+
+void HeadlessCore::openURL(String url) {
+}
+
+String HeadlessCore::executeExternalCommand(String command, String args, String inDirectory) {
+	String finalCommand = command + " " + args;
+	if(inDirectory != "") {
+		finalCommand = "cd " + inDirectory + " && " + finalCommand;
+	}
+	
+	FILE *fp = popen(finalCommand.c_str(), "r");
+	if(!fp) {
+		return "Unable to execute command";
+	}
+	
+	char path[2048];
+	String retString;
+	while (fgets(path, sizeof(path), fp) != NULL) {
+		retString = retString + String(path);
+	}
+	pclose(fp);
+	return retString;
+}
@@ -28,6 +28,13 @@
 #include "OSBasics.h"
 #include "PolyPerlin.h"
 #include <algorithm>
+#include <vector>
+#include "zlib.h"
+
+#if !defined(_WINDOWS)
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
 
 using namespace Polycode;
 
@@ -36,7 +43,7 @@ void user_read_data(png_structp png_ptr, png_bytep data, png_size_t length) {
 	OSBasics::read(data, length, 1, file);
 }
 
-Image::Image(const String& fileName) : imageData(NULL) {
+Image::Image(const String& fileName) : imageData(NULL), premultiplied(false), mipmapData(NULL), numMipmaps(0) {
 	setPixelType(IMAGE_RGBA);
 	loaded = false;
 	if(!loadImage(fileName)) {
@@ -74,12 +81,12 @@ bool Image::isLoaded() const {
 	return loaded;
 }
 
-Image::Image(int width, int height, int type) : imageData(NULL) {
+Image::Image(int width, int height, int type) : imageData(NULL), premultiplied(false), mipmapData(NULL), numMipmaps(0) {
 	setPixelType(type);
 	createEmpty(width, height);
 }
 
-Image::Image(Image *copyImage) {
+Image::Image(Image *copyImage) : premultiplied(false), mipmapData(NULL), numMipmaps(0) {
 	setPixelType(copyImage->getType());
 	width = copyImage->getWidth();
 	height = copyImage->getHeight();		
@@ -87,7 +94,7 @@ Image::Image(Image *copyImage) {
 	memcpy(imageData, copyImage->getPixels(), width*height*pixelSize);
 }
 
-Image::Image(char *data, int width, int height, int type) {
+Image::Image(char *data, int width, int height, int type) : premultiplied(false), mipmapData(NULL), numMipmaps(0) {
 	setPixelType(type);	
 	imageData = (char*)malloc(width*height*pixelSize);
 	memcpy(imageData, data, width*height*pixelSize);
@@ -106,12 +113,13 @@ void Image::pasteImage(Image *image, int x, int y, int blendingMode , Number ble
 	}
 }
 
-Image::Image() {
+Image::Image() : premultiplied(false), mipmapData(NULL), numMipmaps(0) {
 	imageData = NULL;
 }
 
 Image::~Image() {
 	free(imageData);
+	free(mipmapData);
 }
 
 char *Image::getPixels() {
@@ -169,6 +177,8 @@ int Image::getHeight() const {
 
 void Image::createEmpty(int width, int height) {
 	free(imageData);
+	clearMipmaps();
+	premultiplied = false;
 		
 	imageData = (char*)malloc(width*height*pixelSize);
 	this->width = width;
@@ -665,38 +675,304 @@ bool Image::saveImage(const String &fileName) {
 	return savePNG(fileName);
 }
 
+static void premultiplyPixels(unsigned char *pixels, unsigned int count) {
+	for(unsigned int i=0; i < count; i++) {
+		unsigned int a = pixels[3];
+		pixels[0] = (pixels[0] * a) / 255;
+		pixels[1] = (pixels[1] * a) / 255;
+		pixels[2] = (pixels[2] * a) / 255;
+		pixels += 4;
+	}
+}
+
 void Image::premultiplyAlpha() {
-	unsigned int *imageData32 = (unsigned int*)imageData;
-			
-	for(int x=0; x < width; x++) {
-		for(int y=0; y < height; y++) {
-			
-			unsigned int hex = imageData32[x+(y*width)];
-			
-			int ta = (hex >> 24) & 0xFF;
-			int tb = (hex >> 16) & 0xFF;
-			int tg = (hex >> 8) & 0xFF;
-			int tr = (hex ) & 0xFF;
-	
-			Number r = ((Number)tr)/255.0f;
-			Number g = ((Number)tg)/255.0f;
-			Number b = ((Number)tb)/255.0f;
-			Number a = ((Number)ta)/255.0f;	
-
-			r *= a;
-			g *= a;
-			b *= a;
-						
-			unsigned int ir = 255.0f*r;
-			unsigned int ig = 255.0f*g;
-			unsigned int ib = 255.0f*b;
-			unsigned int ia = 255.0f*a;
-									
-			unsigned int newVal = ((ia & 0xFF) << 24) | ((ib & 0xFF) << 16) | ((ig & 0xFF) << 8) | (ir & 0xFF);
-						
-			imageData32[x+(y*width)] = newVal;
+	premultiplyPixels((unsigned char*)imageData, width*height);
+	for(int i=0; i < numMipmaps; i++) {
+		premultiplyPixels((unsigned char*)getMipmap(i), getMipmapWidth(i)*getMipmapHeight(i));
+	}
+	premultiplied = true;
+}
+
+bool Image::isPremultiplied() const {
+	return premultiplied;
+}
+
+int Image::getNumMipmaps() const {
+	return numMipmaps;
+}
+
+int Image::getMipmapWidth(int level) const {
+	return std::max(1, width >> (level+1));
+}
+
+int Image::getMipmapHeight(int level) const {
+	return std::max(1, height >> (level+1));
+}
+
+char *Image::getMipmap(int level) {
+	if(level < 0 || level >= numMipmaps)
+		return NULL;
+	char *mipmap = mipmapData;
+	for(int i=0; i < level; i++) {
+		mipmap += getMipmapWidth(i)*getMipmapHeight(i)*pixelSize;
+	}
+	return mipmap;
+}
+
+void Image::clearMipmaps() {
+	free(mipmapData);
+	mipmapData = NULL;
+	numMipmaps = 0;
+}
+
+void Image::generateMipmaps() {
+	clearMipmaps();
+	if(imageType != IMAGE_RGBA || !imageData)
+		return;
+	
+	unsigned int mipmapSize = 0;
+	int levels = 0;
+	while(getMipmapWidth(levels-1) > 1 || getMipmapHeight(levels-1) > 1) {
+		mipmapSize += getMipmapWidth(levels)*getMipmapHeight(levels)*4;
+		levels++;
+	}
+	if(levels == 0)
+		return;
+	
+	mipmapData = (char*)malloc(mipmapSize);
+	numMipmaps = levels;
+	
+	// each level is a 2x2 box filter of the previous one
+	const unsigned char *src = (const unsigned char*)imageData;
+	unsigned char *dst = (unsigned char*)mipmapData;
+	int srcWidth = width;
+	int srcHeight = height;
+	for(int level=0; level < levels; level++) {
+		int dstWidth = getMipmapWidth(level);
+		int dstHeight = getMipmapHeight(level);
+		for(int y=0; y < dstHeight; y++) {
+			const unsigned char *row0 = src + std::min(y*2, srcHeight-1)*srcWidth*4;
+			const unsigned char *row1 = src + std::min(y*2+1, srcHeight-1)*srcWidth*4;
+			unsigned char *out = dst + y*dstWidth*4;
+			for(int x=0; x < dstWidth; x++) {
+				int x0 = std::min(x*2, srcWidth-1)*4;
+				int x1 = std::min(x*2+1, srcWidth-1)*4;
+				for(int c=0; c < 4; c++) {
+					out[x*4+c] = (row0[x0+c] + row0[x1+c] + row1[x0+c] + row1[x1+c] + 2) >> 2;
+				}
+			}
+		}
+		src = dst;
+		dst += dstWidth*dstHeight*4;
+		srcWidth = dstWidth;
+		srcHeight = dstHeight;
+	}
+}
+
+// Header of cooked texture files. It is followed by the image pixels and then the pixels
+// of all mipmap levels. Each of the two blocks is deflate compressed if its stored size is
+// smaller than its size.
+struct CookedImageHeader {
+	char magic[4];
+	unsigned int version;
+	unsigned int imageType;
+	unsigned int width;
+	unsigned int height;
+	unsigned int flags;
+	unsigned int numMipmaps;
+	unsigned int sourceSize;
+	unsigned int sourceTime;
+	unsigned int imageSize;
+	unsigned int imageStoredSize;
+	unsigned int mipmapSize;
+	unsigned int mipmapStoredSize;
+};
+
+static const char COOKED_IMAGE_MAGIC[4] = {'P', 'T', 'E', 'X'};
+static const unsigned int COOKED_IMAGE_PREMULTIPLIED = 1;
+
+// Size and modification time of a source file on disk. Returns false for missing and archived files.
+static bool getSourceStamp(const String& fileName, unsigned int *size, unsigned int *time) {
+	OSFILE *file = OSBasics::open(fileName, "rb");
+	if(!file)
+		return false;
+	bool onDisk = file->fileType == OSFILE::TYPE_FILE;
+	if(onDisk) {
+		OSBasics::seek(file, 0, SEEK_END);
+		*size = OSBasics::tell(file);
+		*time = (unsigned int)OSBasics::getFileTime(fileName);
+	}
+	OSBasics::close(file);
+	return onDisk;
+}
+
+static bool readCookedBlock(const char *stored, unsigned int storedSize, char *out, unsigned int size) {
+	if(storedSize == size) {
+		memcpy(out, stored, size);
+		return true;
+	}
+	uLongf outSize = size;
+	return uncompress((Bytef*)out, &outSize, (const Bytef*)stored, storedSize) == Z_OK && outSize == size;
+}
+
+static void writeCookedBlock(const char *data, unsigned int size, bool compress, std::vector<char> &out, unsigned int *storedSize) {
+	if(compress && size > 0) {
+		uLongf compressedSize = compressBound(size);
+		out.resize(compressedSize);
+		if(compress2((Bytef*)&out[0], &compressedSize, (const Bytef*)data, size, Z_BEST_COMPRESSION) == Z_OK && compressedSize < size) {
+			out.resize(compressedSize);
+			*storedSize = compressedSize;
+			return;
 		}
 	}
+	out.assign(data, data + size);
+	*storedSize = size;
+}
+
+bool Image::saveCooked(const String &fileName, const String& sourceFileName, bool compress) {
+	if(!imageData)
+		return false;
+	
+	CookedImageHeader header;
+	memcpy(header.magic, COOKED_IMAGE_MAGIC, 4);
+	header.version = 1;
+	header.imageType = imageType;
+	header.width = width;
+	header.height = height;
+	header.flags = premultiplied ? COOKED_IMAGE_PREMULTIPLIED : 0;
+	header.numMipmaps = numMipmaps;
+	header.sourceSize = 0;
+	header.sourceTime = 0;
+	if(sourceFileName != "") {
+		getSourceStamp(sourceFileName, &header.sourceSize, &header.sourceTime);
+	}
+	
+	header.imageSize = width*height*pixelSize;
+	header.mipmapSize = 0;
+	for(int i=0; i < numMipmaps; i++) {
+		header.mipmapSize += getMipmapWidth(i)*getMipmapHeight(i)*pixelSize;
+	}
+	
+	std::vector<char> imageBlock;
+	std::vector<char> mipmapBlock;
+	writeCookedBlock(imageData, header.imageSize, compress, imageBlock, &header.imageStoredSize);
+	writeCookedBlock(mipmapData, header.mipmapSize, compress, mipmapBlock, &header.mipmapStoredSize);
+	
+	OSFILE *outFile = OSBasics::open(fileName, "wb");
+	if(!outFile) {
+		Logger::log("Error opening cooked texture file for saving: %s\n", fileName.c_str());
+		return false;
+	}
+	OSBasics::write(&header, sizeof(CookedImageHeader), 1, outFile);
+	if(imageBlock.size() > 0)
+		OSBasics::write(&imageBlock[0], 1, imageBlock.size(), outFile);
+	if(mipmapBlock.size() > 0)
+		OSBasics::write(&mipmapBlock[0], 1, mipmapBlock.size(), outFile);
+	OSBasics::close(outFile);
+	return true;
+}
+
+bool Image::loadCooked(const String& fileName, const String& sourceFileName) {
+	OSFILE *inFile = OSBasics::open(fileName, "rb");
+	if(!inFile)
+		return false;
+	
+#if !defined(_WINDOWS)
+	if(inFile->fileType == OSFILE::TYPE_FILE) {
+		int fd = fileno(inFile->file);
+		struct stat fileStat;
+		if(fstat(fd, &fileStat) == 0 && fileStat.st_size >= sizeof(CookedImageHeader)) {
+			void *mapped = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(mapped != MAP_FAILED) {
+				bool result = loadCookedData((const char*)mapped, fileStat.st_size, sourceFileName);
+				munmap(mapped, fileStat.st_size);
+				OSBasics::close(inFile);
+				return result;
+			}
+		}
+	}
+#endif
+	
+	OSBasics::seek(inFile, 0, SEEK_END);
+	long size = OSBasics::tell(inFile);
+	OSBasics::seek(inFile, 0, SEEK_SET);
+	bool result = false;
+	if(size >= (long)sizeof(CookedImageHeader)) {
+		std::vector<char> data(size);
+		if(OSBasics::read(&data[0], size, 1, inFile) == 1) {
+			result = loadCookedData(&data[0], size, sourceFileName);
+		}
+	}
+	OSBasics::close(inFile);
+	return result;
+}
+
+bool Image::loadCookedData(const char *data, unsigned int size, const String& sourceFileName) {
+	CookedImageHeader header;
+	if(size < sizeof(CookedImageHeader))
+		return false;
+	memcpy(&header, data, sizeof(CookedImageHeader));
+	if(memcmp(header.magic, COOKED_IMAGE_MAGIC, 4) != 0 || header.version != 1) {
+		Logger::log("Unsupported cooked texture data\n");
+		return false;
+	}
+	
+	if(sourceFileName != "") {
+		unsigned int sourceSize, sourceTime;
+		if(getSourceStamp(sourceFileName, &sourceSize, &sourceTime) && (sourceSize != header.sourceSize || sourceTime != header.sourceTime)) {
+			return false;
+		}
+	}
+	
+	if(header.numMipmaps > 32 || header.width > 65536 || header.height > 65536) {
+		Logger::log("Cooked texture data is corrupt\n");
+		return false;
+	}
+	
+	Image cooked;
+	cooked.setPixelType(header.imageType);
+	cooked.width = header.width;
+	cooked.height = header.height;
+	// sizes are computed in 64 bits, a 65536x65536 image does not fit in 32
+	unsigned long long imageSize = (unsigned long long)header.width * header.height * cooked.pixelSize;
+	unsigned long long mipmapSize = 0;
+	for(int i=0; i < header.numMipmaps; i++) {
+		mipmapSize += (unsigned long long)cooked.getMipmapWidth(i) * cooked.getMipmapHeight(i) * cooked.pixelSize;
+	}
+	if(header.imageSize != imageSize || header.mipmapSize != mipmapSize || header.imageStoredSize > header.imageSize || header.mipmapStoredSize > header.mipmapSize || size - sizeof(CookedImageHeader) < (unsigned long long)header.imageStoredSize + header.mipmapStoredSize) {
+		Logger::log("Cooked texture data is corrupt\n");
+		return false;
+	}
+	
+	const char *stored = data + sizeof(CookedImageHeader);
+	cooked.imageData = (char*)malloc(header.imageSize);
+	if(!readCookedBlock(stored, header.imageStoredSize, cooked.imageData, header.imageSize)) {
+		Logger::log("Cooked texture data is corrupt\n");
+		return false;
+	}
+	if(header.numMipmaps > 0) {
+		cooked.mipmapData = (char*)malloc(header.mipmapSize);
+		cooked.numMipmaps = header.numMipmaps;
+		if(!readCookedBlock(stored + header.imageStoredSize, header.mipmapStoredSize, cooked.mipmapData, header.mipmapSize)) {
+			Logger::log("Cooked texture data is corrupt\n");
+			return false;
+		}
+	}
+	
+	// take over the decoded buffers
+	free(imageData);
+	free(mipmapData);
+	setPixelType(cooked.imageType);
+	width = cooked.width;
+	height = cooked.height;
+	imageData = cooked.imageData;
+	mipmapData = cooked.mipmapData;
+	numMipmaps = cooked.numMipmaps;
+	premultiplied = (header.flags & COOKED_IMAGE_PREMULTIPLIED) != 0;
+	loaded = true;
+	cooked.imageData = NULL;
+	cooked.mipmapData = NULL;
+	return true;
 }
 
 bool Image::savePNG(const String &fileName) {
@@ -878,7 +1154,10 @@ bool Image::loadPNG(const String& fileName) {
 	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
 	OSBasics::close(infile);
 	
+	free(imageData);
+	clearMipmaps();
 	imageData = image_data;
+	premultiplied = false;
 	return true;
 }
 
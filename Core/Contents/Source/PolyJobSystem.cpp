@@ -0,0 +1,498 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+#include "PolyJobSystem.h"
+#include "OSBasics.h"
+
+#if defined(_WINDOWS)
+	#include <windows.h>
+#else
+	#include <pthread.h>
+	#include <sched.h>
+#endif
+
+using namespace Polycode;
+
+static inline long atomicIncrement(volatile long *value) {
+#if defined(_WINDOWS)
+	return InterlockedIncrement(value);
+#else
+	return __sync_add_and_fetch(value, 1);
+#endif
+}
+
+static inline long atomicDecrement(volatile long *value) {
+#if defined(_WINDOWS)
+	return InterlockedDecrement(value);
+#else
+	return __sync_sub_and_fetch(value, 1);
+#endif
+}
+
+static inline long atomicRead(volatile long *value) {
+#if defined(_WINDOWS)
+	return InterlockedCompareExchange(value, 0, 0);
+#else
+	return __sync_add_and_fetch(value, 0);
+#endif
+}
+
+static inline void yieldThread() {
+#if defined(_WINDOWS)
+	SwitchToThread();
+#else
+	sched_yield();
+#endif
+}
+
+static inline void spinLock(volatile long *lock) {
+#if defined(_WINDOWS)
+	while(InterlockedExchange(lock, 1) != 0) {
+#else
+	while(__sync_lock_test_and_set(lock, 1) != 0) {
+#endif
+		while(atomicRead(lock) != 0) {
+			yieldThread();
+		}
+	}
+}
+
+static inline void spinUnlock(volatile long *lock) {
+#if defined(_WINDOWS)
+	InterlockedExchange(lock, 0);
+#else
+	__sync_lock_release(lock);
+#endif
+}
+
+#if defined(_WINDOWS)
+static DWORD WINAPI runJobWorker(LPVOID param) {
+	JobWorker *worker = (JobWorker*)param;
+	worker->jobSystem->runWorker(worker);
+	return 0;
+}
+#else
+static void *runJobWorker(void *param) {
+	JobWorker *worker = (JobWorker*)param;
+	worker->jobSystem->runWorker(worker);
+	return NULL;
+}
+#endif
+
+Job::Job() {
+	reset();
+}
+
+void Job::reset() {
+	function = NULL;
+	rangeFunction = NULL;
+	data = NULL;
+	rangeStart = 0;
+	rangeEnd = 0;
+	grainSize = 1;
+	parent = NULL;
+	unfinishedJobs = 1;
+	pendingDependencies = 1;
+	lock = 0;
+	finished = 0;
+	dependents.clear();
+}
+
+bool Job::isFinished() const {
+	return atomicRead((volatile long*)&finished) != 0;
+}
+
+JobQueue::JobQueue() {
+	lock = 0;
+}
+
+JobSystem::JobSystem(int numWorkers) {
+	if(numWorkers < 0) {
+		numWorkers = OSBasics::getProcessorCount() - 1;
+		if(numWorkers < 0)
+			numWorkers = 0;
+	}
+	
+	numQueues = numWorkers + 1;
+	queues = new JobQueue[numQueues];
+	
+	for(int i=0; i < MAX_JOB_BLOCKS; i++) {
+		jobBlocks[i] = NULL;
+	}
+	numJobBlocks = 0;
+	numAllocatedJobs = 0;
+	jobPoolLock = 0;
+	
+	activeJobs = 0;
+	queuedJobs = 0;
+	sleepingWorkers = 0;
+	running = true;
+	
+#if defined(_WINDOWS)
+	wakeMutex = new CRITICAL_SECTION;
+	InitializeCriticalSection((CRITICAL_SECTION*)wakeMutex);
+	wakeCondition = new CONDITION_VARIABLE;
+	InitializeConditionVariable((CONDITION_VARIABLE*)wakeCondition);
+	workerKey = new DWORD;
+	*((DWORD*)workerKey) = TlsAlloc();
+#else
+	wakeMutex = new pthread_mutex_t;
+	pthread_mutex_init((pthread_mutex_t*)wakeMutex, NULL);
+	wakeCondition = new pthread_cond_t;
+	pthread_cond_init((pthread_cond_t*)wakeCondition, NULL);
+	workerKey = new pthread_key_t;
+	pthread_key_create((pthread_key_t*)workerKey, NULL);
+#endif
+	
+	for(int i=0; i < numWorkers; i++) {
+		JobWorker *worker = new JobWorker();
+		worker->jobSystem = this;
+		worker->queueIndex = i+1;
+#if defined(_WINDOWS)
+		worker->thread = CreateThread(NULL, 0, runJobWorker, worker, 0, NULL);
+		if(worker->thread == NULL) {
+			delete worker;
+			break;
+		}
+#else
+		pthread_t *thread = new pthread_t;
+		if(pthread_create(thread, NULL, runJobWorker, worker) != 0) {
+			delete thread;
+			delete worker;
+			break;
+		}
+		worker->thread = thread;
+#endif
+		workers.push_back(worker);
+	}
+}
+
+JobSystem::~JobSystem() {
+	endFrame();
+	
+	running = false;
+#if defined(_WINDOWS)
+	EnterCriticalSection((CRITICAL_SECTION*)wakeMutex);
+	WakeAllConditionVariable((CONDITION_VARIABLE*)wakeCondition);
+	LeaveCriticalSection((CRITICAL_SECTION*)wakeMutex);
+#else
+	pthread_mutex_lock((pthread_mutex_t*)wakeMutex);
+	pthread_cond_broadcast((pthread_cond_t*)wakeCondition);
+	pthread_mutex_unlock((pthread_mutex_t*)wakeMutex);
+#endif
+	
+	for(int i=0; i < workers.size(); i++) {
+#if defined(_WINDOWS)
+		WaitForSingleObject((HANDLE)workers[i]->thread, INFINITE);
+		CloseHandle((HANDLE)workers[i]->thread);
+#else
+		pthread_join(*((pthread_t*)workers[i]->thread), NULL);
+		delete (pthread_t*)workers[i]->thread;
+#endif
+		delete workers[i];
+	}
+	
+	for(int i=0; i < numJobBlocks; i++) {
+		delete [] jobBlocks[i];
+	}
+	delete [] queues;
+	
+#if defined(_WINDOWS)
+	DeleteCriticalSection((CRITICAL_SECTION*)wakeMutex);
+	delete (CRITICAL_SECTION*)wakeMutex;
+	delete (CONDITION_VARIABLE*)wakeCondition;
+	TlsFree(*((DWORD*)workerKey));
+	delete (DWORD*)workerKey;
+#else
+	pthread_mutex_destroy((pthread_mutex_t*)wakeMutex);
+	delete (pthread_mutex_t*)wakeMutex;
+	pthread_cond_destroy((pthread_cond_t*)wakeCondition);
+	delete (pthread_cond_t*)wakeCondition;
+	pthread_key_delete(*((pthread_key_t*)workerKey));
+	delete (pthread_key_t*)workerKey;
+#endif
+}
+
+int JobSystem::getNumWorkers() const {
+	return workers.size();
+}
+
+int JobSystem::getQueueIndex() {
+#if defined(_WINDOWS)
+	JobWorker *worker = (JobWorker*)TlsGetValue(*((DWORD*)workerKey));
+#else
+	JobWorker *worker = (JobWorker*)pthread_getspecific(*((pthread_key_t*)workerKey));
+#endif
+	if(worker)
+		return worker->queueIndex;
+	// the owning thread and any other thread share the first queue
+	return 0;
+}
+
+void JobSystem::runWorker(JobWorker *worker) {
+#if defined(_WINDOWS)
+	TlsSetValue(*((DWORD*)workerKey), worker);
+#else
+	pthread_setspecific(*((pthread_key_t*)workerKey), worker);
+#endif
+	
+	int spins = 0;
+	while(running) {
+		Job *job = findJob(worker->queueIndex);
+		if(job) {
+			executeJob(job);
+			spins = 0;
+			continue;
+		}
+		
+		if(spins < WORKER_SPIN_COUNT) {
+			spins++;
+			yieldThread();
+			continue;
+		}
+		
+		// announce the sleep before checking for jobs, so that queueJob() either sees the sleeping worker or this thread sees the job
+#if defined(_WINDOWS)
+		EnterCriticalSection((CRITICAL_SECTION*)wakeMutex);
+		atomicIncrement(&sleepingWorkers);
+		while(running && atomicRead(&queuedJobs) == 0) {
+			SleepConditionVariableCS((CONDITION_VARIABLE*)wakeCondition, (CRITICAL_SECTION*)wakeMutex, INFINITE);
+		}
+		atomicDecrement(&sleepingWorkers);
+		LeaveCriticalSection((CRITICAL_SECTION*)wakeMutex);
+#else
+		pthread_mutex_lock((pthread_mutex_t*)wakeMutex);
+		atomicIncrement(&sleepingWorkers);
+		while(running && atomicRead(&queuedJobs) == 0) {
+			pthread_cond_wait((pthread_cond_t*)wakeCondition, (pthread_mutex_t*)wakeMutex);
+		}
+		atomicDecrement(&sleepingWorkers);
+		pthread_mutex_unlock((pthread_mutex_t*)wakeMutex);
+#endif
+		spins = 0;
+	}
+}
+
+Job *JobSystem::allocateJob() {
+	long index = atomicIncrement(&numAllocatedJobs) - 1;
+	long block = index / JOB_BLOCK_SIZE;
+	
+	Job *job;
+	if(block >= MAX_JOB_BLOCKS) {
+		job = new Job();
+		spinLock(&jobPoolLock);
+		overflowJobs.push_back(job);
+		spinUnlock(&jobPoolLock);
+		return job;
+	}
+	
+	if(block >= atomicRead(&numJobBlocks)) {
+		spinLock(&jobPoolLock);
+		while(numJobBlocks <= block) {
+			jobBlocks[numJobBlocks] = new Job[JOB_BLOCK_SIZE];
+			atomicIncrement(&numJobBlocks);
+		}
+		spinUnlock(&jobPoolLock);
+	}
+	
+	job = &jobBlocks[block][index % JOB_BLOCK_SIZE];
+	job->reset();
+	return job;
+}
+
+Job *JobSystem::createJob(JobFunction function, void *data, Job *parent) {
+	Job *job = allocateJob();
+	job->function = function;
+	job->data = data;
+	job->parent = parent;
+	if(parent)
+		atomicIncrement(&parent->unfinishedJobs);
+	return job;
+}
+
+Job *JobSystem::createRangeJob(unsigned int count, unsigned int grainSize, JobRangeFunction function, void *data, Job *parent) {
+	Job *job = createJob(NULL, data, parent);
+	job->rangeFunction = function;
+	job->rangeStart = 0;
+	job->rangeEnd = count;
+	job->grainSize = grainSize > 0 ? grainSize : 1;
+	return job;
+}
+
+void JobSystem::addDependency(Job *job, Job *dependency) {
+	spinLock(&dependency->lock);
+	if(dependency->finished == 0) {
+		atomicIncrement(&job->pendingDependencies);
+		dependency->dependents.push_back(job);
+	}
+	spinUnlock(&dependency->lock);
+}
+
+void JobSystem::run(Job *job) {
+	atomicIncrement(&activeJobs);
+	if(atomicDecrement(&job->pendingDependencies) == 0)
+		queueJob(job);
+}
+
+void JobSystem::queueJob(Job *job) {
+	// counted before it is pushed, so a thread that pops the job never takes the count below zero
+	atomicIncrement(&queuedJobs);
+	
+	JobQueue *queue = &queues[getQueueIndex()];
+	spinLock(&queue->lock);
+	queue->jobs.push_back(job);
+	spinUnlock(&queue->lock);
+	
+	if(atomicRead(&sleepingWorkers) > 0) {
+#if defined(_WINDOWS)
+		EnterCriticalSection((CRITICAL_SECTION*)wakeMutex);
+		WakeConditionVariable((CONDITION_VARIABLE*)wakeCondition);
+		LeaveCriticalSection((CRITICAL_SECTION*)wakeMutex);
+#else
+		pthread_mutex_lock((pthread_mutex_t*)wakeMutex);
+		pthread_cond_signal((pthread_cond_t*)wakeCondition);
+		pthread_mutex_unlock((pthread_mutex_t*)wakeMutex);
+#endif
+	}
+}
+
+Job *JobSystem::findJob(int queueIndex) {
+	if(atomicRead(&queuedJobs) == 0)
+		return NULL;
+	
+	Job *job = NULL;
+	
+	// newest job of the own queue first, its data is most likely still in the cache
+	JobQueue *queue = &queues[queueIndex];
+	spinLock(&queue->lock);
+	if(!queue->jobs.empty()) {
+		job = queue->jobs.back();
+		queue->jobs.pop_back();
+	}
+	spinUnlock(&queue->lock);
+	
+	// otherwise steal the oldest job of another queue, which tends to be the largest
+	for(int i=1; i < numQueues && !job; i++) {
+		JobQueue *victim = &queues[(queueIndex + i) % numQueues];
+		spinLock(&victim->lock);
+		if(!victim->jobs.empty()) {
+			job = victim->jobs.front();
+			victim->jobs.pop_front();
+		}
+		spinUnlock(&victim->lock);
+	}
+	
+	if(job)
+		atomicDecrement(&queuedJobs);
+	return job;
+}
+
+void JobSystem::executeJob(Job *job) {
+	if(job->rangeFunction) {
+		unsigned int start = job->rangeStart;
+		unsigned int end = job->rangeEnd;
+		
+		// hand the upper halves to other workers until the rest is small enough to run here
+		while(end - start > job->grainSize) {
+			unsigned int middle = start + (end - start) / 2;
+			Job *child = createJob(NULL, job->data, job);
+			child->rangeFunction = job->rangeFunction;
+			child->rangeStart = middle;
+			child->rangeEnd = end;
+			child->grainSize = job->grainSize;
+			run(child);
+			end = middle;
+		}
+		
+		if(end > start)
+			job->rangeFunction(job->data, start, end);
+	} else if(job->function) {
+		job->function(job->data);
+	}
+	
+	finishJob(job);
+}
+
+void JobSystem::finishJob(Job *job) {
+	if(atomicDecrement(&job->unfinishedJobs) != 0)
+		return;
+	
+	spinLock(&job->lock);
+	atomicIncrement(&job->finished);
+	spinUnlock(&job->lock);
+	
+	// no dependents can be added once the job is marked finished
+	for(int i=0; i < job->dependents.size(); i++) {
+		Job *dependent = job->dependents[i];
+		if(atomicDecrement(&dependent->pendingDependencies) == 0)
+			queueJob(dependent);
+	}
+	
+	if(job->parent)
+		finishJob(job->parent);
+	
+	atomicDecrement(&activeJobs);
+}
+
+void JobSystem::wait(Job *job) {
+	int queueIndex = getQueueIndex();
+	while(!job->isFinished()) {
+		Job *next = findJob(queueIndex);
+		if(next) {
+			executeJob(next);
+		} else {
+			yieldThread();
+		}
+	}
+}
+
+void JobSystem::parallelFor(unsigned int count, unsigned int grainSize, JobRangeFunction function, void *data) {
+	if(count == 0)
+		return;
+	
+	if(count <= grainSize || workers.size() == 0) {
+		function(data, 0, count);
+		return;
+	}
+	
+	Job *job = createRangeJob(count, grainSize, function, data);
+	run(job);
+	wait(job);
+}
+
+void JobSystem::endFrame() {
+	int queueIndex = getQueueIndex();
+	while(atomicRead(&activeJobs) > 0) {
+		Job *next = findJob(queueIndex);
+		if(next) {
+			executeJob(next);
+		} else {
+			yieldThread();
+		}
+	}
+	
+	numAllocatedJobs = 0;
+	for(int i=0; i < overflowJobs.size(); i++) {
+		delete overflowJobs[i];
+	}
+	overflowJobs.clear();
+}
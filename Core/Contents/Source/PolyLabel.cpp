@@ -21,6 +21,8 @@
 */
 
 #include "PolyLabel.h"
+#include "PolyGlyphAtlas.h"
+#include "PolyMesh.h"
   
 using namespace Polycode;
 
@@ -58,13 +60,27 @@ ColorRange::ColorRange(Color color, unsigned int rangeStart, unsigned int rangeE
 }
 
 
-Label::Label(Font *font, const String& text, int size, int antiAliasMode, bool premultiplyAlpha) : Image(), _optionsChanged(false) {
+Label::Label(Font *font, const String& text, int size, int antiAliasMode, bool premultiplyAlpha, bool useGlyphAtlas) : Image(), _optionsChanged(false) {
 		setPixelType(Image::IMAGE_RGBA);
 		this->font = font;
 		this->size = size;
 		this->premultiplyAlpha = premultiplyAlpha;
 		imageData = NULL;
 		this->antiAliasMode = antiAliasMode;
+		this->useGlyphAtlas = useGlyphAtlas;
+		glyphAtlas = NULL;
+		glyphMesh = NULL;
+		meshQuadCount = 0;
+		meshValidCount = 0;
+		meshGeneration = 0;
+		meshScale = 1.0;
+		meshOffsetX = 0.0;
+		meshOffsetY = 0.0;
+		meshYUp = false;
+		meshColorsDirty = true;
+		baseLineOffset = 0;
+		xAdjustOffset = 0;
+		baseLineAdjust = 0;
 		setText(text);
 }
 
@@ -96,11 +112,16 @@ int Label::getTextWidthForString(const String& text) {
 	if(!font->isValid())
 		return 0;
 	
-	GlyphData data;
-	precacheGlyphs(text, &data);
-
 	FT_BBox bbox;
-	computeStringBbox(&data, &bbox);	
+	if(useGlyphAtlas) {
+		std::vector<LabelGlyph> glyphs;
+		layoutGlyphs(font->getGlyphAtlas(size, antiAliasMode, premultiplyAlpha), String(text).getWDataWithEncoding(String::ENCODING_UTF8), glyphs, 0);
+		computeLayoutBbox(glyphs, &bbox);
+	} else {
+		GlyphData data;
+		precacheGlyphs(text, &data);
+		computeStringBbox(&data, &bbox);
+	}
 	
 	return (bbox.xMax -  bbox.xMin);
 
@@ -112,11 +133,16 @@ int Label::getTextHeightForString(const String& text) {
 	if(!font->isValid())
 		return 0;
 
-	GlyphData data;
-	precacheGlyphs(text, &data);
-
 	FT_BBox bbox;
-	computeStringBbox(&data, &bbox);	
+	if(useGlyphAtlas) {
+		std::vector<LabelGlyph> glyphs;
+		layoutGlyphs(font->getGlyphAtlas(size, antiAliasMode, premultiplyAlpha), String(text).getWDataWithEncoding(String::ENCODING_UTF8), glyphs, 0);
+		computeLayoutBbox(glyphs, &bbox);
+	} else {
+		GlyphData data;
+		precacheGlyphs(text, &data);
+		computeStringBbox(&data, &bbox);
+	}
 	
 	return (bbox.yMax -  bbox.yMin);
 }
@@ -197,11 +223,13 @@ const String& Label::getText() const {
 void Label::clearColors() {
 	colorRanges.clear();
 	_optionsChanged = true;
+	meshColorsDirty = true;
 }
 
 void Label::setColorForRange(Color color, unsigned int rangeStart, unsigned int rangeEnd) {
 	colorRanges.push_back(ColorRange(color, rangeStart, rangeEnd));
 	_optionsChanged = true;	
+	meshColorsDirty = true;
 }
 
 Color Label::getColorForIndex(unsigned int index) {
@@ -210,7 +238,7 @@ Color Label::getColorForIndex(unsigned int index) {
 			return colorRanges[i].color;
 		}
 	}
-	return Color(1.0,1.0,1.0,1.0);
+	return Color(1.0f,1.0f,1.0f,1.0f);
 }
 
 void Label::precacheGlyphs(String text, GlyphData *glyphData) {
@@ -296,6 +324,221 @@ int Label::getBaselineAdjust() {
 	return baseLineAdjust;
 }
 
+int Label::getXAdjust() {
+	return xAdjustOffset;
+}
+
+bool Label::usesGlyphAtlas() const {
+	return useGlyphAtlas;
+}
+
+GlyphAtlas *Label::getGlyphAtlas() {
+	return glyphAtlas;
+}
+
+void Label::layoutGlyphs(GlyphAtlas *atlas, const std::wstring &wstr, std::vector<LabelGlyph> &glyphs, unsigned int start) {
+	glyphs.resize(start);
+	glyphs.reserve(wstr.length());
+	
+	int penX = 0;
+	FT_UInt previous = 0;
+	unsigned int colorIndex = 0;
+	if(start > 0) {
+		penX = glyphs[start-1].nextPenX;
+		previous = glyphs[start-1].nextPrevious;
+		colorIndex = glyphs[start-1].nextColorIndex;
+	}
+	
+	LabelGlyph entry;
+	for(unsigned int n = start; n < wstr.length(); n++) {
+		entry.charCode = (FT_ULong)wstr[n];
+		if(wstr[n] == '\t') {
+			entry.glyph = atlas->getGlyph(' ');
+			entry.advanceMultiplier = 4;
+		} else {
+			entry.glyph = atlas->getGlyph(entry.charCode);
+			entry.advanceMultiplier = 1;
+		}
+		
+		// kerning is applied even if the glyph fails to load, like precacheGlyphs() does
+		FT_UInt glyphIndex = entry.glyph ? entry.glyph->glyphIndex : FT_Get_Char_Index(font->getFace(), wstr[n] == '\t' ? ' ' : entry.charCode);
+		if(previous && glyphIndex) {
+			penX += atlas->getKerning(previous, glyphIndex);
+		}
+		
+		entry.penX = penX;
+		entry.colorIndex = colorIndex;
+		if(entry.glyph) {
+			penX += entry.glyph->advance * entry.advanceMultiplier;
+			previous = glyphIndex;
+			colorIndex++;
+		}
+		entry.nextPenX = penX;
+		entry.nextPrevious = previous;
+		entry.nextColorIndex = colorIndex;
+		glyphs.push_back(entry);
+	}
+}
+
+void Label::computeLayoutBbox(const std::vector<LabelGlyph> &glyphs, FT_BBox *abbox) {
+	FT_BBox bbox;
+	bbox.xMin = bbox.yMin = 32000;
+	bbox.xMax = bbox.yMax = -32000;
+	
+	for(unsigned int n = 0; n < glyphs.size(); n++) {
+		const AtlasGlyph *glyph = glyphs[n].glyph;
+		if(!glyph)
+			continue;
+		if(glyphs[n].penX + glyph->xMin < bbox.xMin)
+			bbox.xMin = glyphs[n].penX + glyph->xMin;
+		if(glyph->yMin < bbox.yMin)
+			bbox.yMin = glyph->yMin;
+		if(glyphs[n].penX + glyph->xMax > bbox.xMax)
+			bbox.xMax = glyphs[n].penX + glyph->xMax;
+		if(glyph->yMax > bbox.yMax)
+			bbox.yMax = glyph->yMax;
+	}
+	
+	if(bbox.xMin > bbox.xMax) {
+		bbox.xMin = 0;
+		bbox.yMin = 0;
+		bbox.xMax = 0;
+		bbox.yMax = 0;
+	}
+	
+	if(glyphs.size() > 0) {
+		const LabelGlyph &last = glyphs[glyphs.size()-1];
+		if(last.glyph && (last.charCode == ' ' || last.charCode == '\t')) {
+			bbox.xMax += last.glyph->advance * last.advanceMultiplier;
+		}
+	}
+	
+	*abbox = bbox;
+}
+
+void Label::writeGlyphQuad(Mesh *mesh, unsigned int index, Number scale, Number offsetX, Number offsetY, bool yUp) {
+	const LabelGlyph &entry = glyphLayout[index];
+	
+	Number x0 = 0.0, x1 = 0.0, yTop = 0.0, yBottom = 0.0;
+	Number u0 = 0.0, u1 = 0.0, vTop = 0.0, vBottom = 0.0;
+	
+	// characters without a bitmap still get a degenerate quad to keep quads and characters in step
+	const AtlasGlyph *glyph = entry.glyph;
+	if(glyph && glyph->width > 0) {
+		Image *atlasImage = glyphAtlas->getImage();
+		Number atlasWidth = atlasImage->getWidth();
+		Number atlasHeight = atlasImage->getHeight();
+		
+		x0 = ((entry.penX + glyph->left) * scale) + offsetX;
+		x1 = x0 + (glyph->width * scale);
+		if(yUp) {
+			yTop = (glyph->top * scale) + offsetY;
+			yBottom = yTop - (glyph->height * scale);
+		} else {
+			yTop = (-glyph->top * scale) + offsetY;
+			yBottom = yTop + (glyph->height * scale);
+		}
+		u0 = glyph->x / atlasWidth;
+		u1 = (glyph->x + glyph->width) / atlasWidth;
+		vBottom = glyph->y / atlasHeight;
+		vTop = (glyph->y + glyph->height) / atlasHeight;
+	}
+	
+	Number corners[4][4];
+	if(yUp) {
+		Number c[4][4] = {{x0, yBottom, u0, vBottom}, {x1, yBottom, u1, vBottom}, {x1, yTop, u1, vTop}, {x0, yTop, u0, vTop}};
+		memcpy(corners, c, sizeof(corners));
+	} else {
+		Number c[4][4] = {{x0, yTop, u0, vTop}, {x1, yTop, u1, vTop}, {x1, yBottom, u1, vBottom}, {x0, yBottom, u0, vBottom}};
+		memcpy(corners, c, sizeof(corners));
+	}
+	
+	unsigned int vertexIndex = index * 4;
+	for(int i=0; i < 4; i++) {
+		float *position = &mesh->vertexPositionArray[(vertexIndex+i)*3];
+		position[0] = corners[i][0];
+		position[1] = corners[i][1];
+		position[2] = 0.0;
+		
+		float *normal = &mesh->vertexNormalArray[(vertexIndex+i)*3];
+		normal[0] = 0.0;
+		normal[1] = 0.0;
+		normal[2] = 1.0;
+		
+		float *tangent = &mesh->vertexTangentArray[(vertexIndex+i)*3];
+		tangent[0] = 1.0;
+		tangent[1] = 0.0;
+		tangent[2] = 0.0;
+		
+		float *texCoord = &mesh->vertexTexCoordArray[(vertexIndex+i)*2];
+		texCoord[0] = corners[i][2];
+		texCoord[1] = corners[i][3];
+		
+		mesh->indexArray[vertexIndex+i] = vertexIndex+i;
+	}
+}
+
+bool Label::updateGlyphMesh(Mesh *mesh, Number scale, Number offsetX, Number offsetY, bool yUp, Color tint) {
+	unsigned int generation = glyphAtlas ? glyphAtlas->getGeneration() : 0;
+	bool useColors = colorRanges.size() > 0;
+	
+	bool rebuild = (mesh != glyphMesh || !mesh->isIndexedMesh() || generation != meshGeneration || scale != meshScale || offsetX != meshOffsetX || offsetY != meshOffsetY || yUp != meshYUp);
+	bool recolor = (rebuild || meshColorsDirty || (useColors && tint != meshTint));
+	
+	unsigned int count = glyphLayout.size();
+	unsigned int start = rebuild ? 0 : meshValidCount;
+	if(start == count && meshQuadCount == count && !recolor) {
+		return false;
+	}
+	
+	if(rebuild) {
+		mesh->clearMesh();
+		mesh->setMeshType(Mesh::QUAD_MESH);
+		mesh->convertToIndexedMesh();
+	}
+	
+	mesh->vertexPositionArray.resize(count * 12);
+	mesh->vertexNormalArray.resize(count * 12);
+	mesh->vertexTangentArray.resize(count * 12);
+	mesh->vertexColorArray.resize(count * 16);
+	mesh->vertexTexCoordArray.resize(count * 8);
+	mesh->indexArray.resize(count * 4);
+	
+	for(unsigned int i = start; i < count; i++) {
+		writeGlyphQuad(mesh, i, scale, offsetX, offsetY, yUp);
+	}
+	
+	unsigned int colorStart = recolor ? 0 : start;
+	Color glyphColor = Color(1.0f, 1.0f, 1.0f, 1.0f);
+	for(unsigned int i = colorStart; i < count; i++) {
+		if(useColors) {
+			glyphColor = getColorForIndex(glyphLayout[i].colorIndex) * tint;
+		}
+		float *color = &mesh->vertexColorArray[i * 16];
+		for(int j=0; j < 4; j++) {
+			color[(j*4)] = glyphColor.r;
+			color[(j*4)+1] = glyphColor.g;
+			color[(j*4)+2] = glyphColor.b;
+			color[(j*4)+3] = glyphColor.a;
+		}
+	}
+	
+	mesh->useVertexColors = useColors;
+	mesh->dirtyArrays();
+	
+	glyphMesh = mesh;
+	meshQuadCount = count;
+	meshValidCount = count;
+	meshGeneration = generation;
+	meshScale = scale;
+	meshOffsetX = offsetX;
+	meshOffsetY = offsetY;
+	meshYUp = yUp;
+	meshTint = tint;
+	meshColorsDirty = false;
+	return true;
+}
+
 void Label::drawGlyphBitmap(FT_Bitmap *bitmap, unsigned int x, unsigned int y, Color glyphColor) {
 
 	int lineoffset = (height-y) * (width*4);
@@ -362,7 +605,7 @@ void Label::renderGlyphs(GlyphData *glyphData) {
 		useColorRanges = true;
 	}
 	
-	Color glyphColor = Color(1.0, 1.0, 1.0, 1.0);
+	Color glyphColor = Color(1.0f, 1.0f, 1.0f, 1.0f);
 
 	int start_x = 0; //( ( my_target_width  - string_width  ) / 2 ) * 64;
 	int start_y = 0; //( ( my_target_height - string_height ) / 2 ) * 64;
@@ -412,6 +655,35 @@ void Label::setText(const String& text) {
 
 	this->text = text;
 
+	if(useGlyphAtlas) {
+		GlyphAtlas *atlas = font->getGlyphAtlas(size, antiAliasMode, premultiplyAlpha);
+		std::wstring wstr = std::wstring(this->text.getWDataWithEncoding(String::ENCODING_UTF8));
+		
+		// only characters after the unchanged start of the text need to be laid out again
+		unsigned int start = 0;
+		if(atlas == glyphAtlas) {
+			while(start < glyphLayout.size() && start < wstr.length() && glyphLayout[start].charCode == (FT_ULong)wstr[start]) {
+				start++;
+			}
+		}
+		glyphAtlas = atlas;
+		layoutGlyphs(atlas, wstr, glyphLayout, start);
+		if(meshValidCount > start) {
+			meshValidCount = start;
+		}
+		
+		FT_BBox bbox;
+		computeLayoutBbox(glyphLayout, &bbox);
+		
+		width = (bbox.xMax -  bbox.xMin)+1;
+		height = (bbox.yMax -  bbox.yMin)+1;
+		baseLineOffset = bbox.yMin;
+		xAdjustOffset = bbox.xMin;
+		baseLineAdjust = bbox.yMax;
+		_optionsChanged = false;
+		return;
+	}
+
 	precacheGlyphs(text, &labelData);
 
 	FT_BBox bbox;
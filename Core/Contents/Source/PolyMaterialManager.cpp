@@ -28,8 +28,11 @@
 #include "PolyRenderer.h"
 #include "PolyResourceManager.h"
 #include "PolyFixedShader.h"
+#include "PolyCore.h"
+#include "OSBasics.h"
 
 #include "tinyxml.h"
+#include <stdio.h>
 
 using namespace Polycode;
 using std::vector;
@@ -114,12 +117,9 @@ Texture *MaterialManager::createTextureFromFile(const String& fileName, bool cla
 		return newTexture;
 	}
 	
-	Image *image = new Image(fileName);
+	Image *image = loadTextureImage(fileName, premultiplyAlphaOnLoad, createMipmaps);
 	if(image->isLoaded()) {
-		if(premultiplyAlphaOnLoad) {
-			image->premultiplyAlpha();
-		}
-		newTexture = createTexture(image->getWidth(), image->getHeight(), image->getPixels(), clamp, createMipmaps);
+		newTexture = createTextureFromImage(image, clamp, createMipmaps);
 		newTexture->setResourcePath(fileName);
 		CoreServices::getInstance()->getResourceManager()->addResource(newTexture);		
 	} else {
@@ -153,10 +153,85 @@ Texture *MaterialManager::createTexture(int width, int height, char *imageData,
 
 Texture *MaterialManager::createTextureFromImage(Image *image, bool clamp, bool createMipmaps) {
 	Texture *newTexture;
-	newTexture = createTexture(image->getWidth(), image->getHeight(), image->getPixels(),clamp, createMipmaps, image->getType());
+	bool precomputedMipmaps = createMipmaps && image->getNumMipmaps() > 0;
+	newTexture = createTexture(image->getWidth(), image->getHeight(), image->getPixels(),clamp, createMipmaps && !precomputedMipmaps, image->getType());
+	if(precomputedMipmaps) {
+		newTexture->setMipmaps(image);
+	}
 	return newTexture; 
 }
 
+void MaterialManager::setTextureCacheFolder(const String& folder) {
+	textureCacheFolder = folder;
+	if(textureCacheFolder != "" && !OSBasics::isFolder(textureCacheFolder)) {
+		OSBasics::createFolder(textureCacheFolder);
+	}
+}
+
+String MaterialManager::getTextureCacheFolder() const {
+	return textureCacheFolder;
+}
+
+Image *MaterialManager::loadTextureImage(const String& fileName, bool premultiply, bool createMipmaps) {
+	Image *image = new Image();
+	
+	// cooked by polybuild
+	size_t extensionStart = fileName.rfind(".");
+	size_t nameStart = fileName.rfind("/");
+	if(extensionStart != std::string::npos && (nameStart == std::string::npos || extensionStart > nameStart)) {
+		String cookedFileName = fileName.substr(0, extensionStart) + ".ptex";
+		if(OSBasics::fileExists(cookedFileName) && image->loadCooked(cookedFileName, fileName) && (premultiply || !image->isPremultiplied())) {
+			if(premultiply && !image->isPremultiplied()) {
+				image->premultiplyAlpha();
+			}
+			return image;
+		}
+	}
+	
+	// the cache is keyed by the path and the options, and checked against the size and modification time of the file
+	String cacheFileName;
+	if(textureCacheFolder != "") {
+		unsigned int hash = 2166136261u ^ ((premultiply ? 1 : 0) | (createMipmaps ? 2 : 0));
+		const char *str = fileName.c_str();
+		for(int i=0; str[i] != 0; i++) {
+			hash ^= (unsigned char)str[i];
+			hash *= 16777619u;
+		}
+		char hashString[16];
+		snprintf(hashString, sizeof(hashString), "%08x", hash);
+		cacheFileName = textureCacheFolder + "/" + String(hashString) + ".ptex";
+		if(image->loadCooked(cacheFileName, fileName) && image->isPremultiplied() == premultiply) {
+			return image;
+		}
+	}
+	
+	delete image;
+	image = new Image(fileName);
+	if(!image->isLoaded()) {
+		return image;
+	}
+	if(premultiply) {
+		image->premultiplyAlpha();
+	}
+	
+	if(cacheFileName != "") {
+		if(createMipmaps) {
+			image->generateMipmaps();
+		}
+		// written under a per thread name and moved in place, so that readers never see partial files
+		String tempFileName = cacheFileName + "." + String::IntToString((int)getThreadID()) + ".tmp";
+		if(image->saveCooked(tempFileName, fileName)) {
+#ifdef _WINDOWS
+			OSBasics::removeItem(cacheFileName);
+#endif
+			if(rename(tempFileName.c_str(), cacheFileName.c_str()) != 0) {
+				OSBasics::removeItem(tempFileName);
+			}
+		}
+	}
+	return image;
+}
+
 void MaterialManager::reloadProgramsAndTextures() {
 	reloadTextures();
 	reloadPrograms();
@@ -307,15 +382,18 @@ void MaterialManager::addShader(Shader *shader) {
 }
 
 std::vector<Shader*> MaterialManager::loadShadersFromFile(String fileName) {
-	std::vector<Shader*> retVector;
-	
 	TiXmlDocument doc(fileName.c_str());
 	doc.LoadFile();
+	return shadersFromXMLDocument(&doc);
+}
+
+std::vector<Shader*> MaterialManager::shadersFromXMLDocument(TiXmlDocument *doc) {
+	std::vector<Shader*> retVector;
 	
-	if(doc.Error()) {
-		Logger::log("XML Error: %s\n", doc.ErrorDesc());
+	if(doc->Error()) {
+		Logger::log("XML Error: %s\n", doc->ErrorDesc());
 	} else {
-		TiXmlElement *mElem = doc.RootElement()->FirstChildElement("shaders");
+		TiXmlElement *mElem = doc->RootElement()->FirstChildElement("shaders");
 		if(mElem) {
 			TiXmlNode* pChild;					
 			for (pChild = mElem->FirstChild(); pChild != 0; pChild = pChild->NextSibling()) {	
@@ -332,15 +410,18 @@ std::vector<Shader*> MaterialManager::loadShadersFromFile(String fileName) {
 }
 
 std::vector<Cubemap*> MaterialManager::loadCubemapsFromFile(String fileName) {
-	std::vector<Cubemap*> retVector;
-	
 	TiXmlDocument doc(fileName.c_str());
 	doc.LoadFile();
+	return cubemapsFromXMLDocument(&doc);
+}
+
+std::vector<Cubemap*> MaterialManager::cubemapsFromXMLDocument(TiXmlDocument *doc) {
+	std::vector<Cubemap*> retVector;
 	
-	if(doc.Error()) {
-		Logger::log("XML Error: %s\n", doc.ErrorDesc());
+	if(doc->Error()) {
+		Logger::log("XML Error: %s\n", doc->ErrorDesc());
 	} else {
-		TiXmlElement *mElem = doc.RootElement()->FirstChildElement("cubemaps");
+		TiXmlElement *mElem = doc->RootElement()->FirstChildElement("cubemaps");
 		if(mElem) {
 			TiXmlNode* pChild;					
 			for (pChild = mElem->FirstChild(); pChild != 0; pChild = pChild->NextSibling()) {
@@ -356,15 +437,18 @@ std::vector<Cubemap*> MaterialManager::loadCubemapsFromFile(String fileName) {
 }
 
 std::vector<Material*> MaterialManager::loadMaterialsFromFile(String fileName) {
-	std::vector<Material*> retVector;
-	
 	TiXmlDocument doc(fileName.c_str());
 	doc.LoadFile();
+	return materialsFromXMLDocument(&doc);
+}
+
+std::vector<Material*> MaterialManager::materialsFromXMLDocument(TiXmlDocument *doc) {
+	std::vector<Material*> retVector;
 	
-	if(doc.Error()) {
-		Logger::log("XML Error: %s\n", doc.ErrorDesc());
+	if(doc->Error()) {
+		Logger::log("XML Error: %s\n", doc->ErrorDesc());
 	} else {
-		TiXmlElement *mElem = doc.RootElement()->FirstChildElement("materials");
+		TiXmlElement *mElem = doc->RootElement()->FirstChildElement("materials");
 		if(mElem) {
 			TiXmlNode* pChild;					
 			for (pChild = mElem->FirstChild(); pChild != 0; pChild = pChild->NextSibling()) {
@@ -521,7 +605,7 @@ Material *MaterialManager::materialFromXMLNode(TiXmlNode *node) {
 										{
 											std::vector<String> values = pvalue.split(" ");
 											if(values.size() == 4) {
-												param->setColor(Color(atof(values[0].c_str()), atof(values[1].c_str()), atof(values[2].c_str()), atof(values[3].c_str())));
+												param->setColor(Color((Number)atof(values[0].c_str()), (Number)atof(values[1].c_str()), (Number)atof(values[2].c_str()), (Number)atof(values[3].c_str())));
 											} else {
 												printf("Material parameter error: A Vector3 must have 3 values (%d provided)!\n", (int)values.size());
 											}
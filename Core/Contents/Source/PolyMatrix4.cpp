@@ -36,8 +36,85 @@ Matrix4::Matrix4(const Number *m) {
 	memcpy(ml, m, sizeof(Number)*16);
 }
 
+#if defined(POLYCODE_MATH_SSE)
+
+// Lane selection helpers for the block inverse below, lanes listed from 0 to 3.
+#define SSE_SWIZZLE(v, x, y, z, w) _mm_shuffle_ps(v, v, _MM_SHUFFLE(w, z, y, x))
+#define SSE_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+
+// Each __m128 holds a row major 2x2 matrix. A# is the adjugate of A.
+
+// A * B
+static inline __m128 mat2Mul(__m128 a, __m128 b) {
+	return _mm_add_ps(_mm_mul_ps(a, SSE_SWIZZLE(b, 0,3,0,3)), _mm_mul_ps(SSE_SWIZZLE(a, 1,0,3,2), SSE_SWIZZLE(b, 2,1,2,1)));
+}
+
+// A# * B
+static inline __m128 mat2AdjMul(__m128 a, __m128 b) {
+	return _mm_sub_ps(_mm_mul_ps(SSE_SWIZZLE(a, 3,3,0,0), b), _mm_mul_ps(SSE_SWIZZLE(a, 1,1,2,2), SSE_SWIZZLE(b, 2,3,0,1)));
+}
+
+// A * B#
+static inline __m128 mat2MulAdj(__m128 a, __m128 b) {
+	return _mm_sub_ps(_mm_mul_ps(a, SSE_SWIZZLE(b, 3,0,3,0)), _mm_mul_ps(SSE_SWIZZLE(a, 1,0,3,2), SSE_SWIZZLE(b, 2,1,2,1)));
+}
+
+#endif
+
 Matrix4 Matrix4::Inverse() const
 {
+#if defined(POLYCODE_MATH_SSE)
+	// Inverts the matrix as 2x2 blocks | A B |
+	//                                  | C D |
+	__m128 row0 = _mm_loadu_ps(ml);
+	__m128 row1 = _mm_loadu_ps(ml+4);
+	__m128 row2 = _mm_loadu_ps(ml+8);
+	__m128 row3 = _mm_loadu_ps(ml+12);
+	
+	__m128 A = _mm_movelh_ps(row0, row1);
+	__m128 B = _mm_movehl_ps(row1, row0);
+	__m128 C = _mm_movelh_ps(row2, row3);
+	__m128 D = _mm_movehl_ps(row3, row2);
+	
+	// determinants of the blocks as (|A|, |B|, |C|, |D|)
+	__m128 detSub = _mm_sub_ps(
+		_mm_mul_ps(SSE_SHUFFLE(row0, row2, 0,2,0,2), SSE_SHUFFLE(row1, row3, 1,3,1,3)),
+		_mm_mul_ps(SSE_SHUFFLE(row0, row2, 1,3,1,3), SSE_SHUFFLE(row1, row3, 0,2,0,2)));
+	__m128 detA = SSE_SWIZZLE(detSub, 0,0,0,0);
+	__m128 detB = SSE_SWIZZLE(detSub, 1,1,1,1);
+	__m128 detC = SSE_SWIZZLE(detSub, 2,2,2,2);
+	__m128 detD = SSE_SWIZZLE(detSub, 3,3,3,3);
+	
+	__m128 D_C = mat2AdjMul(D, C);
+	__m128 A_B = mat2AdjMul(A, B);
+	
+	// adjugates of the inverse blocks X, Y, Z and W
+	__m128 X_ = _mm_sub_ps(_mm_mul_ps(detD, A), mat2Mul(B, D_C));
+	__m128 W_ = _mm_sub_ps(_mm_mul_ps(detA, D), mat2Mul(C, A_B));
+	__m128 Y_ = _mm_sub_ps(_mm_mul_ps(detB, C), mat2MulAdj(D, A_B));
+	__m128 Z_ = _mm_sub_ps(_mm_mul_ps(detC, B), mat2MulAdj(A, D_C));
+	
+	// |M| = |A|*|D| + |B|*|C| - tr((A#B)(D#C))
+	__m128 detM = _mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC));
+	__m128 tr = _mm_mul_ps(A_B, SSE_SWIZZLE(D_C, 0,2,1,3));
+	tr = _mm_add_ps(tr, SSE_SWIZZLE(tr, 2,3,0,1));
+	tr = _mm_add_ps(tr, SSE_SWIZZLE(tr, 1,0,3,2));
+	detM = _mm_sub_ps(detM, tr);
+	
+	__m128 rDetM = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), detM);
+	X_ = _mm_mul_ps(X_, rDetM);
+	Y_ = _mm_mul_ps(Y_, rDetM);
+	Z_ = _mm_mul_ps(Z_, rDetM);
+	W_ = _mm_mul_ps(W_, rDetM);
+	
+	// the adjugate shuffle is combined with putting the blocks back into rows
+	Matrix4 r;
+	_mm_storeu_ps(r.ml, SSE_SHUFFLE(X_, Y_, 3,1,3,1));
+	_mm_storeu_ps(r.ml+4, SSE_SHUFFLE(X_, Y_, 2,0,2,0));
+	_mm_storeu_ps(r.ml+8, SSE_SHUFFLE(Z_, W_, 3,1,3,1));
+	_mm_storeu_ps(r.ml+12, SSE_SHUFFLE(Z_, W_, 2,0,2,0));
+	return r;
+#else
 	Number m00 = m[0][0], m01 = m[0][1], m02 = m[0][2], m03 = m[0][3];
 	Number m10 = m[1][0], m11 = m[1][1], m12 = m[1][2], m13 = m[1][3];
 	Number m20 = m[2][0], m21 = m[2][1], m22 = m[2][2], m23 = m[2][3];
@@ -96,6 +173,7 @@ Matrix4 Matrix4::Inverse() const
 		d10, d11, d12, d13,
 		d20, d21, d22, d23,
 		d30, d31, d32, d33);
+#endif
 }
 
 Matrix4 Matrix4::inverseAffine(void) const
@@ -260,3 +338,113 @@ Number Matrix4::generalDeterminant(Number const* const*a,int n)
     }
     return(det) ;
 }
+
+void Matrix4::transformPoints(const Matrix4 &matrix, const Vector3 *points, Vector3 *out, unsigned int count) {
+	for(unsigned int i=0; i < count; i++) {
+		out[i] = matrix * points[i];
+	}
+}
+
+void Matrix4::transformPositions(const Matrix4 &matrix, const float *positions, float *out, unsigned int count) {
+#if defined(POLYCODE_SIMD_SSE) || defined(POLYCODE_SIMD_NEON)
+	float rows[16];
+	for(int i=0; i < 16; i++) {
+		rows[i] = matrix.ml[i];
+	}
+#endif
+
+#if defined(POLYCODE_SIMD_SSE)
+	__m128 row0 = _mm_loadu_ps(rows);
+	__m128 row1 = _mm_loadu_ps(rows+4);
+	__m128 row2 = _mm_loadu_ps(rows+8);
+	__m128 row3 = _mm_loadu_ps(rows+12);
+	for(unsigned int i=0; i < count; i++) {
+		__m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(positions[0]), row0), _mm_mul_ps(_mm_set1_ps(positions[1]), row1));
+		r = _mm_add_ps(r, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(positions[2]), row2), row3));
+		_mm_storel_pi((__m64*)out, r);
+		_mm_store_ss(out+2, _mm_movehl_ps(r, r));
+		positions += 3;
+		out += 3;
+	}
+#elif defined(POLYCODE_SIMD_NEON)
+	float32x4_t row0 = vld1q_f32(rows);
+	float32x4_t row1 = vld1q_f32(rows+4);
+	float32x4_t row2 = vld1q_f32(rows+8);
+	float32x4_t row3 = vld1q_f32(rows+12);
+	for(unsigned int i=0; i < count; i++) {
+		float32x4_t r = vmlaq_n_f32(row3, row0, positions[0]);
+		r = vmlaq_n_f32(r, row1, positions[1]);
+		r = vmlaq_n_f32(r, row2, positions[2]);
+		vst1_f32(out, vget_low_f32(r));
+		vst1q_lane_f32(out+2, r, 2);
+		positions += 3;
+		out += 3;
+	}
+#else
+	const Number (*m)[4] = matrix.m;
+	for(unsigned int i=0; i < count; i++) {
+		Number x = positions[0];
+		Number y = positions[1];
+		Number z = positions[2];
+		out[0] = x*m[0][0] + y*m[1][0] + z*m[2][0] + m[3][0];
+		out[1] = x*m[0][1] + y*m[1][1] + z*m[2][1] + m[3][1];
+		out[2] = x*m[0][2] + y*m[1][2] + z*m[2][2] + m[3][2];
+		positions += 3;
+		out += 3;
+	}
+#endif
+}
+
+void Matrix4::transformDirections(const Matrix4 &matrix, const float *directions, float *out, unsigned int count) {
+#if defined(POLYCODE_SIMD_SSE) || defined(POLYCODE_SIMD_NEON)
+	float rows[12];
+	for(int i=0; i < 12; i++) {
+		rows[i] = matrix.ml[i];
+	}
+#endif
+
+#if defined(POLYCODE_SIMD_SSE)
+	__m128 row0 = _mm_loadu_ps(rows);
+	__m128 row1 = _mm_loadu_ps(rows+4);
+	__m128 row2 = _mm_loadu_ps(rows+8);
+	for(unsigned int i=0; i < count; i++) {
+		__m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(directions[0]), row0), _mm_mul_ps(_mm_set1_ps(directions[1]), row1));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(directions[2]), row2));
+		_mm_storel_pi((__m64*)out, r);
+		_mm_store_ss(out+2, _mm_movehl_ps(r, r));
+		directions += 3;
+		out += 3;
+	}
+#elif defined(POLYCODE_SIMD_NEON)
+	float32x4_t row0 = vld1q_f32(rows);
+	float32x4_t row1 = vld1q_f32(rows+4);
+	float32x4_t row2 = vld1q_f32(rows+8);
+	for(unsigned int i=0; i < count; i++) {
+		float32x4_t r = vmulq_n_f32(row0, directions[0]);
+		r = vmlaq_n_f32(r, row1, directions[1]);
+		r = vmlaq_n_f32(r, row2, directions[2]);
+		vst1_f32(out, vget_low_f32(r));
+		vst1q_lane_f32(out+2, r, 2);
+		directions += 3;
+		out += 3;
+	}
+#else
+	const Number (*m)[4] = matrix.m;
+	for(unsigned int i=0; i < count; i++) {
+		Number x = directions[0];
+		Number y = directions[1];
+		Number z = directions[2];
+		out[0] = x*m[0][0] + y*m[1][0] + z*m[2][0];
+		out[1] = x*m[0][1] + y*m[1][1] + z*m[2][1];
+		out[2] = x*m[0][2] + y*m[1][2] + z*m[2][2];
+		directions += 3;
+		out += 3;
+	}
+#endif
+}
+
+void Matrix4::multiplyMatrices(const Matrix4 *a, const Matrix4 *b, Matrix4 *out, unsigned int count) {
+	for(unsigned int i=0; i < count; i++) {
+		out[i] = a[i] * b[i];
+	}
+}
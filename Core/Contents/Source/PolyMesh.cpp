@@ -23,6 +23,13 @@
 #include "PolyMesh.h"
 #include "PolyLogger.h"
 #include "OSBasics.h"
+#include <string.h>
+#include <limits.h>
+
+#if !defined(_WINDOWS)
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
 
 using std::min;
 using std::max;
@@ -30,6 +37,329 @@ using std::vector;
 
 namespace Polycode {
 
+	// Flat vertex record used to weld identical vertices into indexed storage.
+	// All members are 4 bytes wide, so the struct has no padding and can be hashed and compared bytewise.
+	struct IndexedVertexRecord {
+		float position[3];
+		float normal[3];
+		float color[4];
+		float texCoord[2];
+		unsigned int boneIndices[Mesh::MAX_BONE_WEIGHTS];
+		float boneWeights[Mesh::MAX_BONE_WEIGHTS];
+	};
+
+	static void appendIndexedVertex(Mesh *mesh, const IndexedVertexRecord &record, bool withBones) {
+		mesh->vertexPositionArray.insert(mesh->vertexPositionArray.end(), record.position, record.position+3);
+		mesh->vertexNormalArray.insert(mesh->vertexNormalArray.end(), record.normal, record.normal+3);
+		mesh->vertexColorArray.insert(mesh->vertexColorArray.end(), record.color, record.color+4);
+		mesh->vertexTexCoordArray.insert(mesh->vertexTexCoordArray.end(), record.texCoord, record.texCoord+2);
+		for(int i=0; i < 3; i++) {
+			mesh->vertexTangentArray.push_back(0.0f);
+		}
+		if(withBones) {
+			mesh->vertexBoneIndexArray.insert(mesh->vertexBoneIndexArray.end(), record.boneIndices, record.boneIndices+Mesh::MAX_BONE_WEIGHTS);
+			mesh->vertexBoneWeightArray.insert(mesh->vertexBoneWeightArray.end(), record.boneWeights, record.boneWeights+Mesh::MAX_BONE_WEIGHTS);
+		}
+		if(!mesh->vertexRestPositionArray.empty()) {
+			mesh->vertexRestPositionArray.insert(mesh->vertexRestPositionArray.end(), record.position, record.position+3);
+			mesh->vertexRestNormalArray.insert(mesh->vertexRestNormalArray.end(), record.normal, record.normal+3);
+		}
+	}
+
+	// Keeps the strongest MAX_BONE_WEIGHTS assignments and renormalizes them.
+	static void packBoneWeights(const vector<unsigned int> &boneIDs, const vector<float> &weights, IndexedVertexRecord &record) {
+		vector<bool> used(weights.size(), false);
+		float totalWeight = 0;
+		for(int b=0; b < Mesh::MAX_BONE_WEIGHTS; b++) {
+			int best = -1;
+			for(int i=0; i < weights.size(); i++) {
+				if(!used[i] && weights[i] > 0 && (best == -1 || weights[i] > weights[best])) {
+					best = i;
+				}
+			}
+			if(best == -1) {
+				record.boneIndices[b] = 0;
+				record.boneWeights[b] = 0;
+			} else {
+				used[best] = true;
+				record.boneIndices[b] = boneIDs[best];
+				record.boneWeights[b] = weights[best];
+				totalWeight += weights[best];
+			}
+		}
+		if(totalWeight > 0) {
+			for(int b=0; b < Mesh::MAX_BONE_WEIGHTS; b++) {
+				record.boneWeights[b] = record.boneWeights[b] / totalWeight;
+			}
+		}
+	}
+
+	static const unsigned int NO_WELD_ENTRY = 0xFFFFFFFF;
+
+	// Hash table that appends unique vertex records to a mesh and returns the index of an
+	// identical, previously added record instead of adding a duplicate.
+	class IndexedVertexWelder {
+		public:
+			IndexedVertexWelder(Mesh *mesh, unsigned int maxVertices, bool withBones) : mesh(mesh), withBones(withBones) {
+				unsigned int tableSize = 16;
+				while(tableSize < maxVertices * 2) {
+					tableSize *= 2;
+				}
+				buckets.resize(tableSize, NO_WELD_ENTRY);
+				baseIndex = mesh->vertexPositionArray.size() / 3;
+			}
+
+			unsigned int addVertex(const IndexedVertexRecord &record) {
+				unsigned int bucket = hashRecord(record) & (buckets.size() - 1);
+				for(unsigned int entry = buckets[bucket]; entry != NO_WELD_ENTRY; entry = next[entry]) {
+					if(memcmp(&records[entry], &record, sizeof(IndexedVertexRecord)) == 0) {
+						return baseIndex + entry;
+					}
+				}
+				unsigned int entry = records.size();
+				records.push_back(record);
+				next.push_back(buckets[bucket]);
+				buckets[bucket] = entry;
+				appendIndexedVertex(mesh, record, withBones);
+				return baseIndex + entry;
+			}
+
+		protected:
+
+			static unsigned int hashRecord(const IndexedVertexRecord &record) {
+				const unsigned char *bytes = (const unsigned char*)&record;
+				unsigned int hash = 2166136261u;
+				for(int i=0; i < sizeof(IndexedVertexRecord); i++) {
+					hash = (hash ^ bytes[i]) * 16777619u;
+				}
+				return hash;
+			}
+
+			Mesh *mesh;
+			bool withBones;
+			unsigned int baseIndex;
+			vector<unsigned int> buckets;
+			vector<unsigned int> next;
+			vector<IndexedVertexRecord> records;
+	};
+
+	static void recordFromVertex(Vertex *vertex, Polygon *polygon, IndexedVertexRecord &record) {
+		Vector3 normal = vertex->normal;
+		if(!polygon->useVertexNormals) {
+			normal = polygon->getFaceNormal();
+		}
+		record.position[0] = vertex->x;
+		record.position[1] = vertex->y;
+		record.position[2] = vertex->z;
+		record.normal[0] = normal.x;
+		record.normal[1] = normal.y;
+		record.normal[2] = normal.z;
+		record.color[0] = vertex->vertexColor.r;
+		record.color[1] = vertex->vertexColor.g;
+		record.color[2] = vertex->vertexColor.b;
+		record.color[3] = vertex->vertexColor.a;
+		record.texCoord[0] = vertex->texCoord.x;
+		record.texCoord[1] = vertex->texCoord.y;
+
+		vector<unsigned int> boneIDs;
+		vector<float> weights;
+		for(int b=0; b < vertex->getNumBoneAssignments(); b++) {
+			boneIDs.push_back(vertex->getBoneAssignment(b)->boneID);
+			weights.push_back(vertex->getBoneAssignment(b)->weight);
+		}
+		packBoneWeights(boneIDs, weights, record);
+	}
+
+	// Face corners (the vertices of each face, in draw order) with per-face vectors, grouped by
+	// welded position. Coincident positions are found with a spatial hash, so building the
+	// groups is linear in the number of corners.
+	class MeshFaceCorners {
+		public:
+			void build(Number weldDistance) {
+				unsigned int faceCount = faceStart.size() - 1;
+				cornerFace.resize(positions.size());
+				faceAreaNormals.resize(faceCount);
+				faceNormals.resize(faceCount);
+				faceTangents.resize(faceCount);
+				
+				for(int f=0; f < faceCount; f++) {
+					unsigned int first = faceStart[f];
+					unsigned int count = faceStart[f+1] - first;
+					for(int c=first; c < first+count; c++) {
+						cornerFace[c] = f;
+					}
+					if(count < 3)
+						continue;
+					
+					// Newell's method, the length of the result is twice the face area
+					Vector3 areaNormal;
+					for(int c=0; c < count; c++) {
+						const Vector3 &p0 = positions[first+c];
+						const Vector3 &p1 = positions[first+((c+1) % count)];
+						areaNormal.x += (p0.y - p1.y) * (p0.z + p1.z);
+						areaNormal.y += (p0.z - p1.z) * (p0.x + p1.x);
+						areaNormal.z += (p0.x - p1.x) * (p0.y + p1.y);
+					}
+					faceAreaNormals[f] = areaNormal;
+					faceNormals[f] = areaNormal;
+					faceNormals[f].Normalize();
+					
+					const Vector3 &p0 = positions[first];
+					const Vector3 &p1 = positions[first+1];
+					const Vector3 &p2 = positions[first+2];
+					const Vector2 &t0 = texCoords[first];
+					const Vector2 &t1 = texCoords[first+1];
+					const Vector2 &t2 = texCoords[first+2];
+					Vector3 side0 = p0 - p1;
+					Vector3 side1 = p2 - p0;
+					Vector3 tangent = side0 * (t2.y - t0.y) - side1 * (t0.y - t1.y);
+					tangent.Normalize();
+					Vector3 binormal = side0 * (t2.x - t0.x) - side1 * (t0.x - t1.x);
+					binormal.Normalize();
+					if(tangent.crossProduct(binormal).dot(side1.crossProduct(side0)) < 0.0f) {
+						tangent = tangent * -1;
+					}
+					faceTangents[f] = tangent;
+				}
+				
+				weldPositions(weldDistance);
+			}
+			
+			vector<Vector3> positions;
+			vector<Vector2> texCoords;
+			vector<unsigned int> faceStart;
+			vector<unsigned int> cornerFace;
+			vector<Vector3> faceAreaNormals;
+			vector<Vector3> faceNormals;
+			vector<Vector3> faceTangents;
+			
+			vector<unsigned int> cornerGroup;
+			vector<unsigned int> groupStart;
+			vector<unsigned int> groupCorners;
+			
+		protected:
+		
+			static unsigned int hashCell(long long x, long long y, long long z) {
+				return (unsigned int)((x * 73856093) ^ (y * 19349663) ^ (z * 83492791));
+			}
+			
+			void weldPositions(Number weldDistance) {
+				unsigned int tableSize = 16;
+				while(tableSize < positions.size() * 2) {
+					tableSize *= 2;
+				}
+				vector<unsigned int> buckets(tableSize, NO_WELD_ENTRY);
+				vector<unsigned int> next;
+				vector<Vector3> groupPositions;
+				Number invCellSize = 1.0 / weldDistance;
+				
+				cornerGroup.resize(positions.size());
+				for(int c=0; c < positions.size(); c++) {
+					const Vector3 &p = positions[c];
+					long long cx = (long long)floor(p.x * invCellSize);
+					long long cy = (long long)floor(p.y * invCellSize);
+					long long cz = (long long)floor(p.z * invCellSize);
+					
+					unsigned int group = NO_WELD_ENTRY;
+					for(int dx=-1; dx <= 1 && group == NO_WELD_ENTRY; dx++) {
+						for(int dy=-1; dy <= 1 && group == NO_WELD_ENTRY; dy++) {
+							for(int dz=-1; dz <= 1 && group == NO_WELD_ENTRY; dz++) {
+								unsigned int bucket = hashCell(cx+dx, cy+dy, cz+dz) & (tableSize-1);
+								for(unsigned int g = buckets[bucket]; g != NO_WELD_ENTRY; g = next[g]) {
+									Vector3 diff = groupPositions[g] - p;
+									if(fabs(diff.x) <= weldDistance && fabs(diff.y) <= weldDistance && fabs(diff.z) <= weldDistance) {
+										group = g;
+										break;
+									}
+								}
+							}
+						}
+					}
+					
+					if(group == NO_WELD_ENTRY) {
+						group = groupPositions.size();
+						groupPositions.push_back(p);
+						unsigned int bucket = hashCell(cx, cy, cz) & (tableSize-1);
+						next.push_back(buckets[bucket]);
+						buckets[bucket] = group;
+					}
+					cornerGroup[c] = group;
+				}
+				
+				groupStart.assign(groupPositions.size()+1, 0);
+				for(int c=0; c < cornerGroup.size(); c++) {
+					groupStart[cornerGroup[c]+1]++;
+				}
+				for(int g=0; g < groupPositions.size(); g++) {
+					groupStart[g+1] += groupStart[g];
+				}
+				vector<unsigned int> cursor(groupStart.begin(), groupStart.end()-1);
+				groupCorners.resize(cornerGroup.size());
+				for(int c=0; c < cornerGroup.size(); c++) {
+					groupCorners[cursor[cornerGroup[c]]++] = c;
+				}
+			}
+	};
+	
+	// Sums the face vectors of the corners in each welded group, split into clusters of faces whose
+	// normals are within the smoothing angle of the first face of the cluster (and, for tangents,
+	// whose texture coordinates match). Each corner is only compared against the clusters of its
+	// group, and a fixed smoothing angle leaves room for a bounded number of them, so this is linear
+	// in the number of corners.
+	static void smoothCornerVectors(const MeshFaceCorners &corners, const vector<Vector3> &faceVectors, Number cosAngle, bool matchTexCoords, vector<Vector3> &cornerVectors) {
+		cornerVectors.assign(corners.positions.size(), Vector3());
+		unsigned int groupCount = corners.groupStart.size() - 1;
+		
+		vector<unsigned int> cornerCluster(corners.groupCorners.size());
+		vector<unsigned int> clusterCorners;
+		vector<Vector3> clusterSums;
+		
+		for(int g=0; g < groupCount; g++) {
+			unsigned int first = corners.groupStart[g];
+			unsigned int last = corners.groupStart[g+1];
+			
+			if(cosAngle <= -1.0 && !matchTexCoords) {
+				Vector3 sum;
+				for(int i=first; i < last; i++) {
+					sum += faceVectors[corners.cornerFace[corners.groupCorners[i]]];
+				}
+				for(int i=first; i < last; i++) {
+					cornerVectors[corners.groupCorners[i]] = sum;
+				}
+				continue;
+			}
+			
+			clusterCorners.clear();
+			clusterSums.clear();
+			for(int i=first; i < last; i++) {
+				unsigned int corner = corners.groupCorners[i];
+				unsigned int face = corners.cornerFace[corner];
+				const Vector3 &faceNormal = corners.faceNormals[face];
+				
+				unsigned int cluster = clusterCorners.size();
+				for(int k=0; k < clusterCorners.size(); k++) {
+					unsigned int other = clusterCorners[k];
+					if(faceNormal.dot(corners.faceNormals[corners.cornerFace[other]]) < cosAngle - 0.0001)
+						continue;
+					if(matchTexCoords && (corners.texCoords[corner].x != corners.texCoords[other].x || corners.texCoords[corner].y != corners.texCoords[other].y))
+						continue;
+					cluster = k;
+					break;
+				}
+				if(cluster == clusterCorners.size()) {
+					clusterCorners.push_back(corner);
+					clusterSums.push_back(Vector3());
+				}
+				clusterSums[cluster] += faceVectors[face];
+				cornerCluster[i] = cluster;
+			}
+			
+			for(int i=first; i < last; i++) {
+				cornerVectors[corners.groupCorners[i]] = clusterSums[cornerCluster[i]];
+			}
+		}
+	}
+
 	Mesh::Mesh(const String& fileName) {
 		
 		for(int i=0; i < 16; i++) {
@@ -40,6 +370,11 @@ namespace Polycode {
 		
 		meshType = TRI_MESH;
 		meshHasVertexBuffer = false;
+		indexedMesh = false;
+		polygonViewDirty = false;
+		smoothNormals = true;
+		normalSmoothAngle = 90.0;
+		boundsVertexCount = NO_CACHED_BOUNDS;
 		loadMesh(fileName);
 		vertexBuffer = NULL;			
 		useVertexColors = false;
@@ -52,6 +387,11 @@ namespace Polycode {
 		}		
 		this->meshType = meshType;
 		meshHasVertexBuffer = false;		
+		indexedMesh = false;
+		polygonViewDirty = false;
+		smoothNormals = true;
+		normalSmoothAngle = 90.0;
+		boundsVertexCount = NO_CACHED_BOUNDS;
 		vertexBuffer = NULL;
 		useVertexColors = false;				
 	}
@@ -64,11 +404,30 @@ namespace Polycode {
 		clearMesh();
 	}
 	
-	void Mesh::clearMesh() {
+	void Mesh::clearPolygons() {
 		for(int i=0; i < polygons.size(); i++) {	
 			delete polygons[i];
 		}
 		polygons.clear();
+	}
+	
+	void Mesh::clearMesh() {
+		clearPolygons();
+		
+		vertexPositionArray.clear();
+		vertexNormalArray.clear();
+		vertexTangentArray.clear();
+		vertexColorArray.clear();
+		vertexTexCoordArray.clear();
+		vertexRestPositionArray.clear();
+		vertexRestNormalArray.clear();
+		vertexBoneIndexArray.clear();
+		vertexBoneWeightArray.clear();
+		indexArray.clear();
+		indexedMesh = false;
+		polygonViewDirty = false;
+		boundsVertexCount = NO_CACHED_BOUNDS;
+		
 		if(vertexBuffer)
 			delete vertexBuffer;
 		vertexBuffer = NULL;
@@ -90,13 +449,26 @@ namespace Polycode {
 	}
 
 	void Mesh::setVertexBuffer(VertexBuffer *buffer) {
+		if(vertexBuffer && vertexBuffer != buffer)
+			delete vertexBuffer;
 		vertexBuffer = buffer;
 		meshHasVertexBuffer = true;
 	}
 	
 	Number Mesh::getRadius() {
+		if(hasCachedBounds()) {
+			return cachedRadius;
+		}
 		Number hRad = 0;
 		Number len;
+		if(indexedMesh) {
+			for(int i=0; i < vertexPositionArray.size(); i += 3) {
+				len = Vector3(vertexPositionArray[i], vertexPositionArray[i+1], vertexPositionArray[i+2]).length();
+				if(len > hRad)
+					hRad = len;
+			}
+			return hRad;
+		}
 		for(int i=0; i < polygons.size(); i++) {	
 			for(int j=0; j < polygons[i]->getVertexCount(); j++) {
 				len = polygons[i]->getVertex(j)->length();
@@ -107,7 +479,116 @@ namespace Polycode {
 		return hRad;
 	}
 	
-	void Mesh::saveToFile(OSFILE *outFile) {				
+	// Header of version 2 mesh files. The header is followed by the vertex streams, each
+	// vertexCount entries long: positions (3 floats), normals (3 floats), tangents (3 floats),
+	// colors (4 floats), texture coordinates (2 floats) and, for skinned meshes, bone ids and
+	// bone weights (MAX_BONE_WEIGHTS unsigned shorts each, weights scaled to 0-65535). The
+	// index array (indexCount unsigned ints) comes last. Every field and stream is a multiple
+	// of 4 bytes long, so a file mapped at a page boundary can be read in place.
+	struct MeshFileHeader {
+		char magic[4];
+		unsigned int version;
+		unsigned int meshType;
+		unsigned int flags;
+		unsigned int vertexCount;
+		unsigned int indexCount;
+		float bboxSize[3];
+		float radius;
+		unsigned int dataSize;
+	};
+	
+	static const char MESH_FILE_MAGIC[4] = {'P', 'M', 'S', 'H'};
+	static const unsigned int MESH_FILE_HAS_BONES = 1;
+	
+	static unsigned int meshFileDataSize(unsigned int vertexCount, unsigned int indexCount, bool withBones) {
+		unsigned int size = vertexCount * (3+3+3+4+2) * sizeof(float);
+		if(withBones) {
+			size += vertexCount * Mesh::MAX_BONE_WEIGHTS * 2 * sizeof(unsigned short);
+		}
+		return size + indexCount * sizeof(unsigned int);
+	}
+	
+	static void writeMeshStream(const vector<float> &stream, OSFILE *outFile) {
+		if(stream.size() > 0)
+			OSBasics::write(&stream[0], sizeof(float), stream.size(), outFile);
+	}
+	
+	bool Mesh::hasCachedBounds() {
+		return boundsVertexCount != NO_CACHED_BOUNDS && indexedMesh && boundsVertexCount == vertexPositionArray.size() / 3;
+	}
+	
+	void Mesh::saveToFile(OSFILE *outFile, int fileFormat) {
+		if(fileFormat == MESH_FORMAT_V1) {
+			saveToFileV1(outFile);
+		} else {
+			saveToFileV2(outFile);
+		}
+	}
+	
+	void Mesh::saveToFileV2(OSFILE *outFile) {
+		convertToIndexedMesh();
+		indexedMesh = true;
+		
+		unsigned int vertexCount = getVertexCount();
+		if(vertexTangentArray.size() != vertexCount * 3) {
+			calculateTangents();
+		}
+		if(vertexNormalArray.size() != vertexCount * 3 || vertexColorArray.size() != vertexCount * 4 || vertexTexCoordArray.size() != vertexCount * 2) {
+			Logger::log("Mesh vertex arrays are inconsistent, not saving\n");
+			return;
+		}
+		bool withBones = vertexCount > 0 && vertexBoneWeightArray.size() == vertexCount * MAX_BONE_WEIGHTS && vertexBoneIndexArray.size() == vertexBoneWeightArray.size();
+		
+		MeshFileHeader header;
+		memcpy(header.magic, MESH_FILE_MAGIC, 4);
+		header.version = 2;
+		header.meshType = meshType;
+		header.flags = withBones ? MESH_FILE_HAS_BONES : 0;
+		header.vertexCount = vertexCount;
+		header.indexCount = indexArray.size();
+		header.dataSize = meshFileDataSize(vertexCount, header.indexCount, withBones);
+		
+		float radius = 0;
+		float bbox[3] = {0, 0, 0};
+		for(int i=0; i < vertexPositionArray.size(); i += 3) {
+			for(int c=0; c < 3; c++) {
+				bbox[c] = max(bbox[c], (float)fabs(vertexPositionArray[i+c]));
+			}
+			radius = max(radius, (float)Vector3(vertexPositionArray[i], vertexPositionArray[i+1], vertexPositionArray[i+2]).length());
+		}
+		for(int c=0; c < 3; c++) {
+			header.bboxSize[c] = bbox[c] * 2;
+		}
+		header.radius = radius;
+		
+		OSBasics::write(&header, sizeof(MeshFileHeader), 1, outFile);
+		writeMeshStream(vertexPositionArray, outFile);
+		writeMeshStream(vertexNormalArray, outFile);
+		writeMeshStream(vertexTangentArray, outFile);
+		writeMeshStream(vertexColorArray, outFile);
+		writeMeshStream(vertexTexCoordArray, outFile);
+		
+		if(withBones) {
+			vector<unsigned short> packed(vertexCount * MAX_BONE_WEIGHTS);
+			for(int i=0; i < packed.size(); i++) {
+				packed[i] = (unsigned short)min(vertexBoneIndexArray[i], (unsigned int)0xFFFF);
+			}
+			OSBasics::write(&packed[0], sizeof(unsigned short), packed.size(), outFile);
+			for(int i=0; i < packed.size(); i++) {
+				float weight = max(0.0f, min(1.0f, vertexBoneWeightArray[i]));
+				packed[i] = (unsigned short)(weight * 65535.0f + 0.5f);
+			}
+			OSBasics::write(&packed[0], sizeof(unsigned short), packed.size(), outFile);
+		}
+		
+		if(indexArray.size() > 0)
+			OSBasics::write(&indexArray[0], sizeof(unsigned int), indexArray.size(), outFile);
+	}
+	
+	void Mesh::saveToFileV1(OSFILE *outFile) {				
+		if(indexedMesh && polygonViewDirty) {
+			buildPolygonView();
+		}
 		unsigned int numFaces = polygons.size();
 
 		OSBasics::write(&meshType, sizeof(unsigned int), 1, outFile);		
@@ -158,74 +639,235 @@ namespace Polycode {
 
 	
 	void Mesh::loadFromFile(OSFILE *inFile) {
-
 		unsigned int meshType;		
-		OSBasics::read(&meshType, sizeof(unsigned int), 1, inFile);				
-		setMeshType(meshType);
+		if(OSBasics::read(&meshType, sizeof(unsigned int), 1, inFile) != 1) {
+			Logger::log("Error reading mesh file\n");
+			return;
+		}
 		
-		int verticesPerFace;
-		switch(meshType) {
-			case TRI_MESH:
-				verticesPerFace = 3;
-			break;
-			case QUAD_MESH:
-				verticesPerFace = 4;
-			break;
-			default:
-				verticesPerFace = 1;				
-			break;
+		if(memcmp(&meshType, MESH_FILE_MAGIC, 4) != 0) {
+			// version 1 files start with the mesh type
+			loadFromFileV1(meshType, inFile);
+			return;
+		}
+		
+		// version 2, read the rest of the file with a single read
+		vector<unsigned int> data(sizeof(MeshFileHeader) / sizeof(unsigned int));
+		data[0] = meshType;
+		if(OSBasics::read(&data[1], sizeof(MeshFileHeader) - sizeof(unsigned int), 1, inFile) != 1) {
+			Logger::log("Error reading mesh file header\n");
+			return;
+		}
+		unsigned int dataSize = ((MeshFileHeader*)&data[0])->dataSize;
+		
+		// the size is read from the file, so check it against the bytes left
+		// in the file before allocating anything
+		long dataStart = OSBasics::tell(inFile);
+		OSBasics::seek(inFile, 0L, SEEK_END);
+		long fileEnd = OSBasics::tell(inFile);
+		OSBasics::seek(inFile, dataStart, SEEK_SET);
+		if(dataStart < 0 || fileEnd < dataStart || dataSize % sizeof(unsigned int) != 0 || dataSize > (unsigned long)(fileEnd - dataStart) ||
+			dataSize > UINT_MAX - sizeof(MeshFileHeader)) {
+			Logger::log("Mesh file data is corrupt\n");
+			return;
+		}
+		size_t totalSize = sizeof(MeshFileHeader) + (size_t)dataSize;
+		
+		data.resize(totalSize / sizeof(unsigned int));
+		if(dataSize > 0 && OSBasics::read(&data[sizeof(MeshFileHeader) / sizeof(unsigned int)], dataSize, 1, inFile) != 1) {
+			Logger::log("Error reading mesh file data\n");
+			return;
+		}
+		loadFromMemory((const char*)&data[0], totalSize);
+	}
+	
+	bool Mesh::loadFromMemory(const char *data, unsigned int size) {
+		MeshFileHeader header;
+		if(size < sizeof(MeshFileHeader)) {
+			Logger::log("Mesh data is too short\n");
+			return false;
+		}
+		memcpy(&header, data, sizeof(MeshFileHeader));
+		if(memcmp(header.magic, MESH_FILE_MAGIC, 4) != 0 || header.version != 2) {
+			Logger::log("Unsupported mesh data\n");
+			return false;
+		}
+		
+		bool withBones = (header.flags & MESH_FILE_HAS_BONES) != 0;
+		unsigned int vertexCount = header.vertexCount;
+		// bound the counts by the data size first, so the size computation cannot wrap around
+		unsigned int payloadSize = size - sizeof(MeshFileHeader);
+		unsigned int vertexSize = meshFileDataSize(1, 0, withBones);
+		if(vertexCount > payloadSize / vertexSize || header.indexCount > (payloadSize - (vertexCount * vertexSize)) / sizeof(unsigned int) ||
+			header.dataSize != meshFileDataSize(vertexCount, header.indexCount, withBones)) {
+			Logger::log("Mesh data is corrupt\n");
+			return false;
+		}
+		
+		const unsigned int *indices = (const unsigned int*)(data + sizeof(MeshFileHeader) + header.dataSize - (header.indexCount * sizeof(unsigned int)));
+		for(int i=0; i < header.indexCount; i++) {
+			if(indices[i] >= vertexCount) {
+				Logger::log("Mesh data has an index out of range\n");
+				return false;
+			}
 		}
 		
+		setMeshType(header.meshType);
+		if(!indexedMesh && polygons.size() > 0) {
+			convertToIndexedMesh();
+		}
+		indexedMesh = true;
+		
+		unsigned int baseIndex = vertexPositionArray.size() / 3;
+		bool hadBones = !vertexBoneWeightArray.empty();
+		
+		// the streams are laid out like the indexed arrays, so each one is a single copy
+		const float *stream = (const float*)(data + sizeof(MeshFileHeader));
+		vertexPositionArray.insert(vertexPositionArray.end(), stream, stream + vertexCount * 3);
+		stream += vertexCount * 3;
+		vertexNormalArray.insert(vertexNormalArray.end(), stream, stream + vertexCount * 3);
+		stream += vertexCount * 3;
+		vertexTangentArray.insert(vertexTangentArray.end(), stream, stream + vertexCount * 3);
+		stream += vertexCount * 3;
+		vertexColorArray.insert(vertexColorArray.end(), stream, stream + vertexCount * 4);
+		stream += vertexCount * 4;
+		vertexTexCoordArray.insert(vertexTexCoordArray.end(), stream, stream + vertexCount * 2);
+		stream += vertexCount * 2;
+		
+		if(withBones) {
+			vertexBoneIndexArray.resize(baseIndex * MAX_BONE_WEIGHTS, 0);
+			vertexBoneWeightArray.resize(baseIndex * MAX_BONE_WEIGHTS, 0.0f);
+			const unsigned short *packed = (const unsigned short*)stream;
+			unsigned int packedCount = vertexCount * MAX_BONE_WEIGHTS;
+			vertexBoneIndexArray.insert(vertexBoneIndexArray.end(), packed, packed + packedCount);
+			packed += packedCount;
+			vertexBoneWeightArray.reserve(vertexBoneWeightArray.size() + packedCount);
+			for(int i=0; i < packedCount; i++) {
+				vertexBoneWeightArray.push_back(((float)packed[i]) / 65535.0f);
+			}
+		} else {
+			if(hadBones) {
+				vertexBoneIndexArray.resize((baseIndex + vertexCount) * MAX_BONE_WEIGHTS, 0);
+				vertexBoneWeightArray.resize((baseIndex + vertexCount) * MAX_BONE_WEIGHTS, 0.0f);
+			}
+		}
+		
+		if(baseIndex == 0) {
+			indexArray.insert(indexArray.end(), indices, indices + header.indexCount);
+		} else {
+			indexArray.reserve(indexArray.size() + header.indexCount);
+			for(int i=0; i < header.indexCount; i++) {
+				indexArray.push_back(baseIndex + indices[i]);
+			}
+		}
+		
+		if(!vertexBoneWeightArray.empty()) {
+			vertexRestPositionArray = vertexPositionArray;
+			vertexRestNormalArray = vertexNormalArray;
+		}
+		
+		if(baseIndex == 0) {
+			cachedBBox = Vector3(header.bboxSize[0], header.bboxSize[1], header.bboxSize[2]);
+			cachedRadius = header.radius;
+			boundsVertexCount = vertexCount;
+		} else {
+			boundsVertexCount = NO_CACHED_BOUNDS;
+		}
+		
+		polygonViewDirty = true;
+		for(int i=0; i < 16; i++) {
+			arrayDirtyMap[i] = true;
+		}
+		return true;
+	}
+	
+	void Mesh::loadFromFileV1(unsigned int meshType, OSFILE *inFile) {
+		boundsVertexCount = NO_CACHED_BOUNDS;
+		setMeshType(meshType);
+		
+		unsigned int verticesPerFace = getVerticesPerFace();
+		
 		unsigned int numFaces;		
 		OSBasics::read(&numFaces, sizeof(unsigned int), 1, inFile);
 		
+		if(!indexedMesh && polygons.size() > 0) {
+			convertToIndexedMesh();
+		}
+		indexedMesh = true;
+		
+		unsigned int vertexCount = vertexPositionArray.size() / 3;
+		vertexBoneIndexArray.resize(vertexCount * MAX_BONE_WEIGHTS, 0);
+		vertexBoneWeightArray.resize(vertexCount * MAX_BONE_WEIGHTS, 0.0f);
+		
 		Vector3_struct pos;
 		Vector3_struct nor;
 		Vector4_struct col;			
 		Vector2_struct tex;
 		
+		IndexedVertexRecord record;
+		vector<unsigned int> boneIDs;
+		vector<float> weights;
+		
+		IndexedVertexWelder welder(this, numFaces * verticesPerFace, true);
+		indexArray.reserve(indexArray.size() + (numFaces * verticesPerFace));
+		
 		for(int i=0; i < numFaces; i++) {	
-			Polygon *poly = new Polygon();			
-			
 			for(int j=0; j < verticesPerFace; j++) {
 				OSBasics::read(&pos, sizeof(Vector3_struct), 1, inFile);
 				OSBasics::read(&nor, sizeof(Vector3_struct), 1, inFile);
 				OSBasics::read(&col, sizeof(Vector4_struct), 1, inFile);						
 				OSBasics::read(&tex, sizeof(Vector2_struct), 1, inFile);						
 				
-				Vertex *vertex = new Vertex(pos.x, pos.y, pos.z);
-				vertex->setNormal(nor.x,nor.y, nor.z);
-				vertex->restNormal.set(nor.x,nor.y, nor.z);
-				vertex->vertexColor.setColor(col.x,col.y, col.z, col.w);
-				vertex->setTexCoord(tex.x, tex.y);
+				record.position[0] = pos.x;
+				record.position[1] = pos.y;
+				record.position[2] = pos.z;
+				record.normal[0] = nor.x;
+				record.normal[1] = nor.y;
+				record.normal[2] = nor.z;
+				record.color[0] = col.x;
+				record.color[1] = col.y;
+				record.color[2] = col.z;
+				record.color[3] = col.w;
+				record.texCoord[0] = tex.x;
+				record.texCoord[1] = tex.y;
 				
 				unsigned int numBoneWeights;
 				OSBasics::read(&numBoneWeights, sizeof(unsigned int), 1, inFile);								
+				boneIDs.clear();
+				weights.clear();
 				for(int b=0; b < numBoneWeights; b++) {
 					float weight;
 					unsigned int boneID;
 					OSBasics::read(&boneID, sizeof(unsigned int), 1, inFile);													
 					OSBasics::read(&weight, sizeof(float), 1, inFile);																		
-					vertex->addBoneAssignment(boneID, weight);
+					boneIDs.push_back(boneID);
+					weights.push_back(weight);
 				}
+				packBoneWeights(boneIDs, weights, record);
 				
-				Number totalWeight = 0;				
-				for(int m=0; m < vertex->getNumBoneAssignments(); m++) {
-					BoneAssignment *ba = vertex->getBoneAssignment(m);					
-					totalWeight += ba->weight;
-				}				
-
-				for(int m=0; m < vertex->getNumBoneAssignments(); m++) {
-					BoneAssignment *ba = vertex->getBoneAssignment(m);					
-					ba->weight = ba->weight/totalWeight;
-				}				
-
-				
-				poly->addVertex(vertex);
+				indexArray.push_back(welder.addVertex(record));
+			}
+		}
+		
+		bool hasBoneWeights = false;
+		for(int i=0; i < vertexBoneWeightArray.size(); i++) {
+			if(vertexBoneWeightArray[i] > 0) {
+				hasBoneWeights = true;
+				break;
 			}
-			addPolygon(poly);
 		}
 		
+		if(hasBoneWeights) {
+			vertexRestPositionArray = vertexPositionArray;
+			vertexRestNormalArray = vertexNormalArray;
+		} else {
+			vertexBoneIndexArray.clear();
+			vertexBoneWeightArray.clear();
+			vertexRestPositionArray.clear();
+			vertexRestNormalArray.clear();
+		}
+		
+		polygonViewDirty = true;
 		calculateTangents();
 		
 		arrayDirtyMap[RenderDataArray::VERTEX_DATA_ARRAY] = true;		
@@ -233,14 +875,16 @@ namespace Polycode {
 		arrayDirtyMap[RenderDataArray::TEXCOORD_DATA_ARRAY] = true;
 		arrayDirtyMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;	
 		arrayDirtyMap[RenderDataArray::TANGENT_DATA_ARRAY] = true;								
+		arrayDirtyMap[RenderDataArray::INDEX_DATA_ARRAY] = true;
 	}
 	
-	void Mesh::saveToFile(const String& fileName) {
+	void Mesh::saveToFile(const String& fileName, int fileFormat) {
 		OSFILE *outFile = OSBasics::open(fileName, "wb");
 		if(!outFile) {
 			Logger::log("Error opening mesh file for saving: %s", fileName.c_str());
+			return;
 		}
-		saveToFile(outFile);
+		saveToFile(outFile, fileFormat);
 		OSBasics::close(outFile);	
 	
 	}
@@ -249,14 +893,34 @@ namespace Polycode {
 		OSFILE *inFile = OSBasics::open(fileName, "rb");
 		if(!inFile) {
 			Logger::log("Error opening mesh file %s", fileName.c_str());
+			return;
+		}
+		
+		bool loaded = false;
+#if !defined(_WINDOWS)
+		// version 2 files on disk are mapped and copied straight into the vertex arrays
+		if(inFile->fileType == OSFILE::TYPE_FILE) {
+			int fd = fileno(inFile->file);
+			struct stat fileStat;
+			if(fstat(fd, &fileStat) == 0 && fileStat.st_size >= sizeof(MeshFileHeader)) {
+				void *mapped = mmap(NULL, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if(mapped != MAP_FAILED) {
+					if(memcmp(mapped, MESH_FILE_MAGIC, 4) == 0) {
+						loadFromMemory((const char*)mapped, fileStat.st_size);
+						loaded = true;
+					}
+					munmap(mapped, fileStat.st_size);
+				}
+			}
+		}
+#endif
+		if(!loaded) {
+			loadFromFile(inFile);
 		}
-		loadFromFile(inFile);
 		OSBasics::close(inFile);	
-		arrayDirtyMap[RenderDataArray::VERTEX_DATA_ARRAY] = true;		
-		arrayDirtyMap[RenderDataArray::COLOR_DATA_ARRAY] = true;				
-		arrayDirtyMap[RenderDataArray::TEXCOORD_DATA_ARRAY] = true;						
-		arrayDirtyMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;										
-		arrayDirtyMap[RenderDataArray::TANGENT_DATA_ARRAY] = true;		
+		for(int i=0; i < 16; i++) {
+			arrayDirtyMap[i] = true;
+		}
 	}
 	
 	void Mesh::createVPlane(Number w, Number h) { 
@@ -315,6 +979,31 @@ namespace Polycode {
 		Vector3 positiveOffset;
 		Vector3 negativeOffset;
 		
+		if(indexedMesh) {
+			for(int i=0; i < vertexPositionArray.size(); i += 3) {
+				positiveOffset.x = max(positiveOffset.x, (Number)vertexPositionArray[i]);
+				positiveOffset.y = max(positiveOffset.y, (Number)vertexPositionArray[i+1]);
+				positiveOffset.z = max(positiveOffset.z, (Number)vertexPositionArray[i+2]);
+				negativeOffset.x = min(negativeOffset.x, (Number)vertexPositionArray[i]);
+				negativeOffset.y = min(negativeOffset.y, (Number)vertexPositionArray[i+1]);
+				negativeOffset.z = min(negativeOffset.z, (Number)vertexPositionArray[i+2]);
+			}
+			
+			Vector3 finalOffset = (positiveOffset + negativeOffset) / 2.0f;
+			for(int i=0; i < vertexPositionArray.size(); i += 3) {
+				vertexPositionArray[i] -= finalOffset.x;
+				vertexPositionArray[i+1] -= finalOffset.y;
+				vertexPositionArray[i+2] -= finalOffset.z;
+			}
+			for(int i=0; i < vertexRestPositionArray.size(); i += 3) {
+				vertexRestPositionArray[i] -= finalOffset.x;
+				vertexRestPositionArray[i+1] -= finalOffset.y;
+				vertexRestPositionArray[i+2] -= finalOffset.z;
+			}
+			dirtyArray(RenderDataArray::VERTEX_DATA_ARRAY);
+			return finalOffset;
+		}
+		
 		for(int i=0; i < polygons.size(); i++) {
 			for(int j=0; j < polygons[i]->getVertexCount(); j++) {
 				positiveOffset.x = max(positiveOffset.x,polygons[i]->getVertex(j)->x);
@@ -359,14 +1048,26 @@ namespace Polycode {
 		}		
 	
 		
-		arrayDirtyMap[RenderDataArray::VERTEX_DATA_ARRAY] = true;
+		dirtyArray(RenderDataArray::VERTEX_DATA_ARRAY);
 		
 		return finalOffset;		
 	}	
 	
 	Vector3 Mesh::calculateBBox() {
+		if(hasCachedBounds()) {
+			return cachedBBox;
+		}
 		Vector3 retVec;
 		
+		if(indexedMesh) {
+			for(int i=0; i < vertexPositionArray.size(); i += 3) {
+				retVec.x = max(retVec.x, (Number)fabs(vertexPositionArray[i]));
+				retVec.y = max(retVec.y, (Number)fabs(vertexPositionArray[i+1]));
+				retVec.z = max(retVec.z, (Number)fabs(vertexPositionArray[i+2]));
+			}
+			return retVec*2;
+		}
+		
 		for(int i=0; i < polygons.size(); i++) {
 			for(int j=0; j < polygons[i]->getVertexCount(); j++) {				
 				retVec.x = max(retVec.x,fabs(polygons[i]->getVertex(j)->x));
@@ -457,6 +1158,9 @@ namespace Polycode {
 	}
 	
 	unsigned int Mesh::getVertexCount() {
+		if(indexedMesh) {
+			return vertexPositionArray.size() / 3;
+		}
 		unsigned int total = 0;
 		for(int i=0; i < polygons.size(); i++) {
 			total += polygons[i]->getVertexCount();
@@ -721,12 +1425,19 @@ namespace Polycode {
 	void Mesh::dirtyArray(unsigned int arrayIndex) {
 		if(arrayIndex < 16)
 			arrayDirtyMap[arrayIndex] = true;				
+		if(arrayIndex == RenderDataArray::VERTEX_DATA_ARRAY)
+			boundsVertexCount = NO_CACHED_BOUNDS;
+		if(indexedMesh)
+			polygonViewDirty = true;
 	}
 	
 	void Mesh::dirtyArrays() {
 		for(int i=0; i < 16; i++) {
 			arrayDirtyMap[i] = true;
 		}
+		if(indexedMesh)
+			polygonViewDirty = true;
+		boundsVertexCount = NO_CACHED_BOUNDS;
 	}
 	
 	
@@ -738,6 +1449,9 @@ namespace Polycode {
 	}
 	
 	vector<Polygon*> Mesh::getConnectedFaces(Vertex *v) {
+		if(indexedMesh && polygonViewDirty) {
+			buildPolygonView();
+		}
 		vector<Polygon*> retVec;	
 		for(int i=0; i < polygons.size(); i++) {
 			bool pushed = false;		
@@ -755,52 +1469,99 @@ namespace Polycode {
 	}
 	
 	void Mesh::calculateTangents() {
-		for(int i =0; i < polygons.size(); i++) {
-			polygons[i]->calculateTangent();
-		}		
-		/*
-		for(int i=0; i < polygons.size(); i++) {
-			for(int j=0; j < polygons[i]->getVertexCount(); j++) {		
-				Vertex *v =  polygons[i]->getVertex(j);
-
-				Vector3 tangent;		
-				vector<Polygon*> connectedFaces = getConnectedFaces(v);
-				int numConnected = connectedFaces.size();
-				if(numConnected > 2)
-					numConnected = 2;
-				for(int k=0; k < numConnected; k++) {					
-					tangent += connectedFaces[k]->getFaceTangent();
-				}						
-				tangent = tangent / numConnected;
+		if(!indexedMesh) {
+			for(int i =0; i < polygons.size(); i++) {
+				polygons[i]->calculateTangent();
+			}
+		} else if(getVerticesPerFace() < 3) {
+			vertexTangentArray.assign(vertexPositionArray.size(), 0.0f);
+			arrayDirtyMap[RenderDataArray::TANGENT_DATA_ARRAY] = true;
+			return;
+		}
+		
+		// Tangents are smoothed across the same faces as the normals, but never across texture seams.
+		MeshFaceCorners corners;
+		buildFaceCorners(corners);
+		vector<Vector3> cornerTangents;
+		Number cosAngle = smoothNormals ? cos(normalSmoothAngle * TORADIANS) : 1.0;
+		smoothCornerVectors(corners, corners.faceTangents, cosAngle, true, cornerTangents);
+		
+		if(indexedMesh) {
+			vertexTangentArray.assign(vertexPositionArray.size(), 0.0f);
+			for(int i=0; i < cornerTangents.size(); i++) {
+				unsigned int index = indexArray[i] * 3;
+				vertexTangentArray[index] += cornerTangents[i].x;
+				vertexTangentArray[index+1] += cornerTangents[i].y;
+				vertexTangentArray[index+2] += cornerTangents[i].z;
+			}
+			for(int i=0; i < vertexTangentArray.size(); i += 3) {
+				Vector3 normal(vertexNormalArray[i], vertexNormalArray[i+1], vertexNormalArray[i+2]);
+				Vector3 tangent(vertexTangentArray[i], vertexTangentArray[i+1], vertexTangentArray[i+2]);
+				tangent = tangent - (normal * normal.dot(tangent));
 				tangent.Normalize();
-				v->tangent = tangent;
+				vertexTangentArray[i] = tangent.x;
+				vertexTangentArray[i+1] = tangent.y;
+				vertexTangentArray[i+2] = tangent.z;
 			}
-		}		
-		*/
+			polygonViewDirty = true;
+		} else {
+			unsigned int corner = 0;
+			for(int i=0; i < polygons.size(); i++) {
+				for(int j=0; j < polygons[i]->getVertexCount(); j++) {
+					Vertex *v = polygons[i]->getVertex(j);
+					Vector3 tangent = cornerTangents[corner++];
+					tangent = tangent - (v->normal * v->normal.dot(tangent));
+					tangent.Normalize();
+					v->tangent = tangent;
+				}
+			}
+		}
+		
 		arrayDirtyMap[RenderDataArray::TANGENT_DATA_ARRAY] = true;		
 	}
 	
 	void Mesh::calculateNormals(bool smooth, Number smoothAngle) {
-		for(int i =0; i < polygons.size(); i++) {
-			polygons[i]->calculateNormal();
-		}	
+		smoothNormals = smooth;
+		normalSmoothAngle = smoothAngle;
+		
+		if(!indexedMesh) {
+			for(int i =0; i < polygons.size(); i++) {
+				polygons[i]->calculateNormal();
+			}	
+			if(!smooth) {
+				arrayDirtyMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;
+				return;
+			}
+		} else {
+			if(getVerticesPerFace() < 3)
+				return;
+		}
 		
+		MeshFaceCorners corners;
+		buildFaceCorners(corners);
+		vector<Vector3> cornerNormals;
 		if(smooth) {
+			smoothCornerVectors(corners, corners.faceAreaNormals, cos(smoothAngle * TORADIANS), false, cornerNormals);
+		} else {
+			cornerNormals.resize(corners.positions.size());
+			for(int i=0; i < cornerNormals.size(); i++) {
+				cornerNormals[i] = corners.faceNormals[corners.cornerFace[i]];
+			}
+		}
+		for(int i=0; i < cornerNormals.size(); i++) {
+			cornerNormals[i].Normalize();
+		}
+		
+		if(indexedMesh) {
+			setIndexedCornerNormals(cornerNormals);
+		} else {
+			unsigned int corner = 0;
 			for(int i=0; i < polygons.size(); i++) {
-				for(int j=0; j < polygons[i]->getVertexCount(); j++) {		
-					Vertex *v =  polygons[i]->getVertex(j);
-
-					Vector3 normal;		
-					vector<Polygon*> connectedFaces = getConnectedFaces(v);
-					for(int k=0; k < connectedFaces.size(); k++) {					
-						normal += connectedFaces[k]->getFaceNormal();
-					}					
-					normal = normal / connectedFaces.size();
-					normal.Normalize();
-					v->setNormal(normal.x, normal.y, normal.z);
+				for(int j=0; j < polygons[i]->getVertexCount(); j++) {
+					Vector3 normal = cornerNormals[corner++];
+					polygons[i]->getVertex(j)->setNormal(normal.x, normal.y, normal.z);
 				}
 			}
-		
 		}
 		
 		arrayDirtyMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;		
@@ -815,7 +1576,22 @@ namespace Polycode {
 	}
 	
 	void Mesh::addPolygon(Polygon *newPolygon) {
-		polygons.push_back(newPolygon);
+		boundsVertexCount = NO_CACHED_BOUNDS;
+		if(indexedMesh) {
+			IndexedVertexRecord record;
+			bool withBones = !vertexBoneWeightArray.empty();
+			for(int i=0; i < newPolygon->getVertexCount(); i++) {
+				recordFromVertex(newPolygon->getVertex(i), newPolygon, record);
+				indexArray.push_back(vertexPositionArray.size() / 3);
+				appendIndexedVertex(this, record, withBones);
+			}
+			polygonViewDirty = true;
+			arrayDirtyMap[RenderDataArray::INDEX_DATA_ARRAY] = true;
+			// the vertices now live in the indexed arrays, the polygon view is rebuilt from them
+			delete newPolygon;
+		} else {
+			polygons.push_back(newPolygon);
+		}
 		arrayDirtyMap[RenderDataArray::VERTEX_DATA_ARRAY] = true;		
 		arrayDirtyMap[RenderDataArray::COLOR_DATA_ARRAY] = true;				
 		arrayDirtyMap[RenderDataArray::TEXCOORD_DATA_ARRAY] = true;		
@@ -825,10 +1601,261 @@ namespace Polycode {
 	
 	
 	unsigned int Mesh::getPolygonCount() {
+		if(indexedMesh && polygonViewDirty) {
+			buildPolygonView();
+		}
 		return polygons.size();
 	}
 	
 	Polygon *Mesh::getPolygon(unsigned int index) {
+		if(indexedMesh && polygonViewDirty) {
+			buildPolygonView();
+		}
 		return polygons[index];
 	}
+	
+	unsigned int Mesh::getVerticesPerFace() {
+		switch(meshType) {
+			case TRI_MESH:
+				return 3;
+			case QUAD_MESH:
+				return 4;
+			default:
+				return 1;
+		}
+	}
+	
+	unsigned int Mesh::addIndexedVertex(const Vector3 &position, const Vector3 &normal, const Vector2 &texCoord) {
+		boundsVertexCount = NO_CACHED_BOUNDS;
+		if(!indexedMesh && polygons.size() > 0) {
+			convertToIndexedMesh();
+		}
+		indexedMesh = true;
+		
+		IndexedVertexRecord record;
+		memset(&record, 0, sizeof(IndexedVertexRecord));
+		record.position[0] = position.x;
+		record.position[1] = position.y;
+		record.position[2] = position.z;
+		record.normal[0] = normal.x;
+		record.normal[1] = normal.y;
+		record.normal[2] = normal.z;
+		record.color[0] = 1.0f;
+		record.color[1] = 1.0f;
+		record.color[2] = 1.0f;
+		record.color[3] = 1.0f;
+		record.texCoord[0] = texCoord.x;
+		record.texCoord[1] = texCoord.y;
+		appendIndexedVertex(this, record, !vertexBoneWeightArray.empty());
+		
+		polygonViewDirty = true;
+		arrayDirtyMap[RenderDataArray::VERTEX_DATA_ARRAY] = true;		
+		arrayDirtyMap[RenderDataArray::COLOR_DATA_ARRAY] = true;				
+		arrayDirtyMap[RenderDataArray::TEXCOORD_DATA_ARRAY] = true;		
+		arrayDirtyMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;		
+		arrayDirtyMap[RenderDataArray::TANGENT_DATA_ARRAY] = true;
+		return (vertexPositionArray.size() / 3) - 1;
+	}
+	
+	void Mesh::addIndex(unsigned int index) {
+		indexArray.push_back(index);
+		polygonViewDirty = true;
+		arrayDirtyMap[RenderDataArray::INDEX_DATA_ARRAY] = true;
+	}
+	
+	unsigned int Mesh::getIndexCount() {
+		return indexArray.size();
+	}
+	
+	unsigned int Mesh::getIndexSize() {
+		if(vertexPositionArray.size() / 3 <= 65536) {
+			return 2;
+		} else {
+			return 4;
+		}
+	}
+	
+	void Mesh::convertToIndexedMesh() {
+		if(indexedMesh)
+			return;
+		
+		unsigned int totalVertices = 0;
+		bool withBones = false;
+		for(int i=0; i < polygons.size(); i++) {
+			totalVertices += polygons[i]->getVertexCount();
+			for(int j=0; j < polygons[i]->getVertexCount(); j++) {
+				if(polygons[i]->getVertex(j)->getNumBoneAssignments() > 0)
+					withBones = true;
+			}
+		}
+		
+		IndexedVertexRecord record;
+		IndexedVertexWelder welder(this, totalVertices, withBones);
+		indexArray.reserve(totalVertices);
+		for(int i=0; i < polygons.size(); i++) {
+			for(int j=0; j < polygons[i]->getVertexCount(); j++) {
+				recordFromVertex(polygons[i]->getVertex(j), polygons[i], record);
+				indexArray.push_back(welder.addVertex(record));
+			}
+		}
+		
+		if(withBones) {
+			vertexRestPositionArray = vertexPositionArray;
+			vertexRestNormalArray = vertexNormalArray;
+		}
+		
+		indexedMesh = true;
+		polygonViewDirty = true;
+		calculateTangents();
+		dirtyArrays();
+	}
+	
+	void Mesh::buildPolygonView() {
+		clearPolygons();
+		polygonViewDirty = false;
+		
+		unsigned int verticesPerFace = getVerticesPerFace();
+		bool hasBones = !vertexBoneWeightArray.empty();
+		
+		for(int i=0; i+verticesPerFace <= indexArray.size(); i += verticesPerFace) {
+			Polygon *polygon = new Polygon();
+			for(int j=0; j < verticesPerFace; j++) {
+				unsigned int index = indexArray[i+j];
+				Vertex *vertex = new Vertex(vertexPositionArray[(index*3)], vertexPositionArray[(index*3)+1], vertexPositionArray[(index*3)+2],
+											vertexNormalArray[(index*3)], vertexNormalArray[(index*3)+1], vertexNormalArray[(index*3)+2],
+											vertexTexCoordArray[(index*2)], vertexTexCoordArray[(index*2)+1]);
+				vertex->restNormal = vertex->normal;
+				if(!vertexRestPositionArray.empty()) {
+					vertex->restPosition.set(vertexRestPositionArray[(index*3)], vertexRestPositionArray[(index*3)+1], vertexRestPositionArray[(index*3)+2]);
+					vertex->restNormal.set(vertexRestNormalArray[(index*3)], vertexRestNormalArray[(index*3)+1], vertexRestNormalArray[(index*3)+2]);
+				}
+				vertex->tangent.set(vertexTangentArray[(index*3)], vertexTangentArray[(index*3)+1], vertexTangentArray[(index*3)+2]);
+				vertex->vertexColor.setColor(vertexColorArray[(index*4)], vertexColorArray[(index*4)+1], vertexColorArray[(index*4)+2], vertexColorArray[(index*4)+3]);
+				if(hasBones) {
+					for(int b=0; b < MAX_BONE_WEIGHTS; b++) {
+						if(vertexBoneWeightArray[(index*MAX_BONE_WEIGHTS)+b] > 0) {
+							vertex->addBoneAssignment(vertexBoneIndexArray[(index*MAX_BONE_WEIGHTS)+b], vertexBoneWeightArray[(index*MAX_BONE_WEIGHTS)+b]);
+						}
+					}
+				}
+				polygon->addVertex(vertex);
+			}
+			if(verticesPerFace >= 3) {
+				Vector3 faceNormal = (*polygon->getVertex(0) - *polygon->getVertex(1)).crossProduct(*polygon->getVertex(1) - *polygon->getVertex(2));
+				faceNormal.Normalize();
+				polygon->setNormal(faceNormal);
+			}
+			polygons.push_back(polygon);
+		}
+	}
+	
+	unsigned int Mesh::duplicateIndexedVertex(unsigned int index) {
+		unsigned int newIndex = vertexPositionArray.size() / 3;
+		for(int c=0; c < 3; c++) {
+			vertexPositionArray.push_back(vertexPositionArray[(index*3)+c]);
+			vertexNormalArray.push_back(vertexNormalArray[(index*3)+c]);
+			vertexTangentArray.push_back(vertexTangentArray[(index*3)+c]);
+		}
+		for(int c=0; c < 4; c++) {
+			vertexColorArray.push_back(vertexColorArray[(index*4)+c]);
+		}
+		for(int c=0; c < 2; c++) {
+			vertexTexCoordArray.push_back(vertexTexCoordArray[(index*2)+c]);
+		}
+		if(!vertexRestPositionArray.empty()) {
+			for(int c=0; c < 3; c++) {
+				vertexRestPositionArray.push_back(vertexRestPositionArray[(index*3)+c]);
+				vertexRestNormalArray.push_back(vertexRestNormalArray[(index*3)+c]);
+			}
+		}
+		if(!vertexBoneWeightArray.empty()) {
+			for(int c=0; c < MAX_BONE_WEIGHTS; c++) {
+				vertexBoneIndexArray.push_back(vertexBoneIndexArray[(index*MAX_BONE_WEIGHTS)+c]);
+				vertexBoneWeightArray.push_back(vertexBoneWeightArray[(index*MAX_BONE_WEIGHTS)+c]);
+			}
+		}
+		return newIndex;
+	}
+	
+	void Mesh::setIndexedCornerNormals(const vector<Vector3> &cornerNormals) {
+		// Corners that share a vertex but end up with different normals (hard edges beyond the
+		// smoothing angle) get their own copy of the vertex.
+		vector<bool> assigned(vertexPositionArray.size() / 3, false);
+		vector<unsigned int> nextCopy(vertexPositionArray.size() / 3, NO_WELD_ENTRY);
+		
+		for(int i=0; i < cornerNormals.size(); i++) {
+			unsigned int index = indexArray[i];
+			const Vector3 &normal = cornerNormals[i];
+			
+			if(!assigned[index]) {
+				assigned[index] = true;
+				vertexNormalArray[(index*3)] = normal.x;
+				vertexNormalArray[(index*3)+1] = normal.y;
+				vertexNormalArray[(index*3)+2] = normal.z;
+				continue;
+			}
+			
+			unsigned int match = NO_WELD_ENTRY;
+			for(unsigned int copy = index; copy != NO_WELD_ENTRY; copy = nextCopy[copy]) {
+				if(fabs(vertexNormalArray[(copy*3)] - normal.x) < 0.0001 &&
+				   fabs(vertexNormalArray[(copy*3)+1] - normal.y) < 0.0001 &&
+				   fabs(vertexNormalArray[(copy*3)+2] - normal.z) < 0.0001) {
+					match = copy;
+					break;
+				}
+			}
+			
+			if(match == NO_WELD_ENTRY) {
+				match = duplicateIndexedVertex(index);
+				vertexNormalArray[(match*3)] = normal.x;
+				vertexNormalArray[(match*3)+1] = normal.y;
+				vertexNormalArray[(match*3)+2] = normal.z;
+				assigned.push_back(true);
+				nextCopy.push_back(nextCopy[index]);
+				nextCopy[index] = match;
+			}
+			indexArray[i] = match;
+		}
+		
+		if(!vertexRestNormalArray.empty()) {
+			vertexRestNormalArray = vertexNormalArray;
+		}
+		
+		polygonViewDirty = true;
+		dirtyArrays();
+	}
+	
+	void Mesh::buildFaceCorners(MeshFaceCorners &corners) {
+		if(indexedMesh) {
+			unsigned int verticesPerFace = getVerticesPerFace();
+			unsigned int cornerCount = indexArray.size() - (indexArray.size() % verticesPerFace);
+			corners.positions.reserve(cornerCount);
+			corners.texCoords.reserve(cornerCount);
+			for(int i=0; i < cornerCount; i++) {
+				unsigned int index = indexArray[i];
+				if(i % verticesPerFace == 0) {
+					corners.faceStart.push_back(i);
+				}
+				corners.positions.push_back(Vector3(vertexPositionArray[(index*3)], vertexPositionArray[(index*3)+1], vertexPositionArray[(index*3)+2]));
+				corners.texCoords.push_back(Vector2(vertexTexCoordArray[(index*2)], vertexTexCoordArray[(index*2)+1]));
+			}
+		} else {
+			for(int i=0; i < polygons.size(); i++) {
+				corners.faceStart.push_back(corners.positions.size());
+				for(int j=0; j < polygons[i]->getVertexCount(); j++) {
+					Vertex *v = polygons[i]->getVertex(j);
+					corners.positions.push_back(*v);
+					corners.texCoords.push_back(v->texCoord);
+				}
+			}
+		}
+		corners.faceStart.push_back(corners.positions.size());
+		
+		Vector3 bBox = calculateBBox();
+		Number weldDistance = max(max(bBox.x, bBox.y), bBox.z) * 0.00001;
+		if(weldDistance <= 0)
+			weldDistance = 0.00001;
+		corners.build(weldDistance);
+	}
+	
 }
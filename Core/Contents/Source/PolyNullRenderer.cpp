@@ -0,0 +1,617 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+#include "PolyNullRenderer.h"
+#include "PolyCubemap.h"
+#include "PolyFixedShader.h"
+#include "PolyLogger.h"
+#include "PolyMaterial.h"
+#include "PolyModule.h"
+
+using namespace Polycode;
+
+static Matrix4 frustumMatrix(Number left, Number right, Number bottom, Number top, Number nearPlane, Number farPlane) {
+	// same layout as glFrustum, which matches the row vector convention of Matrix4
+	Matrix4 m;
+	memset(m.ml, 0, sizeof(Number)*16);
+	m.ml[0] = (2.0 * nearPlane) / (right - left);
+	m.ml[5] = (2.0 * nearPlane) / (top - bottom);
+	m.ml[8] = (right + left) / (right - left);
+	m.ml[9] = (top + bottom) / (top - bottom);
+	m.ml[10] = -(farPlane + nearPlane) / (farPlane - nearPlane);
+	m.ml[11] = -1.0;
+	m.ml[14] = -(2.0 * farPlane * nearPlane) / (farPlane - nearPlane);
+	return m;
+}
+
+static Matrix4 orthoMatrix(Number left, Number right, Number bottom, Number top, Number nearPlane, Number farPlane) {
+	// same layout as glOrtho
+	Matrix4 m;
+	m.ml[0] = 2.0 / (right - left);
+	m.ml[5] = 2.0 / (top - bottom);
+	m.ml[10] = -2.0 / (farPlane - nearPlane);
+	m.ml[12] = -(right + left) / (right - left);
+	m.ml[13] = -(top + bottom) / (top - bottom);
+	m.ml[14] = -(farPlane + nearPlane) / (farPlane - nearPlane);
+	return m;
+}
+
+static bool unprojectPoint(Number winX, Number winY, Number winZ, const Matrix4 &modelview, const Matrix4 &projection, Number viewportWidth, Number viewportHeight, Vector3 *result) {
+	// equivalent of gluUnProject for a viewport at the origin
+	Matrix4 inverse = (modelview * projection).Inverse();
+	Number in[4];
+	in[0] = (winX / viewportWidth) * 2.0 - 1.0;
+	in[1] = (winY / viewportHeight) * 2.0 - 1.0;
+	in[2] = (winZ * 2.0) - 1.0;
+	in[3] = 1.0;
+	
+	Number out[4];
+	for(int j=0; j < 4; j++) {
+		out[j] = in[0] * inverse.m[0][j] + in[1] * inverse.m[1][j] + in[2] * inverse.m[2][j] + in[3] * inverse.m[3][j];
+	}
+	if(out[3] == 0.0)
+		return false;
+	
+	*result = Vector3(out[0] / out[3], out[1] / out[3], out[2] / out[3]);
+	return true;
+}
+
+NullTexture::NullTexture(unsigned int width, unsigned int height, char *textureData, bool clamp, bool createMipmaps, int type) : Texture(width, height, textureData, clamp, createMipmaps, type) {
+}
+
+NullTexture::~NullTexture() {
+}
+
+void NullTexture::setTextureData(char *data) {
+}
+
+void NullTexture::recreateFromImageData() {
+}
+
+NullVertexBuffer::NullVertexBuffer(Mesh *mesh) : VertexBuffer() {
+	meshType = mesh->getMeshType();
+	indexCount = 0;
+	
+	if(mesh->isIndexedMesh()) {
+		vertexCount = mesh->getVertexCount();
+		indexCount = mesh->getIndexCount();
+		return;
+	}
+	
+	vertexCount = 0;
+	for(int i=0; i < mesh->getPolygonCount(); i++) {
+		vertexCount += mesh->getPolygon(i)->getVertexCount();
+	}
+}
+
+NullVertexBuffer::~NullVertexBuffer() {
+}
+
+int NullVertexBuffer::getIndexCount() const {
+	return indexCount;
+}
+
+NullRenderer::NullRenderer() : Renderer() {
+	nearPlane = 0.1f;
+	farPlane = 100.0f;
+	verticesToDraw = 0;
+	indicesToDraw = 0;
+	viewportWidth = 1;
+	viewportHeight = 1;
+}
+
+NullRenderer::~NullRenderer() {
+}
+
+void NullRenderer::applyRenderState(int state, int value) {
+	if(changeRenderState(state, value)) {
+		logCommand(COMMAND_STATE_CHANGE, state, value, 0, NULL);
+	}
+}
+
+void NullRenderer::Resize(int xRes, int yRes) {
+	this->xRes = xRes;
+	this->yRes = yRes;
+	viewportWidth = xRes;
+	viewportHeight = yRes;
+	resetViewport();
+}
+
+void NullRenderer::BeginRender() {
+	if(doClearBuffer) {
+		logCommand(COMMAND_CLEAR, 1, 1, 0, NULL);
+	}
+	modelviewMatrix.identity();
+	currentTexture = NULL;
+	invalidateRenderStates();
+	beginFrameStats();
+}
+
+void NullRenderer::EndRender() {
+	endFrameStats();
+	if(matrixStack.size() > 0) {
+		Logger::log("NullRenderer: %d matrices left on the matrix stack at the end of the frame\n", (int)matrixStack.size());
+		matrixStack.clear();
+	}
+}
+
+Cubemap *NullRenderer::createCubemap(Texture *t0, Texture *t1, Texture *t2, Texture *t3, Texture *t4, Texture *t5) {
+	return new Cubemap(t0, t1, t2, t3, t4, t5);
+}
+
+Texture *NullRenderer::createTexture(unsigned int width, unsigned int height, char *textureData, bool clamp, bool createMipmaps, int type) {
+	return new NullTexture(width, height, textureData, clamp, createMipmaps, type);
+}
+
+void NullRenderer::destroyTexture(Texture *texture) {
+	delete texture;
+}
+
+void NullRenderer::createRenderTextures(Texture **colorBuffer, Texture **depthBuffer, int width, int height, bool floatingPointBuffer) {
+	if(colorBuffer) {
+		*colorBuffer = new NullTexture(width, height, NULL, true, false);
+	}
+	if(depthBuffer) {
+		*depthBuffer = new NullTexture(width, height, NULL, true, false);
+	}
+}
+
+Texture *NullRenderer::createFramebufferTexture(unsigned int width, unsigned int height) {
+	return new NullTexture(width, height, NULL, true, false);
+}
+
+void NullRenderer::bindFrameBufferTexture(Texture *texture) {
+	if(!texture)
+		return;
+	logCommand(COMMAND_BIND_FRAMEBUFFER, 0, 0, 0, texture);
+	logCommand(COMMAND_CLEAR, 1, 1, 0, NULL);
+}
+
+void NullRenderer::bindFrameBufferTextureDepth(Texture *texture) {
+	if(!texture)
+		return;
+	logCommand(COMMAND_BIND_FRAMEBUFFER, 1, 0, 0, texture);
+	logCommand(COMMAND_CLEAR, 1, 1, 0, NULL);
+}
+
+void NullRenderer::unbindFramebuffers() {
+	logCommand(COMMAND_UNBIND_FRAMEBUFFERS, 0, 0, 0, NULL);
+}
+
+Image *NullRenderer::renderScreenToImage() {
+	return new Image(xRes, yRes, Image::IMAGE_RGBA);
+}
+
+void NullRenderer::resetViewport() {
+	Number fW, fH;
+	fH = tan(fov / 360.0 * PI) * nearPlane;
+	fW = fH * (viewportWidth / viewportHeight);
+	projectionMatrix = frustumMatrix(-fW + (viewportShift.x*fW*2.0), fW + (viewportShift.x*fW*2.0), -fH + (viewportShift.y*fH*2.0), fH + (viewportShift.y*fH*2.0), nearPlane, farPlane);
+}
+
+void NullRenderer::loadIdentity() {
+	modelviewMatrix.identity();
+}
+
+void NullRenderer::setOrthoMode(Number xSize, Number ySize, bool centered) {
+	if(xSize == 0)
+		xSize = xRes;
+	if(ySize == 0)
+		ySize = yRes;
+	
+	setBlendingMode(BLEND_MODE_NORMAL);
+	enableBackfaceCulling(false);
+	
+	if(centered) {
+		projectionMatrix = orthoMatrix(-xSize*0.5, xSize*0.5, ySize*0.5, -ySize*0.5, -1.0, 1.0);
+	} else {
+		projectionMatrix = orthoMatrix(0.0, xSize, ySize, 0.0, -1.0, 1.0);
+	}
+	orthoMode = true;
+	modelviewMatrix.identity();
+}
+
+void NullRenderer::_setOrthoMode(Number orthoSizeX, Number orthoSizeY) {
+	this->orthoSizeX = orthoSizeX;
+	this->orthoSizeY = orthoSizeY;
+	
+	if(!orthoMode) {
+		projectionMatrix = orthoMatrix(-orthoSizeX*0.5, orthoSizeX*0.5, -orthoSizeY*0.5, orthoSizeY*0.5, -farPlane, farPlane);
+		orthoMode = true;
+	}
+	modelviewMatrix.identity();
+}
+
+void NullRenderer::setPerspectiveMode() {
+	setBlendingMode(BLEND_MODE_NORMAL);
+	if(orthoMode) {
+		enableDepthTest(true);
+		enableBackfaceCulling(true);
+		orthoMode = false;
+	}
+	modelviewMatrix.identity();
+	currentTexture = NULL;
+}
+
+void NullRenderer::setTexture(Texture *texture) {
+	if(texture == NULL) {
+		applyRenderState(RENDER_STATE_TEXTURE_ENABLED, false);
+		return;
+	}
+	
+	if(renderMode == RENDER_MODE_NORMAL) {
+		applyRenderState(RENDER_STATE_TEXTURE_ENABLED, true);
+		if(currentTexture != texture) {
+			frameStats.textureBinds++;
+			logCommand(COMMAND_SET_TEXTURE, 0, 0, 0, texture);
+		}
+	} else {
+		applyRenderState(RENDER_STATE_TEXTURE_ENABLED, false);
+	}
+	
+	currentTexture = texture;
+}
+
+void NullRenderer::enableBackfaceCulling(bool val) {
+	applyRenderState(RENDER_STATE_BACKFACE_CULLING, val);
+}
+
+void NullRenderer::clearScreen() {
+	logCommand(COMMAND_CLEAR, 1, 1, 0, NULL);
+}
+
+void NullRenderer::translate2D(Number x, Number y) {
+	translate3D(x, y, 0.0);
+}
+
+void NullRenderer::rotate2D(Number angle) {
+	Number c = cos(angle * TORADIANS);
+	Number s = sin(angle * TORADIANS);
+	Matrix4 rotation;
+	rotation.m[0][0] = c;
+	rotation.m[0][1] = s;
+	rotation.m[1][0] = -s;
+	rotation.m[1][1] = c;
+	modelviewMatrix = rotation * modelviewMatrix;
+}
+
+void NullRenderer::scale2D(Vector2 *scale) {
+	Vector3 scale3D(scale->x, scale->y, 1.0);
+	this->scale3D(&scale3D);
+}
+
+void NullRenderer::setVertexColor(Number r, Number g, Number b, Number a) {
+}
+
+void NullRenderer::pushRenderDataArray(RenderDataArray *array) {
+	switch(array->arrayType) {
+		case RenderDataArray::VERTEX_DATA_ARRAY:
+			verticesToDraw = array->count;
+		break;
+		case RenderDataArray::INDEX_DATA_ARRAY:
+			indicesToDraw = array->count;
+		break;
+	}
+}
+
+RenderDataArray *NullRenderer::createRenderDataArrayForMesh(Mesh *mesh, int arrayType) {
+	RenderDataArray *arrays[16];
+	bool updateMap[16];
+	for(int i=0; i < 16; i++) {
+		arrays[i] = NULL;
+		updateMap[i] = false;
+	}
+	
+	RenderDataArray *newArray = createRenderDataArray(arrayType);
+	arrays[arrayType] = newArray;
+	updateMap[arrayType] = true;
+	fillRenderDataArrays(mesh, arrays, updateMap);
+	return newArray;
+}
+
+RenderDataArray *NullRenderer::createRenderDataArray(int arrayType) {
+	RenderDataArray *newArray = new RenderDataArray();
+	newArray->arrayType = arrayType;
+	newArray->arrayPtr = malloc(1);
+	newArray->capacity = 1;
+	newArray->stride = 0;
+	newArray->count = 0;
+	newArray->rendererData = NULL;
+	
+	switch (arrayType) {
+		case RenderDataArray::COLOR_DATA_ARRAY:
+			newArray->size = 4;
+		break;
+		case RenderDataArray::TEXCOORD_DATA_ARRAY:
+		case RenderDataArray::INDEX_DATA_ARRAY:
+			newArray->size = 2;
+		break;
+		default:
+			newArray->size = 3;
+		break;
+	}
+	
+	return newArray;
+}
+
+void NullRenderer::updateRenderDataArraysForMesh(Mesh *mesh, bool *updateMap) {
+	for(int i=0; i < 16; i++) {
+		if(updateMap[i] && mesh->renderDataArrays[i] == NULL) {
+			mesh->renderDataArrays[i] = createRenderDataArray(i);
+		}
+	}
+	fillRenderDataArrays(mesh, mesh->renderDataArrays, updateMap);
+}
+
+void NullRenderer::setRenderArrayData(RenderDataArray *array, Number *arrayData) {
+}
+
+void NullRenderer::drawArrays(int drawType) {
+	unsigned int count = indicesToDraw > 0 ? indicesToDraw : verticesToDraw;
+	frameStats.drawCalls++;
+	frameStats.verticesDrawn += count;
+	logCommand(COMMAND_DRAW_ARRAYS, drawType, 0, count, NULL);
+	
+	verticesToDraw = 0;
+	indicesToDraw = 0;
+}
+
+void NullRenderer::translate3D(Vector3 *position) {
+	translate3D(position->x, position->y, position->z);
+}
+
+void NullRenderer::translate3D(Number x, Number y, Number z) {
+	Matrix4 translation;
+	translation.setPosition(x, y, z);
+	modelviewMatrix = translation * modelviewMatrix;
+}
+
+void NullRenderer::scale3D(Vector3 *scale) {
+	Matrix4 scaleMatrix;
+	scaleMatrix.setScale(*scale);
+	modelviewMatrix = scaleMatrix * modelviewMatrix;
+}
+
+void NullRenderer::pushMatrix() {
+	matrixStack.push_back(modelviewMatrix);
+	logCommand(COMMAND_PUSH_MATRIX, 0, 0, 0, NULL);
+}
+
+void NullRenderer::popMatrix() {
+	if(matrixStack.size() == 0) {
+		Logger::log("NullRenderer: matrix stack underflow\n");
+		return;
+	}
+	modelviewMatrix = matrixStack.back();
+	matrixStack.pop_back();
+	logCommand(COMMAND_POP_MATRIX, 0, 0, 0, NULL);
+}
+
+void NullRenderer::setLineSmooth(bool val) {
+	applyRenderState(RENDER_STATE_LINE_SMOOTH, val);
+}
+
+void NullRenderer::setLineSize(Number lineSize) {
+}
+
+void NullRenderer::enableLighting(bool enable) {
+	lightingEnabled = enable;
+}
+
+void NullRenderer::enableFog(bool enable) {
+}
+
+void NullRenderer::setFogProperties(int fogMode, Color color, Number density, Number startDepth, Number endDepth) {
+}
+
+void NullRenderer::multModelviewMatrix(Matrix4 m) {
+	modelviewMatrix = m * modelviewMatrix;
+}
+
+void NullRenderer::setModelviewMatrix(Matrix4 m) {
+	modelviewMatrix = m;
+}
+
+void NullRenderer::setBlendingMode(int blendingMode) {
+	applyRenderState(RENDER_STATE_BLENDING_MODE, (blendingMode * 2) + (blendNormalAsPremultiplied ? 1 : 0));
+}
+
+void NullRenderer::applyMaterial(Material *material, ShaderBinding *localOptions, unsigned int shaderIndex) {
+	frameStats.materialChanges++;
+	logCommand(COMMAND_APPLY_MATERIAL, shaderIndex, 0, 0, material);
+	
+	if(!material->getShader(shaderIndex) || !shadersEnabled) {
+		setTexture(NULL);
+		return;
+	}
+	
+	switch(material->getShader(shaderIndex)->getType()) {
+		case Shader::FIXED_SHADER:
+			setTexture(((FixedShaderBinding*)material->getShaderBinding(shaderIndex))->getDiffuseTexture());
+		break;
+		case Shader::MODULE_SHADER:
+			currentMaterial = material;
+			currentTexture = NULL;
+			renderStateValid[RENDER_STATE_TEXTURE_ENABLED] = false;
+		break;
+	}
+	
+	setBlendingMode(material->blendingMode);
+}
+
+void NullRenderer::clearShader() {
+	renderStateValues[RENDER_STATE_TEXTURE_ENABLED] = false;
+	renderStateValid[RENDER_STATE_TEXTURE_ENABLED] = true;
+	currentMaterial = NULL;
+	logCommand(COMMAND_CLEAR_SHADER, 0, 0, 0, NULL);
+}
+
+void NullRenderer::setDepthFunction(int depthFunction) {
+}
+
+void NullRenderer::createVertexBufferForMesh(Mesh *mesh) {
+	mesh->setVertexBuffer(new NullVertexBuffer(mesh));
+}
+
+void NullRenderer::drawVertexBuffer(VertexBuffer *buffer, bool enableColorBuffer) {
+	NullVertexBuffer *nullBuffer = (NullVertexBuffer*)buffer;
+	unsigned int count = nullBuffer->getIndexCount() > 0 ? nullBuffer->getIndexCount() : nullBuffer->getVertexCount();
+	frameStats.drawCalls++;
+	frameStats.verticesDrawn += count;
+	logCommand(COMMAND_DRAW_VERTEX_BUFFER, buffer->meshType, 0, count, buffer);
+}
+
+void NullRenderer::enableDepthTest(bool val) {
+	applyRenderState(RENDER_STATE_DEPTH_TEST, val);
+}
+
+void NullRenderer::enableDepthWrite(bool val) {
+	applyRenderState(RENDER_STATE_DEPTH_WRITE, val);
+}
+
+void NullRenderer::setClippingPlanes(Number nearPlane, Number farPlane) {
+	this->nearPlane = nearPlane;
+	this->farPlane = farPlane;
+	resetViewport();
+}
+
+void NullRenderer::enableAlphaTest(bool val) {
+	applyRenderState(RENDER_STATE_ALPHA_TEST, val);
+}
+
+void NullRenderer::clearBuffer(bool colorBuffer, bool depthBuffer) {
+	logCommand(COMMAND_CLEAR, colorBuffer, depthBuffer, 0, NULL);
+}
+
+void NullRenderer::drawToColorBuffer(bool val) {
+}
+
+void NullRenderer::drawScreenQuad(Number qx, Number qy) {
+	setOrthoMode();
+	frameStats.drawCalls++;
+	frameStats.verticesDrawn += 4;
+	logCommand(COMMAND_DRAW_ARRAYS, Mesh::QUAD_MESH, 0, 4, NULL);
+	setPerspectiveMode();
+}
+
+void NullRenderer::cullFrontFaces(bool val) {
+	cullingFrontFaces = val;
+}
+
+Vector3 NullRenderer::projectRayFrom2DCoordinate(Number x, Number y, Matrix4 cameraMatrix, Matrix4 projectionMatrix) {
+	Matrix4 camInverse = cameraMatrix.Inverse();
+	Vector3 nearVec, farVec;
+	unprojectPoint(x, yRes - y, 0.0, camInverse, projectionMatrix, viewportWidth, viewportHeight, &nearVec);
+	unprojectPoint(x, yRes - y, 1.0, camInverse, projectionMatrix, viewportWidth, viewportHeight, &farVec);
+	
+	Vector3 dirVec = farVec - nearVec;
+	dirVec.Normalize();
+	return dirVec;
+}
+
+Matrix4 NullRenderer::getProjectionMatrix() {
+	return projectionMatrix;
+}
+
+Matrix4 NullRenderer::getModelviewMatrix() {
+	return modelviewMatrix;
+}
+
+Vector3 NullRenderer::Unproject(Number x, Number y) {
+	Vector3 coords;
+	unprojectPoint(x, viewportHeight - y, 0.0, modelviewMatrix, projectionMatrix, viewportWidth, viewportHeight, &coords);
+	return coords;
+}
+
+int NullRenderer::getMatrixStackDepth() const {
+	return matrixStack.size();
+}
+
+RecordingRenderer::RecordingRenderer() : NullRenderer() {
+	recording = true;
+	maxMatrixDepth = 0;
+	lastFrameMaxMatrixDepth = 0;
+}
+
+RecordingRenderer::~RecordingRenderer() {
+}
+
+void RecordingRenderer::BeginRender() {
+	frameCommands.clear();
+	maxMatrixDepth = matrixStack.size();
+	NullRenderer::BeginRender();
+}
+
+void RecordingRenderer::EndRender() {
+	NullRenderer::EndRender();
+	lastFrameCommands.swap(frameCommands);
+	frameCommands.clear();
+	lastFrameMaxMatrixDepth = maxMatrixDepth;
+}
+
+void RecordingRenderer::logCommand(int type, int param, int value, unsigned int vertexCount, void *data) {
+	if(!recording)
+		return;
+	
+	RenderCommand command;
+	command.type = type;
+	command.param = param;
+	command.value = value;
+	command.vertexCount = vertexCount;
+	command.matrixDepth = matrixStack.size();
+	command.data = data;
+	frameCommands.push_back(command);
+	
+	if(command.matrixDepth > maxMatrixDepth)
+		maxMatrixDepth = command.matrixDepth;
+}
+
+const std::vector<RenderCommand> &RecordingRenderer::getFrameCommands() const {
+	return frameCommands;
+}
+
+const std::vector<RenderCommand> &RecordingRenderer::getLastFrameCommands() const {
+	return lastFrameCommands;
+}
+
+unsigned int RecordingRenderer::getLastFrameCommandCount(int type) const {
+	unsigned int count = 0;
+	for(int i=0; i < lastFrameCommands.size(); i++) {
+		if(lastFrameCommands[i].type == type)
+			count++;
+	}
+	return count;
+}
+
+int RecordingRenderer::getLastFrameMaxMatrixDepth() const {
+	return lastFrameMaxMatrixDepth;
+}
+
+void RecordingRenderer::dumpLastFrame() const {
+	static const char *commandNames[] = {"draw arrays", "draw vertex buffer", "state change", "set texture", "apply material", "clear shader", "push matrix", "pop matrix", "clear", "bind framebuffer", "unbind framebuffers"};
+	
+	Logger::log("Frame: %d commands, %d draw calls, %d vertices, %d state changes (%d redundant), %d texture binds, %d material changes\n", (int)lastFrameCommands.size(), lastFrameStats.drawCalls, lastFrameStats.verticesDrawn, lastFrameStats.stateChanges, lastFrameStats.redundantStateChanges, lastFrameStats.textureBinds, lastFrameStats.materialChanges);
+	for(int i=0; i < lastFrameCommands.size(); i++) {
+		const RenderCommand &command = lastFrameCommands[i];
+		Logger::log("%5d [%d] %s param=%d value=%d vertices=%d data=%p\n", i, command.matrixDepth, commandNames[command.type], command.param, command.value, command.vertexCount, command.data);
+	}
+}
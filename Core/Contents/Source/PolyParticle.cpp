@@ -21,132 +21,46 @@
 */
 
 #include "PolyParticle.h"
-#include "PolyMesh.h"
-#include "PolyPolygon.h"
-#include "PolySceneMesh.h"
-#include "PolyScreenShape.h"
 
 using namespace Polycode;
 
-Mesh *Particle::billboardMesh = 0;
+ParticleStore::ParticleStore() {
 
-Particle::Particle(int particleType, bool isScreenParticle, Material *material, Texture *texture, Mesh *particleMesh) {
-	life = 0;
-	if(isScreenParticle) {
-		createScreenParticle(particleType, texture, particleMesh);		
-	} else {
-		createSceneParticle(particleType, material, particleMesh);
-	}
-	
-	Reset(true);
 }
 
-void Particle::createSceneParticle(int particleType, Material *material, Mesh *particleMesh) {
-	switch(particleType) {
-		case BILLBOARD_PARTICLE:
-		{
-			if(!billboardMesh) {
-				billboardMesh = new Mesh(Mesh::QUAD_MESH);
-				
-				Polygon *imagePolygon = new Polygon();
-				imagePolygon->addVertex(0,1,0,0,0);	
-				imagePolygon->addVertex(1,1,0, 1, 0);			
-				imagePolygon->addVertex(1,0,0, 1, 1);		
-				imagePolygon->addVertex(0,0,0,0,1);
+ParticleStore::~ParticleStore() {
 
-				billboardMesh->addPolygon(imagePolygon);
-		
-		for(int i=0; i < billboardMesh->getPolygonCount(); i++) {
-			for(int j=0; j < billboardMesh->getPolygon(i)->getVertexCount(); j++) {
-				billboardMesh->getPolygon(i)->getVertex(j)->x = billboardMesh->getPolygon(i)->getVertex(j)->x - (1.0/2.0f);
-				billboardMesh->getPolygon(i)->getVertex(j)->z = billboardMesh->getPolygon(i)->getVertex(j)->z - (1.0/2.0f);
-			}
-		}
-
-		billboardMesh->calculateNormals();
-		billboardMesh->arrayDirtyMap[RenderDataArray::VERTEX_DATA_ARRAY] = true;		
-		billboardMesh->arrayDirtyMap[RenderDataArray::COLOR_DATA_ARRAY] = true;				
-		billboardMesh->arrayDirtyMap[RenderDataArray::TEXCOORD_DATA_ARRAY] = true;						
-		billboardMesh->arrayDirtyMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;					
-				
-			} 
-			SceneMesh *primitive = new SceneMesh(billboardMesh);
-			
-			primitive->setMaterial(material);
-			primitive->billboardMode = true;
-			primitive->billboardRoll = true;
-//			primitive->alphaTest = true;
-//			primitive->depthTest = false;
-			primitive->depthWrite = false;
-			primitive->backfaceCulled = false;
-			particleBody = primitive;			
-		}
-			break;
-		case MESH_PARTICLE: 
-		{
-			SceneMesh *primitive = new SceneMesh(particleMesh);
-			if(particleMesh->getMeshType() == Mesh::TRI_MESH)
-				primitive->cacheToVertexBuffer(true);
-			primitive->setMaterial(material);
-			//			primitive->billboardMode = true;
-			//			primitive->billboardRoll = true;
-			//primitive->depthTest = false;
-			//			primitive->backfaceCulled = false;
-			particleBody = primitive;						
-		}			
-		break;
-		default:
-			assert(0);
-		break;
-	}
 }
 
-void Particle::createScreenParticle(int particleType, Texture *texture, Mesh *particleMesh) {
-	
-	ScreenShape *primitive = new ScreenShape(ScreenShape::SHAPE_RECT, 1.0, 1.0f);
-	primitive->setTexture(texture);	
-//	primitive->billboardMode = true;
-//	primitive->billboardRoll = true;
-	
-	particleBody = primitive;			
-	return;
-	
-	switch(particleType) {
-		case BILLBOARD_PARTICLE:
-		{
-			ScreenShape *primitive = new ScreenShape(ScreenShape::SHAPE_RECT, 1.0f, 1.0f);
-//			primitive->setTexture(texture->get)
-			particleBody = primitive;			
-		}
-			break;
-		case MESH_PARTICLE: 
-		{
-//			ScreenMesh *primitive = new ScreenMesh(particleMesh);
-//			primitive->cacheToVertexBuffer(true);
-//			primitive->setMaterial(texture);
-//			particleBody = primitive;						
-		}			
-			break;
-	}	
+void ParticleStore::resize(unsigned int count) {
+	positionX.resize(count, 0.0f);
+	positionY.resize(count, 0.0f);
+	positionZ.resize(count, 0.0f);
+	velocityX.resize(count, 0.0f);
+	velocityY.resize(count, 0.0f);
+	velocityZ.resize(count, 0.0f);
+	life.resize(count, 0.0f);
+	lifespan.resize(count, 0.0f);
+	colorR.resize(count, 0.0f);
+	colorG.resize(count, 0.0f);
+	colorB.resize(count, 0.0f);
+	colorA.resize(count, 0.0f);
+	particleSize.resize(count, 0.0f);
+	rotation.resize(count, 0.0f);
+	brightnessDeviation.resize(count, 0.0f);
+	perlinPosX.resize(count, 0.0f);
+	perlinPosY.resize(count, 0.0f);
+	perlinPosZ.resize(count, 0.0f);
 }
 
-
-void Particle::Reset(bool continuious) {
-	if(continuious) {
-		if(life > lifespan)
-			life = 0 + (life - lifespan);
-		else
-			life = 0;
-	} else {
-			life = 0;		
-	}
-
-	perlinPosX = (Number)rand()/RAND_MAX;
-	perlinPosY = (Number)rand()/RAND_MAX;
-	perlinPosZ = (Number)rand()/RAND_MAX;
-	
+unsigned int ParticleStore::size() const {
+	return life.size();
 }
 
-Particle::~Particle() {
+Vector3 ParticleStore::getPosition(unsigned int index) const {
+	return Vector3(positionX[index], positionY[index], positionZ[index]);
+}
 
+Vector3 ParticleStore::getVelocity(unsigned int index) const {
+	return Vector3(velocityX[index], velocityY[index], velocityZ[index]);
 }
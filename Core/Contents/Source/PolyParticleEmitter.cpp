@@ -24,13 +24,16 @@
 #include "PolyCoreServices.h"
 #include "PolyParticle.h"
 #include "PolyPerlin.h"
+#include "PolyPolygon.h"
 #include "PolyResource.h"
 #include "PolyScene.h"
 #include "PolyScreen.h"
 #include "PolyTimer.h"
+#include "PolyMaterial.h"
 #include "PolyMaterialManager.h"
 #include "PolyResourceManager.h"
 #include "PolyScreenMesh.h"
+#include "PolyShader.h"
 #include "PolyRenderer.h"
 
 using namespace Polycode;
@@ -41,6 +44,9 @@ ParticleEmitter(materialName, particleMesh, particleType, emitterType, lifespan,
 {
 	isScreenEmitter = false;
 	emitterMesh = emitter;	
+	
+	// billboards are blended and should not occlude each other
+	particleDepthWrite = (particleType == Particle::MESH_PARTICLE);
 	createParticles();	
 	
 }
@@ -50,21 +56,17 @@ SceneParticleEmitter::~SceneParticleEmitter() {
 }
 
 void SceneParticleEmitter::respawnSceneParticles() {
+	Vector3 origin;
+	if(ParticleEmitter::ignoreParentMatrix) {
+		origin = getBaseMatrix().getPosition();
+	}
 	for(int i=0; i < particles.size(); i++) {
-		Particle *particle = particles[i];
-		removeChild((SceneEntity*)particle->particleBody);
-		addParticleBody(particle->particleBody);
-		resetParticle(particle);				
-		particle->life = lifespan * ((Number)rand()/RAND_MAX);		
+		spawnParticle(i, origin);
+		particles.life[i] = lifespan * ((Number)rand()/RAND_MAX);		
 	}
 	updateEmitter();
 }
 
-void SceneParticleEmitter::addParticleBody(Entity *particleBody) {
-	addEntity((SceneEntity*)particleBody);	
-	particleBody->editorOnly = true;
-}
-
 void SceneParticleEmitter::dispatchTriggerCompleteEvent() {
 	((EventDispatcher*)this)->dispatchEvent(new Event(Event::COMPLETE_EVENT), Event::COMPLETE_EVENT);
 }
@@ -76,8 +78,39 @@ Matrix4 SceneParticleEmitter::getBaseMatrix() {
 
 void SceneParticleEmitter::Update() {
 	updateEmitter();
+	
+	Vector3 extent(std::max(fabs(particleBoundsMin.x), fabs(particleBoundsMax.x)),
+				std::max(fabs(particleBoundsMin.y), fabs(particleBoundsMax.y)),
+				std::max(fabs(particleBoundsMin.z), fabs(particleBoundsMax.z)));
+	bBox = extent * 2;
+	bBoxRadius = extent.length();
 }
 
+void SceneParticleEmitter::Render() {
+	Vector3 right(1.0, 0.0, 0.0);
+	Vector3 up(0.0, 1.0, 0.0);
+	Vector3 facing(0.0, 0.0, 1.0);
+	
+	if(particleBillboardMode) {
+		// the camera axes in emitter space are the columns of the modelview rotation
+		Matrix4 modelview = renderer->getModelviewMatrix();
+		right = Vector3(modelview.m[0][0], modelview.m[1][0], modelview.m[2][0]);
+		up = Vector3(modelview.m[0][1], modelview.m[1][1], modelview.m[2][1]);
+		facing = Vector3(modelview.m[0][2], modelview.m[1][2], modelview.m[2][2]);
+		right.Normalize();
+		up.Normalize();
+		facing.Normalize();
+	}
+	
+	Matrix4 toLocal;
+	if(ParticleEmitter::ignoreParentMatrix) {
+		toLocal = getConcatenatedMatrix().Inverse();
+	}
+	
+	Color baseColor = getCombinedColor();
+	buildParticleStream(right, up, facing, baseColor, toLocal);
+	renderParticleStream(renderer, baseColor);
+}
 
 ScreenParticleEmitter::ScreenParticleEmitter(const String& imageFile, int particleType, int emitterType, Number lifespan, unsigned int numParticles, Vector3 direction, Vector3 gravity, Vector3 deviation, Vector3 emitterRadius, Mesh *particleMesh, ScreenMesh *emitter)
 		: ScreenEntity(),
@@ -86,14 +119,12 @@ ParticleEmitter(imageFile, particleMesh, particleType, emitterType, lifespan, nu
 	particleSize = 10.0; 
 	isScreenEmitter = true;
 	emitterMesh = emitter;	
+	particleDepthWrite = false;
+	particleDepthTest = false;
 	createParticles();
 }
 
 ScreenParticleEmitter::~ScreenParticleEmitter(){ 
-	for(int i=0;i < particles.size(); i++) {
-		removeChild((ScreenEntity*)particles[i]->particleBody);
-		delete particles[i];
-	}
 }
 
 Entity *ScreenParticleEmitter::Clone(bool deepClone, bool ignoreEditorOnly) const {
@@ -145,9 +176,20 @@ void ScreenParticleEmitter::Update() {
 	updateEmitter();
 }
 
-void ScreenParticleEmitter::addParticleBody(Entity *particleBody) {
-	addChild((ScreenEntity*)particleBody);
-	particleBody->editorOnly = true;	
+void ScreenParticleEmitter::Render() {
+	Matrix4 toLocal;
+	if(ParticleEmitter::ignoreParentMatrix) {
+		toLocal = getConcatenatedMatrix().Inverse();
+	}
+	
+	Color baseColor = getCombinedColor();
+	buildParticleStream(Vector3(1.0, 0.0, 0.0), Vector3(0.0, 1.0, 0.0), Vector3(0.0, 0.0, 1.0), baseColor, toLocal);
+	
+	// particles are laid out like children of the emitter
+	renderer->pushMatrix();
+	adjustMatrixForChildren();
+	renderParticleStream(renderer, baseColor);
+	renderer->popMatrix();
 }
 
 void ScreenParticleEmitter::dispatchTriggerCompleteEvent() {
@@ -181,6 +223,15 @@ ParticleEmitter::ParticleEmitter(const String& imageFile, Mesh *particleMesh, in
 	allAtOnce = false;
 	
 	blendingMode = Renderer::BLEND_MODE_NORMAL;
+	particleDepthWrite = true;
+	particleDepthTest = true;
+	particleAlphaTest = false;
+	particlesVisible = true;
+	particleBillboardMode = true;
+	
+	particleMaterial = NULL;
+	particleShaderBinding = NULL;
+	particleTexture = NULL;
 	
 	particleSize = 1.0;
 	
@@ -212,6 +263,20 @@ ParticleEmitter::ParticleEmitter(const String& imageFile, Mesh *particleMesh, in
 	
 	useColorCurves = false;
 	useScaleCurves = false;	
+	
+	streamMeshType = Mesh::QUAD_MESH;
+	streamVertexCount = 0;
+	int streamArrayTypes[4] = {RenderDataArray::VERTEX_DATA_ARRAY, RenderDataArray::COLOR_DATA_ARRAY, RenderDataArray::TEXCOORD_DATA_ARRAY, RenderDataArray::NORMAL_DATA_ARRAY};
+	int streamArraySizes[4] = {3, 4, 2, 3};
+	for(int i=0; i < 4; i++) {
+		streamArrays[i].arrayType = streamArrayTypes[i];
+		streamArrays[i].size = streamArraySizes[i];
+		streamArrays[i].stride = 0;
+		streamArrays[i].arrayPtr = NULL;
+		streamArrays[i].rendererData = NULL;
+		streamArrays[i].count = 0;
+		streamArrays[i].capacity = 0;
+	}
 }
 
 bool ParticleEmitter::getIgnoreParentMatrix() const {
@@ -220,9 +285,6 @@ bool ParticleEmitter::getIgnoreParentMatrix() const {
 
 void ParticleEmitter::setIgnoreParentMatrix(bool val) {
 	ignoreParentMatrix = val;
-	for(int i=0; i < particles.size(); i++) {
-		particles[i]->particleBody->ignoreParentMatrix = ignoreParentMatrix;
-	}
 }
 
 
@@ -232,41 +294,91 @@ Texture *ParticleEmitter::getParticleTexture() const {
 
 void ParticleEmitter::setParticleTexture(Texture *texture) {
 	particleTexture = texture;
-	for(int i=0; i < particles.size(); i++) {
-		((ScreenMesh*)particles[i]->particleBody)->setTexture(particleTexture);
-	}
 }
 			
 void ParticleEmitter::createParticles() {
 	
-	if(isScreenEmitter)
+	if(isScreenEmitter) {
 		particleTexture = CoreServices::getInstance()->getMaterialManager()->createTextureFromFile(textureFile);	
-	else
+	} else {
 		particleMaterial = (Material*)CoreServices::getInstance()->getResourceManager()->getResource(Resource::RESOURCE_MATERIAL, textureFile);	
+		if(particleMaterial && particleMaterial->getNumShaders() > 0) {
+			particleShaderBinding = particleMaterial->getShader(0)->createBinding();
+		}
+	}
+	
+	if(particleType == Particle::MESH_PARTICLE) {
+		buildMeshTemplate();
+	}
 	
+	Vector3 origin;
+	if(ignoreParentMatrix) {
+		origin = getBaseMatrix().getPosition();
+	}
 	
-	Particle *particle;	
+	particles.resize(numParticles);
 	for(int i=0; i < numParticles; i++) {
-		particle = new Particle(particleType, isScreenEmitter, particleMaterial, particleTexture, pMesh);
-		particle->particleBody->ignoreParentMatrix = ignoreParentMatrix;
-		particle->velVector = dirVector;
-		particle->dirVector = dirVector;
-		particle->deviation = deviation;
-		particle->lifespan = lifespan;
-		particles.push_back(particle);
-		addParticleBody(particle->particleBody);					
-		resetParticle(particle);
-		particle->life = lifespan * ((Number)rand()/RAND_MAX);		
+		spawnParticle(i, origin);
+		particles.life[i] = lifespan * ((Number)rand()/RAND_MAX);		
 	}
 	updateEmitter();	
 }
 
-void ParticleEmitter::dispatchTriggerCompleteEvent() {
+void ParticleEmitter::buildMeshTemplate() {
+	templatePositions.clear();
+	templateNormals.clear();
+	templateTexCoords.clear();
+	if(!pMesh)
+		return;
+	
+	// particle meshes are batched as triangle lists, faces are split into fans
+	if(pMesh->isIndexedMesh()) {
+		unsigned int faceSize = pMesh->getVerticesPerFace();
+		if(faceSize < 3)
+			return;
+		for(unsigned int face=0; face + faceSize <= pMesh->indexArray.size(); face += faceSize) {
+			for(unsigned int k=1; k+1 < faceSize; k++) {
+				unsigned int corners[3] = {pMesh->indexArray[face], pMesh->indexArray[face+k], pMesh->indexArray[face+k+1]};
+				for(int c=0; c < 3; c++) {
+					unsigned int v = corners[c];
+					templatePositions.push_back(pMesh->vertexPositionArray[(v*3)]);
+					templatePositions.push_back(pMesh->vertexPositionArray[(v*3)+1]);
+					templatePositions.push_back(pMesh->vertexPositionArray[(v*3)+2]);
+					templateNormals.push_back(pMesh->vertexNormalArray[(v*3)]);
+					templateNormals.push_back(pMesh->vertexNormalArray[(v*3)+1]);
+					templateNormals.push_back(pMesh->vertexNormalArray[(v*3)+2]);
+					templateTexCoords.push_back(pMesh->vertexTexCoordArray[(v*2)]);
+					templateTexCoords.push_back(pMesh->vertexTexCoordArray[(v*2)+1]);
+				}
+			}
+		}
+		return;
+	}
+	
+	for(int i=0; i < pMesh->getPolygonCount(); i++) {
+		Polygon *polygon = pMesh->getPolygon(i);
+		Vector3 faceNormal = polygon->getFaceNormal();
+		for(unsigned int k=1; k+1 < polygon->getVertexCount(); k++) {
+			unsigned int corners[3] = {0, k, k+1};
+			for(int c=0; c < 3; c++) {
+				Vertex *vertex = polygon->getVertex(corners[c]);
+				Vector3 normal = polygon->useVertexNormals ? vertex->normal : faceNormal;
+				templatePositions.push_back(vertex->x);
+				templatePositions.push_back(vertex->y);
+				templatePositions.push_back(vertex->z);
+				templateNormals.push_back(normal.x);
+				templateNormals.push_back(normal.y);
+				templateNormals.push_back(normal.z);
+				templateTexCoords.push_back(vertex->getTexCoord().x);
+				templateTexCoords.push_back(vertex->getTexCoord().y);
+			}
+		}
+	}
 }
 
-void ParticleEmitter::addParticleBody(Entity *particleBody) {
+void ParticleEmitter::dispatchTriggerCompleteEvent() {
 }
-			
+
 Matrix4 ParticleEmitter::getBaseMatrix() {
 	return Matrix4();
 }
@@ -280,16 +392,11 @@ void ParticleEmitter::setRotationSpeed(Number speed) {
 }
 
 void ParticleEmitter::setParticleVisibility(bool val) {
-	for(int i=0;i < particles.size(); i++) {
-		particles[i]->particleBody->visible = val;
-	}
+	particlesVisible = val;
 }
 
 void ParticleEmitter::setParticleBlendingMode(int mode) {
 	blendingMode = mode;
-	for(int i=0;i < particles.size(); i++) {
-		particles[i]->particleBody->setBlendingMode(mode);
-	}
 }
 
 int ParticleEmitter::getParticleBlendingMode() const {
@@ -297,28 +404,20 @@ int ParticleEmitter::getParticleBlendingMode() const {
 }
 
 void ParticleEmitter::setAlphaTest(bool val) {
-	for(int i=0;i < particles.size(); i++) {
-		particles[i]->particleBody->alphaTest = val;
-	}		
+	particleAlphaTest = val;
 }
 
 void ParticleEmitter::setDepthWrite(bool val) {
-	for(int i=0;i < particles.size(); i++) {
-		particles[i]->particleBody->depthWrite = val;
-	}	
+	particleDepthWrite = val;
 }
 
 void ParticleEmitter::setDepthTest(bool val) {
-	for(int i=0;i < particles.size(); i++) {
-		particles[i]->particleBody->depthTest= val;
-	}	
+	particleDepthTest = val;
 }
 
 
 void ParticleEmitter::setBillboardMode(bool mode) {
-	for(int i=0;i < particles.size(); i++) {
-		particles[i]->particleBody->billboardMode = mode;
-	}
+	particleBillboardMode = mode;
 }
 
 void ParticleEmitter::enablePerlin(bool val) {
@@ -326,32 +425,24 @@ void ParticleEmitter::enablePerlin(bool val) {
 }
 
 ParticleEmitter::~ParticleEmitter() {
-	
+	delete timer;
+	delete motionPerlin;
+	delete particleShaderBinding;
 }
 
 void ParticleEmitter::setParticleCount(int count) {
 	if(count > particles.size()) {
-		int oldSize  = count-particles.size();
-		Particle *particle;
-		for(int i=0; i  < oldSize; i++) {
-			particle = new Particle(particleType, isScreenEmitter, particleMaterial, particleTexture, pMesh);
-			particle->particleBody->ignoreParentMatrix = ignoreParentMatrix;
-			particle->velVector = dirVector;
-			particle->dirVector = dirVector;
-			particle->deviation = deviation;
-			particle->lifespan = lifespan;
-			particle->life = lifespan * ((Number)rand()/RAND_MAX);
-			particles.push_back(particle);
-			addParticleBody(particle->particleBody);
+		unsigned int oldSize = particles.size();
+		particles.resize(count);
+		Vector3 origin;
+		if(ignoreParentMatrix) {
+			origin = getBaseMatrix().getPosition();
+		}
+		for(unsigned int i=oldSize; i < count; i++) {
+			spawnParticle(i, origin);
 		}
 	}
 	numParticles = count;
-	for(int i=0; i < particles.size(); i++) {
-		if(i < numParticles)
-			particles[i]->particleBody->visible =true;
-		else
-			particles[i]->particleBody->visible = false;
-	}
 	resetAll();
 }
 
@@ -364,7 +455,7 @@ void ParticleEmitter::enableEmitter(bool val) {
 	isEmitterEnabled = val;
 	if(val) {
 		for(int i=0;i < numParticles; i++) {
-			particles[i]->life = particles[i]->lifespan * ((Number)rand()/RAND_MAX);
+			particles.life[i] = particles.lifespan[i] * ((Number)rand()/RAND_MAX);
 		}
 	}
 }
@@ -372,8 +463,12 @@ void ParticleEmitter::enableEmitter(bool val) {
 void ParticleEmitter::Trigger() {
 	if(!isEmitterEnabled)
 		return;
+	Vector3 origin;
+	if(ignoreParentMatrix) {
+		origin = getBaseMatrix().getPosition();
+	}
 	for(int i=0;i < numParticles; i++) {
-			resetParticle(particles[i]);
+		spawnParticle(i, origin);
 	}
 }
 
@@ -381,89 +476,64 @@ bool ParticleEmitter::emitterEnabled() {
 	return isEmitterEnabled;
 }
 
-void ParticleEmitter::resetParticle(Particle *particle) {
-//	particle->particleBody->visible = true;
-	particle->lifespan  = lifespan;
-	Matrix4 concatMatrix = getBaseMatrix();
-	
-	Vector3	startVector;
-	
-	Vector3 compoundScale(1.0, 1.0, 1.0);
+void ParticleEmitter::resetParticle(unsigned int index) {
+	if(index >= particles.size())
+		return;
+	Vector3 origin;
 	if(ignoreParentMatrix) {
-		compoundScale = getParticleCompoundScale();
+		origin = getBaseMatrix().getPosition();
 	}
+	spawnParticle(index, origin);
+}
+
+void ParticleEmitter::spawnParticle(unsigned int index, const Vector3 &origin) {
+	particles.lifespan[index] = lifespan;
 	
-	particle->dirVector = dirVector;
-//	if(emitterMesh) {
-//		Polygon *randPoly = emitterMesh->getMesh()->getPolygon(rand() % emitterMesh->getMesh()->getPolygonCount());		
-//		startVector = *randPoly->getVertex(rand() % 3);
-//		startVector = emitterMesh->getConcatenatedMatrix() * startVector;
-//	} else {
-		startVector = Vector3(-(emitterRadius.x/2.0f)+emitterRadius.x*((Number)rand()/RAND_MAX),-(emitterRadius.y/2.0f)+emitterRadius.y*((Number)rand()/RAND_MAX),-(emitterRadius.z/2.0f)+emitterRadius.z*((Number)rand()/RAND_MAX));	
-//	}
-		
+	if(emitterType != TRIGGERED_EMITTER && particles.life[index] > lifespan) {
+		particles.life[index] = particles.life[index] - lifespan;
+	} else {
+		particles.life[index] = 0;
+	}
 	
-	particle->Reset(emitterType != TRIGGERED_EMITTER);	
-	particle->velVector = particle->dirVector;
-	Number dev = ((deviation.x/2.0f)*-1.0f) + ((deviation.x)*((Number)rand()/RAND_MAX));
-	particle->velVector.x += dev;
-	dev = (deviation.y/2.0f*-1.0f) + ((deviation.y)*((Number)rand()/RAND_MAX));
-	particle->velVector.y += dev;
-	dev = (deviation.z/2.0f*-1.0f) + ((deviation.z)*((Number)rand()/RAND_MAX));
-	particle->velVector.z += dev;
+	particles.perlinPosX[index] = (Number)rand()/RAND_MAX;
+	particles.perlinPosY[index] = (Number)rand()/RAND_MAX;
+	particles.perlinPosZ[index] = (Number)rand()/RAND_MAX;
 	
-	particle->brightnessDeviation = 1.0f - ( (-brightnessDeviation) + ((brightnessDeviation*2) * ((Number)rand()/RAND_MAX)));
+	particles.positionX[index] = origin.x - (emitterRadius.x/2.0f) + emitterRadius.x*((Number)rand()/RAND_MAX);
+	particles.positionY[index] = origin.y - (emitterRadius.y/2.0f) + emitterRadius.y*((Number)rand()/RAND_MAX);
+	particles.positionZ[index] = origin.z - (emitterRadius.z/2.0f) + emitterRadius.z*((Number)rand()/RAND_MAX);
 	
-//	particle->velVector = concatMatrix.rotateVector(particle->velVector);	
-
-	if(ignoreParentMatrix) {
-		particle->particleBody->setPosition(concatMatrix.getPosition());
-	} else {
-		particle->particleBody->setPosition(0.0, 0.0, 0.0);
-	}
+	particles.velocityX[index] = dirVector.x - (deviation.x/2.0f) + (deviation.x*((Number)rand()/RAND_MAX));
+	particles.velocityY[index] = dirVector.y - (deviation.y/2.0f) + (deviation.y*((Number)rand()/RAND_MAX));
+	particles.velocityZ[index] = dirVector.z - (deviation.z/2.0f) + (deviation.z*((Number)rand()/RAND_MAX));
 	
-	particle->particleBody->Translate(startVector);
-	particle->particleBody->rebuildTransformMatrix();	
+	particles.brightnessDeviation[index] = 1.0f - ( (-brightnessDeviation) + ((brightnessDeviation*2) * ((Number)rand()/RAND_MAX)));
 	
 	if(useScaleCurves) {
-		particle->particleBody->setScale(scaleCurve.getHeightAt(0) * particleSize * compoundScale.x,
-									 scaleCurve.getHeightAt(0) * particleSize * compoundScale.y,
-									 scaleCurve.getHeightAt(0) * particleSize * compoundScale.z);
+		particles.particleSize[index] = scaleCurve.getHeightAt(0) * particleSize;
 	} else {
-		particle->particleBody->setScale(particleSize  * compoundScale.x, particleSize * compoundScale.y, particleSize * compoundScale.z);
+		particles.particleSize[index] = particleSize;
 	}
 	
 	if(useColorCurves) {
-		particle->particleBody->color.setColor(colorCurveR.getHeightAt(0),
-										   colorCurveG.getHeightAt(0),
-										   colorCurveB.getHeightAt(0),
-										   colorCurveA.getHeightAt(0));
+		particles.colorR[index] = colorCurveR.getHeightAt(0);
+		particles.colorG[index] = colorCurveG.getHeightAt(0);
+		particles.colorB[index] = colorCurveB.getHeightAt(0);
+		particles.colorA[index] = colorCurveA.getHeightAt(0);
 	} else {
-		particle->particleBody->color.setColor(1.0, 1.0, 1.0, 1.0);
+		particles.colorR[index] = 1.0;
+		particles.colorG[index] = 1.0;
+		particles.colorB[index] = 1.0;
+		particles.colorA[index] = 1.0;
 	}
-	
-			
-}
-
-Vector3 ScreenParticleEmitter::getParticleCompoundScale() {
-	return getCompoundScale();
-}
-
-Vector3 SceneParticleEmitter::getParticleCompoundScale() {
-	return getCompoundScale();
-}
-
-
-Vector3 ParticleEmitter::getParticleCompoundScale() {
-	return Vector3();
 }
 			
 void ParticleEmitter::resetAll() {
 	for(int i=0;i < particles.size(); i++) {
 		if(allAtOnce)
-			particles[i]->life = 0;
+			particles.life[i] = 0;
 		else
-			particles[i]->life = particles[i]->lifespan * ((Number)rand()/RAND_MAX);
+			particles.life[i] = particles.lifespan[i] * ((Number)rand()/RAND_MAX);
 	}
 }
 
@@ -476,99 +546,306 @@ unsigned int ParticleEmitter::getNumParticles() const {
 	return numParticles;
 }
 
-Particle *ParticleEmitter::getParticleAtIndex(unsigned int index) const {
-	if(index < particles.size()) {
-		return particles[index];
-	} else {
-		return NULL;
-	}
+ParticleStore *ParticleEmitter::getParticleStore() {
+	return &particles;
 }
 
-
 void ParticleEmitter::updateEmitter() {	
 	
-	Vector3 translationVector;
 	Number elapsed = timer->getElapsedf();
+	unsigned int count = numParticles;
+	if(count > particles.size())
+		count = particles.size();
+	if(count == 0)
+		return;
 	
-	Particle *particle;
-	Number normLife;
+	float step = elapsed * particleSpeedMod;
+	float gravityX = gravVector.x * step;
+	float gravityY = gravVector.y * step;
+	float gravityZ = gravVector.z * step;
+	float moveZ = isScreenEmitter ? 0.0f : step;
 	
-	Vector3 compoundScale(1.0, 1.0, 1.0);
-	if(ignoreParentMatrix) {
-		compoundScale = getParticleCompoundScale();
+	float *positionX = &particles.positionX[0];
+	float *positionY = &particles.positionY[0];
+	float *positionZ = &particles.positionZ[0];
+	float *velocityX = &particles.velocityX[0];
+	float *velocityY = &particles.velocityY[0];
+	float *velocityZ = &particles.velocityZ[0];
+	float *life = &particles.life[0];
+	float *particleLifespan = &particles.lifespan[0];
+	
+	for(unsigned int i=0; i < count; i++) {
+		life[i] += elapsed;
+		velocityX[i] -= gravityX;
+		velocityY[i] -= gravityY;
+		velocityZ[i] -= gravityZ;
+		positionX[i] += velocityX[i] * step;
+		positionY[i] += velocityY[i] * step;
+		positionZ[i] += velocityZ[i] * moveZ;
 	}
 	
-	for(int i=0;i < numParticles; i++) {	
-		particle = particles[i];
-		
-		normLife = particle->life / particle->lifespan;
-		Vector3 gVec = gravVector;
-		particle->life += elapsed;
-		particle->velVector -= gVec*elapsed*particleSpeedMod;
-		translationVector = particle->velVector;
-		translationVector = translationVector*elapsed*particleSpeedMod;
-		if(perlinEnabled) {
-			translationVector.x += ((perlinModSize * motionPerlin->Get((particle->life/particle->lifespan), particle->perlinPosX))*elapsed*particleSpeedMod);
-			translationVector.y += ((perlinModSize * motionPerlin->Get((particle->life/particle->lifespan), particle->perlinPosY))*elapsed*particleSpeedMod);
-			translationVector.z += ((perlinModSize * motionPerlin->Get((particle->life/particle->lifespan), particle->perlinPosZ))*elapsed*particleSpeedMod);
+	if(perlinEnabled) {
+		float perlinStep = perlinModSize * step;
+		for(unsigned int i=0; i < count; i++) {
+			Number normLife = life[i] / particleLifespan[i];
+			positionX[i] += motionPerlin->Get(normLife, particles.perlinPosX[i]) * perlinStep;
+			positionY[i] += motionPerlin->Get(normLife, particles.perlinPosY[i]) * perlinStep;
+			if(!isScreenEmitter) {
+				positionZ[i] += motionPerlin->Get(normLife, particles.perlinPosZ[i]) * perlinStep;
+			}
+		}
+	}
+	
+	if(!rotationFollowsPath) {
+		float *rotation = &particles.rotation[0];
+		float rotationStep = rotationSpeed * elapsed;
+		for(unsigned int i=0; i < count; i++) {
+			rotation[i] += rotationStep;
+		}
+	}
+	
+	float *brightness = &particles.brightnessDeviation[0];
+	float *colorR = &particles.colorR[0];
+	float *colorG = &particles.colorG[0];
+	float *colorB = &particles.colorB[0];
+	float *colorA = &particles.colorA[0];
+	if(useColorCurves) {
+		for(unsigned int i=0; i < count; i++) {
+			Number normLife = life[i] / particleLifespan[i];
+			colorR[i] = colorCurveR.getHeightAt(normLife) * brightness[i];
+			colorG[i] = colorCurveG.getHeightAt(normLife) * brightness[i];
+			colorB[i] = colorCurveB.getHeightAt(normLife) * brightness[i];
+			colorA[i] = colorCurveA.getHeightAt(normLife) * brightness[i];
+		}
+	} else {
+		for(unsigned int i=0; i < count; i++) {
+			colorR[i] = brightness[i];
+			colorG[i] = brightness[i];
+			colorB[i] = brightness[i];
+			colorA[i] = 1.0f;
+		}
+	}
+	
+	float *size = &particles.particleSize[0];
+	if(useScaleCurves) {
+		for(unsigned int i=0; i < count; i++) {
+			size[i] = scaleCurve.getHeightAt(life[i] / particleLifespan[i]) * particleSize;
+		}
+	} else {
+		for(unsigned int i=0; i < count; i++) {
+			size[i] = particleSize;
+		}
+	}
+	
+	if(isEmitterEnabled && emitterType == CONTINUOUS_EMITTER) {
+		bool haveOrigin = false;
+		Vector3 origin;
+		for(unsigned int i=0; i < count; i++) {
+			if(life[i] > particleLifespan[i]) {
+				if(!haveOrigin && ignoreParentMatrix) {
+					origin = getBaseMatrix().getPosition();
+				}
+				haveOrigin = true;
+				spawnParticle(i, origin);
+			}
+		}
+	}
+	
+	updateParticleBounds();
+}
+
+void ParticleEmitter::updateParticleBounds() {
+	unsigned int count = std::min((unsigned int)particles.size(), numParticles);
+	if(count == 0) {
+		particleBoundsMin = Vector3();
+		particleBoundsMax = Vector3();
+		return;
+	}
+	
+	float minX = particles.positionX[0], maxX = minX;
+	float minY = particles.positionY[0], maxY = minY;
+	float minZ = particles.positionZ[0], maxZ = minZ;
+	float maxSize = 0.0f;
+	for(unsigned int i=0; i < count; i++) {
+		minX = std::min(minX, particles.positionX[i]);
+		maxX = std::max(maxX, particles.positionX[i]);
+		minY = std::min(minY, particles.positionY[i]);
+		maxY = std::max(maxY, particles.positionY[i]);
+		minZ = std::min(minZ, particles.positionZ[i]);
+		maxZ = std::max(maxZ, particles.positionZ[i]);
+		maxSize = std::max(maxSize, particles.particleSize[i]);
+	}
+	
+	// grow by the largest particle, rotated either way
+	float templateRadius = 0.70710678f;
+	if(particleType == Particle::MESH_PARTICLE) {
+		templateRadius = 0.0f;
+		for(unsigned int i=0; i+2 < templatePositions.size(); i += 3) {
+			float radius = sqrtf(templatePositions[i]*templatePositions[i] + templatePositions[i+1]*templatePositions[i+1] + templatePositions[i+2]*templatePositions[i+2]);
+			templateRadius = std::max(templateRadius, radius);
 		}
+	}
+	float pad = maxSize * templateRadius;
+	particleBoundsMin = Vector3(minX - pad, minY - pad, minZ - pad);
+	particleBoundsMax = Vector3(maxX + pad, maxY + pad, maxZ + pad);
+}
+
+void ParticleEmitter::buildParticleStream(const Vector3 &right, const Vector3 &up, const Vector3 &facing, const Color &baseColor, const Matrix4 &toLocal) {
+	unsigned int count = std::min((unsigned int)particles.size(), numParticles);
+	
+	bool meshParticles = (particleType == Particle::MESH_PARTICLE);
+	unsigned int verticesPerParticle = meshParticles ? templatePositions.size() / 3 : 4;
+	int meshType = meshParticles ? Mesh::TRI_MESH : Mesh::QUAD_MESH;
+	unsigned int vertexCount = count * verticesPerParticle;
+	
+	// texture coordinates only depend on the layout, so they are only
+	// written when the stream grows or changes type
+	if(streamPositions.size() < vertexCount * 3 || streamMeshType != meshType) {
+		streamMeshType = meshType;
+		streamPositions.resize(vertexCount * 3);
+		streamColors.resize(vertexCount * 4);
+		streamNormals.resize(vertexCount * 3);
+		streamTexCoords.resize(vertexCount * 2);
 		
-		if(isScreenEmitter) {		
-			translationVector.z = 0;
+		unsigned int capacity = streamPositions.size() / 3 / (verticesPerParticle > 0 ? verticesPerParticle : 1);
+		float *texCoords = streamTexCoords.size() > 0 ? &streamTexCoords[0] : NULL;
+		for(unsigned int i=0; i < capacity; i++) {
+			if(meshParticles) {
+				for(unsigned int v=0; v < templateTexCoords.size(); v++) {
+					*texCoords++ = templateTexCoords[v];
+				}
+			} else {
+				*texCoords++ = 0.0f; *texCoords++ = 1.0f;
+				*texCoords++ = 1.0f; *texCoords++ = 1.0f;
+				*texCoords++ = 1.0f; *texCoords++ = 0.0f;
+				*texCoords++ = 0.0f; *texCoords++ = 0.0f;
+			}
+		}
+	}
+	streamVertexCount = vertexCount;
+	if(vertexCount == 0)
+		return;
+	
+	float *positions = &streamPositions[0];
+	float *colors = &streamColors[0];
+	float *normals = &streamNormals[0];
+	
+	for(unsigned int i=0; i < count; i++) {
+		Vector3 center(particles.positionX[i], particles.positionY[i], particles.positionZ[i]);
+		if(ignoreParentMatrix) {
+			center = toLocal * center;
 		}
+		Vector3 velocity(particles.velocityX[i], particles.velocityY[i], particles.velocityZ[i]);
 		
-		particle->particleBody->Translate(translationVector);
+		float r = particles.colorR[i] * baseColor.r;
+		float g = particles.colorG[i] * baseColor.g;
+		float b = particles.colorB[i] * baseColor.b;
+		float a = particles.colorA[i] * baseColor.a;
+		for(unsigned int v=0; v < verticesPerParticle; v++) {
+			*colors++ = r;
+			*colors++ = g;
+			*colors++ = b;
+			*colors++ = a;
+		}
 		
+		Number size = particles.particleSize[i];
 		
-		if(rotationFollowsPath)  {
-			if(isScreenEmitter) {
-				Number angle = atan2(translationVector.x, translationVector.y);
-				particle->particleBody->setRoll(360 - ((angle * TODEGREES)+180));
-			
+		if(meshParticles) {
+			Matrix4 rotationMatrix;
+			if(rotationFollowsPath && velocity.length() > 0.0) {
+				Vector3 zAxis = velocity;
+				zAxis.Normalize();
+				Vector3 xAxis = Vector3(1.0, 0.0, 0.0).crossProduct(zAxis);
+				if(xAxis.length() < 0.0001) {
+					xAxis = Vector3(0.0, 1.0, 0.0).crossProduct(zAxis);
+				}
+				xAxis.Normalize();
+				Vector3 yAxis = zAxis.crossProduct(xAxis);
+				rotationMatrix = Matrix4(xAxis.x, xAxis.y, xAxis.z, 0.0,
+										yAxis.x, yAxis.y, yAxis.z, 0.0,
+										zAxis.x, zAxis.y, zAxis.z, 0.0,
+										0.0, 0.0, 0.0, 1.0);
 			} else {
-				particle->particleBody->lookAt(particle->particleBody->getPosition() + translationVector, Vector3(1,0,0));			
+				Quaternion rotationQuat;
+				rotationQuat.fromAxes(particles.rotation[i], particles.rotation[i], particles.rotation[i]);
+				rotationMatrix = rotationQuat.createMatrix();
 			}
-		} else {
-			if(isScreenEmitter) {
-				particle->particleBody->Roll(rotationSpeed*elapsed);
-			} else {
-				particle->particleBody->Roll(rotationSpeed*elapsed);
-				particle->particleBody->Pitch(rotationSpeed*elapsed);
-				particle->particleBody->Yaw(rotationSpeed*elapsed);						
+			
+			Matrix4::transformDirections(rotationMatrix, &templateNormals[0], normals, verticesPerParticle);
+			
+			// scale the rotation rows by the particle size and move to its center
+			for(int r=0; r < 3; r++) {
+				rotationMatrix.m[r][0] *= size;
+				rotationMatrix.m[r][1] *= size;
+				rotationMatrix.m[r][2] *= size;
 			}
-		}		
-		
-//		if(isScreenEmitter)
-//			particle->particleBody->setPositionZ(0);		
-		
-		if(useColorCurves) {
-			particle->particleBody->color.setColor(colorCurveR.getHeightAt(normLife)*particle->brightnessDeviation,
-											   colorCurveG.getHeightAt(normLife)*particle->brightnessDeviation,
-											   colorCurveB.getHeightAt(normLife)*particle->brightnessDeviation,
-											   colorCurveA.getHeightAt(normLife)*particle->brightnessDeviation);
-		} else {
-			particle->particleBody->color.setColor(particle->brightnessDeviation,
-											   particle->brightnessDeviation,
-											   particle->brightnessDeviation,
-											   1.0);		
-		}
-	
-		if(useScaleCurves) {
-			particle->particleBody->setScale(scaleCurve.getHeightAt(normLife) * particleSize * compoundScale.x,
-										 scaleCurve.getHeightAt(normLife) * particleSize * compoundScale.y,
-										 scaleCurve.getHeightAt(normLife) * particleSize * compoundScale.z);
-		
-		} else {
-			particle->particleBody->setScale(particleSize*compoundScale.x, particleSize*compoundScale.y, particleSize*compoundScale.z);
+			rotationMatrix.setPosition(center.x, center.y, center.z);
+			Matrix4::transformPositions(rotationMatrix, &templatePositions[0], positions, verticesPerParticle);
+			
+			positions += verticesPerParticle * 3;
+			normals += verticesPerParticle * 3;
+			continue;
 		}
 		
-		if(particle->life > particle->lifespan && isEmitterEnabled) {
-			if(emitterType == CONTINUOUS_EMITTER) {
-				resetParticle(particle);
+		Number angle = particles.rotation[i];
+		if(rotationFollowsPath) {
+			if(isScreenEmitter) {
+				angle = 360 - ((atan2(velocity.x, velocity.y) * TODEGREES) + 180);
 			} else {
-			//	dispatchTriggerCompleteEvent();
-//				particle->particleBody->visible = false;
+				angle = atan2(velocity.dot(up), velocity.dot(right)) * TODEGREES;
 			}
 		}
+		Number halfSize = size * 0.5;
+		Number c = cos(angle * TORADIANS) * halfSize;
+		Number s = sin(angle * TORADIANS) * halfSize;
+		Vector3 cornerX = (right * c) + (up * s);
+		Vector3 cornerY = (up * c) - (right * s);
+		
+		Vector3 corners[4] = {center - cornerX - cornerY, center + cornerX - cornerY, center + cornerX + cornerY, center - cornerX + cornerY};
+		for(int v=0; v < 4; v++) {
+			*positions++ = corners[v].x;
+			*positions++ = corners[v].y;
+			*positions++ = corners[v].z;
+			*normals++ = facing.x;
+			*normals++ = facing.y;
+			*normals++ = facing.z;
+		}
+	}
+}
+
+void ParticleEmitter::renderParticleStream(Renderer *renderer, const Color &baseColor) {
+	if(!particlesVisible || streamVertexCount == 0 || !renderer)
+		return;
+	
+	streamArrays[0].arrayPtr = &streamPositions[0];
+	streamArrays[1].arrayPtr = &streamColors[0];
+	streamArrays[2].arrayPtr = &streamTexCoords[0];
+	streamArrays[3].arrayPtr = &streamNormals[0];
+	for(int i=0; i < 4; i++) {
+		streamArrays[i].count = streamVertexCount;
+	}
+	
+	renderer->setBlendingMode(blendingMode);
+	renderer->enableDepthWrite(particleDepthWrite);
+	renderer->enableDepthTest(particleDepthTest);
+	renderer->enableAlphaTest(particleAlphaTest);
+	renderer->enableBackfaceCulling(particleType == Particle::MESH_PARTICLE);
+	
+	if(particleMaterial) {
+		renderer->applyMaterial(particleMaterial, particleShaderBinding, 0);
+	} else {
+		renderer->setTexture(particleTexture);
+	}
+	
+	renderer->pushRenderDataArray(&streamArrays[0]);
+	renderer->pushRenderDataArray(&streamArrays[1]);
+	renderer->pushRenderDataArray(&streamArrays[2]);
+	if(!isScreenEmitter) {
+		renderer->pushRenderDataArray(&streamArrays[3]);
+	}
+	renderer->drawArrays(streamMeshType);
+	
+	if(particleMaterial) {
+		renderer->clearShader();
 	}
 }
@@ -58,6 +58,7 @@ void PeerConnection::ackPackets(unsigned int ack) {
 }
 
 Peer::~Peer() {
+	delete updateTimer;
 	delete socket;
 }
 
@@ -0,0 +1,312 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+#include "PolyProfiler.h"
+#include "PolyCoreServices.h"
+#include <stdio.h>
+#include <string.h>
+#include <map>
+
+#if defined(_WINDOWS)
+#include <windows.h>
+#elif defined(__APPLE__) && defined(__MACH__)
+#include <mach/mach_time.h>
+#else
+#include <time.h>
+#endif
+
+using namespace Polycode;
+
+static void appendEscaped(std::string &out, const char *str) {
+	for(const char *c = str; *c; c++) {
+		if(*c == '"' || *c == '\\')
+			out += '\\';
+		out += *c;
+	}
+}
+
+Profiler::Profiler() {
+	enabled = false;
+	frameNumber = 0;
+	setFrameCapacity(300);
+}
+
+Profiler::~Profiler() {
+}
+
+double Profiler::getMicroseconds() {
+#if defined(_WINDOWS)
+	static LARGE_INTEGER frequency;
+	if(frequency.QuadPart == 0)
+		QueryPerformanceFrequency(&frequency);
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return ((double)counter.QuadPart * 1000000.0) / (double)frequency.QuadPart;
+#elif defined(__APPLE__) && defined(__MACH__)
+	static mach_timebase_info_data_t timebase;
+	if(timebase.denom == 0)
+		mach_timebase_info(&timebase);
+	return ((double)mach_absolute_time() * (double)timebase.numer / (double)timebase.denom) / 1000.0;
+#else
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return ((double)now.tv_sec * 1000000.0) + ((double)now.tv_nsec / 1000.0);
+#endif
+}
+
+void Profiler::setEnabled(bool enabled) {
+	if(enabled && !this->enabled) {
+		clear();
+	}
+	this->enabled = enabled;
+	openZones.clear();
+}
+
+void Profiler::setFrameCapacity(int frameCount) {
+	if(frameCount < 1)
+		frameCount = 1;
+	frameCapacity = frameCount;
+	// one extra slot for the frame being recorded
+	frames.clear();
+	frames.resize(frameCapacity + 1);
+	clear();
+}
+
+void Profiler::clear() {
+	currentFrame = -1;
+	completedFrames = 0;
+	frameNumber = 0;
+	openZones.clear();
+}
+
+void Profiler::newFrame() {
+	if(!enabled)
+		return;
+	
+	double now = getMicroseconds();
+	
+	if(currentFrame >= 0) {
+		ProfilerFrame &frame = frames[currentFrame];
+		// zones still open at the end of the frame are cut off there
+		while(openZones.size() > 0) {
+			ProfilerZoneRecord &zone = frame.zones[openZones.back()];
+			zone.duration = now - zone.startTime;
+			openZones.pop_back();
+		}
+		frame.duration = now - frame.startTime;
+		if(completedFrames < frameCapacity)
+			completedFrames++;
+	}
+	
+	currentFrame = (currentFrame + 1) % frames.size();
+	ProfilerFrame &frame = frames[currentFrame];
+	frame.zones.clear();
+	frame.frameNumber = frameNumber++;
+	frame.startTime = now;
+	frame.duration = 0;
+}
+
+void Profiler::beginZone(const char *name) {
+	if(!enabled || currentFrame < 0)
+		return;
+	
+	ProfilerFrame &frame = frames[currentFrame];
+	ProfilerZoneRecord zone;
+	zone.name = name;
+	zone.depth = openZones.size();
+	zone.duration = 0;
+	zone.startTime = getMicroseconds();
+	openZones.push_back(frame.zones.size());
+	frame.zones.push_back(zone);
+}
+
+void Profiler::beginNamedZone(const String &name) {
+	// keep a single copy of every name, so zones can point to it
+	std::set<std::string>::iterator it = zoneNames.insert(name.getSTLString()).first;
+	beginZone(it->c_str());
+}
+
+void Profiler::endZone() {
+	if(!enabled || openZones.size() == 0)
+		return;
+	
+	ProfilerZoneRecord &zone = frames[currentFrame].zones[openZones.back()];
+	zone.duration = getMicroseconds() - zone.startTime;
+	openZones.pop_back();
+}
+
+int Profiler::getFrameCount() const {
+	return completedFrames;
+}
+
+const ProfilerFrame *Profiler::getFrame(int index) const {
+	if(index < 0 || index >= completedFrames)
+		return NULL;
+	int size = frames.size();
+	int first = (currentFrame - completedFrames + size) % size;
+	return &frames[(first + index) % size];
+}
+
+Number Profiler::getAverageFrameTime() const {
+	if(completedFrames == 0)
+		return 0;
+	double total = 0;
+	for(int i=0; i < completedFrames; i++) {
+		total += getFrame(i)->duration;
+	}
+	return (total / completedFrames) / 1000.0;
+}
+
+Number Profiler::getMaxFrameTime() const {
+	double maxTime = 0;
+	for(int i=0; i < completedFrames; i++) {
+		if(getFrame(i)->duration > maxTime)
+			maxTime = getFrame(i)->duration;
+	}
+	return maxTime / 1000.0;
+}
+
+void Profiler::collectZoneTime(const String &name, double *totalTime, double *maxTime, double *calls) const {
+	*totalTime = 0;
+	*maxTime = 0;
+	*calls = 0;
+	for(int i=0; i < completedFrames; i++) {
+		const ProfilerFrame *frame = getFrame(i);
+		double frameTime = 0;
+		for(int j=0; j < frame->zones.size(); j++) {
+			if(strcmp(name.c_str(), frame->zones[j].name) == 0) {
+				frameTime += frame->zones[j].duration;
+				(*calls)++;
+			}
+		}
+		*totalTime += frameTime;
+		if(frameTime > *maxTime)
+			*maxTime = frameTime;
+	}
+}
+
+Number Profiler::getAverageZoneTime(const String &name) const {
+	if(completedFrames == 0)
+		return 0;
+	double totalTime, maxTime, calls;
+	collectZoneTime(name, &totalTime, &maxTime, &calls);
+	return (totalTime / completedFrames) / 1000.0;
+}
+
+Number Profiler::getMaxZoneTime(const String &name) const {
+	double totalTime, maxTime, calls;
+	collectZoneTime(name, &totalTime, &maxTime, &calls);
+	return maxTime / 1000.0;
+}
+
+Number Profiler::getAverageZoneCount(const String &name) const {
+	if(completedFrames == 0)
+		return 0;
+	double totalTime, maxTime, calls;
+	collectZoneTime(name, &totalTime, &maxTime, &calls);
+	return calls / completedFrames;
+}
+
+String Profiler::getSummary() const {
+	// zone names in the order they were first entered, with their nesting depth
+	std::vector<String> names;
+	std::vector<int> depths;
+	std::map<std::string, int> nameIndices;
+	for(int i=0; i < completedFrames; i++) {
+		const ProfilerFrame *frame = getFrame(i);
+		for(int j=0; j < frame->zones.size(); j++) {
+			std::string name = frame->zones[j].name;
+			if(nameIndices.find(name) == nameIndices.end()) {
+				nameIndices[name] = names.size();
+				names.push_back(String(name));
+				depths.push_back(frame->zones[j].depth);
+			}
+		}
+	}
+	
+	char line[512];
+	std::string summary;
+	snprintf(line, sizeof(line), "%d frames, average %.3f ms, max %.3f ms\n", completedFrames, getAverageFrameTime(), getMaxFrameTime());
+	summary += line;
+	snprintf(line, sizeof(line), "%-48s %10s %10s %8s\n", "zone", "avg ms", "max ms", "calls");
+	summary += line;
+	
+	for(int i=0; i < names.size(); i++) {
+		double totalTime, maxTime, calls;
+		collectZoneTime(names[i], &totalTime, &maxTime, &calls);
+		std::string indentedName = std::string(depths[i] * 2, ' ') + names[i].getSTLString();
+		snprintf(line, sizeof(line), "%-48s %10.3f %10.3f %8.1f\n", indentedName.c_str(), (totalTime / completedFrames) / 1000.0, maxTime / 1000.0, calls / completedFrames);
+		summary += line;
+	}
+	return String(summary);
+}
+
+String Profiler::getChromeTrace() const {
+	std::string trace = "{\"traceEvents\":[";
+	char event[256];
+	bool firstEvent = true;
+	
+	double baseTime = 0;
+	if(completedFrames > 0)
+		baseTime = getFrame(0)->startTime;
+	
+	for(int i=0; i < completedFrames; i++) {
+		const ProfilerFrame *frame = getFrame(i);
+		snprintf(event, sizeof(event), "%s\n{\"name\":\"Frame %u\",\"cat\":\"frame\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}", firstEvent ? "" : ",", frame->frameNumber, frame->startTime - baseTime, frame->duration);
+		trace += event;
+		firstEvent = false;
+		
+		for(int j=0; j < frame->zones.size(); j++) {
+			const ProfilerZoneRecord &zone = frame->zones[j];
+			trace += ",\n{\"name\":\"";
+			appendEscaped(trace, zone.name);
+			snprintf(event, sizeof(event), "\",\"cat\":\"zone\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}", zone.startTime - baseTime, zone.duration);
+			trace += event;
+		}
+	}
+	trace += "\n],\"displayTimeUnit\":\"ms\"}\n";
+	return String(trace);
+}
+
+bool Profiler::saveChromeTrace(const String &fileName) const {
+	FILE *file = fopen(fileName.c_str(), "wb");
+	if(!file)
+		return false;
+	String trace = getChromeTrace();
+	size_t written = fwrite(trace.c_str(), 1, trace.length(), file);
+	fclose(file);
+	return written == trace.length();
+}
+
+ProfilerZone::ProfilerZone(const char *name) {
+	profiler = CoreServices::getInstance()->getProfiler();
+	if(profiler->isEnabled()) {
+		profiler->beginZone(name);
+	} else {
+		profiler = NULL;
+	}
+}
+
+ProfilerZone::~ProfilerZone() {
+	if(profiler)
+		profiler->endZone();
+}
@@ -45,6 +45,24 @@ void Quaternion::createFromAxisAngle(Number ax, Number ay, Number az, Number deg
 Matrix4 Quaternion::createMatrix() const
 {
 	Matrix4 m;
+#if defined(POLYCODE_MATH_SSE)
+	// each row is identity + a*b + c*d, with the signs folded into constants whose last lane clears w
+	__m128 q = _mm_setr_ps(x, y, z, w);
+	__m128 q2 = _mm_add_ps(q, q);
+	
+	__m128 row0 = _mm_mul_ps(_mm_mul_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(0,0,0,1)), _mm_setr_ps(-1.0f, 1.0f, 1.0f, 0.0f)), _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(0,2,1,1)));
+	row0 = _mm_add_ps(row0, _mm_mul_ps(_mm_mul_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(0,3,3,2)), _mm_setr_ps(-1.0f, 1.0f, -1.0f, 0.0f)), _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(0,1,2,2))));
+	
+	__m128 row1 = _mm_mul_ps(_mm_mul_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(0,1,0,0)), _mm_setr_ps(1.0f, -1.0f, 1.0f, 0.0f)), _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(0,2,0,1)));
+	row1 = _mm_add_ps(row1, _mm_mul_ps(_mm_mul_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(0,3,2,3)), _mm_setr_ps(-1.0f, -1.0f, 1.0f, 0.0f)), _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(0,0,2,2))));
+	
+	__m128 row2 = _mm_mul_ps(_mm_mul_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(0,0,1,0)), _mm_setr_ps(1.0f, 1.0f, -1.0f, 0.0f)), _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(0,0,2,2)));
+	row2 = _mm_add_ps(row2, _mm_mul_ps(_mm_mul_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(0,1,3,3)), _mm_setr_ps(1.0f, -1.0f, -1.0f, 0.0f)), _mm_shuffle_ps(q2, q2, _MM_SHUFFLE(0,1,0,1))));
+	
+	_mm_storeu_ps(m.ml, _mm_add_ps(row0, _mm_setr_ps(1.0f, 0.0f, 0.0f, 0.0f)));
+	_mm_storeu_ps(m.ml+4, _mm_add_ps(row1, _mm_setr_ps(0.0f, 1.0f, 0.0f, 0.0f)));
+	_mm_storeu_ps(m.ml+8, _mm_add_ps(row2, _mm_setr_ps(0.0f, 0.0f, 1.0f, 0.0f)));
+#else
         Number fTx  = 2.0*x;
         Number fTy  = 2.0*y;
         Number fTz  = 2.0*z;
@@ -67,6 +85,7 @@ Matrix4 Quaternion::createMatrix() const
         m[0][2] = fTxz-fTwy;
         m[1][2] = fTyz+fTwx;
         m[2][2] = 1.0-(fTxx+fTyy);	
+#endif
 	return m;
 }
 
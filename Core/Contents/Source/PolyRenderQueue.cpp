@@ -0,0 +1,168 @@
+/*
+ Copyright (C) 2011 by Ivan Safrin
+ 
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+ 
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+ 
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+
+#include "PolyRenderQueue.h"
+#include "PolyEntity.h"
+#include "PolyMaterial.h"
+#include "PolyRenderer.h"
+#include <algorithm>
+
+using namespace Polycode;
+
+RenderQueue::RenderQueue() {
+	sortingEnabled = true;
+	itemCount = 0;
+}
+
+RenderQueue::~RenderQueue() {
+}
+
+void RenderQueue::clear() {
+	// items are kept allocated between frames
+	itemCount = 0;
+}
+
+unsigned int RenderQueue::getItemCount() const {
+	return itemCount;
+}
+
+void RenderQueue::addEntity(Entity *entity, Renderer *renderer) {
+	if(itemCount == items.size()) {
+		items.push_back(RenderQueueItem());
+	}
+	RenderQueueItem &item = items[itemCount];
+	
+	item.entity = entity;
+	item.modelviewMatrix = renderer->getModelviewMatrix();
+	item.modelMatrix = renderer->getCurrentModelMatrix();
+	item.color = entity->getCombinedColor();
+	item.blendingMode = entity->blendingMode;
+	item.depthWrite = entity->depthWrite;
+	item.depthTest = entity->depthTest;
+	item.alphaTest = entity->alphaTest;
+	item.backfaceCulled = entity->backfaceCulled;
+	item.depthOnly = entity->depthOnly;
+	item.renderMode = renderer->getRenderMode();
+	item.scissorEnabled = renderer->isScissorEnabled();
+	item.scissorBox = renderer->getScissorBox();
+	
+	item.material = entity->getRenderMaterial();
+	item.texture = entity->getRenderTexture();
+	item.shader = item.material ? item.material->getShader(0) : NULL;
+	
+	// the camera looks down -z, so view space depth is the negated z translation
+	item.depth = -item.modelviewMatrix.m[3][2];
+	item.sequence = itemCount;
+	
+	int materialBlendingMode = item.material ? item.material->blendingMode : Renderer::BLEND_MODE_NORMAL;
+	if(item.depthOnly) {
+		item.pass = PASS_DEPTH_ONLY;
+	} else if(!item.depthTest) {
+		item.pass = PASS_OVERLAY;
+	} else if(!item.depthWrite || item.color.a < 1.0 || item.blendingMode != Renderer::BLEND_MODE_NORMAL || materialBlendingMode != Renderer::BLEND_MODE_NORMAL) {
+		item.pass = PASS_TRANSPARENT;
+	} else {
+		item.pass = PASS_OPAQUE;
+	}
+	
+	itemCount++;
+}
+
+bool RenderQueue::compareItems(const RenderQueueItem *a, const RenderQueueItem *b) {
+	if(a->pass != b->pass)
+		return a->pass < b->pass;
+	
+	switch(a->pass) {
+		case PASS_OPAQUE:
+		case PASS_DEPTH_ONLY:
+			if(a->shader != b->shader)
+				return std::less<Shader*>()(a->shader, b->shader);
+			if(a->material != b->material)
+				return std::less<Material*>()(a->material, b->material);
+			if(a->texture != b->texture)
+				return std::less<Texture*>()(a->texture, b->texture);
+			if(a->depth != b->depth)
+				return a->depth < b->depth;
+		break;
+		case PASS_TRANSPARENT:
+			if(a->depth != b->depth)
+				return a->depth > b->depth;
+		break;
+	}
+	return a->sequence < b->sequence;
+}
+
+void RenderQueue::render(Renderer *renderer) {
+	sortedItems.resize(itemCount);
+	for(unsigned int i=0; i < itemCount; i++) {
+		sortedItems[i] = &items[i];
+	}
+	if(sortingEnabled) {
+		std::sort(sortedItems.begin(), sortedItems.end(), compareItems);
+	}
+	
+	bool oldScissorEnabled = renderer->isScissorEnabled();
+	Polycode::Rectangle oldScissorBox = renderer->getScissorBox();
+	int oldRenderMode = renderer->getRenderMode();
+	
+	renderer->pushMatrix();
+	for(unsigned int i=0; i < itemCount; i++) {
+		RenderQueueItem *item = sortedItems[i];
+		
+		renderer->setModelviewMatrix(item->modelviewMatrix);
+		renderer->setCurrentModelMatrix(item->modelMatrix);
+		
+		// the renderer drops state changes that are already in effect
+		renderer->enableDepthWrite(item->depthWrite);
+		renderer->enableDepthTest(item->depthTest);
+		renderer->enableAlphaTest(item->alphaTest);
+		renderer->setBlendingMode(item->blendingMode);
+		renderer->enableBackfaceCulling(item->backfaceCulled);
+		renderer->setRenderMode(item->renderMode);
+		renderer->setVertexColor(item->color.r, item->color.g, item->color.b, item->color.a);
+		
+		if(item->scissorEnabled != renderer->isScissorEnabled()) {
+			renderer->enableScissor(item->scissorEnabled);
+		}
+		if(item->scissorEnabled) {
+			renderer->setScissorBox(item->scissorBox);
+		}
+		
+		if(item->depthOnly) {
+			renderer->drawToColorBuffer(false);
+		}
+		
+		item->entity->Render();
+		
+		if(item->depthOnly) {
+			renderer->drawToColorBuffer(true);
+		}
+	}
+	renderer->popMatrix();
+	
+	renderer->enableDepthWrite(true);
+	renderer->setRenderMode(oldRenderMode);
+	renderer->enableScissor(oldScissorEnabled);
+	renderer->setScissorBox(oldScissorBox);
+	
+	clear();
+}
@@ -25,6 +25,19 @@
 
 using namespace Polycode;
 
+RenderStats::RenderStats() {
+	reset();
+}
+
+void RenderStats::reset() {
+	drawCalls = 0;
+	verticesDrawn = 0;
+	stateChanges = 0;
+	redundantStateChanges = 0;
+	textureBinds = 0;
+	materialChanges = 0;
+}
+
 Renderer::Renderer() : clearColor(0.2f, 0.2f, 0.2f, 0.0), currentTexture(NULL), renderMode(0), lightingEnabled(false), orthoMode(false), xRes(0), yRes(0) {
 	anisotropy = 0;
 	textureFilteringMode = TEX_FILTERING_LINEAR;
@@ -46,6 +59,9 @@ Renderer::Renderer() : clearColor(0.2f, 0.2f, 0.2f, 0.0), currentTexture(NULL),
 	blendNormalAsPremultiplied = false;
 	
 	doClearBuffer = true;
+	cullingCamera = NULL;
+	renderQueue = NULL;
+	invalidateRenderStates();
 }
 
 Renderer::~Renderer() {
@@ -286,6 +302,55 @@ const Matrix4& Renderer::getCameraMatrix() const {
 	return cameraMatrix;
 }
 
+void Renderer::setCullingCamera(Camera *camera) {
+	cullingCamera = camera;
+}
+
+Camera *Renderer::getCullingCamera() const {
+	return cullingCamera;
+}
+
+void Renderer::setRenderQueue(RenderQueue *queue) {
+	renderQueue = queue;
+}
+
+RenderQueue *Renderer::getRenderQueue() const {
+	return renderQueue;
+}
+
+const RenderStats &Renderer::getFrameStats() const {
+	return frameStats;
+}
+
+const RenderStats &Renderer::getLastFrameStats() const {
+	return lastFrameStats;
+}
+
+void Renderer::beginFrameStats() {
+	frameStats.reset();
+}
+
+void Renderer::endFrameStats() {
+	lastFrameStats = frameStats;
+}
+
+void Renderer::invalidateRenderStates() {
+	for(int i=0; i < RENDER_STATE_COUNT; i++) {
+		renderStateValid[i] = false;
+	}
+}
+
+bool Renderer::changeRenderState(int state, int value) {
+	if(renderStateValid[state] && renderStateValues[state] == value) {
+		frameStats.redundantStateChanges++;
+		return false;
+	}
+	renderStateValues[state] = value;
+	renderStateValid[state] = true;
+	frameStats.stateChanges++;
+	return true;
+}
+
 void Renderer::setCameraPosition(Vector3 pos) {
 	cameraPosition = pos;
 	pos = pos * -1;
@@ -363,16 +428,172 @@ void Renderer::setRendererShaderParams(Shader *shader, ShaderBinding *binding) {
 	}
 }
 
+void Renderer::updateRenderDataArraysForMesh(Mesh *mesh, bool *updateMap) {
+	for(int i=0; i < 16; i++) {
+		if(!updateMap[i])
+			continue;
+		if(mesh->renderDataArrays[i] != NULL) {
+			free(mesh->renderDataArrays[i]->arrayPtr);
+			delete mesh->renderDataArrays[i];
+		}
+		mesh->renderDataArrays[i] = createRenderDataArrayForMesh(mesh, i);
+	}
+}
+
 void Renderer::pushDataArrayForMesh(Mesh *mesh, int arrayType) {
 	if(mesh->arrayDirtyMap[arrayType] == true || mesh->renderDataArrays[arrayType] == NULL) {
-		if(mesh->renderDataArrays[arrayType] != NULL) {
-			free(mesh->renderDataArrays[arrayType]->arrayPtr);
-			delete mesh->renderDataArrays[arrayType];
+		// rebuild every other stale array of the mesh along with this one, so
+		// that the vertex data only has to be walked once
+		bool updateMap[16];
+		for(int i=0; i < 16; i++) {
+			updateMap[i] = (i == arrayType) || (mesh->arrayDirtyMap[i] && mesh->renderDataArrays[i] != NULL);
+		}
+		updateRenderDataArraysForMesh(mesh, updateMap);
+		for(int i=0; i < 16; i++) {
+			if(updateMap[i])
+				mesh->arrayDirtyMap[i] = false;
 		}
-		mesh->renderDataArrays[arrayType] = createRenderDataArrayForMesh(mesh, arrayType);
-		mesh->arrayDirtyMap[arrayType] = false;
 	}
 	pushRenderDataArray(mesh->renderDataArrays[arrayType]);
+	
+	// indexed meshes carry their index array along with the vertex positions
+	if(arrayType == RenderDataArray::VERTEX_DATA_ARRAY && mesh->isIndexedMesh()) {
+		pushDataArrayForMesh(mesh, RenderDataArray::INDEX_DATA_ARRAY);
+	}
+}
+
+static void *reserveRenderDataArray(RenderDataArray *array, unsigned int bytes) {
+	if(bytes > array->capacity) {
+		array->arrayPtr = realloc(array->arrayPtr, bytes);
+		array->capacity = bytes;
+	}
+	return array->arrayPtr;
+}
+
+static void copyIndexedRenderData(RenderDataArray *array, const std::vector<float> &source, unsigned int vertexCount) {
+	array->count = vertexCount;
+	reserveRenderDataArray(array, source.size() * sizeof(float));
+	if(source.size() > 0) {
+		memcpy(array->arrayPtr, &source[0], source.size() * sizeof(float));
+	}
+}
+
+void Renderer::fillRenderDataArrays(Mesh *mesh, RenderDataArray **arrays, bool *updateMap) {
+	
+	if(mesh->isIndexedMesh()) {
+		unsigned int vertexCount = mesh->getVertexCount();
+		if(updateMap[RenderDataArray::VERTEX_DATA_ARRAY])
+			copyIndexedRenderData(arrays[RenderDataArray::VERTEX_DATA_ARRAY], mesh->vertexPositionArray, vertexCount);
+		if(updateMap[RenderDataArray::COLOR_DATA_ARRAY])
+			copyIndexedRenderData(arrays[RenderDataArray::COLOR_DATA_ARRAY], mesh->vertexColorArray, vertexCount);
+		if(updateMap[RenderDataArray::NORMAL_DATA_ARRAY])
+			copyIndexedRenderData(arrays[RenderDataArray::NORMAL_DATA_ARRAY], mesh->vertexNormalArray, vertexCount);
+		if(updateMap[RenderDataArray::TANGENT_DATA_ARRAY])
+			copyIndexedRenderData(arrays[RenderDataArray::TANGENT_DATA_ARRAY], mesh->vertexTangentArray, vertexCount);
+		if(updateMap[RenderDataArray::TEXCOORD_DATA_ARRAY])
+			copyIndexedRenderData(arrays[RenderDataArray::TEXCOORD_DATA_ARRAY], mesh->vertexTexCoordArray, vertexCount);
+		
+		if(updateMap[RenderDataArray::INDEX_DATA_ARRAY]) {
+			RenderDataArray *array = arrays[RenderDataArray::INDEX_DATA_ARRAY];
+			unsigned int indexCount = mesh->getIndexCount();
+			array->size = mesh->getIndexSize();
+			array->count = indexCount;
+			reserveRenderDataArray(array, indexCount * array->size);
+			if(array->size == 2) {
+				unsigned short *indices = (unsigned short*)array->arrayPtr;
+				for(int i=0; i < indexCount; i++) {
+					indices[i] = mesh->indexArray[i];
+				}
+			} else if(indexCount > 0) {
+				memcpy(array->arrayPtr, &mesh->indexArray[0], indexCount * sizeof(unsigned int));
+			}
+		}
+		return;
+	}
+	
+	// count the vertices once, so every array can be sized up front
+	unsigned int polygonCount = mesh->getPolygonCount();
+	unsigned int vertexCount = 0;
+	for(int i=0; i < polygonCount; i++) {
+		vertexCount += mesh->getPolygon(i)->getVertexCount();
+	}
+	
+	float *positions = NULL;
+	float *colors = NULL;
+	float *normals = NULL;
+	float *tangents = NULL;
+	float *texCoords = NULL;
+	
+	for(int i=0; i < RenderDataArray::INDEX_DATA_ARRAY; i++) {
+		if(!updateMap[i])
+			continue;
+		RenderDataArray *array = arrays[i];
+		array->count = vertexCount;
+		float *buffer = (float*)reserveRenderDataArray(array, vertexCount * array->size * sizeof(float));
+		switch(i) {
+			case RenderDataArray::VERTEX_DATA_ARRAY:
+				positions = buffer;
+			break;
+			case RenderDataArray::COLOR_DATA_ARRAY:
+				colors = buffer;
+			break;
+			case RenderDataArray::NORMAL_DATA_ARRAY:
+				normals = buffer;
+			break;
+			case RenderDataArray::TANGENT_DATA_ARRAY:
+				tangents = buffer;
+			break;
+			case RenderDataArray::TEXCOORD_DATA_ARRAY:
+				texCoords = buffer;
+			break;
+		}
+	}
+	
+	// fill all requested attributes in a single pass over the polygons
+	for(int i=0; i < polygonCount; i++) {
+		Polygon *polygon = mesh->getPolygon(i);
+		unsigned int polygonVertexCount = polygon->getVertexCount();
+		Vector3 faceNormal;
+		if(normals && !polygon->useVertexNormals) {
+			faceNormal = polygon->getFaceNormal();
+		}
+		
+		for(int j=0; j < polygonVertexCount; j++) {
+			Vertex *vertex = polygon->getVertex(j);
+			if(positions) {
+				*positions++ = vertex->x;
+				*positions++ = vertex->y;
+				*positions++ = vertex->z;
+			}
+			if(colors) {
+				*colors++ = vertex->vertexColor.r;
+				*colors++ = vertex->vertexColor.g;
+				*colors++ = vertex->vertexColor.b;
+				*colors++ = vertex->vertexColor.a;
+			}
+			if(normals) {
+				if(polygon->useVertexNormals) {
+					*normals++ = vertex->normal.x;
+					*normals++ = vertex->normal.y;
+					*normals++ = vertex->normal.z;
+				} else {
+					*normals++ = faceNormal.x;
+					*normals++ = faceNormal.y;
+					*normals++ = faceNormal.z;
+				}
+			}
+			if(tangents) {
+				*tangents++ = vertex->tangent.x;
+				*tangents++ = vertex->tangent.y;
+				*tangents++ = vertex->tangent.z;
+			}
+			if(texCoords) {
+				Vector2 texCoord = vertex->getTexCoord();
+				*texCoords++ = texCoord.x;
+				*texCoords++ = texCoord.y;
+			}
+		}
+	}
 }
 
 int Renderer::getXRes() {
@@ -28,6 +28,7 @@ using namespace Polycode;
 
 Resource::Resource(int type) : EventDispatcher() {
 	this->type = type;
+	resourceIndex = -1;
 	reloadOnFileModify = false;
 	resourceFileTime = 0;
 }
@@ -49,11 +50,25 @@ int Resource::getResourceType() const {
 }
 
 void Resource::setResourceName(const String& newName) {
+	if(resourceIndex < 0) {
+		name = newName;
+		return;
+	}
+	ResourceManager *resourceManager = CoreServices::getInstance()->getResourceManager();
+	resourceManager->unindexResource(this);
 	name = newName;
+	resourceManager->indexResource(this);
 }
 
 void Resource::setResourcePath(const String& path) {
+	if(resourceIndex < 0) {
+		resourcePath = path;
+		return;
+	}
+	ResourceManager *resourceManager = CoreServices::getInstance()->getResourceManager();
+	resourceManager->unindexResource(this);
 	resourcePath = path;
+	resourceManager->indexResource(this);
 }
 
 const String& Resource::getResourcePath() const {
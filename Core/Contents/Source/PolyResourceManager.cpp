@@ -21,11 +21,13 @@
 */
 
 #include "PolyResourceManager.h"
+#include "PolyAssetLoader.h"
 #include "PolyCoreServices.h"
 #include "PolyCubemap.h"
 #include "PolyMaterialManager.h"
 #include "PolyModule.h"
 #include "PolyFontManager.h"
+#include "PolyImage.h"
 #include "PolyLogger.h"
 #include "PolyMaterial.h"
 #include "PolyShader.h"
@@ -34,6 +36,12 @@
 
 #include "physfs.h"
 #include "tinyxml.h"
+#include <algorithm>
+
+#if defined(__linux__)
+	#include <sys/inotify.h>
+	#include <unistd.h>
+#endif
 
 using std::vector;
 using namespace Polycode;
@@ -42,31 +50,31 @@ ResourceManager::ResourceManager() {
 	PHYSFS_init(NULL);
 	ticksSinceCheck = 0;
 	reloadResourcesOnModify = false;
+	logLookups = false;
+	watchDescriptor = -1;
+	watchFailed = false;
 }
 
 ResourceManager::~ResourceManager() {
 		printf("Shutting down resource manager...\n");
+		stopWatching();
 		PHYSFS_deinit();
 		
-		for(int i=0; i < resources.size(); i++)	{
-			if(resources[i]->getResourceType() == Resource::RESOURCE_MATERIAL) {
-				delete resources[i];
+		// deleting a resource removes it from the list, so each type is collected first
+		int deleteTypes[] = {Resource::RESOURCE_MATERIAL, Resource::RESOURCE_SHADER, Resource::RESOURCE_PROGRAM};
+		for(int t=0; t < 3; t++) {
+			std::vector<Resource*> typeResources = getResources(deleteTypes[t]);
+			for(int i=0; i < typeResources.size(); i++) {
+				delete typeResources[i];
 			}
 		}
 		
-		for(int i=0; i < resources.size(); i++)	{
-			if(resources[i]->getResourceType() == Resource::RESOURCE_SHADER) {
-				delete resources[i];
-			}
-		}
-
-		for(int i=0; i < resources.size(); i++)	{
-			if(resources[i]->getResourceType() == Resource::RESOURCE_PROGRAM) {
-				delete resources[i];
-			}
+		for(int i=0; i < resources.size(); i++) {
+			resources[i]->resourceIndex = -1;
 		}
-		
 		resources.clear();
+		nameIndex.clear();
+		pathIndex.clear();
 }
 
 void ResourceManager::parseShaders(const String& dirPath, bool recursive) {
@@ -160,26 +168,67 @@ void ResourceManager::parseCubemaps(const String& dirPath, bool recursive) {
 }
 
 bool ResourceManager::hasResource(Resource *resource) {
-	for(int i=0; i < resources.size(); i++) {
-		if(resources[i] == resource) {
-			return true;
+	return resource->resourceIndex >= 0 && resource->resourceIndex < resources.size() && resources[resource->resourceIndex] == resource;
+}
+
+unsigned int ResourceManager::hashKey(int resourceType, const String& key) {
+	// FNV-1a
+	unsigned int hash = 2166136261u ^ (unsigned int)resourceType;
+	const char *str = key.c_str();
+	for(int i=0; str[i] != 0; i++) {
+		hash ^= (unsigned char)str[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+void ResourceManager::indexResource(Resource *resource) {
+	nameIndex.insert(std::pair<unsigned int, Resource*>(hashKey(resource->getResourceType(), resource->getResourceName()), resource));
+	pathIndex.insert(std::pair<unsigned int, Resource*>(hashKey(0, resource->getResourcePath()), resource));
+	if(watchDescriptor >= 0)
+		watchResource(resource);
+}
+
+void ResourceManager::unindexResource(Resource *resource) {
+	std::pair<std::multimap<unsigned int, Resource*>::iterator, std::multimap<unsigned int, Resource*>::iterator> range;
+	range = nameIndex.equal_range(hashKey(resource->getResourceType(), resource->getResourceName()));
+	for(std::multimap<unsigned int, Resource*>::iterator it = range.first; it != range.second; ++it) {
+		if(it->second == resource) {
+			nameIndex.erase(it);
+			break;
+		}
+	}
+	range = pathIndex.equal_range(hashKey(0, resource->getResourcePath()));
+	for(std::multimap<unsigned int, Resource*>::iterator it = range.first; it != range.second; ++it) {
+		if(it->second == resource) {
+			pathIndex.erase(it);
+			break;
 		}
 	}
-	return false;
+	if(watchDescriptor >= 0)
+		unwatchResource(resource);
 }
 
 void ResourceManager::addResource(Resource *resource) {
-	resources.push_back(resource);
 	resource->resourceFileTime = OSBasics::getFileTime(resource->getResourcePath());
+	if(hasResource(resource))
+		return;
+	resource->resourceIndex = resources.size();
+	resources.push_back(resource);
+	indexResource(resource);
 }
 
 void ResourceManager::removeResource(Resource *resource) {
-	for(int i=0;i<resources.size();i++) {
-		if(resources[i] == resource) {
-			resources.erase(resources.begin()+i);
-			return;
-		}
-	}	
+	if(!hasResource(resource))
+		return;
+	unindexResource(resource);
+	
+	// move the last resource into the freed slot
+	int index = resource->resourceIndex;
+	resources[index] = resources[resources.size()-1];
+	resources[index]->resourceIndex = index;
+	resources.pop_back();
+	resource->resourceIndex = -1;
 }
 
 
@@ -245,39 +294,173 @@ void ResourceManager::removeArchive(const String& path) {
 }
 
 
+void ResourceManager::collectDirEntries(const String& dirPath, bool recursive, const String& basePath, vector<OSFileEntry> &files, vector<String> &basePaths) {
+	vector<OSFileEntry> resourceDir;
+	resourceDir = OSBasics::parseFolder(dirPath, false);
+	for(int i=0; i < resourceDir.size(); i++) {	
+		if(resourceDir[i].type == OSFileEntry::TYPE_FILE) {
+			files.push_back(resourceDir[i]);
+			basePaths.push_back(basePath);
+		} else {
+			if(recursive) {
+				if(basePath == "") {
+					collectDirEntries(dirPath+"/"+resourceDir[i].name, true, resourceDir[i].name, files, basePaths);
+				} else {
+					collectDirEntries(dirPath+"/"+resourceDir[i].name, true, basePath+"/"+resourceDir[i].name, files, basePaths);
+				}
+			}
+		}
+	}
+}
+
 void ResourceManager::addDirResource(const String& dirPath, bool recursive) {
-	parseTextures(dirPath, recursive, "");
-	parsePrograms(dirPath, recursive);
-	parseShaders(dirPath, recursive);
-	parseCubemaps(dirPath, recursive);	
-	parseMaterials(dirPath, recursive);
-	parseOthers(dirPath, recursive);	
+	MaterialManager *materialManager = CoreServices::getInstance()->getMaterialManager();
+	AssetLoader *assetLoader = CoreServices::getInstance()->getAssetLoader();
+	
+	// scan the directory tree once
+	vector<OSFileEntry> files;
+	vector<String> basePaths;
+	collectDirEntries(dirPath, recursive, "", files, basePaths);
+	
+	// read and decode each image and material file once, in parallel
+	vector<AssetRequest*> textureRequests;
+	vector<int> textureFiles;
+	vector<AssetRequest*> materialRequests;
+	vector<AssetRequest*> batch;
+	
+	for(int i=0; i < files.size(); i++) {
+		if(files[i].extension == "png") {
+			AssetRequest *request = new AssetRequest(AssetRequest::ASSET_TEXTURE, files[i].fullPath);
+			request->premultiplyAlpha = materialManager->premultiplyAlphaOnLoad;
+			request->createMipmaps = materialManager->mipmapsDefault;
+			textureRequests.push_back(request);
+			textureFiles.push_back(i);
+			if(!materialManager->getTextureByResourcePath(files[i].fullPath))
+				batch.push_back(request);
+		} else if(files[i].extension == "mat") {
+			AssetRequest *request = new AssetRequest(AssetRequest::ASSET_MATERIALS, files[i].fullPath);
+			materialRequests.push_back(request);
+			batch.push_back(request);
+		}
+	}
+	
+	assetLoader->decodeBatch(batch);
+	
+	// create the resources in dependency order: textures and programs first, then the shaders, cubemaps and materials that use them
+	for(int i=0; i < textureRequests.size(); i++) {
+		OSFileEntry &entry = files[textureFiles[i]];
+		Logger::log("Adding texture %s\n", entry.nameWithoutExtension.c_str());
+		Texture *t = materialManager->getTextureByResourcePath(entry.fullPath);
+		if(!t) {
+			Image *image = textureRequests[i]->getDecodedImage();
+			if(!image) {
+				Logger::log("Error loading image (\"%s\").\n", entry.fullPath.c_str());
+				continue;
+			}
+			t = materialManager->createTextureFromImage(image, materialManager->clampDefault, materialManager->mipmapsDefault);
+		}
+		if(basePaths[textureFiles[i]] == "") {
+			t->setResourceName(entry.name);
+		} else {
+			t->setResourceName(basePaths[textureFiles[i]]+"/"+entry.name);
+		}
+		t->setResourcePath(entry.fullPath);
+		addResource(t);
+	}
+	
+	for(int i=0; i < files.size(); i++) {
+		ShaderProgram *newProgram = materialManager->createProgramFromFile(files[i].fullPath);
+		if(newProgram) {
+			newProgram->setResourceName(files[i].name);
+			newProgram->setResourcePath(files[i].fullPath);
+			addResource(newProgram);
+		}
+	}
+	
+	for(int i=0; i < materialRequests.size(); i++) {
+		TiXmlDocument *document = materialRequests[i]->getDecodedDocument();
+		if(!document)
+			continue;
+		std::vector<Shader*> shaders = materialManager->shadersFromXMLDocument(document);
+		for(int s=0; s < shaders.size(); s++) {
+			addResource(shaders[s]);
+			materialManager->addShader(shaders[s]);
+		}
+	}
+	
+	for(int i=0; i < materialRequests.size(); i++) {
+		TiXmlDocument *document = materialRequests[i]->getDecodedDocument();
+		if(!document)
+			continue;
+		std::vector<Cubemap*> cubemaps = materialManager->cubemapsFromXMLDocument(document);
+		for(int c=0; c < cubemaps.size(); c++) {
+			addResource(cubemaps[c]);
+		}
+	}
+	
+	for(int i=0; i < materialRequests.size(); i++) {
+		TiXmlDocument *document = materialRequests[i]->getDecodedDocument();
+		if(!document)
+			continue;
+		std::vector<Material*> materials = materialManager->materialsFromXMLDocument(document);
+		for(int m=0; m < materials.size(); m++) {
+			materials[m]->setResourceName(materials[m]->getName());
+			addResource(materials[m]);
+			materialManager->addMaterial(materials[m]);
+		}
+	}
+	
+	for(int i=0; i < files.size(); i++) {
+		if(files[i].extension == "ttf") {
+			Logger::log("Registering font: %s\n", files[i].nameWithoutExtension.c_str());
+			CoreServices::getInstance()->getFontManager()->registerFont(files[i].nameWithoutExtension, files[i].fullPath);
+		}
+	}
+	
+	for(int i=0; i < textureRequests.size(); i++) {
+		delete textureRequests[i];
+	}
+	for(int i=0; i < materialRequests.size(); i++) {
+		delete materialRequests[i];
+	}
 }
 
 Resource *ResourceManager::getResourceByPath(const String& resourcePath) const {
-	Logger::log("requested %s\n", resourcePath.c_str());
-	for(int i =0; i < resources.size(); i++) {
-		if(resources[i]->getResourcePath() == resourcePath) {
-			return resources[i];
+	if(logLookups)
+		Logger::log("requested %s\n", resourcePath.c_str());
+	
+	std::pair<std::multimap<unsigned int, Resource*>::const_iterator, std::multimap<unsigned int, Resource*>::const_iterator> range;
+	range = pathIndex.equal_range(hashKey(0, resourcePath));
+	for(std::multimap<unsigned int, Resource*>::const_iterator it = range.first; it != range.second; ++it) {
+		if(it->second->getResourcePath() == resourcePath) {
+			return it->second;
 		}
 	}
-	Logger::log("return NULL\n");	
+	
+	if(logLookups)
+		Logger::log("return NULL\n");	
 	return NULL;
 }
 
 Resource *ResourceManager::getResource(int resourceType, const String& resourceName) const {
-	Logger::log("requested %s\n", resourceName.c_str());
-	for(int i =0; i < resources.size(); i++) {
-		if(resources[i]->getResourceName() == resourceName && resources[i]->getResourceType() == resourceType) {
-			return resources[i];
+	if(logLookups)
+		Logger::log("requested %s\n", resourceName.c_str());
+	
+	std::pair<std::multimap<unsigned int, Resource*>::const_iterator, std::multimap<unsigned int, Resource*>::const_iterator> range;
+	range = nameIndex.equal_range(hashKey(resourceType, resourceName));
+	for(std::multimap<unsigned int, Resource*>::const_iterator it = range.first; it != range.second; ++it) {
+		if(it->second->getResourceType() == resourceType && it->second->getResourceName() == resourceName) {
+			return it->second;
 		}
 	}
 	
 	if(resourceType == Resource::RESOURCE_TEXTURE && resourceName != "default/default.png") {
-		Logger::log("Texture not found, using default\n");
+		if(logLookups)
+			Logger::log("Texture not found, using default\n");
 		return getResource(Resource::RESOURCE_TEXTURE, "default/default.png");
 	}	
-	Logger::log("return NULL\n");
+	if(logLookups)
+		Logger::log("return NULL\n");
 	// need to add some sort of default resource for each type
 	return NULL;
 }
@@ -295,10 +478,142 @@ void ResourceManager::checkForChangedFiles() {
 	}
 }
 
-void ResourceManager::Update(int elapsed) {
-	if(!reloadResourcesOnModify)
+String ResourceManager::getRealPath(const String& path) {
+	if(PHYSFS_exists(path.c_str())) {
+		const char *realDir = PHYSFS_getRealDir(path.c_str());
+		if(realDir)
+			return String(realDir) + "/" + path;
+	}
+	return path;
+}
+
+void ResourceManager::startWatching() {
+#if defined(__linux__)
+	watchDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(watchDescriptor < 0) {
+		Logger::log("Could not start watching resource files, checking for changes every %d ms instead\n", RESOURCE_CHECK_INTERVAL);
 		return;
+	}
+	for(int i=0; i < resources.size(); i++) {
+		watchResource(resources[i]);
+	}
+#endif
+}
+
+void ResourceManager::stopWatching() {
+#if defined(__linux__)
+	if(watchDescriptor >= 0)
+		close(watchDescriptor);
+#endif
+	watchDescriptor = -1;
+	watchedDirectories.clear();
+	watchedDirectoryIDs.clear();
+	watchedFiles.clear();
+}
+
+void ResourceManager::watchResource(Resource *resource) {
+#if defined(__linux__)
+	if(resource->getResourcePath() == "")
+		return;
+	String realPath = getRealPath(resource->getResourcePath());
+	
+	size_t slash = realPath.rfind("/");
+	String directory;
+	if(slash == std::string::npos) {
+		directory = ".";
+	} else if(slash == 0) {
+		directory = "/";
+	} else {
+		directory = realPath.substr(0, slash);
+	}
+	
+	// the directory is watched rather than the file, so files that editors save by replacing them are still seen
+	if(watchedDirectoryIDs.find(directory.contents) == watchedDirectoryIDs.end()) {
+		int watchID = inotify_add_watch(watchDescriptor, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		watchedDirectoryIDs[directory.contents] = watchID;
+		if(watchID >= 0)
+			watchedDirectories[watchID] = directory;
+	}
+	watchedFiles.insert(std::pair<unsigned int, Resource*>(hashKey(0, realPath), resource));
+#endif
+}
+
+void ResourceManager::unwatchResource(Resource *resource) {
+	std::pair<std::multimap<unsigned int, Resource*>::iterator, std::multimap<unsigned int, Resource*>::iterator> range;
+	range = watchedFiles.equal_range(hashKey(0, getRealPath(resource->getResourcePath())));
+	for(std::multimap<unsigned int, Resource*>::iterator it = range.first; it != range.second; ++it) {
+		if(it->second == resource) {
+			watchedFiles.erase(it);
+			return;
+		}
+	}
+	// the real path can change if archives were mounted since the resource was watched
+	for(std::multimap<unsigned int, Resource*>::iterator it = watchedFiles.begin(); it != watchedFiles.end(); ++it) {
+		if(it->second == resource) {
+			watchedFiles.erase(it);
+			return;
+		}
+	}
+}
+
+void ResourceManager::readWatchEvents() {
+#if defined(__linux__)
+	std::vector<Resource*> changed;
+	char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	
+	while(true) {
+		ssize_t length = read(watchDescriptor, buffer, sizeof(buffer));
+		if(length <= 0)
+			break;
 		
+		const struct inotify_event *event;
+		for(char *ptr = buffer; ptr < buffer + length; ptr += sizeof(struct inotify_event) + event->len) {
+			event = (const struct inotify_event*)ptr;
+			if(event->len == 0)
+				continue;
+			std::map<int, String>::iterator directory = watchedDirectories.find(event->wd);
+			if(directory == watchedDirectories.end())
+				continue;
+			
+			String filePath = directory->second + "/" + String(event->name);
+			std::pair<std::multimap<unsigned int, Resource*>::iterator, std::multimap<unsigned int, Resource*>::iterator> range;
+			range = watchedFiles.equal_range(hashKey(0, filePath));
+			for(std::multimap<unsigned int, Resource*>::iterator it = range.first; it != range.second; ++it) {
+				Resource *resource = it->second;
+				if(resource->reloadOnFileModify && getRealPath(resource->getResourcePath()) == filePath) {
+					if(std::find(changed.begin(), changed.end(), resource) == changed.end())
+						changed.push_back(resource);
+				}
+			}
+		}
+	}
+	
+	// reloading can re-index resources, so the changed resources are collected first
+	for(int i=0; i < changed.size(); i++) {
+		changed[i]->reloadResource();
+		changed[i]->resourceFileTime = OSBasics::getFileTime(changed[i]->getResourcePath());
+	}
+#endif
+}
+
+void ResourceManager::Update(int elapsed) {
+	if(!reloadResourcesOnModify) {
+		if(watchDescriptor >= 0)
+			stopWatching();
+		return;
+	}
+	
+#if defined(__linux__)
+	if(watchDescriptor < 0 && !watchFailed) {
+		startWatching();
+		watchFailed = (watchDescriptor < 0);
+	}
+	if(watchDescriptor >= 0) {
+		readWatchEvents();
+		return;
+	}
+#endif
+	
 	ticksSinceCheck += elapsed;
 	if(ticksSinceCheck > RESOURCE_CHECK_INTERVAL) {
 		ticksSinceCheck = 0;
@@ -75,8 +75,9 @@ long getThreadID() {
 void Core::getScreenInfo(int *width, int *height, int *hz) {
 	SDL_Init(SDL_INIT_VIDEO); // Or GetVideoInfo will not work
 	const SDL_VideoInfo *video = SDL_GetVideoInfo();
-	if (width) *width = video->current_w;
-	if (height) *height = video->current_h;
+	// there is no video info without a display, e.g. when running a HeadlessCore
+	if (width) *width = video ? video->current_w : 0;
+	if (height) *height = video ? video->current_h : 0;
 	if (hz) *hz = 0;
 }
 
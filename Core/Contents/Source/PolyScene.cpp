@@ -22,17 +22,20 @@
 
 #include "PolyScene.h"
 #include "OSBasics.h"
+#include "PolyAABBTree.h"
 #include "PolyCamera.h"
 #include "PolyCoreServices.h"
 #include "PolyLogger.h"
 #include "PolyMaterial.h"
 #include "PolyMesh.h"
 #include "PolyRenderer.h"
+#include "PolyRenderQueue.h"
 #include "PolyResource.h"
 #include "PolyResourceManager.h"
 #include "PolySceneLight.h"
 #include "PolySceneMesh.h"
 #include "PolySceneManager.h"
+#include <float.h>
 
 using std::vector;
 using namespace Polycode;
@@ -49,6 +52,9 @@ Scene::Scene() : EventDispatcher() {
 	ambientColor.setColor(0.0,0.0,0.0,1.0);
 	useClearColor = false;
 	ownsChildren = false;
+	spatialIndex = NULL;
+	renderQueue = new RenderQueue();
+	useRenderQueue = false;
 	CoreServices::getInstance()->getSceneManager()->addScene(this);	
 }
 
@@ -64,6 +70,9 @@ Scene::Scene(bool virtualScene) : EventDispatcher() {
 	ambientColor.setColor(0.0,0.0,0.0,1.0);	
 	useClearColor = false;
 	ownsChildren = false;
+	spatialIndex = NULL;
+	renderQueue = new RenderQueue();
+	useRenderQueue = false;
 	if (!isSceneVirtual) {
 		CoreServices::getInstance()->getSceneManager()->addScene(this);
 	}
@@ -97,7 +106,9 @@ void Scene::Update() {
 	for(int i=0; i<entities.size();i++) {
 		entities[i]->doUpdates();		
 		entities[i]->updateEntityMatrix();
+		queueSpatialUpdate(i);
 	}
+	updateSpatialIndex();
 }
 
 Scene::~Scene() {
@@ -106,6 +117,8 @@ Scene::~Scene() {
 			delete entities[i];
 		}
 	}
+	setSpatialIndexEnabled(false);
+	delete renderQueue;
 	CoreServices::getInstance()->getSceneManager()->removeScene(this);	
 	delete defaultCamera;
 }
@@ -132,17 +145,243 @@ void Scene::setFogProperties(int fogMode, Color color, Number density, Number st
 }
 
 SceneEntity *Scene::getEntityAtScreenPosition(Number x, Number y) {
-	for(int i =0; i< entities.size(); i++) {
-		if(entities[i]->testMouseCollision(x,y)) {
-			return entities[i];
+	if(!activeCamera)
+		return NULL;
+	
+	Matrix4 cameraMatrix = activeCamera->getConcatenatedMatrix();
+	Vector3 direction = CoreServices::getInstance()->getRenderer()->projectRayFrom2DCoordinate(x, y, cameraMatrix, activeCamera->getProjectionMatrix());
+	return pickEntity(cameraMatrix.getPosition(), direction, FLT_MAX);
+}
+
+SceneEntity *Scene::getEntityAlongRay(const Vector3 &origin, const Vector3 &dest) {
+	return pickEntity(origin, dest - origin, 1.0);
+}
+
+SceneEntity *Scene::pickEntity(const Vector3 &origin, const Vector3 &direction, Number maxDistance) {
+	Number a = direction.dot(direction);
+	if(a == 0)
+		return NULL;
+	
+	std::vector<SceneEntity*> candidates;
+	if(spatialIndex) {
+		spatialQueryResults.clear();
+		spatialIndex->queryRay(origin, direction, maxDistance, spatialQueryResults);
+		for(int i=0; i < spatialQueryResults.size(); i++) {
+			candidates.push_back(((SceneSpatialEntry*)spatialQueryResults[i])->entity);
 		}
+	} else {
+		candidates = entities;
+	}
+	
+	SceneEntity *nearest = NULL;
+	Number nearestDistance = maxDistance;
+	for(int i=0; i < candidates.size(); i++) {
+		Number radius = candidates[i]->getSubtreeBoundsRadius();
+		if(radius <= 0)
+			continue;
+		
+		// entry point of the ray into the bounding sphere
+		Vector3 offset = origin - candidates[i]->getWorldBoundsCenter();
+		Number b = 2.0 * direction.dot(offset);
+		Number c = offset.dot(offset) - (radius * radius);
+		Number distance = 0;
+		if(c > 0) {
+			Number discriminant = (b * b) - (4.0 * a * c);
+			if(discriminant < 0)
+				continue;
+			distance = (-b - sqrt(discriminant)) / (2.0 * a);
+			if(distance < 0)
+				continue;
+		}
+		
+		if(distance <= nearestDistance) {
+			nearest = candidates[i];
+			nearestDistance = distance;
+		}
+	}
+	return nearest;
+}
+
+void Scene::setSpatialIndexEnabled(bool enabled) {
+	if(enabled == (spatialIndex != NULL))
+		return;
+	
+	if(enabled) {
+		spatialIndex = new AABBTree();
+		for(int i=0; i < entities.size(); i++) {
+			addSpatialEntry(entities[i]);
+		}
+		updateSpatialIndex();
+	} else {
+		for(int i=0; i < spatialEntries.size(); i++) {
+			delete spatialEntries[i];
+		}
+		spatialEntries.clear();
+		unboundedEntries.clear();
+		dirtySpatialEntries.clear();
+		delete spatialIndex;
+		spatialIndex = NULL;
 	}
-	return NULL;
+}
+
+bool Scene::isSpatialIndexEnabled() const {
+	return spatialIndex != NULL;
+}
+
+void Scene::addSpatialEntry(SceneEntity *entity) {
+	// the proxy is created on the next update, once the entity has bounds
+	SceneSpatialEntry *entry = new SceneSpatialEntry();
+	entry->entity = entity;
+	entry->index = spatialEntries.size();
+	entry->proxyId = -1;
+	entry->bounded = true;
+	entry->queued = true;
+	entry->radius = 0;
+	spatialEntries.push_back(entry);
+	dirtySpatialEntries.push_back(entry);
+}
+
+void Scene::queueSpatialUpdate(unsigned int index) {
+	if(!spatialIndex)
+		return;
+	SceneSpatialEntry *entry = spatialEntries[index];
+	if(entry->queued)
+		return;
+	if(entry->radius != entry->entity->getSubtreeBoundsRadius() || entry->center != entry->entity->getWorldBoundsCenter()) {
+		entry->queued = true;
+		dirtySpatialEntries.push_back(entry);
+	}
+}
+
+void Scene::updateSpatialIndex() {
+	if(!spatialIndex)
+		return;
+	
+	// only entities whose bounds changed since the last update are refit, and
+	// their proxies only get reinserted when they leave their enlarged box
+	for(int i=0; i < dirtySpatialEntries.size(); i++) {
+		SceneSpatialEntry *entry = dirtySpatialEntries[i];
+		entry->queued = false;
+		entry->center = entry->entity->getWorldBoundsCenter();
+		entry->radius = entry->entity->getSubtreeBoundsRadius();
+		AABB box = AABB::fromSphere(entry->center, entry->radius);
+		if(entry->proxyId == -1) {
+			entry->proxyId = spatialIndex->createProxy(box, entry);
+		} else {
+			spatialIndex->moveProxy(entry->proxyId, box);
+		}
+		
+		bool bounded = (entry->radius > 0);
+		if(bounded && !entry->bounded) {
+			removeUnboundedEntry(entry);
+		} else if(!bounded && entry->bounded) {
+			unboundedEntries.push_back(entry);
+		}
+		entry->bounded = bounded;
+	}
+	dirtySpatialEntries.clear();
+}
+
+void Scene::removeUnboundedEntry(SceneSpatialEntry *entry) {
+	for(int i=0; i < unboundedEntries.size(); i++) {
+		if(unboundedEntries[i] == entry) {
+			unboundedEntries[i] = unboundedEntries.back();
+			unboundedEntries.pop_back();
+			return;
+		}
+	}
+}
+
+void Scene::collectEntitiesInFrustum(Camera *camera, std::vector<SceneEntity*> &results) {
+	results.clear();
+	if(!spatialIndex) {
+		for(int i=0; i < entities.size(); i++) {
+			Number radius = entities[i]->getSubtreeBoundsRadius();
+			if(radius <= 0 || camera->isSphereInFrustum(entities[i]->getWorldBoundsCenter(), radius)) {
+				results.push_back(entities[i]);
+			}
+		}
+		return;
+	}
+	
+	spatialQueryResults.clear();
+	spatialIndex->queryFrustum(camera, spatialQueryResults);
+	
+	// the tree returns entries in no particular order, so visible entries are
+	// flagged in a bit mask that is read back in the order entities were
+	// added in, which decides draw order. Entities without bounds are never culled.
+	visibleMask.assign((spatialEntries.size() + 31) / 32, 0);
+	for(int i=0; i < unboundedEntries.size(); i++) {
+		unsigned int index = unboundedEntries[i]->index;
+		visibleMask[index / 32] |= (1u << (index % 32));
+	}
+	for(int i=0; i < spatialQueryResults.size(); i++) {
+		SceneSpatialEntry *entry = (SceneSpatialEntry*)spatialQueryResults[i];
+		if(entry->bounded)
+			visibleMask[entry->index / 32] |= (1u << (entry->index % 32));
+	}
+	
+	for(unsigned int i=0; i < visibleMask.size(); i++) {
+		unsigned int bits = visibleMask[i];
+		for(unsigned int index = i * 32; bits != 0; index++, bits >>= 1) {
+			if(bits & 1)
+				results.push_back(entities[index]);
+		}
+	}
+}
+
+std::vector<SceneEntity*> Scene::getEntitiesInFrustum(Camera *camera) {
+	std::vector<SceneEntity*> results;
+	if(camera)
+		collectEntitiesInFrustum(camera, results);
+	return results;
+}
+
+std::vector<SceneEntity*> Scene::getEntitiesInSphere(const Vector3 &center, Number radius) {
+	std::vector<SceneEntity*> results;
+	if(spatialIndex) {
+		spatialQueryResults.clear();
+		spatialIndex->querySphere(center, radius, spatialQueryResults);
+		for(int i=0; i < spatialQueryResults.size(); i++) {
+			SceneEntity *entity = ((SceneSpatialEntry*)spatialQueryResults[i])->entity;
+			if(entity->getWorldBoundsCenter().distance(center) <= entity->getSubtreeBoundsRadius() + radius)
+				results.push_back(entity);
+		}
+	} else {
+		for(int i=0; i < entities.size(); i++) {
+			if(entities[i]->getWorldBoundsCenter().distance(center) <= entities[i]->getSubtreeBoundsRadius() + radius)
+				results.push_back(entities[i]);
+		}
+	}
+	return results;
+}
+
+std::vector<SceneEntity*> Scene::getEntitiesInBox(const Vector3 &boxMin, const Vector3 &boxMax) {
+	std::vector<SceneEntity*> results;
+	AABB box(boxMin, boxMax);
+	if(spatialIndex) {
+		spatialQueryResults.clear();
+		spatialIndex->queryBox(box, spatialQueryResults);
+		for(int i=0; i < spatialQueryResults.size(); i++) {
+			SceneEntity *entity = ((SceneSpatialEntry*)spatialQueryResults[i])->entity;
+			if(box.intersectsSphere(entity->getWorldBoundsCenter(), entity->getSubtreeBoundsRadius()))
+				results.push_back(entity);
+		}
+	} else {
+		for(int i=0; i < entities.size(); i++) {
+			if(box.intersectsSphere(entities[i]->getWorldBoundsCenter(), entities[i]->getSubtreeBoundsRadius()))
+				results.push_back(entities[i]);
+		}
+	}
+	return results;
 }
 
 void Scene::addEntity(SceneEntity *entity) {
 	entity->setRenderer(CoreServices::getInstance()->getRenderer());
 	entities.push_back(entity);
+	if(spatialIndex) {
+		addSpatialEntry(entity);
+	}
 }
 
 void Scene::addChild(SceneEntity *entity) {
@@ -153,6 +392,26 @@ void Scene::removeEntity(SceneEntity *entity) {
 	for(int i=0; i < entities.size(); i++) {
 		if(entities[i] == entity) {
 			entities.erase(entities.begin()+i);
+			if(spatialIndex) {
+				SceneSpatialEntry *entry = spatialEntries[i];
+				if(entry->proxyId != -1)
+					spatialIndex->destroyProxy(entry->proxyId);
+				if(!entry->bounded)
+					removeUnboundedEntry(entry);
+				if(entry->queued) {
+					for(int j=0; j < dirtySpatialEntries.size(); j++) {
+						if(dirtySpatialEntries[j] == entry) {
+							dirtySpatialEntries.erase(dirtySpatialEntries.begin()+j);
+							break;
+						}
+					}
+				}
+				delete entry;
+				spatialEntries.erase(spatialEntries.begin()+i);
+				for(int j=i; j < spatialEntries.size(); j++) {
+					spatialEntries[j]->index = j;
+				}
+			}
 			return;
 		}		
 	}
@@ -173,7 +432,9 @@ void Scene::Render(Camera *targetCamera) {
 	// prepare lights...
 	for(int i=0; i<entities.size();i++) {
 		entities[i]->updateEntityMatrix();
+		queueSpatialUpdate(i);
 	}	
+	updateSpatialIndex();
 	
 	//make these the closest
 	
@@ -247,15 +508,37 @@ void Scene::Render(Camera *targetCamera) {
 	}
 	
 	
-	for(int i=0; i<entities.size();i++) {
-		if(entities[i]->getBBoxRadius() > 0) {
-			if(targetCamera->isSphereInFrustum((entities[i]->getPosition()), entities[i]->getBBoxRadius()))
-				entities[i]->transformAndRender();
-		} else {
-			entities[i]->transformAndRender();		
+	// entities cull themselves and their children against the camera
+	// using the world bounds updated above
+	Renderer *renderer = CoreServices::getInstance()->getRenderer();
+	Camera *previousCullingCamera = renderer->getCullingCamera();
+	renderer->setCullingCamera(targetCamera);
+	targetCamera->cullingStats.reset();
+	
+	RenderQueue *previousRenderQueue = renderer->getRenderQueue();
+	renderer->setRenderQueue(useRenderQueue ? renderQueue : NULL);
+	
+	if(spatialIndex) {
+		collectEntitiesInFrustum(targetCamera, visibleEntities);
+		unsigned int rejected = entities.size() - visibleEntities.size();
+		targetCamera->cullingStats.entitiesVisited += rejected;
+		targetCamera->cullingStats.entitiesCulled += rejected;
+		for(int i=0; i<visibleEntities.size();i++) {
+			visibleEntities[i]->transformAndRender();
+		}
+	} else {
+		for(int i=0; i<entities.size();i++) {
+			entities[i]->transformAndRender();
 		}
 	}
 	
+	renderer->setRenderQueue(previousRenderQueue);
+	renderer->setCullingCamera(previousCullingCamera);
+	
+	if(useRenderQueue) {
+		renderQueue->render(renderer);
+	}
+	
 	if(targetCamera->getOrthoMode()) {
 		CoreServices::getInstance()->getRenderer()->setPerspectiveMode();
 	}
@@ -276,18 +559,33 @@ void Scene::RenderDepthOnly(Camera *targetCamera) {
 	targetCamera->doCameraTransform();	
 	targetCamera->buildFrustumPlanes();
 	
+	Renderer *renderer = CoreServices::getInstance()->getRenderer();
+	Camera *previousCullingCamera = renderer->getCullingCamera();
+	renderer->setCullingCamera(targetCamera);
+	targetCamera->cullingStats.reset();
+	
+	// depth maps are drawn immediately
+	RenderQueue *previousRenderQueue = renderer->getRenderQueue();
+	renderer->setRenderQueue(NULL);
+	
 	CoreServices::getInstance()->getRenderer()->setTexture(NULL);
 	CoreServices::getInstance()->getRenderer()->enableShaders(false);
-	for(int i=0; i<entities.size();i++) {
-		if(entities[i]->castShadows) {
-		if(entities[i]->getBBoxRadius() > 0) {
-			if(targetCamera->isSphereInFrustum((entities[i]->getPosition()), entities[i]->getBBoxRadius()))
-				entities[i]->transformAndRender();
-		} else {
-			entities[i]->transformAndRender();		
+	if(spatialIndex) {
+		collectEntitiesInFrustum(targetCamera, visibleEntities);
+		for(int i=0; i<visibleEntities.size();i++) {
+			if(visibleEntities[i]->castShadows) {
+				visibleEntities[i]->transformAndRender();
+			}
 		}
+	} else {
+		for(int i=0; i<entities.size();i++) {
+			if(entities[i]->castShadows) {
+				entities[i]->transformAndRender();
+			}
 		}
-	}	
+	}
+	renderer->setRenderQueue(previousRenderQueue);
+	renderer->setCullingCamera(previousCullingCamera);
 	CoreServices::getInstance()->getRenderer()->enableShaders(true);
 	CoreServices::getInstance()->getRenderer()->cullFrontFaces(false);	
 }
@@ -23,6 +23,7 @@
 #include "PolySceneLabel.h"
 #include "PolyCoreServices.h"
 #include "PolyFontManager.h"
+#include "PolyGlyphAtlas.h"
 #include "PolyLabel.h"
 #include "PolyMesh.h"
 #include "PolyPolygon.h"
@@ -32,7 +33,7 @@
 using namespace Polycode;
 
 SceneLabel::SceneLabel(const String& fontName, const String& text, int size, Number scale, int amode, bool premultiplyAlpha) : ScenePrimitive(ScenePrimitive::TYPE_PLANE, 1, 1) {
-	label = new Label(CoreServices::getInstance()->getFontManager()->getFontByName(fontName), text, size, amode, premultiplyAlpha);
+	label = new Label(CoreServices::getInstance()->getFontManager()->getFontByName(fontName), text, size, amode, premultiplyAlpha, true);
 	this->scale = scale;
 	updateFromLabel();
 }
@@ -44,22 +45,25 @@ Label *SceneLabel::getLabel() {
 	return label;
 }
 
-void SceneLabel::updateFromLabel() {
+bool SceneLabel::updateGlyphMesh() {
+	Number offsetX = (-label->getXAdjust() - (label->getWidth()/2.0)) * scale;
+	Number offsetY = ((label->getHeight()/2.0) - label->getBaselineAdjust()) * scale;
+	return label->updateGlyphMesh(mesh, scale, offsetX, offsetY, true, Color(1.0f, 1.0f, 1.0f, 1.0f));
+}
 
-	MaterialManager *materialManager = CoreServices::getInstance()->getMaterialManager();	
-	if(texture)
-		materialManager->deleteTexture(texture);
+void SceneLabel::updateFromLabel() {
 
-	texture = materialManager->createTextureFromImage(label, materialManager->clampDefault, materialManager->mipmapsDefault);
+	// the texture belongs to the font's glyph atlas and is shared with other labels
+	texture = NULL;
+	if(label->getGlyphAtlas())
+		texture = label->getGlyphAtlas()->getTexture();
 
 	if(material) {
 		localShaderOptions->clearTexture("diffuse");
 		localShaderOptions->addTexture("diffuse", texture);	
 	}
 
-	delete mesh;
-	mesh = new Mesh(Mesh::QUAD_MESH);
-	mesh->createVPlane(label->getWidth()*scale,label->getHeight()*scale);
+	updateGlyphMesh();
 	
 	bBox.x = label->getWidth()*scale;
 	bBox.y = label->getHeight()*scale;
@@ -75,6 +79,17 @@ void SceneLabel::updateFromLabel() {
 
 }
 
+void SceneLabel::Render() {
+	// other labels can grow the shared atlas, which moves this label's texture coordinates
+	if(label->getGlyphAtlas()) {
+		label->getGlyphAtlas()->getTexture();
+		if(updateGlyphMesh() && useVertexBuffer) {
+			CoreServices::getInstance()->getRenderer()->createVertexBufferForMesh(mesh);
+		}
+	}
+	ScenePrimitive::Render();
+}
+
 void SceneLabel::setText(const String& newText) {
 	
 	if(newText == label->getText() && !label->optionsChanged()) {
@@ -24,6 +24,7 @@
 #include "PolyCamera.h"
 #include "PolyCoreServices.h"
 #include "PolyLogger.h"
+#include "PolyProfiler.h"
 #include "PolyRenderer.h"
 #include "PolyScene.h"
 #include "PolySceneRenderTexture.h"
@@ -94,6 +95,7 @@ void SceneManager::renderVirtual() {
 }
 
 void SceneManager::Render() {
+	ProfilerZone zone("SceneManager::Render");
 	for(int i=0;i<scenes.size();i++) {
 		if(scenes[i]->isEnabled() && !scenes[i]->isVirtual()) {
 			CoreServices::getInstance()->getRenderer()->loadIdentity();
@@ -108,6 +110,7 @@ void SceneManager::Render() {
 }
 
 void SceneManager::Update() {
+	ProfilerZone zone("SceneManager::Update");
 	for(int i=0;i<scenes.size();i++) {
 		if(scenes[i]->isEnabled()) {
 			scenes[i]->Update();
@@ -32,9 +32,116 @@
 #include "PolySkeleton.h"
 #include "PolyResourceManager.h"
 #include "PolyMaterialManager.h"
+#include "PolyJobSystem.h"
+#include <math.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#define POLY_SKINNING_SSE
+	#include <xmmintrin.h>
+#endif
 
 using namespace Polycode;
 
+// A range of vertices of an indexed mesh to skin against a skinning palette.
+struct SkinningJob {
+	const float *palette;
+	unsigned int boneCount;
+	const float *restPositions;
+	const float *restNormals;
+	const unsigned int *boneIndices;
+	const float *boneWeights;
+	float *positions;
+	float *normals;
+	unsigned int start;
+	unsigned int end;
+};
+
+static void skinVertexRange(void *data) {
+	SkinningJob *job = (SkinningJob*)data;
+	
+	for(unsigned int i=job->start; i < job->end; i++) {
+		const unsigned int *indices = job->boneIndices + (i * Mesh::MAX_BONE_WEIGHTS);
+		const float *weights = job->boneWeights + (i * Mesh::MAX_BONE_WEIGHTS);
+		const float *restPosition = job->restPositions + (i*3);
+		const float *restNormal = job->restNormals + (i*3);
+		float position[4];
+		float normal[4];
+		
+		// blend the palette matrices by weight, then transform once
+#ifdef POLY_SKINNING_SSE
+		__m128 row0 = _mm_setzero_ps();
+		__m128 row1 = _mm_setzero_ps();
+		__m128 row2 = _mm_setzero_ps();
+		__m128 row3 = _mm_setzero_ps();
+		for(int b=0; b < Mesh::MAX_BONE_WEIGHTS; b++) {
+			if(weights[b] <= 0.0f || indices[b] >= job->boneCount)
+				continue;
+			const float *m = job->palette + (indices[b] * 16);
+			__m128 weight = _mm_set1_ps(weights[b]);
+			row0 = _mm_add_ps(row0, _mm_mul_ps(_mm_loadu_ps(m), weight));
+			row1 = _mm_add_ps(row1, _mm_mul_ps(_mm_loadu_ps(m+4), weight));
+			row2 = _mm_add_ps(row2, _mm_mul_ps(_mm_loadu_ps(m+8), weight));
+			row3 = _mm_add_ps(row3, _mm_mul_ps(_mm_loadu_ps(m+12), weight));
+		}
+		
+		__m128 rotated = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(_mm_set1_ps(restPosition[0]), row0),
+			_mm_mul_ps(_mm_set1_ps(restPosition[1]), row1)),
+			_mm_mul_ps(_mm_set1_ps(restPosition[2]), row2));
+		_mm_storeu_ps(position, _mm_add_ps(rotated, row3));
+		
+		_mm_storeu_ps(normal, _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(_mm_set1_ps(restNormal[0]), row0),
+			_mm_mul_ps(_mm_set1_ps(restNormal[1]), row1)),
+			_mm_mul_ps(_mm_set1_ps(restNormal[2]), row2)));
+#else
+		float m[12];
+		for(int j=0; j < 12; j++) {
+			m[j] = 0.0f;
+		}
+		float translation[3] = {0.0f, 0.0f, 0.0f};
+		for(int b=0; b < Mesh::MAX_BONE_WEIGHTS; b++) {
+			if(weights[b] <= 0.0f || indices[b] >= job->boneCount)
+				continue;
+			const float *boneMatrix = job->palette + (indices[b] * 16);
+			float weight = weights[b];
+			for(int r=0; r < 3; r++) {
+				m[(r*4)] += boneMatrix[(r*4)] * weight;
+				m[(r*4)+1] += boneMatrix[(r*4)+1] * weight;
+				m[(r*4)+2] += boneMatrix[(r*4)+2] * weight;
+			}
+			translation[0] += boneMatrix[12] * weight;
+			translation[1] += boneMatrix[13] * weight;
+			translation[2] += boneMatrix[14] * weight;
+		}
+		
+		for(int c=0; c < 3; c++) {
+			position[c] = restPosition[0]*m[c] + restPosition[1]*m[4+c] + restPosition[2]*m[8+c] + translation[c];
+			normal[c] = restNormal[0]*m[c] + restNormal[1]*m[4+c] + restNormal[2]*m[8+c];
+		}
+#endif
+		
+		float *outPosition = job->positions + (i*3);
+		outPosition[0] = position[0];
+		outPosition[1] = position[1];
+		outPosition[2] = position[2];
+		
+		float length = sqrtf(normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2]);
+		float scale = length > 0.0f ? 1.0f / length : 0.0f;
+		float *outNormal = job->normals + (i*3);
+		outNormal[0] = normal[0] * scale;
+		outNormal[1] = normal[1] * scale;
+		outNormal[2] = normal[2] * scale;
+	}
+}
+
+static void skinVertexRangeJob(void *data, unsigned int start, unsigned int end) {
+	SkinningJob job = *((SkinningJob*)data);
+	job.start = start;
+	job.end = end;
+	skinVertexRange(&job);
+}
+
 SceneMesh *SceneMesh::SceneMeshFromMesh(Mesh *mesh) {
 	return new SceneMesh(mesh);
 }
@@ -54,6 +161,7 @@ SceneMesh::SceneMesh(const String& fileName) : SceneEntity(), texture(NULL), mat
 	ownsMesh = true;
 	ownsSkeleton = true;
 	lineWidth = 1.0;
+	skinningThreadCount = 1;
 }
 
 SceneMesh::SceneMesh(Mesh *mesh) : SceneEntity(), texture(NULL), material(NULL), skeleton(NULL), localShaderOptions(NULL) {
@@ -67,7 +175,7 @@ SceneMesh::SceneMesh(Mesh *mesh) : SceneEntity(), texture(NULL), material(NULL),
 	ownsMesh = true;
 	ownsSkeleton = true;	
 	lineWidth = 1.0;
-		
+	skinningThreadCount = 1;
 }
 
 SceneMesh::SceneMesh(int meshType) : texture(NULL), material(NULL), skeleton(NULL), localShaderOptions(NULL) {
@@ -80,7 +188,8 @@ SceneMesh::SceneMesh(int meshType) : texture(NULL), material(NULL), skeleton(NUL
 	lineSmooth = false;
 	ownsMesh = true;
 	ownsSkeleton = true;	
-	lineWidth = 1.0;	
+	lineWidth = 1.0;
+	skinningThreadCount = 1;
 }
 
 void SceneMesh::setMesh(Mesh *mesh) {
@@ -165,6 +274,11 @@ void SceneMesh::loadSkeleton(const String& fileName) {
 
 void SceneMesh::setSkeleton(Skeleton *skeleton) {
 	this->skeleton = skeleton;
+	
+	// indexed meshes look up bones by id when skinning
+	if(mesh->isIndexedMesh())
+		return;
+		
 	for(int i=0; i < mesh->getPolygonCount(); i++) {
 		Polygon *polygon = mesh->getPolygon(i);
 		unsigned int vCount = polygon->getVertexCount();
@@ -181,64 +295,94 @@ Material *SceneMesh::getMaterial() {
 	return material;
 }
 
+Material *SceneMesh::getRenderMaterial() {
+	return material;
+}
+
+Texture *SceneMesh::getRenderTexture() {
+	return texture;
+}
+
 Skeleton *SceneMesh::getSkeleton() {
 	return skeleton;
 }
 
+void SceneMesh::skinIndexedMesh() {
+	unsigned int vertexCount = mesh->vertexRestPositionArray.size() / 3;
+	const float *palette = skeleton->getSkinningPalette();
+	if(vertexCount == 0 || !palette)
+		return;
+	
+	SkinningJob job;
+	job.palette = palette;
+	job.boneCount = skeleton->getNumBones();
+	job.restPositions = &mesh->vertexRestPositionArray[0];
+	job.restNormals = &mesh->vertexRestNormalArray[0];
+	job.boneIndices = &mesh->vertexBoneIndexArray[0];
+	job.boneWeights = &mesh->vertexBoneWeightArray[0];
+	job.positions = &mesh->vertexPositionArray[0];
+	job.normals = &mesh->vertexNormalArray[0];
+	job.start = 0;
+	job.end = vertexCount;
+	
+	unsigned int rangeCount = vertexCount / MIN_VERTICES_PER_SKINNING_THREAD;
+	if(skinningThreadCount < rangeCount)
+		rangeCount = skinningThreadCount;
+	
+	if(rangeCount <= 1) {
+		skinVertexRange(&job);
+	} else {
+		unsigned int grainSize = (vertexCount + rangeCount - 1) / rangeCount;
+		CoreServices::getInstance()->getJobSystem()->parallelFor(vertexCount, grainSize, skinVertexRangeJob, &job);
+	}
+	
+	mesh->dirtyArray(RenderDataArray::VERTEX_DATA_ARRAY);
+	mesh->dirtyArray(RenderDataArray::NORMAL_DATA_ARRAY);
+}
+
 void SceneMesh::renderMeshLocally() {
 	Renderer *renderer = CoreServices::getInstance()->getRenderer();
 	
-	if(skeleton) {	
+	if(skeleton && mesh->isIndexedMesh()) {
+		skinIndexedMesh();
+	} else if(skeleton && skeleton->getNumBones() > 0) {
+		const float *palette = skeleton->getSkinningPalette();
+		unsigned int boneCount = skeleton->getNumBones();
 		for(int i=0; i < mesh->getPolygonCount(); i++) {
 			Polygon *polygon = mesh->getPolygon(i);			
 			unsigned int vCount = polygon->getVertexCount();			
 			for(int j=0; j < vCount; j++) {
 				Vertex *vert = polygon->getVertex(j);
+				const Vector3 &aPos = vert->restPosition;
+				const Vector3 &aNorm = vert->restNormal;
+				Vector3 tPos;
 				Vector3 norm;
 				
-					Vector3 aPos = vert->restPosition;
-					Vector3 tPos;
-
-					Number mult = 1;					
-/*				
-					Number mult = 0;
-					for(int b =0; b < vert->getNumBoneAssignments(); b++) {
-						BoneAssignment *bas = vert->getBoneAssignment(b);
-						mult += bas->weight;
-					}
-					mult = 1.0f/mult;
-*/				
-					for(int b =0; b < vert->getNumBoneAssignments(); b++) {
-						BoneAssignment *bas = vert->getBoneAssignment(b);
-						Bone *bone = bas->bone;
-						if(bone) {
-							
-							Matrix4 restMatrix = bone->getRestMatrix();
-							Matrix4 finalMatrix = bone->getFinalMatrix();
-							
-							Vector3 vec = restMatrix * aPos;
-							tPos += finalMatrix * vec * (bas->weight*mult);
-							
-							Vector3 nvec = vert->restNormal;
-							nvec = restMatrix.rotateVector(nvec);
-							nvec = finalMatrix.rotateVector(nvec);
-							
-							norm += nvec * (bas->weight*mult);
-						}
-					}					
+				for(int b =0; b < vert->getNumBoneAssignments(); b++) {
+					BoneAssignment *bas = vert->getBoneAssignment(b);
+					if(!bas->bone || bas->boneID >= boneCount)
+						continue;
 					
+					const float *m = palette + (bas->boneID * 16);
+					Number weight = bas->weight;
+					tPos.x += (aPos.x*m[0] + aPos.y*m[4] + aPos.z*m[8] + m[12]) * weight;
+					tPos.y += (aPos.x*m[1] + aPos.y*m[5] + aPos.z*m[9] + m[13]) * weight;
+					tPos.z += (aPos.x*m[2] + aPos.y*m[6] + aPos.z*m[10] + m[14]) * weight;
+					norm.x += (aNorm.x*m[0] + aNorm.y*m[4] + aNorm.z*m[8]) * weight;
+					norm.y += (aNorm.x*m[1] + aNorm.y*m[5] + aNorm.z*m[9]) * weight;
+					norm.z += (aNorm.x*m[2] + aNorm.y*m[6] + aNorm.z*m[10]) * weight;
+				}
 				
-					vert->x = tPos.x;
-					vert->y = tPos.y;
-					vert->z = tPos.z;				
-				
-					norm.Normalize();
-					vert->setNormal(norm.x, norm.y, norm.z);
+				vert->x = tPos.x;
+				vert->y = tPos.y;
+				vert->z = tPos.z;				
 				
+				norm.Normalize();
+				vert->setNormal(norm.x, norm.y, norm.z);
 			}
 		}
-		mesh->arrayDirtyMap[RenderDataArray::VERTEX_DATA_ARRAY] = true;		
-		mesh->arrayDirtyMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;	
+		mesh->dirtyArray(RenderDataArray::VERTEX_DATA_ARRAY);
+		mesh->dirtyArray(RenderDataArray::NORMAL_DATA_ARRAY);
 		mesh->arrayDirtyMap[RenderDataArray::TANGENT_DATA_ARRAY] = true;				
 	}
 
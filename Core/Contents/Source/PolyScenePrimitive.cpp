@@ -77,6 +77,7 @@ ScenePrimitive::ScenePrimitive(int type, Number v1, Number v2, Number v3,Number
 			bBox.z = v1*2;						
 		break;						
 	}
+	bBoxRadius = mesh->getRadius();
 }
 
 ScenePrimitive::~ScenePrimitive() {
@@ -378,10 +378,12 @@ MouseEventResult ScreenEntity::_onMouseMove(Number x, Number y, int timestamp) {
 			xmouse = localCoordinate.x;
 			ymouse = localCoordinate.y;
 
-			dispatchEvent(new InputEvent(Vector2(localCoordinate.x,localCoordinate.y), timestamp), InputEvent::EVENT_MOUSEMOVE);
+			InputEvent moveEvent(Vector2(localCoordinate.x,localCoordinate.y), timestamp);
+			dispatchEventNoDelete(&moveEvent, InputEvent::EVENT_MOUSEMOVE);
 
 			if(!mouseOver) {
-					dispatchEvent(new InputEvent(Vector2(localCoordinate.x,localCoordinate.y), timestamp), InputEvent::EVENT_MOUSEOVER);
+					InputEvent overEvent(Vector2(localCoordinate.x,localCoordinate.y), timestamp);
+					dispatchEventNoDelete(&overEvent, InputEvent::EVENT_MOUSEOVER);
 					mouseOver = true;
 			}
 			ret.hit = true;
@@ -396,7 +398,8 @@ MouseEventResult ScreenEntity::_onMouseMove(Number x, Number y, int timestamp) {
 				Matrix4 inverse = getScreenConcatenatedMatrix().Inverse();
 				localCoordinate = inverse * localCoordinate;
 
-				dispatchEvent(new InputEvent(Vector2(localCoordinate.x,localCoordinate.y), timestamp), InputEvent::EVENT_MOUSEOUT);
+				InputEvent outEvent(Vector2(localCoordinate.x,localCoordinate.y), timestamp);
+				dispatchEventNoDelete(&outEvent, InputEvent::EVENT_MOUSEOUT);
 				mouseOver = false;
 			}
 		}
@@ -428,9 +431,9 @@ MouseEventResult ScreenEntity::_onMouseUp(Number x, Number y, int mouseButton, i
 			localCoordinate = inverse * localCoordinate;
 
 			onMouseUp(localCoordinate.x,localCoordinate.y);
-			InputEvent *inputEvent = new InputEvent(Vector2(localCoordinate.x,localCoordinate.y), timestamp);
-			inputEvent->mouseButton = mouseButton;
-			dispatchEvent(inputEvent, InputEvent::EVENT_MOUSEUP);
+			InputEvent inputEvent(Vector2(localCoordinate.x,localCoordinate.y), timestamp);
+			inputEvent.mouseButton = mouseButton;
+			dispatchEventNoDelete(&inputEvent, InputEvent::EVENT_MOUSEUP);
 
 			ret.hit = true;
 			if(blockMouseInput) {
@@ -443,9 +446,9 @@ MouseEventResult ScreenEntity::_onMouseUp(Number x, Number y, int mouseButton, i
 			Matrix4 inverse = getScreenConcatenatedMatrix().Inverse();
 			localCoordinate = inverse * localCoordinate;
 
-			InputEvent *inputEvent = new InputEvent(Vector2(localCoordinate.x,localCoordinate.y), timestamp);
-			inputEvent->mouseButton = mouseButton;
-			dispatchEvent(inputEvent, InputEvent::EVENT_MOUSEUP_OUTSIDE);
+			InputEvent inputEvent(Vector2(localCoordinate.x,localCoordinate.y), timestamp);
+			inputEvent.mouseButton = mouseButton;
+			dispatchEventNoDelete(&inputEvent, InputEvent::EVENT_MOUSEUP_OUTSIDE);
 		}
 
 		for(int i=children.size()-1;i>=0;i--) {
@@ -478,8 +481,8 @@ MouseEventResult ScreenEntity::_onMouseWheelUp(Number x, Number y, int timestamp
 
 			onMouseWheelUp(localCoordinate.x,localCoordinate.y);
 
-			InputEvent *inputEvent = new InputEvent(Vector2(localCoordinate.x,localCoordinate.y), timestamp);
-			dispatchEvent(inputEvent, InputEvent::EVENT_MOUSEWHEEL_UP);
+			InputEvent inputEvent(Vector2(localCoordinate.x,localCoordinate.y), timestamp);
+			dispatchEventNoDelete(&inputEvent, InputEvent::EVENT_MOUSEWHEEL_UP);
 
 			ret.hit = true;
 			if(blockMouseInput) {
@@ -515,8 +518,8 @@ MouseEventResult ScreenEntity::_onMouseWheelDown(Number x, Number y, int timesta
 
 			onMouseWheelDown(localCoordinate.x,localCoordinate.y);
 
-			InputEvent *inputEvent = new InputEvent(Vector2(localCoordinate.x,localCoordinate.y), timestamp);
-			dispatchEvent(inputEvent, InputEvent::EVENT_MOUSEWHEEL_DOWN);
+			InputEvent inputEvent(Vector2(localCoordinate.x,localCoordinate.y), timestamp);
+			dispatchEventNoDelete(&inputEvent, InputEvent::EVENT_MOUSEWHEEL_DOWN);
 
 			ret.hit = true;
 			if(blockMouseInput) {
@@ -553,15 +556,15 @@ MouseEventResult ScreenEntity::_onMouseDown(Number x, Number y, int mouseButton,
 
 			onMouseDown(localCoordinate.x,localCoordinate.y);
 
-			InputEvent *inputEvent = new InputEvent(Vector2(localCoordinate.x,localCoordinate.y), timestamp);
+			InputEvent inputEvent(Vector2(localCoordinate.x,localCoordinate.y), timestamp);
 
-			inputEvent->mouseButton = mouseButton;
-			dispatchEvent(inputEvent, InputEvent::EVENT_MOUSEDOWN);
+			inputEvent.mouseButton = mouseButton;
+			dispatchEventNoDelete(&inputEvent, InputEvent::EVENT_MOUSEDOWN);
 
 			if(timestamp - lastClickTicks < 400) {
-				InputEvent *inputEvent = new InputEvent(Vector2(x,y), timestamp);
-				inputEvent->mouseButton = mouseButton;
-				dispatchEvent(inputEvent, InputEvent::EVENT_DOUBLECLICK);
+				InputEvent inputEvent(Vector2(x,y), timestamp);
+				inputEvent.mouseButton = mouseButton;
+				dispatchEventNoDelete(&inputEvent, InputEvent::EVENT_DOUBLECLICK);
 			}
 			lastClickTicks = timestamp;
 			ret.hit = true;
@@ -24,6 +24,7 @@
 #include "PolyCoreServices.h"
 #include "PolyFontManager.h"
 #include "PolyFont.h"
+#include "PolyGlyphAtlas.h"
 #include "PolyLabel.h"
 #include "PolyMaterialManager.h"
 #include "PolyMesh.h"
@@ -34,7 +35,7 @@
 using namespace Polycode;
 
 ScreenLabel::ScreenLabel(const String& text, int size, const String& fontName, int amode, bool premultiplyAlpha) : ScreenShape(ScreenShape::SHAPE_RECT,1,1) {
-	label = new Label(CoreServices::getInstance()->getFontManager()->getFontByName(fontName), text, size, amode, premultiplyAlpha);
+	label = new Label(CoreServices::getInstance()->getFontManager()->getFontByName(fontName), text, size, amode, premultiplyAlpha, true);
 	texture = NULL;
 	updateTexture();
 	setPositionMode(POSITION_TOPLEFT);
@@ -68,28 +69,38 @@ const String& ScreenLabel::getText() const {
 
 void ScreenLabel::updateTexture() {
 	
-	if(texture) {
-		CoreServices::getInstance()->getMaterialManager()->deleteTexture(texture);
-	}
-	
+	// the texture belongs to the font's glyph atlas and is shared with other labels
 	texture = NULL;
 	if(!label->getFont())
 		return;
 	if(!label->getFont()->isValid())
 		return;				
 	
-	texture = CoreServices::getInstance()->getMaterialManager()->createTextureFromImage(label, true, false);
+	texture = label->getGlyphAtlas()->getTexture();
+	label->updateGlyphMesh(mesh, 1.0, 0.0, 0.0, false, getCombinedColor());
 	setWidth(label->getWidth());
 	setHeight(label->getHeight());
-	setShapeSize(width, height);
-
+	rebuildTransformMatrix();
+	matrixDirty = true;
 }
 
 void ScreenLabel::Render() {
+	Renderer *renderer = CoreServices::getInstance()->getRenderer();
 	if(positionAtBaseline) {
-		CoreServices::getInstance()->getRenderer()->translate2D(0.0, -label->getBaselineAdjust() + label->getSize());
+		renderer->translate2D(0.0, -label->getBaselineAdjust() + label->getSize());
 	}
+	
+	if(label->getGlyphAtlas()) {
+		texture = label->getGlyphAtlas()->getTexture();
+		label->updateGlyphMesh(mesh, 1.0, 0.0, 0.0, false, getCombinedColor());
+	}
+	
+	// glyph quads are relative to the pen origin, move them to where the label image used to be
+	Number offsetX = -label->getXAdjust() - floor(width/2.0f);
+	Number offsetY = label->getBaselineAdjust() - floor(height/2.0f);
+	renderer->translate2D(offsetX, offsetY);
 	ScreenShape::Render();
+	renderer->translate2D(-offsetX, -offsetY);
 }
 
 void ScreenLabel::setText(const String& newText) {
@@ -22,6 +22,7 @@
 
 #include "PolyScreenManager.h"
 #include "PolyCoreServices.h"
+#include "PolyProfiler.h"
 #include "PolyRenderer.h"
 #include "PolyScreen.h"
 
@@ -58,6 +59,7 @@ void ScreenManager::handleEvent(Event *event) {
 }
 
 void ScreenManager::Render() {
+	ProfilerZone zone("ScreenManager::Render");
 	Renderer *renderer = CoreServices::getInstance()->getRenderer();
 	for(int i=0;i<screens.size();i++) {
 		if(screens[i]->enabled) {
@@ -79,6 +81,7 @@ void ScreenManager::Render() {
 }
 
 void ScreenManager::Update() {
+	ProfilerZone zone("ScreenManager::Update");
 	for(int i=0;i<screens.size();i++) {
 		if(screens[i]->enabled) {
 			screens[i]->Update();
@@ -358,7 +358,8 @@ void ScreenSprite::Update() {
 	currentFrame++;
 	if(currentFrame >= currentAnimation->numFrames) {
 		if(playingOnce) {
-			dispatchEvent(new Event(), Event::COMPLETE_EVENT);
+			Event completeEvent;
+			dispatchEventNoDelete(&completeEvent, Event::COMPLETE_EVENT);
 			return;			
 		} else {
 			currentFrame = 0;
@@ -35,14 +35,13 @@ ServerClient::~ServerClient() {
 	
 }
 
-ServerClientEvent *ServerClient::handlePacket(Packet *packet) {
-	ServerClientEvent *event = new ServerClientEvent();	
-	event->data = packet->data;
-	event->dataSize = packet->header.size;
-	event->dataType = packet->header.type;
-	event->client = this;
-	dispatchEvent(event, ServerClientEvent::EVENT_CLIENT_DATA);	
-	return event;
+void ServerClient::handlePacket(Packet *packet) {
+	ServerClientEvent event;	
+	event.data = packet->data;
+	event.dataSize = packet->header.size;
+	event.dataType = packet->header.type;
+	event.client = this;
+	dispatchEventNoDelete(&event, ServerClientEvent::EVENT_CLIENT_DATA);	
 }
 
 Server::Server(unsigned int port,  unsigned int rate, ServerWorld *world) : Peer(port) {
@@ -52,6 +51,7 @@ Server::Server(unsigned int port,  unsigned int rate, ServerWorld *world) : Peer
 }
 
 Server::~Server() {
+	delete rateTimer;
 }
 
 ServerClient *Server::getConnectedClient(PeerConnection *connection) {
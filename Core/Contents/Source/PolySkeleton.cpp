@@ -23,7 +23,10 @@
 #include "PolySkeleton.h"
 #include "PolyBezierCurve.h"
 #include "PolyBone.h"
+#include "PolyCore.h"
+#include "PolyCoreServices.h"
 #include "PolyLabel.h"
+#include "PolyQuaternionCurve.h"
 #include "PolySceneLabel.h"
 #include "PolySceneLine.h"
 #include "PolyTween.h"
@@ -36,15 +39,24 @@ Skeleton *Skeleton::BlankSkeleton() {
 }
 
 Skeleton::Skeleton(const String& fileName) : SceneEntity() {
+	skinningPaletteDirty = true;
+	animationUpdateInterval = 0;
+	animationTimeAccumulator = 0;
 	loadSkeleton(fileName);
 	currentAnimation = NULL;
 }
 
 Skeleton::Skeleton() {
 	currentAnimation = NULL;	
+	skinningPaletteDirty = true;
+	animationUpdateInterval = 0;
+	animationTimeAccumulator = 0;
 }
 
 Skeleton::~Skeleton() {
+	for(int i=0; i < animationStates.size(); i++) {
+		delete animationStates[i];
+	}
 }
 
 int Skeleton::getNumBones() const {
@@ -77,7 +89,7 @@ void Skeleton::enableBoneLabels(const String& labelFont, Number size, Number sca
 }
 
 void Skeleton::playAnimationByIndex(int index, bool once) {
-	if(index > animations.size()-1)
+	if(index < 0 || index >= animations.size())
 		return;
 		
 	SkeletonAnimation *anim = animations[index];
@@ -87,11 +99,8 @@ void Skeleton::playAnimationByIndex(int index, bool once) {
 	if(anim == currentAnimation && !once)
 		return;
 	
-	if(currentAnimation)
-		currentAnimation->Stop();
-	
 	currentAnimation = anim;
-	anim->Play(once);	
+	startAnimationState(anim, 0, 1.0, false, once, 0.0);
 }
 
 void Skeleton::playAnimation(const String& animName, bool once) {
@@ -102,11 +111,118 @@ void Skeleton::playAnimation(const String& animName, bool once) {
 	if(anim == currentAnimation && !once)
 		return;
 	
-	if(currentAnimation)
-		currentAnimation->Stop();
-		
 	currentAnimation = anim;
-	anim->Play(once);
+	startAnimationState(anim, 0, 1.0, false, once, 0.0);
+}
+
+void Skeleton::crossfadeAnimation(const String& animName, Number fadeTime, bool once) {
+	SkeletonAnimation *anim = getAnimation(animName);
+	if(!anim)
+		return;
+	
+	currentAnimation = anim;
+	startAnimationState(anim, 0, 1.0, false, once, fadeTime);
+}
+
+void Skeleton::playAnimationLayer(const String& animName, int layer, Number weight, bool additive, bool once, Number fadeTime) {
+	SkeletonAnimation *anim = getAnimation(animName);
+	if(!anim)
+		return;
+	if(layer < 1)
+		layer = 1;
+	startAnimationState(anim, layer, weight, additive, once, fadeTime);
+}
+
+void Skeleton::stopAnimationLayer(int layer, Number fadeTime) {
+	for(int i=0; i < animationStates.size(); i++) {
+		SkeletonAnimationState *state = animationStates[i];
+		if(state->layer != layer)
+			continue;
+		if(fadeTime > 0) {
+			state->targetWeight = 0;
+			state->fadeRate = state->weight / fadeTime;
+		} else {
+			delete state;
+			animationStates.erase(animationStates.begin()+i);
+			i--;
+		}
+	}
+	if(layer == 0)
+		currentAnimation = NULL;
+}
+
+void Skeleton::stopAnimations() {
+	for(int i=0; i < animationStates.size(); i++) {
+		delete animationStates[i];
+	}
+	animationStates.clear();
+	currentAnimation = NULL;
+}
+
+void Skeleton::setAnimationUpdateInterval(Number interval) {
+	animationUpdateInterval = interval;
+}
+
+Number Skeleton::getAnimationUpdateInterval() const {
+	return animationUpdateInterval;
+}
+
+void Skeleton::startAnimationState(SkeletonAnimation *animation, int layer, Number weight, bool additive, bool once, Number fadeTime) {
+	SkeletonAnimationState *newState = NULL;
+	
+	// everything else on the layer fades out, an animation that is
+	// already playing on it fades back in from its current weight
+	for(int i=0; i < animationStates.size(); i++) {
+		SkeletonAnimationState *state = animationStates[i];
+		if(state->layer != layer)
+			continue;
+		if(state->animation == animation) {
+			newState = state;
+			continue;
+		}
+		if(fadeTime > 0) {
+			state->targetWeight = 0;
+			state->fadeRate = state->weight / fadeTime;
+		} else {
+			delete state;
+			animationStates.erase(animationStates.begin()+i);
+			i--;
+		}
+	}
+	
+	if(!newState) {
+		newState = new SkeletonAnimationState(animation);
+		newState->layer = layer;
+		for(unsigned int i=0; i < animation->getNumBoneTracks(); i++) {
+			int boneIndex = -1;
+			Bone *targetBone = animation->getBoneTrack(i)->getTargetBone();
+			for(int j=0; j < bones.size(); j++) {
+				if(bones[j] == targetBone) {
+					boneIndex = j;
+					break;
+				}
+			}
+			newState->trackBones.push_back(boneIndex);
+		}
+		
+		// keep the states ordered by layer so they blend bottom up
+		int insertIndex = animationStates.size();
+		while(insertIndex > 0 && animationStates[insertIndex-1]->layer > layer) {
+			insertIndex--;
+		}
+		animationStates.insert(animationStates.begin()+insertIndex, newState);
+	} else if(once) {
+		newState->time = 0;
+	}
+	
+	newState->additive = additive;
+	newState->once = once;
+	newState->targetWeight = weight;
+	if(fadeTime > 0) {
+		newState->fadeRate = fabs(weight - newState->weight) / fadeTime;
+	} else {
+		newState->weight = weight;
+	}
 }
 
 SkeletonAnimation *Skeleton::getAnimation(const String& name) const {
@@ -118,10 +234,215 @@ SkeletonAnimation *Skeleton::getAnimation(const String& name) const {
 }
 
 void Skeleton::Update() {
+	updateAnimations(CoreServices::getInstance()->getCore()->getElapsed());
+	skinningPaletteDirty = true;
+}
+
+static void blendBonePose(BonePose &pose, const BonePose &target, Number weight) {
+	pose.position = pose.position + (target.position - pose.position) * weight;
+	pose.scale = pose.scale + (target.scale - pose.scale) * weight;
+	pose.rotation = Quaternion::Slerp(weight, pose.rotation, target.rotation, true);
+}
+
+static void addBonePose(BonePose &pose, const BonePose &target, const BonePose &bind, Number weight) {
+	pose.position = pose.position + (target.position - bind.position) * weight;
+	if(bind.scale.x != 0)
+		pose.scale.x *= 1.0 + (target.scale.x / bind.scale.x - 1.0) * weight;
+	if(bind.scale.y != 0)
+		pose.scale.y *= 1.0 + (target.scale.y / bind.scale.y - 1.0) * weight;
+	if(bind.scale.z != 0)
+		pose.scale.z *= 1.0 + (target.scale.z / bind.scale.z - 1.0) * weight;
+	Quaternion delta = bind.rotation.Inverse() * target.rotation;
+	pose.rotation = pose.rotation * Quaternion::Slerp(weight, Quaternion(), delta, true);
+}
+
+void Skeleton::updateAnimations(Number elapsed) {
+	if(animationStates.size() == 0)
+		return;
+	
+	animationTimeAccumulator += elapsed;
+	if(animationTimeAccumulator < animationUpdateInterval)
+		return;
+	elapsed = animationTimeAccumulator;
+	animationTimeAccumulator = 0;
+	
+	if(boneOrder.size() != bones.size()) {
+		buildBoneOrder();
+	}
+	
+	Number baseWeight = 0;
+	for(int i=0; i < animationStates.size(); i++) {
+		SkeletonAnimationState *state = animationStates[i];
+		Number duration = state->animation->getDuration();
+		state->time += elapsed * state->animation->getSpeed();
+		if(state->once) {
+			if(state->time > duration)
+				state->time = duration;
+		} else if(duration > 0) {
+			state->time = fmod(state->time, duration);
+			if(state->time < 0)
+				state->time += duration;
+		}
+		
+		if(state->weight < state->targetWeight) {
+			state->weight += state->fadeRate * elapsed;
+			if(state->weight > state->targetWeight)
+				state->weight = state->targetWeight;
+		} else if(state->weight > state->targetWeight) {
+			state->weight -= state->fadeRate * elapsed;
+			if(state->weight < state->targetWeight)
+				state->weight = state->targetWeight;
+		}
+		
+		if(state->weight <= 0 && state->targetWeight <= 0) {
+			delete state;
+			animationStates.erase(animationStates.begin()+i);
+			i--;
+			continue;
+		}
+		
+		if(state->layer == 0)
+			baseWeight += state->weight;
+	}
+	
+	// base layer states are averaged by weight, with the bind pose
+	// making up any weight they leave over
+	unsigned int boneCount = bones.size();
+	blendPoses = bindPoses;
+	Number blendedWeight = baseWeight < 1.0 ? 1.0 - baseWeight : 0.0;
+	
+	for(int i=0; i < animationStates.size(); i++) {
+		SkeletonAnimationState *state = animationStates[i];
+		if(state->weight <= 0)
+			continue;
+		
+		Number duration = state->animation->getDuration();
+		Number a = duration > 0 ? state->time / duration : 0;
+		
+		if(state->layer == 0) {
+			samplePoses = bindPoses;
+			for(int j=0; j < state->trackBones.size(); j++) {
+				int boneIndex = state->trackBones[j];
+				if(boneIndex >= 0)
+					state->animation->getBoneTrack(j)->samplePose(a, &samplePoses[boneIndex]);
+			}
+			blendedWeight += state->weight;
+			Number fraction = state->weight / blendedWeight;
+			for(unsigned int j=0; j < boneCount; j++) {
+				blendBonePose(blendPoses[j], samplePoses[j], fraction);
+			}
+		} else {
+			Number weight = state->weight > 1.0 ? 1.0 : state->weight;
+			for(int j=0; j < state->trackBones.size(); j++) {
+				int boneIndex = state->trackBones[j];
+				if(boneIndex < 0)
+					continue;
+				BonePose sample = bindPoses[boneIndex];
+				state->animation->getBoneTrack(j)->samplePose(a, &sample);
+				if(state->additive)
+					addBonePose(blendPoses[boneIndex], sample, bindPoses[boneIndex], weight);
+				else
+					blendBonePose(blendPoses[boneIndex], sample, weight);
+			}
+		}
+	}
+	
+	composeBoneMatrices();
+	skinningPaletteDirty = true;
+}
+
+void Skeleton::composeBoneMatrices() {
+	for(unsigned int i=0; i < bones.size(); i++) {
+		const BonePose &pose = blendPoses[i];
+		
+		// same as scale * rotation * translation, written out
+		Matrix4 boneMatrix = pose.rotation.createMatrix();
+		for(int j=0; j < 3; j++) {
+			boneMatrix.m[0][j] *= pose.scale.x;
+			boneMatrix.m[1][j] *= pose.scale.y;
+			boneMatrix.m[2][j] *= pose.scale.z;
+		}
+		boneMatrix.m[3][0] = pose.position.x;
+		boneMatrix.m[3][1] = pose.position.y;
+		boneMatrix.m[3][2] = pose.position.z;
+		
+		bones[i]->setBoneMatrix(boneMatrix);
+		bones[i]->setTransformByMatrixPure(boneMatrix);
+	}
+}
 
-	if(currentAnimation != NULL) {
-		currentAnimation->Update();
+void Skeleton::buildBoneOrder() {
+	// order the bones so that every parent comes before its children
+	boneOrder.clear();
+	std::vector<bool> placed(bones.size(), false);
+	std::vector<unsigned int> chain;
+	for(unsigned int i=0; i < bones.size(); i++) {
+		unsigned int boneIndex = i;
+		while(!placed[boneIndex]) {
+			chain.push_back(boneIndex);
+			placed[boneIndex] = true;
+			int parentIndex = bones[boneIndex]->parentBoneId;
+			if(parentIndex < 0 || parentIndex >= bones.size())
+				break;
+			boneIndex = parentIndex;
+		}
+		while(chain.size() > 0) {
+			boneOrder.push_back(chain.back());
+			chain.pop_back();
+		}
+	}
+	finalMatrices.resize(bones.size());
+	restMatrices.resize(bones.size());
+	
+	bindPoses.resize(bones.size());
+	for(unsigned int i=0; i < bones.size(); i++) {
+		bindPoses[i].position = bones[i]->getPosition();
+		bindPoses[i].rotation = bones[i]->getRotationQuat();
+		bindPoses[i].scale = bones[i]->getScale();
 	}
+
+	skinMatrices.resize(bones.size());
+	skinningPalette.resize(bones.size() * 16);
+}
+
+void Skeleton::updateSkinningPalette() {
+	if(boneOrder.size() != bones.size()) {
+		buildBoneOrder();
+	}
+	
+	for(unsigned int i=0; i < boneOrder.size(); i++) {
+		unsigned int boneIndex = boneOrder[i];
+		Bone *bone = bones[boneIndex];
+		int parentIndex = bone->parentBoneId;
+		if(parentIndex >= 0 && parentIndex < bones.size()) {
+			finalMatrices[boneIndex] = bone->boneMatrix * finalMatrices[parentIndex];
+		} else {
+			finalMatrices[boneIndex] = bone->boneMatrix;
+		}
+		
+		restMatrices[boneIndex] = bone->restMatrix;
+	}
+	
+	// the skin matrices do not depend on each other, so they are multiplied as one batch
+	unsigned int boneCount = bones.size();
+	if(boneCount > 0)
+		Matrix4::multiplyMatrices(&restMatrices[0], &finalMatrices[0], &skinMatrices[0], boneCount);
+	for(unsigned int i=0; i < boneCount; i++) {
+		float *paletteEntry = &skinningPalette[i * 16];
+		for(int j=0; j < 16; j++) {
+			paletteEntry[j] = skinMatrices[i].ml[j];
+		}
+	}
+	skinningPaletteDirty = false;
+}
+
+const float *Skeleton::getSkinningPalette() {
+	if(bones.size() == 0)
+		return NULL;
+	if(skinningPaletteDirty || boneOrder.size() != bones.size()) {
+		updateSkinningPalette();
+	}
+	return &skinningPalette[0];
 }
 
 void Skeleton::loadSkeleton(const String& fileName) {
@@ -303,6 +624,8 @@ BoneTrack::BoneTrack(Bone *bone, Number length) {
 	LocX = NULL;			
 	LocY = NULL;
 	LocZ = NULL;
+	quatTween = NULL;
+	quatCurve = NULL;
 	initialized = false;
 }
 
@@ -317,6 +640,50 @@ BoneTrack::~BoneTrack() {
 	delete LocX;
 	delete LocY;
 	delete LocZ;
+	delete quatCurve;
+}
+
+Bone *BoneTrack::getTargetBone() const {
+	return targetBone;
+}
+
+void BoneTrack::samplePose(Number a, BonePose *pose) {
+	if(LocX)
+		pose->position.x = LocX->getPointAt(a).y;
+	if(LocY)
+		pose->position.y = LocY->getPointAt(a).y;
+	if(LocZ)
+		pose->position.z = LocZ->getPointAt(a).y;
+	
+	if(scaleX)
+		pose->scale.x = scaleX->getPointAt(a).y;
+	if(scaleY)
+		pose->scale.y = scaleY->getPointAt(a).y;
+	if(scaleZ)
+		pose->scale.z = scaleZ->getPointAt(a).y;
+	
+	if(QuatW && QuatX && QuatY && QuatZ) {
+		unsigned int numPoints = QuatW->getNumControlPoints();
+		if(numPoints == 0)
+			return;
+		if(!quatCurve)
+			quatCurve = new QuaternionCurve(QuatW, QuatX, QuatY, QuatZ);
+		
+		// QuaternionCurve::interpolate(t) has no segment after the last
+		// point, so the end of the track is sampled from the one before it
+		unsigned int segment = 0;
+		Number t = 0;
+		if(numPoints > 1) {
+			Number position = a * (numPoints - 1);
+			segment = (unsigned int)position;
+			t = position - segment;
+			if(segment >= numPoints - 1) {
+				segment = numPoints - 2;
+				t = 1.0;
+			}
+		}
+		pose->rotation = quatCurve->interpolate(segment, t, true);
+	}
 }
 
 
@@ -418,21 +785,55 @@ void BoneTrack::setSpeed(Number speed) {
 	for(int i=0; i < pathTweens.size(); i++) {
 		pathTweens[i]->setSpeed(speed);
 	}	
-	quatTween->setSpeed(speed);
+	if(quatTween)
+		quatTween->setSpeed(speed);
+}
+
+BonePose::BonePose() : scale(1,1,1) {
 }
 
+SkeletonAnimationState::SkeletonAnimationState(SkeletonAnimation *animation) {
+	this->animation = animation;
+	time = 0;
+	weight = 0;
+	targetWeight = 0;
+	fadeRate = 0;
+	layer = 0;
+	additive = false;
+	once = false;
+}
 
 SkeletonAnimation::SkeletonAnimation(const String& name, Number duration) {
 	this->name = name;
 	this->duration = duration;
+	speed = 1.0;
 }
 
 void SkeletonAnimation::setSpeed(Number speed) {
+	this->speed = speed;
 	for(int i=0; i < boneTracks.size(); i++) {
 		boneTracks[i]->setSpeed(speed);
 	}	
 }
 
+Number SkeletonAnimation::getSpeed() const {
+	return speed;
+}
+
+Number SkeletonAnimation::getDuration() const {
+	return duration;
+}
+
+unsigned int SkeletonAnimation::getNumBoneTracks() const {
+	return boneTracks.size();
+}
+
+BoneTrack *SkeletonAnimation::getBoneTrack(unsigned int index) const {
+	if(index < boneTracks.size())
+		return boneTracks[index];
+	return NULL;
+}
+
 void SkeletonAnimation::Update() {
 	for(int i=0; i < boneTracks.size(); i++) {
 		boneTracks[i]->Update();
@@ -124,21 +124,20 @@ bool Socket::sendData(const Address &address, char *data, unsigned int packetSiz
 
 int Socket::receiveData() {
 	
-	SocketEvent *event = new SocketEvent();	
+	// the receive event is reused for every packet, listeners must copy any data they keep
 	sockaddr_in from;
 	socklen_t fromLength = sizeof( from );
 	
-	int received_bytes = recvfrom( sockId, (char*)event->data, MAX_PACKET_SIZE,
+	int received_bytes = recvfrom( sockId, (char*)receiveEvent.data, MAX_PACKET_SIZE,
 								  0, (sockaddr*)&from, &fromLength );
 	
 	if ( received_bytes <= 0 ) {
-		delete event;
 		return received_bytes; 
 	}
 	
-	event->dataSize = received_bytes;
-	event->fromAddress = Address(ntohl( from.sin_addr.s_addr ), ntohs( from.sin_port ));
-	dispatchEvent(event, SocketEvent::EVENT_DATA_RECEIVED);
+	receiveEvent.dataSize = received_bytes;
+	receiveEvent.fromAddress = Address(ntohl( from.sin_addr.s_addr ), ntohs( from.sin_port ));
+	dispatchEventNoDelete(&receiveEvent, SocketEvent::EVENT_DATA_RECEIVED);
 	return received_bytes;
 }
 
@@ -26,6 +26,8 @@
 #undef OV_EXCLUDE_STATIC_CALLBACKS
 #include "PolyString.h"
 #include "PolyLogger.h"
+#include "PolyCoreServices.h"
+#include "PolySoundManager.h"
 
 #include "OSBasics.h"
 #include <string>
@@ -57,7 +59,152 @@ long custom_tellfunc(void *datasource) {
 	return OSBasics::tell(file);
 }
 
-Sound::Sound(const String& fileName) :  referenceDistance(1), maxDistance(MAX_FLOAT), pitch(1), volume(1), sampleLength(-1) {
+SoundStream::SoundStream() {
+	oggFile = NULL;
+	channels = 0;
+	frequency = 0;
+	totalSamples = 0;
+	duration = 0.0;
+	for(int i=0; i < STREAM_BUFFER_COUNT; i++) {
+		chunkStart[i] = 0;
+		chunkReady[i] = false;
+	}
+	readIndex = 0;
+	writeIndex = 0;
+	loop = false;
+	finished = false;
+	decoding = false;
+	generation = 0;
+	seekPending = false;
+	seekSample = 0;
+	decodeGeneration = 0;
+	decodeIndex = 0;
+	decodeSeek = false;
+	decodeSeekSample = 0;
+	decodeLoop = false;
+	decodeEnded = false;
+	decodeStart = 0;
+}
+
+SoundStream::~SoundStream() {
+	if(oggFile) {
+		ov_clear((OggVorbis_File*)oggFile);
+		delete (OggVorbis_File*)oggFile;
+	}
+}
+
+bool SoundStream::open(const String& fileName) {
+	OSFILE *f = OSBasics::open(fileName.c_str(), "rb");
+	if(!f) {
+		Logger::log("SOUND ERROR: Error loading OGG file %s\n", fileName.c_str());
+		return false;
+	}
+	
+	ov_callbacks callbacks;
+	callbacks.read_func = custom_readfunc;
+	callbacks.seek_func = custom_seekfunc;
+	callbacks.close_func = custom_closefunc;
+	callbacks.tell_func = custom_tellfunc;
+	
+	OggVorbis_File *file = new OggVorbis_File;
+	if(ov_open_callbacks((void*)f, file, NULL, 0, callbacks) != 0) {
+		Logger::log("SOUND ERROR: %s is not an OGG file\n", fileName.c_str());
+		OSBasics::close(f);
+		delete file;
+		return false;
+	}
+	oggFile = file;
+	
+	vorbis_info *pInfo = ov_info(file, -1);
+	channels = pInfo->channels;
+	frequency = pInfo->rate;
+	totalSamples = ov_pcm_total(file, -1);
+	duration = ov_time_total(file, -1);
+	return true;
+}
+
+void SoundStream::seek(long sample) {
+	generation++;
+	seekPending = true;
+	seekSample = sample;
+	for(int i=0; i < STREAM_BUFFER_COUNT; i++) {
+		chunkReady[i] = false;
+	}
+	readIndex = 0;
+	writeIndex = 0;
+	finished = false;
+}
+
+bool SoundStream::beginDecode() {
+	if(decoding || !oggFile)
+		return false;
+	if(!seekPending && (finished || chunkReady[writeIndex]))
+		return false;
+	
+	decoding = true;
+	decodeGeneration = generation;
+	decodeIndex = writeIndex;
+	decodeSeek = seekPending;
+	decodeSeekSample = seekSample;
+	decodeLoop = loop;
+	seekPending = false;
+	return true;
+}
+
+void SoundStream::decode() {
+	OggVorbis_File *file = (OggVorbis_File*)oggFile;
+	int endian = 0;             // 0 for Little-Endian, 1 for Big-Endian
+	int bitStream;
+	
+	if(decodeSeek) {
+		ov_pcm_seek(file, decodeSeekSample);
+	}
+	
+	decodeStart = ov_pcm_tell(file);
+	decodeEnded = false;
+	decodeData.resize(STREAM_BUFFER_SIZE);
+	
+	unsigned int size = 0;
+	bool rewound = false;
+	while(size < STREAM_BUFFER_SIZE) {
+		long bytes = ov_read(file, &decodeData[size], STREAM_BUFFER_SIZE - size, endian, 2, 1, &bitStream);
+		if(bytes > 0) {
+			size += bytes;
+			rewound = false;
+		} else if(bytes == OV_HOLE) {
+			continue;
+		} else if(decodeLoop && !rewound && totalSamples > 0) {
+			// rewinding twice in a row means the file has no samples at all
+			ov_pcm_seek(file, 0);
+			rewound = true;
+		} else {
+			decodeEnded = true;
+			break;
+		}
+	}
+	decodeData.resize(size);
+}
+
+void SoundStream::endDecode() {
+	decoding = false;
+	if(decodeGeneration != generation)
+		return;
+	
+	if(decodeData.size() > 0) {
+		chunkData[decodeIndex].swap(decodeData);
+		chunkStart[decodeIndex] = decodeStart;
+		chunkReady[decodeIndex] = true;
+		writeIndex = (writeIndex + 1) % STREAM_BUFFER_COUNT;
+	}
+	if(decodeEnded) {
+		finished = true;
+	}
+}
+
+Sound::Sound() : referenceDistance(1), maxDistance(MAX_FLOAT), pitch(1), volume(1), soundLoaded(false), buffer(AL_NONE), bufferCached(false), soundSource(AL_NONE), sampleLength(-1), soundManager(NULL), stream(NULL) {
+}
+
+Sound::Sound(const String& fileName) :  referenceDistance(1), maxDistance(MAX_FLOAT), pitch(1), volume(1), buffer(AL_NONE), bufferCached(false), soundSource(AL_NONE), sampleLength(-1), soundManager(NULL), stream(NULL) {
 	checkALError("Construct: Loose error before construction");
 	soundLoaded = false;	
 
@@ -68,7 +215,7 @@ Sound::Sound(const String& fileName) :  referenceDistance(1), maxDistance(MAX_FL
 	checkALError("Construct from file: Finished");
 }
 
-Sound::Sound(const char *data, int size, int channels, int freq, int bps) : referenceDistance(1), maxDistance(MAX_FLOAT), pitch(1), volume(1), buffer(AL_NONE), soundSource(AL_NONE), sampleLength(-1) {
+Sound::Sound(const char *data, int size, int channels, int freq, int bps) : referenceDistance(1), maxDistance(MAX_FLOAT), pitch(1), volume(1), buffer(AL_NONE), bufferCached(false), soundSource(AL_NONE), sampleLength(-1), soundManager(NULL), stream(NULL) {
 	checkALError("Construct: Loose error before construction");
 	buffer = loadBytes(data, size, freq, channels, bps);
 	
@@ -82,11 +229,51 @@ Sound::Sound(const char *data, int size, int channels, int freq, int bps) : refe
 	checkALError("Construct from data: Finished");
 }
 
-void Sound::loadFile(String fileName) {
+Sound *Sound::createStreamed(const String& fileName) {
+	Sound *sound = new Sound();
+	sound->checkALError("Construct: Loose error before construction");
+	sound->loadFile(fileName, true);
+	sound->setIsPositional(false);
+	sound->checkALError("Construct streamed: Finished");
+	return sound;
+}
 
-	if(soundLoaded) {
-		alDeleteSources(1,&soundSource);	
+void Sound::unloadSound() {
+	if(!soundLoaded)
+		return;
+	
+	if(stream) {
+		soundManager->removeStreamedSound(this);
+	}
+	
+	alDeleteSources(1,&soundSource);
+	checkALError("Destroying sound");
+	
+	if(stream) {
+		alDeleteBuffers(streamBuffers.size(), &streamBuffers[0]);
+		delete stream;
+		stream = NULL;
+		streamBuffers.clear();
+		freeStreamBuffers.clear();
+		queuedStreamChunks.clear();
+	} else if(bufferCached) {
+		soundManager->releaseCachedBuffer(buffer);
+	} else {
+		alDeleteBuffers(1, &buffer);
 	}
+	checkALError("Deleting buffer");
+	
+	buffer = AL_NONE;
+	bufferCached = false;
+	soundSource = AL_NONE;
+	sampleLength = -1;
+	soundLoaded = false;
+}
+
+void Sound::loadFile(String fileName, bool streamed) {
+
+	unloadSound();
+	soundManager = CoreServices::getInstance()->getSoundManager();
 
 	String actualFilename = fileName;
 	OSFILE *test = OSBasics::open(fileName, "rb");
@@ -105,13 +292,49 @@ void Sound::loadFile(String fileName) {
 		extension = "";
 	}
 	
-	if(extension == "wav" || extension == "WAV") {
-		buffer = loadWAV(actualFilename);			
-	} else if(extension == "ogg" || extension == "OGG") {
-		buffer = loadOGG(actualFilename);			
+	this->fileName = actualFilename;
+	
+	if(streamed && (extension == "ogg" || extension == "OGG")) {
+		stream = new SoundStream();
+		if(stream->open(actualFilename)) {
+			streamFormat = (stream->channels == 1) ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
+			sampleLength = stream->totalSamples * stream->channels;
+			streamPlaying = false;
+			streamRewound = true;
+			streamPosition = 0;
+			
+			streamBuffers.resize(STREAM_BUFFER_COUNT);
+			alGenBuffers(STREAM_BUFFER_COUNT, &streamBuffers[0]);
+			checkALError("Stream: generate buffers");
+			freeStreamBuffers = streamBuffers;
+			
+			soundSource = GenSource();
+			soundManager->addStreamedSound(this);
+			
+			reloadProperties();
+			soundLoaded = true;
+			checkALError("Sound load: complete");
+			return;
+		}
+		delete stream;
+		stream = NULL;
 	}
 	
-	this->fileName = actualFilename;
+	// sounds loaded from the same file share one buffer
+	buffer = soundManager->getCachedBuffer(actualFilename, &sampleLength);
+	if(buffer == AL_NONE) {
+		if(extension == "wav" || extension == "WAV") {
+			buffer = loadWAV(actualFilename);			
+		} else if(extension == "ogg" || extension == "OGG") {
+			buffer = loadOGG(actualFilename);			
+		}
+		if(buffer != AL_NONE) {
+			soundManager->addCachedBuffer(actualFilename, buffer, sampleLength);
+			bufferCached = true;
+		}
+	} else {
+		bufferCached = true;
+	}
 	
 	soundSource = GenSource(buffer);	
 	
@@ -122,6 +345,99 @@ void Sound::loadFile(String fileName) {
 	checkALError("Sound load: complete");
 }
 
+Sound *Sound::createFromSamples(const String& fileName, const std::vector<char> &data, int channels, int frequency) {
+	Sound *sound = new Sound();
+	sound->checkALError("Construct: Loose error before construction");
+	sound->soundManager = CoreServices::getInstance()->getSoundManager();
+	sound->fileName = fileName;
+	
+	// sounds loaded from the same file share one buffer
+	sound->buffer = sound->soundManager->getCachedBuffer(fileName, &sound->sampleLength);
+	if(sound->buffer == AL_NONE) {
+		sound->loadBytes(&data[0], data.size(), frequency, channels, 16);
+		sound->soundManager->addCachedBuffer(fileName, sound->buffer, sound->sampleLength);
+	}
+	sound->bufferCached = true;
+	
+	sound->soundSource = sound->GenSource(sound->buffer);
+	sound->setIsPositional(false);
+	sound->reloadProperties();
+	sound->soundLoaded = true;
+	
+	sound->checkALError("Construct from samples: Finished");
+	return sound;
+}
+
+bool Sound::isStreamed() {
+	return (stream != NULL);
+}
+
+SoundStream *Sound::getStream() {
+	return stream;
+}
+
+void Sound::resetStream(long sample) {
+	alSourceStop(soundSource);
+	// detaching the buffers of a stopped source empties its queue
+	alSourcei(soundSource, AL_BUFFER, 0);
+	checkALError("Stream: reset");
+	freeStreamBuffers = streamBuffers;
+	queuedStreamChunks.clear();
+	
+	soundManager->lockStreams();
+	stream->seek(sample);
+	soundManager->notifyStreams();
+	soundManager->unlockStreams();
+	streamPosition = sample;
+}
+
+void Sound::updateStream() {
+	if(!stream || !streamPlaying)
+		return;
+	
+	ALint processed = 0;
+	alGetSourcei(soundSource, AL_BUFFERS_PROCESSED, &processed);
+	while(processed > 0 && queuedStreamChunks.size() > 0) {
+		ALuint processedBuffer;
+		alSourceUnqueueBuffers(soundSource, 1, &processedBuffer);
+		freeStreamBuffers.push_back(processedBuffer);
+		streamPosition = queuedStreamChunks.front().first + queuedStreamChunks.front().second;
+		if(stream->totalSamples > 0)
+			streamPosition %= stream->totalSamples;
+		queuedStreamChunks.pop_front();
+		processed--;
+	}
+	
+	soundManager->lockStreams();
+	while(freeStreamBuffers.size() > 0 && stream->chunkReady[stream->readIndex]) {
+		std::vector<char> &data = stream->chunkData[stream->readIndex];
+		ALuint streamBuffer = freeStreamBuffers.back();
+		freeStreamBuffers.pop_back();
+		alBufferData(streamBuffer, streamFormat, &data[0], static_cast<ALsizei>(data.size()), stream->frequency);
+		alSourceQueueBuffers(soundSource, 1, &streamBuffer);
+		queuedStreamChunks.push_back(std::pair<long, long>(stream->chunkStart[stream->readIndex], data.size() / (2 * stream->channels)));
+		stream->chunkReady[stream->readIndex] = false;
+		stream->readIndex = (stream->readIndex + 1) % STREAM_BUFFER_COUNT;
+		streamRewound = false;
+		soundManager->notifyStreams();
+	}
+	bool drained = stream->finished && !stream->chunkReady[stream->readIndex];
+	soundManager->unlockStreams();
+	checkALError("Stream: queue buffers");
+	
+	ALint state;
+	alGetSourcei(soundSource, AL_SOURCE_STATE, &state);
+	if(state != AL_PLAYING) {
+		if(queuedStreamChunks.size() > 0) {
+			// starts playback, or resumes it if decoding fell behind
+			alSourcePlay(soundSource);
+			checkALError("Stream: play");
+		} else if(drained) {
+			streamPlaying = false;
+		}
+	}
+}
+
 void Sound::reloadProperties() { // Re-set stored properties into sound source.
 	setVolume(volume);
 	setPitch(pitch);
@@ -143,10 +459,7 @@ Number Sound::getPitch() {
 }
 
 Sound::~Sound() {
-	alDeleteSources(1,&soundSource);
-	checkALError("Destroying sound");
-	alDeleteBuffers(1, &buffer);
-	checkALError("Deleting buffer");
+	unloadSound();
 }
 
 void Sound::soundCheck(bool result, const String& err) {
@@ -175,6 +488,25 @@ unsigned short Sound::readByte16(const unsigned char data[2]) {
 }
 
 void Sound::Play(bool loop) {
+	if(stream) {
+		soundManager->lockStreams();
+		stream->loop = loop;
+		if(loop) {
+			stream->finished = false;
+			soundManager->notifyStreams();
+		}
+		soundManager->unlockStreams();
+		
+		// like alSourcePlay, playing again starts over unless the sound was just seeked
+		if(!streamRewound) {
+			resetStream(0);
+		}
+		streamRewound = false;
+		streamPlaying = true;
+		updateStream();
+		return;
+	}
+	
 	if(!loop) {
 		alSourcei(soundSource, AL_LOOPING, AL_FALSE);
 	} else {
@@ -186,6 +518,8 @@ void Sound::Play(bool loop) {
 }
 
 bool Sound::isPlaying() {
+	if(stream)
+		return streamPlaying;
 	ALenum state;
 	alGetSourcei(soundSource, AL_SOURCE_STATE, &state);
 	return (state == AL_PLAYING);
@@ -223,17 +557,30 @@ void Sound::setSoundDirection(Vector3 direction) {
 }
 
 void Sound::setOffset(int off) {
+	if(stream) {
+		if(stream->frequency > 0)
+			seekTo((Number)off / (Number)stream->frequency);
+		return;
+	}
 	alSourcei(soundSource, AL_SAMPLE_OFFSET, off);
 }
 
 
 Number Sound::getPlaybackTime() {
+	if(stream) {
+		if(stream->frequency == 0)
+			return 0.0;
+		return (Number)getOffset() / (Number)stream->frequency;
+	}
 	float result = 0.0;
 	alGetSourcef(soundSource, AL_SEC_OFFSET, &result);
 	return result;
 }
 
 Number Sound::getPlaybackDuration() {
+	if(stream)
+		return stream->duration;
+	
 	ALint sizeInBytes;
 	ALint channels;
 	ALint bits;
@@ -254,6 +601,17 @@ Number Sound::getPlaybackDuration() {
 }
 		
 int Sound::getOffset() {
+	if(stream) {
+		if(queuedStreamChunks.size() == 0)
+			return streamPosition;
+		ALint queueOffset = 0;
+		alGetSourcei(soundSource, AL_SAMPLE_OFFSET, &queueOffset);
+		long position = queuedStreamChunks.front().first + queueOffset;
+		if(stream->totalSamples > 0)
+			position %= stream->totalSamples;
+		return position;
+	}
+	
 	ALint off = -1;
 	alGetSourcei(soundSource, AL_SAMPLE_OFFSET, &off);
 	return off;
@@ -262,6 +620,11 @@ int Sound::getOffset() {
 void Sound::seekTo(Number time) {
 	if(time > getPlaybackDuration())
 		return;
+	if(stream) {
+		resetStream(time * stream->frequency);
+		streamRewound = true;
+		return;
+	}
 	alSourcef(soundSource, AL_SEC_OFFSET, time);
 	checkALError("Seek");
 }
@@ -337,6 +700,12 @@ ALenum Sound::checkALError(const String& operation) {
 }
 
 void Sound::Stop() {
+	if(stream) {
+		streamPlaying = false;
+		resetStream(0);
+		streamRewound = true;
+		return;
+	}
 	alSourceStop(soundSource);
 	checkALError("Stop");
 }
@@ -391,23 +760,18 @@ ALuint Sound::loadBytes(const char *data, int size, int freq, int channels, int
 	return buffer;
 }
 
-ALuint Sound::loadOGG(const String& fileName) {
-	vector<char> data;
-	
-	alGenBuffers(1, &buffer);
+bool Sound::decodeOGG(const String& fileName, std::vector<char> &data, int *channels, int *frequency) {
 	int endian = 0;             // 0 for Little-Endian, 1 for Big-Endian
 	int bitStream;
 	long bytes;
 	char array[BUFFER_SIZE];    // Local fixed size array
 	OSFILE *f;
-	ALenum format;
-	ALsizei freq;
 	
 	// Open for binary reading
 	f = OSBasics::open(fileName.c_str(), "rb");		
 	if(!f) {
-		soundError("Error loading OGG file!\n");
-		return buffer;
+		Logger::log("SOUND ERROR: Error loading OGG file %s\n", fileName.c_str());
+		return false;
 	}
 	vorbis_info *pInfo;
 	OggVorbis_File oggFile;	
@@ -418,28 +782,53 @@ ALuint Sound::loadOGG(const String& fileName) {
 	callbacks.close_func = custom_closefunc;
 	callbacks.tell_func = custom_tellfunc;
 	
-	ov_open_callbacks( (void*)f, &oggFile, NULL, 0, callbacks);
+	if(ov_open_callbacks( (void*)f, &oggFile, NULL, 0, callbacks) != 0) {
+		Logger::log("SOUND ERROR: %s is not an OGG file\n", fileName.c_str());
+		OSBasics::close(f);
+		return false;
+	}
 //	ov_open(f, &oggFile, NULL, 0);
 	// Get some information about the OGG file
 	pInfo = ov_info(&oggFile, -1);
 	
-	// Check the number of channels... always use 16-bit samples
-	if (pInfo->channels == 1)
-		format = AL_FORMAT_MONO16;
-	else
-		format = AL_FORMAT_STEREO16;
-	// end if
+	*channels = pInfo->channels;
 	
 	// The frequency of the sampling rate
-	freq = pInfo->rate;	
+	*frequency = pInfo->rate;	
 	do {
 		// Read up to a buffer's worth of decoded sound data
 		bytes = ov_read(&oggFile, array, BUFFER_SIZE, endian, 2, 1, &bitStream);
 		// Append to end of buffer
-		data.insert(data.end(), array, array + bytes);
+		if(bytes > 0)
+			data.insert(data.end(), array, array + bytes);
 	} while (bytes > 0);
 	ov_clear(&oggFile);
 	
+	return true;
+}
+
+ALuint Sound::loadOGG(const String& fileName) {
+	vector<char> data;
+	int channels;
+	int freq;
+	
+	alGenBuffers(1, &buffer);
+	
+	if(!decodeOGG(fileName, data, &channels, &freq) || data.size() == 0) {
+		soundError("Error loading OGG file!\n");
+		alDeleteBuffers(1, &buffer);
+		buffer = AL_NONE;
+		return buffer;
+	}
+	
+	// Check the number of channels... always use 16-bit samples
+	ALenum format;
+	if (channels == 1)
+		format = AL_FORMAT_MONO16;
+	else
+		format = AL_FORMAT_STEREO16;
+	// end if
+	
 	sampleLength = data.size() / sizeof(unsigned short);
 	
 	alBufferData(buffer, format, &data[0], static_cast<ALsizei>(data.size()), freq);
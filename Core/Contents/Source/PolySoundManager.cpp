@@ -21,14 +21,248 @@
 */
 
 #include "PolySoundManager.h"
+#include "PolyCore.h"
+#include "PolyCoreServices.h"
 #include "PolyLogger.h"
+#include "PolySound.h"
+
+#if defined(_WINDOWS)
+	#include <windows.h>
+#else
+	#include <pthread.h>
+	#include <unistd.h>
+#endif
 
 using namespace Polycode;
 
+static void sleepWorker() {
+#if defined(_WINDOWS)
+	Sleep(1);
+#else
+	usleep(1000);
+#endif
+}
+
+SoundStreamWorker::SoundStreamWorker(SoundManager *manager) : Threaded() {
+	this->manager = manager;
+	threadStopped = false;
+}
+
+SoundStreamWorker::~SoundStreamWorker() {
+
+}
+
+void SoundStreamWorker::runThread() {
+	Threaded::runThread();
+	threadStopped = true;
+}
+
+void SoundStreamWorker::updateThread() {
+	manager->decodeStreams();
+}
+
 SoundManager::SoundManager() {
+	unusedBufferBytes = 0;
+	soundCacheSize = 8 * 1024 * 1024;
+	bufferUseCounter = 0;
+	nextStream = 0;
+	streamWorker = NULL;
+	streamsChanged = false;
+	
+#if defined(_WINDOWS)
+	streamMutex = new CRITICAL_SECTION;
+	InitializeCriticalSection((CRITICAL_SECTION*)streamMutex);
+	streamCondition = new CONDITION_VARIABLE;
+	InitializeConditionVariable((CONDITION_VARIABLE*)streamCondition);
+	decodeCondition = new CONDITION_VARIABLE;
+	InitializeConditionVariable((CONDITION_VARIABLE*)decodeCondition);
+#else
+	streamMutex = new pthread_mutex_t;
+	pthread_mutex_init((pthread_mutex_t*)streamMutex, NULL);
+	streamCondition = new pthread_cond_t;
+	pthread_cond_init((pthread_cond_t*)streamCondition, NULL);
+	decodeCondition = new pthread_cond_t;
+	pthread_cond_init((pthread_cond_t*)decodeCondition, NULL);
+#endif
+	
 	initAL();
 }
 
+void SoundManager::Update() {
+	for(int i=0; i < streamedSounds.size(); i++) {
+		streamedSounds[i]->updateStream();
+	}
+}
+
+void SoundManager::lockStreams() {
+#if defined(_WINDOWS)
+	EnterCriticalSection((CRITICAL_SECTION*)streamMutex);
+#else
+	pthread_mutex_lock((pthread_mutex_t*)streamMutex);
+#endif
+}
+
+void SoundManager::unlockStreams() {
+#if defined(_WINDOWS)
+	LeaveCriticalSection((CRITICAL_SECTION*)streamMutex);
+#else
+	pthread_mutex_unlock((pthread_mutex_t*)streamMutex);
+#endif
+}
+
+void SoundManager::notifyStreams() {
+	streamsChanged = true;
+#if defined(_WINDOWS)
+	WakeConditionVariable((CONDITION_VARIABLE*)streamCondition);
+#else
+	pthread_cond_signal((pthread_cond_t*)streamCondition);
+#endif
+}
+
+void SoundManager::addStreamedSound(Sound *sound) {
+	if(!streamWorker) {
+		streamWorker = new SoundStreamWorker(this);
+		CoreServices::getInstance()->getCore()->createThread(streamWorker);
+	}
+	lockStreams();
+	streamedSounds.push_back(sound);
+	notifyStreams();
+	unlockStreams();
+}
+
+void SoundManager::removeStreamedSound(Sound *sound) {
+	lockStreams();
+	// wait for the stream thread to finish a chunk it is decoding for this sound
+	while(sound->getStream()->decoding) {
+#if defined(_WINDOWS)
+		SleepConditionVariableCS((CONDITION_VARIABLE*)decodeCondition, (CRITICAL_SECTION*)streamMutex, INFINITE);
+#else
+		pthread_cond_wait((pthread_cond_t*)decodeCondition, (pthread_mutex_t*)streamMutex);
+#endif
+	}
+	for(int i=0; i < streamedSounds.size(); i++) {
+		if(streamedSounds[i] == sound) {
+			streamedSounds.erase(streamedSounds.begin()+i);
+			break;
+		}
+	}
+	unlockStreams();
+}
+
+bool SoundManager::decodeStreams() {
+	SoundStream *stream = NULL;
+	
+	lockStreams();
+	for(int i=0; i < streamedSounds.size(); i++) {
+		SoundStream *candidate = streamedSounds[(nextStream + i) % streamedSounds.size()]->getStream();
+		if(candidate->beginDecode()) {
+			stream = candidate;
+			nextStream = (nextStream + i + 1) % streamedSounds.size();
+			break;
+		}
+	}
+	
+	if(!stream) {
+		// nothing needs data until a chunk is consumed, a stream is added or a sound seeks
+		if(!streamsChanged) {
+#if defined(_WINDOWS)
+			SleepConditionVariableCS((CONDITION_VARIABLE*)streamCondition, (CRITICAL_SECTION*)streamMutex, INFINITE);
+#else
+			pthread_cond_wait((pthread_cond_t*)streamCondition, (pthread_mutex_t*)streamMutex);
+#endif
+		}
+		streamsChanged = false;
+		unlockStreams();
+		return false;
+	}
+	unlockStreams();
+	
+	stream->decode();
+	
+	lockStreams();
+	stream->endDecode();
+#if defined(_WINDOWS)
+	WakeAllConditionVariable((CONDITION_VARIABLE*)decodeCondition);
+#else
+	pthread_cond_broadcast((pthread_cond_t*)decodeCondition);
+#endif
+	unlockStreams();
+	return true;
+}
+
+ALuint SoundManager::getCachedBuffer(const String& fileName, int *sampleLength) {
+	for(int i=0; i < cachedBuffers.size(); i++) {
+		if(cachedBuffers[i].fileName == fileName) {
+			if(cachedBuffers[i].refCount == 0) {
+				unusedBufferBytes -= cachedBuffers[i].size;
+			}
+			cachedBuffers[i].refCount++;
+			*sampleLength = cachedBuffers[i].sampleLength;
+			return cachedBuffers[i].buffer;
+		}
+	}
+	return AL_NONE;
+}
+
+void SoundManager::addCachedBuffer(const String& fileName, ALuint buffer, int sampleLength) {
+	SoundBufferEntry entry;
+	entry.fileName = fileName;
+	entry.buffer = buffer;
+	entry.sampleLength = sampleLength;
+	ALint size = 0;
+	alGetBufferi(buffer, AL_SIZE, &size);
+	entry.size = size;
+	entry.refCount = 1;
+	entry.lastUsed = 0;
+	cachedBuffers.push_back(entry);
+}
+
+void SoundManager::releaseCachedBuffer(ALuint buffer) {
+	for(int i=0; i < cachedBuffers.size(); i++) {
+		if(cachedBuffers[i].buffer == buffer) {
+			cachedBuffers[i].refCount--;
+			if(cachedBuffers[i].refCount == 0) {
+				cachedBuffers[i].lastUsed = ++bufferUseCounter;
+				unusedBufferBytes += cachedBuffers[i].size;
+				evictUnusedBuffers();
+			}
+			return;
+		}
+	}
+}
+
+void SoundManager::setSoundCacheSize(unsigned int bytes) {
+	soundCacheSize = bytes;
+	evictUnusedBuffers();
+}
+
+void SoundManager::evictUnusedBuffers() {
+	while(unusedBufferBytes > soundCacheSize) {
+		int oldest = -1;
+		for(int i=0; i < cachedBuffers.size(); i++) {
+			if(cachedBuffers[i].refCount == 0 && (oldest == -1 || cachedBuffers[i].lastUsed < cachedBuffers[oldest].lastUsed)) {
+				oldest = i;
+			}
+		}
+		if(oldest == -1)
+			break;
+		unusedBufferBytes -= cachedBuffers[oldest].size;
+		alDeleteBuffers(1, &cachedBuffers[oldest].buffer);
+		cachedBuffers.erase(cachedBuffers.begin()+oldest);
+	}
+}
+
+void SoundManager::clearUnusedBuffers() {
+	for(int i=0; i < cachedBuffers.size(); i++) {
+		if(cachedBuffers[i].refCount == 0) {
+			alDeleteBuffers(1, &cachedBuffers[i].buffer);
+			cachedBuffers.erase(cachedBuffers.begin()+i);
+			i--;
+		}
+	}
+	unusedBufferBytes = 0;
+}
+
 void SoundManager::initAL() {
 	alGetError();
 	if(alcGetCurrentContext() == 0) {
@@ -110,6 +344,35 @@ void SoundManager::setListenerOrientation(Vector3 orientation, Vector3 upVector)
 }
 
 SoundManager::~SoundManager() {
+	if(streamWorker) {
+		streamWorker->killThread();
+		lockStreams();
+		notifyStreams();
+		unlockStreams();
+		while(!streamWorker->threadStopped) {
+			sleepWorker();
+		}
+		delete streamWorker;
+	}
+	
+#if defined(_WINDOWS)
+	DeleteCriticalSection((CRITICAL_SECTION*)streamMutex);
+	delete (CRITICAL_SECTION*)streamMutex;
+	delete (CONDITION_VARIABLE*)streamCondition;
+	delete (CONDITION_VARIABLE*)decodeCondition;
+#else
+	pthread_mutex_destroy((pthread_mutex_t*)streamMutex);
+	delete (pthread_mutex_t*)streamMutex;
+	pthread_cond_destroy((pthread_cond_t*)streamCondition);
+	delete (pthread_cond_t*)streamCondition;
+	pthread_cond_destroy((pthread_cond_t*)decodeCondition);
+	delete (pthread_cond_t*)decodeCondition;
+#endif
+	
+	for(int i=0; i < cachedBuffers.size(); i++) {
+		alDeleteBuffers(1, &cachedBuffers[i].buffer);
+	}
+	
 	if (context != 0 ) {
 		alcSuspendContext(context);
 		alcMakeContextCurrent(0);
@@ -57,6 +57,11 @@ Texture::Texture(unsigned int width, unsigned int height, char *textureData,bool
 	scrollOffsetY = 0;
 }
 
+void Texture::setMipmaps(Image *image) {
+	createMipmaps = true;
+	recreateFromImageData();
+}
+
 void Texture::reloadResource() {
 	Image *image = new Image(getResourcePath());
 	setImageData(image);
@@ -2,15 +2,100 @@
 #include "PolyThreaded.h"
 #include "PolyCore.h"
 
+#if defined(_WINDOWS)
+	#include <windows.h>
+#endif
+
 using namespace Polycode;
 
+static inline void memoryBarrier() {
+#if defined(_WINDOWS)
+	MemoryBarrier();
+#else
+	__sync_synchronize();
+#endif
+}
+
+ThreadedEventQueue::ThreadedEventQueue(unsigned int capacity) {
+	this->capacity = 1;
+	while(this->capacity < capacity)
+		this->capacity *= 2;
+	mask = this->capacity - 1;
+	events = new Event*[this->capacity];
+	head = 0;
+	tail = 0;
+	maxDepth = 0;
+	droppedCount = 0;
+}
+
+ThreadedEventQueue::~ThreadedEventQueue() {
+	Event *event;
+	while((event = pop())) {
+		if(event->deleteOnDispatch)
+			delete event;
+	}
+	delete [] events;
+}
+
+bool ThreadedEventQueue::push(Event *event) {
+	unsigned int currentTail = tail;
+	memoryBarrier();
+	unsigned int depth = currentTail - head;
+	if(depth >= capacity) {
+		droppedCount++;
+		return false;
+	}
+	
+	events[currentTail & mask] = event;
+	// the event has to be visible before the consumer sees the new tail
+	memoryBarrier();
+	tail = currentTail + 1;
+	
+	if(depth + 1 > maxDepth)
+		maxDepth = depth + 1;
+	return true;
+}
+
+Event *ThreadedEventQueue::pop() {
+	unsigned int currentHead = head;
+	if(currentHead == tail)
+		return NULL;
+	
+	memoryBarrier();
+	Event *event = events[currentHead & mask];
+	// the slot is read before the producer can see it as free
+	memoryBarrier();
+	head = currentHead + 1;
+	return event;
+}
+
+unsigned int ThreadedEventQueue::getDepth() const {
+	return tail - head;
+}
+
+unsigned int ThreadedEventQueue::getMaxDepth() const {
+	return maxDepth;
+}
+
+unsigned int ThreadedEventQueue::getDroppedCount() const {
+	return droppedCount;
+}
+
+unsigned int ThreadedEventQueue::getCapacity() const {
+	return capacity;
+}
+
 Threaded::Threaded() : EventDispatcher() {
 	threadRunning = true;
 	scheduledForRemoval = false;
+	core = NULL;
+	eventQueue = new ThreadedEventQueue(DEFAULT_EVENT_QUEUE_CAPACITY);
 }
 
 Threaded::~Threaded() {
-	core->removeThread(this);
+	if(core)
+		core->removeThread(this);
+	delete eventQueue;
 }
 
 void Threaded::killThread() {
@@ -24,16 +109,22 @@ void Threaded::runThread(){
 }
 
 void Threaded::dispatchEvent(Event *event, int eventCode) {
-	core->lockMutex(eventMutex);
 	event->setEventCode(eventCode);
-	eventQueue.push_back(event);
-	core->unlockMutex(eventMutex);	
+	if(!eventQueue->push(event) && event->deleteOnDispatch)
+		delete event;
 }
 		
 void Threaded::dispatchEventNoDelete(Event *event, int eventCode) {
-	core->lockMutex(eventMutex);
 	event->setEventCode(eventCode);
 	event->deleteOnDispatch = false;
-	eventQueue.push_back(event);	
-	core->unlockMutex(eventMutex);			
+	eventQueue->push(event);
+}
+
+void Threaded::setEventQueueCapacity(unsigned int capacity) {
+	delete eventQueue;
+	eventQueue = new ThreadedEventQueue(capacity);
+}
+
+ThreadedEventQueue *Threaded::getEventQueue() {
+	return eventQueue;
 }
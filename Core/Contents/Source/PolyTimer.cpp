@@ -31,12 +31,19 @@ Timer::Timer(bool triggerMode, int msecs) : EventDispatcher() {
 	this->msecs = msecs;
 	this->triggerMode = triggerMode;
 	paused = false;
-	Reset();
+	ticks = 0;
+	last = 0;
+	elapsed = 0;
+	expires = 0;
+	wheelPrev = NULL;
+	wheelNext = NULL;
+	wheelList = NULL;
 	CoreServices::getInstance()->getTimerManager()->addTimer(this);
 }
 
 void Timer::setTimerInterval(int msecs) {
 	this->msecs = msecs;
+	CoreServices::getInstance()->getTimerManager()->rescheduleTimer(this);
 }
 
 Timer::~Timer() {
@@ -47,20 +54,28 @@ void Timer::Reset() {
 	ticks = 0;
 	last = 0;
 	elapsed = 0;	
+	CoreServices::getInstance()->getTimerManager()->resetTimer(this);
 }
 
 unsigned int Timer::getTicks() {
-	return ticks;
+	return CoreServices::getInstance()->getTimerManager()->getTicks();
 }
 
 void Timer::Pause(bool paused) {
+	TimerManager *timerManager = CoreServices::getInstance()->getTimerManager();
+	ticks = timerManager->getTicks();
 	last = ticks;
 	elapsed = 0;
 	this->paused = paused;
+	timerManager->rescheduleTimer(this);
 }
 
 Number Timer::getElapsedf() {
-	return ((Number)(elapsed))/1000.0f;
+	// elapsed holds the interval of the last trigger during the update it triggered in
+	unsigned int currentTicks = getTicks();
+	if(currentTicks == last)
+		return ((Number)(elapsed))/1000.0f;
+	return ((Number)(currentTicks-last))/1000.0f;
 }
 
 bool Timer::isPaused() {
@@ -68,30 +83,25 @@ bool Timer::isPaused() {
 }
 
 bool Timer::hasElapsed() {
+	TimerManager *timerManager = CoreServices::getInstance()->getTimerManager();
+	ticks = timerManager->getTicks();
 	if(ticks-last > msecs) {
 		last = ticks;
+		timerManager->rescheduleTimer(this);
 		return true;
 	}
 	return false;
 }
 
 void Timer::Update(unsigned int ticks) {
-	if(last == 0) {
-		last = ticks;
-		return;
-	}
-	
 	this->ticks = ticks;
-	elapsed = ticks-last;
-		
-	if(paused)
+	if(paused || !triggerMode)
 		return;
-
-	if(triggerMode) {
-		if(elapsed > msecs) {
-			last = ticks;
-			this->dispatchEvent(new Event(), EVENT_TRIGGER); 
-		} else {
-		}
+	
+	if(ticks - last > msecs) {
+		elapsed = ticks-last;
+		last = ticks;
+		CoreServices::getInstance()->getTimerManager()->rescheduleTimer(this);
+		dispatchEventNoDelete(&triggerEvent, EVENT_TRIGGER); 
 	}
 }
@@ -28,28 +28,164 @@
 using namespace Polycode;
 
 TimerManager::TimerManager() {
-
+	for(int i=0; i < ROOT_SIZE; i++) {
+		rootWheel[i] = NULL;
+	}
+	for(int l=0; l < LEVEL_COUNT; l++) {
+		for(int i=0; i < LEVEL_SIZE; i++) {
+			levelWheels[l][i] = NULL;
+		}
+	}
+	pendingTimers = NULL;
+	wheelTime = 0;
+	currentTicks = 0;
+	started = false;
+	timerCount = 0;
+	scheduledCount = 0;
 }
 
 TimerManager::~TimerManager() {
 
 }
 
-void TimerManager::removeTimer(Timer *timer) {
-	for(int i=0;i<timers.size();i++) {
-		if(timers[i] == timer) {
-			timers.erase(timers.begin()+i);
+void TimerManager::linkTimer(Timer *timer, Timer **list) {
+	timer->wheelList = list;
+	timer->wheelPrev = NULL;
+	timer->wheelNext = *list;
+	if(*list)
+		(*list)->wheelPrev = timer;
+	*list = timer;
+	if(list != &pendingTimers)
+		scheduledCount++;
+}
+
+void TimerManager::unlinkTimer(Timer *timer) {
+	if(!timer->wheelList)
+		return;
+	if(timer->wheelPrev)
+		timer->wheelPrev->wheelNext = timer->wheelNext;
+	else
+		*timer->wheelList = timer->wheelNext;
+	if(timer->wheelNext)
+		timer->wheelNext->wheelPrev = timer->wheelPrev;
+	if(timer->wheelList != &pendingTimers)
+		scheduledCount--;
+	timer->wheelList = NULL;
+	timer->wheelPrev = NULL;
+	timer->wheelNext = NULL;
+}
+
+void TimerManager::insertTimer(Timer *timer, unsigned int expires) {
+	if((int)(expires - wheelTime) < 0)
+		expires = wheelTime;
+	timer->expires = expires;
+	
+	// timers further out than the wheel covers wait in the last slot and are placed again when cascaded
+	unsigned int maxDelta = (1 << (ROOT_BITS + LEVEL_COUNT * LEVEL_BITS)) - 1;
+	unsigned int delta = expires - wheelTime;
+	if(delta > maxDelta) {
+		delta = maxDelta;
+		expires = wheelTime + maxDelta;
+	}
+	
+	if(delta < ROOT_SIZE) {
+		linkTimer(timer, &rootWheel[expires & (ROOT_SIZE-1)]);
+		return;
+	}
+	for(int l=0; l < LEVEL_COUNT; l++) {
+		int shift = ROOT_BITS + l * LEVEL_BITS;
+		if(l == LEVEL_COUNT-1 || delta < (1u << (shift + LEVEL_BITS))) {
+			linkTimer(timer, &levelWheels[l][(expires >> shift) & (LEVEL_SIZE-1)]);
+			return;
 		}
-	}	
+	}
+}
+
+void TimerManager::cascade(int level, int index) {
+	Timer *timer = levelWheels[level][index];
+	while(timer) {
+		Timer *next = timer->wheelNext;
+		unlinkTimer(timer);
+		insertTimer(timer, timer->expires);
+		timer = next;
+	}
 }
 
 void TimerManager::addTimer(Timer *timer) {
-	timers.push_back(timer);		
+	timerCount++;
+	linkTimer(timer, &pendingTimers);
+}
+
+void TimerManager::removeTimer(Timer *timer) {
+	unlinkTimer(timer);
+	timerCount--;
+}
+
+void TimerManager::resetTimer(Timer *timer) {
+	unlinkTimer(timer);
+	linkTimer(timer, &pendingTimers);
+}
+
+void TimerManager::rescheduleTimer(Timer *timer) {
+	// timers that have not started yet are scheduled when they start
+	if(timer->wheelList == &pendingTimers)
+		return;
+	unlinkTimer(timer);
+	if(timer->triggerMode && !timer->paused)
+		insertTimer(timer, timer->last + timer->msecs + 1);
+}
+
+unsigned int TimerManager::getTicks() const {
+	return currentTicks;
+}
+
+int TimerManager::getTimerCount() const {
+	return timerCount;
+}
+
+int TimerManager::getScheduledTimerCount() const {
+	return scheduledCount;
 }
 
 void TimerManager::Update() {
-	int ticks = CoreServices::getInstance()->getCore()->getTicks();
-	for(int i=0;i<timers.size();i++) {
-		timers[i]->Update(ticks);
+	currentTicks = CoreServices::getInstance()->getCore()->getTicks();
+	if(!started) {
+		wheelTime = currentTicks;
+		started = true;
+	}
+	
+	while(pendingTimers) {
+		Timer *timer = pendingTimers;
+		unlinkTimer(timer);
+		timer->ticks = currentTicks;
+		timer->last = currentTicks;
+		timer->elapsed = 0;
+		rescheduleTimer(timer);
+	}
+	
+	if(scheduledCount == 0) {
+		wheelTime = currentTicks + 1;
+		return;
+	}
+	
+	while((int)(currentTicks - wheelTime) >= 0) {
+		int index = wheelTime & (ROOT_SIZE-1);
+		for(int l=0; index == 0 && l < LEVEL_COUNT; l++) {
+			index = (wheelTime >> (ROOT_BITS + l * LEVEL_BITS)) & (LEVEL_SIZE-1);
+			cascade(l, index);
+		}
+		
+		Timer **slot = &rootWheel[wheelTime & (ROOT_SIZE-1)];
+		while(*slot) {
+			Timer *timer = *slot;
+			unlinkTimer(timer);
+			if(currentTicks - timer->last > timer->msecs) {
+				// reschedules the timer before dispatching, so handlers may delete it
+				timer->Update(currentTicks);
+			} else {
+				insertTimer(timer, timer->last + timer->msecs + 1);
+			}
+		}
+		wheelTime++;
 	}
 }
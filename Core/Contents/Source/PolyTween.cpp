@@ -24,89 +24,90 @@
 #include "PolyBezierCurve.h"
 #include "PolyCoreServices.h"
 #include "PolyQuaternionCurve.h"
-#include "PolyTimer.h"
 #include "PolyTweenManager.h"
-#include "PolyTimerManager.h"
 #include "PolyEvent.h"
 
 using namespace Polycode;
 
 Tween::	Tween(Number *target, int easeType, Number startVal, Number endVal, Number time, bool repeat, bool deleteOnComplete, Number waitTime) : EventDispatcher() {
-	this->waitTime = waitTime;
 	this->deleteOnComplete = deleteOnComplete;
-	targetVal = target;
 	this->repeat = repeat;
-	this->easeType = easeType;
-	this->endVal = endVal;
-	this->startVal = startVal;
-	cVal = endVal - startVal;
-	localTargetVal = startVal;
-	this->endTime = time;
-	tweenTime = 0;
-	if(waitTime == 0.0)
-		*targetVal = startVal;
-	tweenTimer = new Timer(true, 1);
-	tweenTimer->addEventListener(this, 0);
-	complete = false;
-
 	actEndTime = time;
-	CoreServices::getInstance()->getTweenManager()->addTween(this);
+	tweenIndex = -1;
+	
+	TweenManager *tweenManager = CoreServices::getInstance()->getTweenManager();
+	tweenManager->addTween(this);
+	
+	TweenState *state = tweenManager->getTweenState(this);
+	state->target = target;
+	state->easeType = easeType;
+	state->startVal = startVal;
+	state->endVal = endVal;
+	state->changeVal = endVal - startVal;
+	state->duration = time;
+	state->waitTime = waitTime;
+	
+	if(waitTime == 0.0)
+		*target = startVal;
+	tweenManager->setTweenActive(this, true);
 }
 
 void Tween::Pause(bool pauseVal) {
-	tweenTimer->Pause(pauseVal);
+	TweenManager *tweenManager = CoreServices::getInstance()->getTweenManager();
+	TweenState *state = tweenManager->getTweenState(this);
+	if(!state)
+		return;
+	state->paused = pauseVal;
+	tweenManager->setTweenActive(this, !state->paused && !state->complete);
 }
 
 void Tween::setSpeed(Number speed) {
+	TweenState *state = CoreServices::getInstance()->getTweenManager()->getTweenState(this);
+	if(!state)
+		return;
 	if(speed <= 0 )		
-		endTime = 0;
+		state->duration = 0;
 	else
-		endTime = actEndTime / speed;
+		state->duration = actEndTime / speed;
 }
 
 Tween::~Tween() {
-	tweenTimer->removeEventListener(this, 0);
-	delete tweenTimer;
-	
 	deleteOnComplete = false; // Prevent loop when we removeTween in next line.
 	CoreServices::getInstance()->getTweenManager()->removeTween(this);
 }
 
 bool Tween::isComplete() {
-	return complete;
+	TweenState *state = CoreServices::getInstance()->getTweenManager()->getTweenState(this);
+	if(!state)
+		return true;
+	return state->complete;
 }
 
 void Tween::doOnComplete() {
-	dispatchEvent(new Event(), Event::COMPLETE_EVENT);
+	Event completeEvent;
+	dispatchEventNoDelete(&completeEvent, Event::COMPLETE_EVENT);
 }
 
-void Tween::handleEvent(Event *event) {
-	if(tweenTime >= endTime+waitTime) {
-		if(repeat){
-			Reset();
-			updateCustomTween();			
-		} else {
-			*targetVal = endVal;			
-			complete = true;
-		}
+void Tween::Reset() {
+	TweenManager *tweenManager = CoreServices::getInstance()->getTweenManager();
+	TweenState *state = tweenManager->getTweenState(this);
+	if(!state)
 		return;
-	}
-	
-	if(targetVal != NULL && tweenTime > waitTime) {
-		localTargetVal = interpolateTween();
-		*targetVal = localTargetVal;
-	}
-	tweenTime += tweenTimer->getElapsedf();
-	updateCustomTween();
+	state->time = 0;
+	state->complete = false;
+	tweenManager->setTweenActive(this, !state->paused);
 }
 
-void Tween::Reset() {
-	tweenTime = 0;
-	complete = false;
+Number Tween::interpolateTween() {
+	TweenState *state = CoreServices::getInstance()->getTweenManager()->getTweenState(this);
+	if(!state)
+		return 0;
+	return interpolate(state->easeType, state->time - state->waitTime, state->startVal, state->changeVal, state->duration);
 }
 
-Number Tween::interpolateTween() {
-	Number t = tweenTime-waitTime;
+Number Tween::interpolate(int easeType, Number t, Number startVal, Number cVal, Number endTime) {
+	if(endTime <= 0)
+		return startVal + cVal;
 	
 	switch(easeType) {
 		case EASE_IN_QUAD:
@@ -22,47 +22,144 @@
 
 #include "PolyTweenManager.h"
 #include "PolyTween.h"
+#include <math.h>
 
 using namespace Polycode;
 
 TweenManager::TweenManager() {
-
+	activeCount = 0;
 }
 
 TweenManager::~TweenManager() {
-
+	for(int i=0; i < states.size(); i++) {
+		states[i].tween->tweenIndex = -1;
+	}
 }
 
 void TweenManager::addTween(Tween *tween) {
-	tweens.push_back(tween);
+	if(tween->tweenIndex >= 0)
+		return;
+	
+	TweenState state;
+	state.tween = tween;
+	state.target = NULL;
+	state.startVal = 0;
+	state.changeVal = 0;
+	state.endVal = 0;
+	state.time = 0;
+	state.waitTime = 0;
+	state.duration = 0;
+	state.easeType = Tween::EASE_NONE;
+	state.paused = false;
+	state.complete = false;
+	
+	// new tweens start out inactive, at the end of the array
+	tween->tweenIndex = states.size();
+	states.push_back(state);
 }
 
 void TweenManager::removeTween(Tween *tween) {
-	for(int i=0;i<tweens.size();i++) {
-		if(tweens[i] == tween) {
-			tweens.erase(tweens.begin()+i);
-			if(tween->deleteOnComplete)
-				delete tween;
-			
-		}
+	int index = tween->tweenIndex;
+	if(index < 0)
+		return;
+	
+	if(index < activeCount) {
+		activeCount--;
+		swapStates(index, activeCount);
+		index = activeCount;
+	}
+	swapStates(index, states.size()-1);
+	states.pop_back();
+	tween->tweenIndex = -1;
+	
+	for(int i=0; i < completedTweens.size(); i++) {
+		if(completedTweens[i] == tween)
+			completedTweens[i] = NULL;
+	}
+	
+	if(tween->deleteOnComplete)
+		delete tween;
+}
+
+TweenState *TweenManager::getTweenState(Tween *tween) {
+	if(tween->tweenIndex < 0)
+		return NULL;
+	return &states[tween->tweenIndex];
+}
+
+void TweenManager::setTweenActive(Tween *tween, bool active) {
+	int index = tween->tweenIndex;
+	if(index < 0)
+		return;
+	
+	if(active && index >= activeCount) {
+		swapStates(index, activeCount);
+		activeCount++;
+	} else if(!active && index < activeCount) {
+		activeCount--;
+		swapStates(index, activeCount);
 	}
 }
 
-void TweenManager::Update() {
-	Tween *tween;
-	for(int i=0;i<tweens.size();i++) {
-		if(tweens[i]->isComplete()) {
-			if(tweens[i]->repeat) {
-				tweens[i]->Reset();
-				return;
+void TweenManager::swapStates(int indexA, int indexB) {
+	if(indexA == indexB)
+		return;
+	TweenState state = states[indexA];
+	states[indexA] = states[indexB];
+	states[indexB] = state;
+	states[indexA].tween->tweenIndex = indexA;
+	states[indexB].tween->tweenIndex = indexB;
+}
+
+int TweenManager::getTweenCount() const {
+	return states.size();
+}
+
+int TweenManager::getActiveTweenCount() const {
+	return activeCount;
+}
+
+void TweenManager::Update(int elapsed) {
+	Number elapsedSeconds = ((Number)elapsed) / 1000.0;
+	
+	for(int i=0; i < activeCount; i++) {
+		TweenState &state = states[i];
+		if(state.complete)
+			continue;
+		
+		state.time += elapsedSeconds;
+		Number totalTime = state.duration + state.waitTime;
+		
+		if(state.time >= totalTime) {
+			if(state.tween->repeat) {
+				state.time = (totalTime > 0) ? fmod(state.time, totalTime) : 0;
 			} else {
-				tween = tweens[i];
-				tweens.erase(tweens.begin()+i);
-				tween->doOnComplete();
-				if(tween->deleteOnComplete)
-					delete tween;
-				return;
+				state.complete = true;
+				if(state.target)
+					*state.target = state.endVal;
+				completedTweens.push_back(state.tween);
+				state.tween->updateCustomTween();
+				continue;
 			}
 		}
+		
+		if(state.target && state.time > state.waitTime) {
+			*state.target = Tween::interpolate(state.easeType, state.time - state.waitTime, state.startVal, state.changeVal, state.duration);
+		}
+		state.tween->updateCustomTween();
+	}
+	
+	// completion handlers can create and delete tweens, so they only run once all tweens are advanced
+	for(int i=0; i < completedTweens.size(); i++) {
+		Tween *tween = completedTweens[i];
+		if(!tween)
+			continue;
+		completedTweens[i] = NULL;
+		setTweenActive(tween, false);
+		bool deleteTween = tween->deleteOnComplete;
+		tween->doOnComplete();
+		if(deleteTween)
+			delete tween;
 	}
+	completedTweens.clear();
 }
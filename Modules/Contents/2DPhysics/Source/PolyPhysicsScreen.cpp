@@ -26,6 +26,7 @@ THE SOFTWARE.
 #include "PolyPhysicsScreenEntity.h"
 #include "PolyCoreServices.h"
 #include "PolyCore.h"
+#include "PolyProfiler.h"
 
 using namespace Polycode;
 
@@ -549,7 +550,8 @@ void PhysicsScreen::handleEvent(Event *event) {
 }
 
 void PhysicsScreen::Update() {
-    
+	ProfilerZone zone("PhysicsScreen::Step");
+	
 	Number elapsed = CoreServices::getInstance()->getCore()->getElapsed() + cyclesLeftOver;
 	
 	while(elapsed > timeStep) {
@@ -23,6 +23,7 @@ THE SOFTWARE.
 #include "PolyCollisionScene.h"
 #include "PolyCollisionSceneEntity.h"
 #include "PolySceneEntity.h"
+#include "PolyProfiler.h"
 
 using namespace Polycode;
 
@@ -45,17 +46,19 @@ void CollisionScene::initCollisionScene(Vector3 size) {
 }
 
 void CollisionScene::Update() {
+	{
+		ProfilerZone zone("CollisionScene::performCollisionDetection");
+		for(int i=0; i < collisionChildren.size(); i++) {
+			if(collisionChildren[i]->enabled)
+				collisionChildren[i]->Update();
+		}
 	
-	for(int i=0; i < collisionChildren.size(); i++) {
-		if(collisionChildren[i]->enabled)
-			collisionChildren[i]->Update();
-	}
-	
-	world->performDiscreteCollisionDetection();	
+		world->performDiscreteCollisionDetection();	
 	
-	for(int i=0; i < collisionChildren.size(); i++) {
-		if(collisionChildren[i]->enabled)		
-			collisionChildren[i]->lastPosition = collisionChildren[i]->getSceneEntity()->getPosition();
+		for(int i=0; i < collisionChildren.size(); i++) {
+			if(collisionChildren[i]->enabled)		
+				collisionChildren[i]->lastPosition = collisionChildren[i]->getSceneEntity()->getPosition();
+		}
 	}
 	Scene::Update();	
 }
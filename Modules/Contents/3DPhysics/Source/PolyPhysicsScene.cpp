@@ -30,6 +30,7 @@ THE SOFTWARE.
 #include "PolyVector3.h"
 #include "PolyPhysicsSceneEntity.h"
 #include "PolyCore.h"
+#include "PolyProfiler.h"
 
 using namespace Polycode;
 
@@ -144,6 +145,7 @@ void PhysicsScene::processWorldCollisions() {
 
 void PhysicsScene::Update() {
 	if(!pausePhysics) {
+	ProfilerZone zone("PhysicsScene::stepSimulation");
 	for(int i=0; i < physicsChildren.size(); i++) {
 //		if(physicsChildren[i]->enabled)
 			physicsChildren[i]->Update();
@@ -906,6 +906,7 @@ bool PolycodePlayer::Update() {
 			lua_getfield(L, LUA_GLOBALSINDEX, "__process_safe_delete");
 			lua_pcall(L, 0,0,errH);	
 		
+			ProfilerZone zone("PolycodePlayer::luaUpdate");
 			lua_getfield(L, LUA_GLOBALSINDEX, "__update");
 			lua_pushnumber(L, core->getElapsed());
 			lua_pcall(L, 1,0,errH);
@@ -0,0 +1,37 @@
+
+#pragma once
+
+#include <stdio.h>
+#include <time.h>
+#include "PolyString.h"
+#include "PolyMesh.h"
+#include "PolyMatrix4.h"
+#include "PolyQuaternion.h"
+#include "PolyHeadlessCore.h"
+
+using namespace Polycode;
+
+class BenchResult {
+public:
+	String name;
+	unsigned int iterations;
+	double totalMs;
+};
+
+typedef void (*BenchSuiteFunc)(bool quick);
+
+class BenchSuite {
+public:
+	const char *name;
+	const char *description;
+	BenchSuiteFunc run;
+};
+
+void printBenchResult(const BenchResult &result);
+HeadlessCore *getBenchCore();
+void runMeshRebuildBench(bool quick);
+void runMathBench(bool quick);
+void runSceneBench(bool quick);
+void runRenderQueueBench(bool quick);
+void runJobsBench(bool quick);
+void runTimersBench(bool quick);
@@ -0,0 +1,688 @@
+
+#include "polybench.h"
+#include "PolyPolygon.h"
+#include "PolyGLRenderer.h"
+#include "PolyCamera.h"
+#include "PolyScene.h"
+#include "PolyScenePrimitive.h"
+#include "PolyTexture.h"
+#include "PolyScreen.h"
+#include "PolyScreenShape.h"
+#include "PolyNullRenderer.h"
+#include "PolyJobSystem.h"
+#include "PolyProfiler.h"
+#include "PolyTimer.h"
+#include "PolyTimerManager.h"
+#include "PolyCoreServices.h"
+#include "string.h"
+
+// polybench: microbenchmarks for engine hot paths that can run without a
+// window or rendering context. Run with no arguments to run every suite, or
+// with suite names to run a subset. --quick reduces iteration counts.
+
+static BenchSuite suites[] = {
+	{"meshrebuild", "render data array rebuild for 1k, 10k and 100k vertex meshes", runMeshRebuildBench},
+	{"math", "Matrix4 and Quaternion operations against the scalar double reference", runMathBench},
+	{"scene", "fixed-step frames of a 3D scene and a 2D screen on the headless core", runSceneBench},
+	{"renderqueue", "draws and state changes of a mixed state scene with the render queue off and on", runRenderQueueBench},
+	{"jobs", "job system parallelFor throughput and dependency chains", runJobsBench},
+	{"timers", "per-frame timer manager cost with 100k idle timers and with triggering timers", runTimersBench},
+};
+
+static const int numSuites = sizeof(suites) / sizeof(BenchSuite);
+
+static double elapsedMs(clock_t start) {
+	return ((double)(clock() - start) * 1000.0) / (double)CLOCKS_PER_SEC;
+}
+
+// Suites that update or render scenes share one headless core, created the
+// first time one of them runs.
+static HeadlessCore *benchCore = NULL;
+
+HeadlessCore *getBenchCore() {
+	if(!benchCore) {
+		benchCore = new HeadlessCore(1280, 720, 60);
+	}
+	return benchCore;
+}
+
+void printBenchResult(const BenchResult &result) {
+	double perIteration = result.iterations > 0 ? result.totalMs / (double)result.iterations : 0.0;
+	printf("  %-40s %8d iterations %10.3f ms total %10.4f ms/iter\n", result.name.c_str(), result.iterations, result.totalMs, perIteration);
+}
+
+// Builds a flat grid of quads with vertexCount vertices (4 per quad, as in
+// meshes loaded from polygon data).
+static Mesh *createGridMesh(unsigned int vertexCount) {
+	Mesh *mesh = new Mesh(Mesh::QUAD_MESH);
+	unsigned int quadCount = vertexCount / 4;
+	unsigned int side = 1;
+	while(side * side < quadCount) {
+		side++;
+	}
+	for(unsigned int i=0; i < quadCount; i++) {
+		Number x = (Number)(i % side);
+		Number z = (Number)(i / side);
+		Polygon *poly = new Polygon();
+		poly->addVertex(x, 0, z, 0, 0);
+		poly->addVertex(x+1, 0, z, 1, 0);
+		poly->addVertex(x+1, 0, z+1, 1, 1);
+		poly->addVertex(x, 0, z+1, 0, 1);
+		mesh->addPolygon(poly);
+	}
+	mesh->calculateNormals(false);
+	mesh->calculateTangents();
+	return mesh;
+}
+
+static void flagAllArrays(bool *updateMap, bool withIndices) {
+	for(int i=0; i < 16; i++) {
+		updateMap[i] = false;
+	}
+	updateMap[RenderDataArray::VERTEX_DATA_ARRAY] = true;
+	updateMap[RenderDataArray::COLOR_DATA_ARRAY] = true;
+	updateMap[RenderDataArray::NORMAL_DATA_ARRAY] = true;
+	updateMap[RenderDataArray::TANGENT_DATA_ARRAY] = true;
+	updateMap[RenderDataArray::TEXCOORD_DATA_ARRAY] = true;
+	updateMap[RenderDataArray::INDEX_DATA_ARRAY] = withIndices;
+}
+
+static void benchMeshRebuild(OpenGLRenderer *renderer, Mesh *mesh, const String &label, unsigned int iterations) {
+	bool updateMap[16];
+	flagAllArrays(updateMap, mesh->isIndexedMesh());
+	
+	// warm up, so the in-place path starts from allocated buffers as it would
+	// after the first frame
+	renderer->updateRenderDataArraysForMesh(mesh, updateMap);
+	
+	BenchResult result;
+	result.iterations = iterations;
+	
+	clock_t start = clock();
+	for(unsigned int i=0; i < iterations; i++) {
+		renderer->Renderer::updateRenderDataArraysForMesh(mesh, updateMap);
+	}
+	result.totalMs = elapsedMs(start);
+	result.name = label + " recreate";
+	printBenchResult(result);
+	
+	start = clock();
+	for(unsigned int i=0; i < iterations; i++) {
+		renderer->updateRenderDataArraysForMesh(mesh, updateMap);
+	}
+	result.totalMs = elapsedMs(start);
+	result.name = label + " in place";
+	printBenchResult(result);
+}
+
+void runMeshRebuildBench(bool quick) {
+	// the array building path makes no GL calls, so no context is needed
+	OpenGLRenderer *renderer = new OpenGLRenderer();
+	
+	unsigned int vertexCounts[3] = {1000, 10000, 100000};
+	for(int i=0; i < 3; i++) {
+		unsigned int iterations = (quick ? 20000000 : 200000000) / vertexCounts[i] / 100;
+		if(iterations < 5) {
+			iterations = 5;
+		}
+		
+		Mesh *mesh = createGridMesh(vertexCounts[i]);
+		benchMeshRebuild(renderer, mesh, String::IntToString(vertexCounts[i]) + " verts, polygons", iterations);
+		
+		mesh->convertToIndexedMesh();
+		benchMeshRebuild(renderer, mesh, String::IntToString(vertexCounts[i]) + " verts, indexed", iterations);
+		delete mesh;
+	}
+	
+	delete renderer;
+}
+
+// Scalar double precision reference for the math suite, matching the
+// Matrix4 and Quaternion code as it is built without POLYCODE_NUMBER_IS_SINGLE.
+struct RefMatrix {
+	double m[16];
+};
+
+static volatile double mathSink = 0.0;
+
+static void refMultiply(const RefMatrix &a, const RefMatrix &b, RefMatrix &r) {
+	for(int i=0; i < 4; i++) {
+		const double *row = a.m + (i*4);
+		r.m[i*4+0] = row[0] * b.m[0] + row[1] * b.m[4] + row[2] * b.m[8] + row[3] * b.m[12];
+		r.m[i*4+1] = row[0] * b.m[1] + row[1] * b.m[5] + row[2] * b.m[9] + row[3] * b.m[13];
+		r.m[i*4+2] = row[0] * b.m[2] + row[1] * b.m[6] + row[2] * b.m[10] + row[3] * b.m[14];
+		r.m[i*4+3] = row[0] * b.m[3] + row[1] * b.m[7] + row[2] * b.m[11] + row[3] * b.m[15];
+	}
+}
+
+static void refInverse(const RefMatrix &a, RefMatrix &r) {
+	const double *m = a.m;
+	double v0 = m[8] * m[13] - m[9] * m[12];
+	double v1 = m[8] * m[14] - m[10] * m[12];
+	double v2 = m[8] * m[15] - m[11] * m[12];
+	double v3 = m[9] * m[14] - m[10] * m[13];
+	double v4 = m[9] * m[15] - m[11] * m[13];
+	double v5 = m[10] * m[15] - m[11] * m[14];
+	
+	double t00 = + (v5 * m[5] - v4 * m[6] + v3 * m[7]);
+	double t10 = - (v5 * m[4] - v2 * m[6] + v1 * m[7]);
+	double t20 = + (v4 * m[4] - v2 * m[5] + v0 * m[7]);
+	double t30 = - (v3 * m[4] - v1 * m[5] + v0 * m[6]);
+	double invDet = 1 / (t00 * m[0] + t10 * m[1] + t20 * m[2] + t30 * m[3]);
+	
+	r.m[0] = t00 * invDet;
+	r.m[4] = t10 * invDet;
+	r.m[8] = t20 * invDet;
+	r.m[12] = t30 * invDet;
+	r.m[1] = - (v5 * m[1] - v4 * m[2] + v3 * m[3]) * invDet;
+	r.m[5] = + (v5 * m[0] - v2 * m[2] + v1 * m[3]) * invDet;
+	r.m[9] = - (v4 * m[0] - v2 * m[1] + v0 * m[3]) * invDet;
+	r.m[13] = + (v3 * m[0] - v1 * m[1] + v0 * m[2]) * invDet;
+	
+	v0 = m[4] * m[13] - m[5] * m[12];
+	v1 = m[4] * m[14] - m[6] * m[12];
+	v2 = m[4] * m[15] - m[7] * m[12];
+	v3 = m[5] * m[14] - m[6] * m[13];
+	v4 = m[5] * m[15] - m[7] * m[13];
+	v5 = m[6] * m[15] - m[7] * m[14];
+	r.m[2] = + (v5 * m[1] - v4 * m[2] + v3 * m[3]) * invDet;
+	r.m[6] = - (v5 * m[0] - v2 * m[2] + v1 * m[3]) * invDet;
+	r.m[10] = + (v4 * m[0] - v2 * m[1] + v0 * m[3]) * invDet;
+	r.m[14] = - (v3 * m[0] - v1 * m[1] + v0 * m[2]) * invDet;
+	
+	v0 = m[9] * m[4] - m[8] * m[5];
+	v1 = m[10] * m[4] - m[8] * m[6];
+	v2 = m[11] * m[4] - m[8] * m[7];
+	v3 = m[10] * m[5] - m[9] * m[6];
+	v4 = m[11] * m[5] - m[9] * m[7];
+	v5 = m[11] * m[6] - m[10] * m[7];
+	r.m[3] = - (v5 * m[1] - v4 * m[2] + v3 * m[3]) * invDet;
+	r.m[7] = + (v5 * m[0] - v2 * m[2] + v1 * m[3]) * invDet;
+	r.m[11] = - (v4 * m[0] - v2 * m[1] + v0 * m[3]) * invDet;
+	r.m[15] = + (v3 * m[0] - v1 * m[1] + v0 * m[2]) * invDet;
+}
+
+static void refQuaternionMatrix(double x, double y, double z, double w, RefMatrix &r) {
+	double tx = 2.0*x, ty = 2.0*y, tz = 2.0*z;
+	double twx = tx*w, twy = ty*w, twz = tz*w;
+	double txx = tx*x, txy = ty*x, txz = tz*x;
+	double tyy = ty*y, tyz = tz*y, tzz = tz*z;
+	r.m[0] = 1.0-(tyy+tzz); r.m[1] = txy+twz; r.m[2] = txz-twy; r.m[3] = 0.0;
+	r.m[4] = txy-twz; r.m[5] = 1.0-(txx+tzz); r.m[6] = tyz+twx; r.m[7] = 0.0;
+	r.m[8] = txz+twy; r.m[9] = tyz-twx; r.m[10] = 1.0-(txx+tyy); r.m[11] = 0.0;
+	r.m[12] = 0.0; r.m[13] = 0.0; r.m[14] = 0.0; r.m[15] = 1.0;
+}
+
+static void refTransformPositions(const RefMatrix &a, const float *in, float *out, unsigned int count) {
+	const double *m = a.m;
+	for(unsigned int i=0; i < count; i++) {
+		double x = in[0], y = in[1], z = in[2];
+		out[0] = x*m[0] + y*m[4] + z*m[8] + m[12];
+		out[1] = x*m[1] + y*m[5] + z*m[9] + m[13];
+		out[2] = x*m[2] + y*m[6] + z*m[10] + m[14];
+		in += 3;
+		out += 3;
+	}
+}
+
+static void printMathResult(const char *name, unsigned int iterations, double referenceMs, double currentMs) {
+	BenchResult result;
+	result.iterations = iterations;
+	result.name = String(name) + " reference";
+	result.totalMs = referenceMs;
+	printBenchResult(result);
+	result.name = String(name) + " current";
+	result.totalMs = currentMs;
+	printBenchResult(result);
+}
+
+void runMathBench(bool quick) {
+	printf("  Number is %s, SIMD %s\n", sizeof(Number) == sizeof(float) ? "float" : "double",
+#if defined(POLYCODE_SIMD_SSE)
+		"SSE"
+#elif defined(POLYCODE_SIMD_NEON)
+		"NEON"
+#else
+		"off"
+#endif
+	);
+	
+	const unsigned int matrixCount = 256;
+	std::vector<RefMatrix> refMatrices(matrixCount);
+	std::vector<Matrix4> matrices(matrixCount);
+	std::vector<Quaternion> quaternions(matrixCount);
+	srand(1);
+	for(unsigned int i=0; i < matrixCount; i++) {
+		Quaternion q(RANDOM_NUMBER, RANDOM_NUMBER, RANDOM_NUMBER, RANDOM_NUMBER);
+		q.Normalize();
+		quaternions[i] = q;
+		matrices[i] = q.createMatrix();
+		matrices[i].setPosition(RANDOM_NUMBER * 10.0, RANDOM_NUMBER * 10.0, RANDOM_NUMBER * 10.0);
+		for(int j=0; j < 16; j++) {
+			refMatrices[i].m[j] = matrices[i].ml[j];
+		}
+	}
+	
+	unsigned int iterations = quick ? 20000 : 200000;
+	double sum = 0.0;
+	
+	RefMatrix refResult;
+	clock_t start = clock();
+	for(unsigned int i=0; i < iterations; i++) {
+		refMultiply(refMatrices[i % matrixCount], refMatrices[(i+1) % matrixCount], refResult);
+		sum += refResult.m[i % 16];
+	}
+	double referenceMs = elapsedMs(start);
+	start = clock();
+	for(unsigned int i=0; i < iterations; i++) {
+		Matrix4 result = matrices[i % matrixCount] * matrices[(i+1) % matrixCount];
+		sum += result.ml[i % 16];
+	}
+	printMathResult("Matrix4 multiply", iterations, referenceMs, elapsedMs(start));
+	
+	start = clock();
+	for(unsigned int i=0; i < iterations; i++) {
+		refInverse(refMatrices[i % matrixCount], refResult);
+		sum += refResult.m[i % 16];
+	}
+	referenceMs = elapsedMs(start);
+	start = clock();
+	for(unsigned int i=0; i < iterations; i++) {
+		Matrix4 result = matrices[i % matrixCount].Inverse();
+		sum += result.ml[i % 16];
+	}
+	printMathResult("Matrix4 inverse", iterations, referenceMs, elapsedMs(start));
+	
+	start = clock();
+	for(unsigned int i=0; i < iterations; i++) {
+		const Quaternion &q = quaternions[i % matrixCount];
+		refQuaternionMatrix(q.x, q.y, q.z, q.w, refResult);
+		sum += refResult.m[i % 16];
+	}
+	referenceMs = elapsedMs(start);
+	start = clock();
+	for(unsigned int i=0; i < iterations; i++) {
+		Matrix4 result = quaternions[i % matrixCount].createMatrix();
+		sum += result.ml[i % 16];
+	}
+	printMathResult("Quaternion to matrix", iterations, referenceMs, elapsedMs(start));
+	
+	// both paths multiply matrices[j] by matrices[(j+i) % count], the
+	// batch reads the right hand side from a copy of the set laid out
+	// twice so each pass is one contiguous run
+	unsigned int batchIterations = iterations / 100;
+	std::vector<Matrix4> products(matrixCount);
+	std::vector<RefMatrix> refProducts(matrixCount);
+	std::vector<Matrix4> wrappedMatrices(matrices.begin(), matrices.end());
+	wrappedMatrices.insert(wrappedMatrices.end(), matrices.begin(), matrices.end());
+	start = clock();
+	for(unsigned int i=0; i < batchIterations; i++) {
+		for(unsigned int j=0; j < matrixCount; j++) {
+			refMultiply(refMatrices[j], refMatrices[(j+i) % matrixCount], refProducts[j]);
+		}
+		sum += refProducts[i % matrixCount].m[i % 16];
+	}
+	referenceMs = elapsedMs(start);
+	start = clock();
+	for(unsigned int i=0; i < batchIterations; i++) {
+		Matrix4::multiplyMatrices(&matrices[0], &wrappedMatrices[i % matrixCount], &products[0], matrixCount);
+		sum += products[i % matrixCount].ml[i % 16];
+	}
+	printMathResult("256 matrix batch multiply", batchIterations, referenceMs, elapsedMs(start));
+	
+	const unsigned int pointCount = 10000;
+	std::vector<float> positions(pointCount * 3);
+	std::vector<float> transformed(pointCount * 3);
+	for(unsigned int i=0; i < positions.size(); i++) {
+		positions[i] = RANDOM_NUMBER * 100.0;
+	}
+	unsigned int pointIterations = quick ? 200 : 2000;
+	start = clock();
+	for(unsigned int i=0; i < pointIterations; i++) {
+		refTransformPositions(refMatrices[i % matrixCount], &positions[0], &transformed[0], pointCount);
+		sum += transformed[i % transformed.size()];
+	}
+	referenceMs = elapsedMs(start);
+	start = clock();
+	for(unsigned int i=0; i < pointIterations; i++) {
+		Matrix4::transformPositions(matrices[i % matrixCount], &positions[0], &transformed[0], pointCount);
+		sum += transformed[i % transformed.size()];
+	}
+	printMathResult("10k positions transform", pointIterations, referenceMs, elapsedMs(start));
+	
+	mathSink = sum;
+}
+
+static void printFrameStats(const char *name, RecordingRenderer *renderer) {
+	const RenderStats &stats = renderer->getLastFrameStats();
+	printf("  %-40s %8u draws %8u vertices %8u state changes\n", name, stats.drawCalls, stats.verticesDrawn, stats.stateChanges);
+}
+
+void runSceneBench(bool quick) {
+	HeadlessCore *core = getBenchCore();
+	RecordingRenderer *renderer = (RecordingRenderer*)CoreServices::getInstance()->getRenderer();
+	int frameCount = quick ? 60 : 600;
+	unsigned int entityCount = 2000;
+	
+	Scene *scene = new Scene();
+	scene->getDefaultCamera()->setPosition(0, 0, 60);
+	scene->getDefaultCamera()->lookAt(Vector3(0, 0, 0));
+	std::vector<ScenePrimitive*> primitives;
+	srand(1);
+	for(unsigned int i=0; i < entityCount; i++) {
+		ScenePrimitive *primitive = new ScenePrimitive(i % 2 ? ScenePrimitive::TYPE_BOX : ScenePrimitive::TYPE_SPHERE, 1, 1, 1);
+		primitive->setPosition(RANDOM_NUMBER * 80.0 - 40.0, RANDOM_NUMBER * 80.0 - 40.0, RANDOM_NUMBER * 80.0 - 40.0);
+		scene->addEntity(primitive);
+		primitives.push_back(primitive);
+	}
+	
+	BenchResult result;
+	result.iterations = frameCount;
+	clock_t start = clock();
+	for(int f=0; f < frameCount; f++) {
+		for(unsigned int i=0; i < primitives.size(); i++) {
+			primitives[i]->setYaw(f + i);
+		}
+		core->runFrames(1);
+	}
+	result.totalMs = elapsedMs(start);
+	result.name = String::IntToString(entityCount) + " moving scene entities";
+	printBenchResult(result);
+	printFrameStats("  last frame", renderer);
+	
+	delete scene;
+	for(unsigned int i=0; i < primitives.size(); i++) {
+		delete primitives[i];
+	}
+	
+	Screen *screen = new Screen();
+	std::vector<ScreenShape*> shapes;
+	for(unsigned int i=0; i < entityCount; i++) {
+		ScreenShape *shape = new ScreenShape(i % 2 ? ScreenShape::SHAPE_RECT : ScreenShape::SHAPE_CIRCLE, 10, 10, 12);
+		shape->setPosition(RANDOM_NUMBER * 1280.0, RANDOM_NUMBER * 720.0);
+		screen->addChild(shape);
+		shapes.push_back(shape);
+	}
+	
+	start = clock();
+	for(int f=0; f < frameCount; f++) {
+		for(unsigned int i=0; i < shapes.size(); i++) {
+			shapes[i]->setRotation(f + i);
+		}
+		core->runFrames(1);
+	}
+	result.totalMs = elapsedMs(start);
+	result.name = String::IntToString(entityCount) + " moving screen shapes";
+	printBenchResult(result);
+	printFrameStats("  last frame", renderer);
+	
+	delete screen;
+	for(unsigned int i=0; i < shapes.size(); i++) {
+		delete shapes[i];
+	}
+}
+
+void runRenderQueueBench(bool quick) {
+	HeadlessCore *core = getBenchCore();
+	RecordingRenderer *renderer = (RecordingRenderer*)CoreServices::getInstance()->getRenderer();
+	int frameCount = quick ? 30 : 300;
+	unsigned int entityCount = 2000;
+	
+	const int textureCount = 8;
+	Texture *textures[textureCount];
+	char pixels[4 * 4 * 4];
+	memset(pixels, 255, sizeof(pixels));
+	for(int i=0; i < textureCount; i++) {
+		textures[i] = renderer->createTexture(4, 4, pixels, false, false);
+	}
+	
+	// every texture comes with its own render states, as it would with
+	// materials, and neighbouring entities use random textures, so scene
+	// graph order changes state on nearly every draw
+	Scene *scene = new Scene();
+	scene->getDefaultCamera()->setPosition(0, 0, 60);
+	scene->getDefaultCamera()->lookAt(Vector3(0, 0, 0));
+	std::vector<ScenePrimitive*> primitives;
+	srand(1);
+	for(unsigned int i=0; i < entityCount; i++) {
+		ScenePrimitive *primitive = new ScenePrimitive(ScenePrimitive::TYPE_BOX, 1, 1, 1);
+		primitive->setPosition(RANDOM_NUMBER * 40.0 - 20.0, RANDOM_NUMBER * 40.0 - 20.0, RANDOM_NUMBER * 40.0 - 20.0);
+		int texture = rand() % textureCount;
+		primitive->setTexture(textures[texture]);
+		primitive->backfaceCulled = (texture % 2 == 0);
+		primitive->alphaTest = (texture >= textureCount / 2);
+		scene->addEntity(primitive);
+		primitives.push_back(primitive);
+	}
+	
+	for(int queued=0; queued < 2; queued++) {
+		scene->useRenderQueue = (queued == 1);
+		core->runFrames(1);
+		
+		BenchResult result;
+		result.iterations = frameCount;
+		clock_t start = clock();
+		core->runFrames(frameCount);
+		result.totalMs = elapsedMs(start);
+		result.name = String::IntToString(entityCount) + " entities, queue " + (queued ? "on" : "off");
+		printBenchResult(result);
+		
+		const RenderStats &stats = renderer->getLastFrameStats();
+		printf("    %u draws, %u state changes, %u redundant, %u texture binds per frame\n", stats.drawCalls, stats.stateChanges, stats.redundantStateChanges, stats.textureBinds);
+	}
+	
+	delete scene;
+	for(unsigned int i=0; i < primitives.size(); i++) {
+		delete primitives[i];
+	}
+	for(int i=0; i < textureCount; i++) {
+		renderer->destroyTexture(textures[i]);
+	}
+}
+
+static void scaleValues(void *data, unsigned int start, unsigned int end) {
+	float *values = (float*)data;
+	for(unsigned int i=start; i < end; i++) {
+		values[i] = sqrtf(values[i] * 1.0001f + 1.0f);
+	}
+}
+
+static void countJob(void *data) {
+	(*(unsigned int*)data)++;
+}
+
+void runJobsBench(bool quick) {
+	JobSystem *jobSystem = new JobSystem();
+	printf("  %d workers\n", jobSystem->getNumWorkers());
+	
+	// the work is spread over threads, so these suites measure wall time
+	// instead of process time
+	const unsigned int valueCount = 1 << 20;
+	std::vector<float> values(valueCount, 1.0f);
+	unsigned int iterations = quick ? 20 : 200;
+	
+	BenchResult result;
+	result.iterations = iterations;
+	double start = Profiler::getMicroseconds();
+	for(unsigned int i=0; i < iterations; i++) {
+		scaleValues(&values[0], 0, valueCount);
+	}
+	result.totalMs = (Profiler::getMicroseconds() - start) / 1000.0;
+	result.name = "1M values serial";
+	printBenchResult(result);
+	
+	unsigned int grainSizes[3] = {256, 4096, 65536};
+	for(int g=0; g < 3; g++) {
+		start = Profiler::getMicroseconds();
+		for(unsigned int i=0; i < iterations; i++) {
+			jobSystem->parallelFor(valueCount, grainSizes[g], scaleValues, &values[0]);
+			jobSystem->endFrame();
+		}
+		result.totalMs = (Profiler::getMicroseconds() - start) / 1000.0;
+		result.name = "1M values parallelFor, grain " + String::IntToString(grainSizes[g]);
+		printBenchResult(result);
+	}
+	
+	// every job waits for the one before it, so this measures the cost of
+	// handing a job over to its dependent
+	const unsigned int chainLength = 1000;
+	unsigned int counter = 0;
+	std::vector<Job*> chain(chainLength);
+	start = Profiler::getMicroseconds();
+	for(unsigned int i=0; i < iterations; i++) {
+		for(unsigned int j=0; j < chainLength; j++) {
+			chain[j] = jobSystem->createJob(countJob, &counter);
+			if(j > 0)
+				jobSystem->addDependency(chain[j], chain[j-1]);
+		}
+		for(unsigned int j=0; j < chainLength; j++) {
+			jobSystem->run(chain[j]);
+		}
+		jobSystem->wait(chain[chainLength-1]);
+		jobSystem->endFrame();
+	}
+	result.totalMs = (Profiler::getMicroseconds() - start) / 1000.0;
+	result.name = "1000 job dependency chain";
+	printBenchResult(result);
+	
+	// independent jobs under one parent, joined by waiting on the parent
+	std::vector<unsigned int> counters(chainLength, 0);
+	start = Profiler::getMicroseconds();
+	for(unsigned int i=0; i < iterations; i++) {
+		Job *parent = jobSystem->createJob(NULL, NULL);
+		for(unsigned int j=0; j < chainLength; j++) {
+			jobSystem->run(jobSystem->createJob(countJob, &counters[j], parent));
+		}
+		jobSystem->run(parent);
+		jobSystem->wait(parent);
+		jobSystem->endFrame();
+	}
+	result.totalMs = (Profiler::getMicroseconds() - start) / 1000.0;
+	result.name = "1000 child jobs fan-out";
+	printBenchResult(result);
+	
+	if(counter != iterations * chainLength) {
+		printf("  dependency chain ran %u of %u jobs\n", counter, iterations * chainLength);
+	}
+	delete jobSystem;
+}
+
+class TimerTriggerCounter : public EventHandler {
+public:
+	TimerTriggerCounter() : triggers(0) {}
+	void handleEvent(Event *event) {
+		triggers++;
+	}
+	unsigned int triggers;
+};
+
+static void benchTimerFrames(HeadlessCore *core, int frameCount, const String &name) {
+	BenchResult result;
+	result.iterations = frameCount;
+	clock_t start = clock();
+	core->runFrames(frameCount);
+	result.totalMs = elapsedMs(start);
+	result.name = name;
+	printBenchResult(result);
+}
+
+void runTimersBench(bool quick) {
+	HeadlessCore *core = getBenchCore();
+	TimerManager *timerManager = CoreServices::getInstance()->getTimerManager();
+	int frameCount = quick ? 600 : 6000;
+	const unsigned int idleCount = 100000;
+	const unsigned int activeCount = 1000;
+	
+	// the frame without timers is the baseline the other frame results
+	// are compared against
+	core->runFrames(1);
+	benchTimerFrames(core, frameCount, "frame without timers");
+	
+	// an hour or more out, so none of these fire while the suite runs
+	std::vector<Timer*> idleTimers(idleCount);
+	BenchResult result;
+	result.iterations = idleCount;
+	clock_t start = clock();
+	for(unsigned int i=0; i < idleCount; i++) {
+		idleTimers[i] = new Timer(true, 3600000 + i);
+	}
+	result.totalMs = elapsedMs(start);
+	result.name = "100k timers created";
+	printBenchResult(result);
+	
+	result.iterations = 1;
+	start = clock();
+	core->runFrames(1);
+	result.totalMs = elapsedMs(start);
+	result.name = "frame scheduling 100k new timers";
+	printBenchResult(result);
+	
+	benchTimerFrames(core, frameCount, "frame with 100k idle timers");
+	printf("    %d timers, %d scheduled\n", timerManager->getTimerCount(), timerManager->getScheduledTimerCount());
+	
+	// intervals of 100 to 1099 ms, so a few timers fire every frame
+	TimerTriggerCounter counter;
+	std::vector<Timer*> activeTimers(activeCount);
+	for(unsigned int i=0; i < activeCount; i++) {
+		activeTimers[i] = new Timer(true, 100 + i);
+		activeTimers[i]->addEventListener(&counter, Timer::EVENT_TRIGGER);
+	}
+	core->runFrames(1);
+	counter.triggers = 0;
+	benchTimerFrames(core, frameCount, "frame with 1000 active, 100k idle timers");
+	printf("    %.1f triggers per frame\n", (double)counter.triggers / (double)frameCount);
+	
+	for(unsigned int i=0; i < activeCount; i++) {
+		delete activeTimers[i];
+	}
+	
+	result.iterations = idleCount;
+	start = clock();
+	for(unsigned int i=0; i < idleCount; i++) {
+		delete idleTimers[i];
+	}
+	result.totalMs = elapsedMs(start);
+	result.name = "100k timers deleted";
+	printBenchResult(result);
+}
+
+int main(int argc, char **argv) {
+	bool quick = false;
+	bool ranSuite = false;
+	
+	for(int i=1; i < argc; i++) {
+		if(strcmp(argv[i], "--quick") == 0) {
+			quick = true;
+		}
+	}
+	
+	for(int s=0; s < numSuites; s++) {
+		bool selected = true;
+		for(int i=1; i < argc; i++) {
+			if(argv[i][0] == '-')
+				continue;
+			selected = false;
+			if(strcmp(argv[i], suites[s].name) == 0) {
+				selected = true;
+				break;
+			}
+		}
+		if(!selected)
+			continue;
+		
+		printf("%s: %s\n", suites[s].name, suites[s].description);
+		suites[s].run(quick);
+		ranSuite = true;
+	}
+	
+	if(!ranSuite) {
+		printf("usage: polybench [--quick] [suite ...]\nsuites:\n");
+		for(int s=0; s < numSuites; s++) {
+			printf("  %-16s %s\n", suites[s].name, suites[s].description);
+		}
+		return 1;
+	}
+	
+	delete benchCore;
+	return 0;
+}
@@ -4,6 +4,7 @@
 #include "stdio.h"
 #include "PolyString.h"
 #include "PolyObject.h"
+#include "PolyImage.h"
 #include "OSBasics.h"
 
 #ifdef _WINDOWS
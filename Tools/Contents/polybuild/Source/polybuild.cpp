@@ -135,6 +135,21 @@ void addFileToZip(zipFile z, String filePath, String pathInZip, bool silent) {
 	}
 
 	zipCloseFileInZip(z);
+	
+	// Store a cooked copy of each texture next to it, which the player loads without decoding the PNG.
+	pos = filePath.rfind(".png");
+	bool isTexture = (pos > -1 && pos == filePath.length() - 4) ? true : false;
+	if(isTexture && getArg("--cookTextures") == "true") {
+		Image image(filePath);
+		if(image.isLoaded()) {
+			image.generateMipmaps();
+			String cookedPath = getArg("--out") + ".ptex.tmp";
+			if(image.saveCooked(cookedPath, filePath)) {
+				addFileToZip(z, cookedPath, pathInZip.substr(0, pathInZip.length() - 4) + ".ptex", silent);
+			}
+			OSBasics::removeItem(cookedPath);
+		}
+	}
 }
 
 void addFolderToZip(zipFile z, String folderPath, String parentFolder, bool silent) {
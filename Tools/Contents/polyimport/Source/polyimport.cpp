@@ -111,12 +111,12 @@ void addToISkeleton(ISkeleton *skel, IBone *parent, const struct aiScene *sc, co
 	skel->addIBone(bone, getBoneID(bone->name));
 }
 
-int exportToFile(const char *fileName, bool swapZY) {
+int exportToFile(const char *fileName, bool swapZY, int meshFormat) {
 	String fileNameMesh = String(fileName)+".mesh";
 	OSFILE *outFile = OSBasics::open(fileNameMesh.c_str(), "wb");
 	Polycode::Mesh *mesh = new Polycode::Mesh(Mesh::TRI_MESH);
 	addToMesh(mesh, scene, scene->mRootNode, swapZY);
-	mesh->saveToFile(outFile);
+	mesh->saveToFile(outFile, meshFormat);
 	OSBasics::close(outFile);
 
 	if(hasWeights) {
@@ -172,12 +172,17 @@ int main(int argc, char **argv) {
 
 	printf("Polycode import tool v0.8.2\n");
 
-	if(argc != 4) {
+	if(argc != 4 && argc != 5) {
 		printf("\n\nInvalid arguments!\n");
-		printf("usage: polyimport <source_file> <output_file> (Swap Z/Y:<true>/<false>) \n\n");
+		printf("usage: polyimport <source_file> <output_file> (Swap Z/Y:<true>/<false>) [Mesh format:<1>/<2>]\n\n");
 		return 0;
 	}
 	
+	int meshFormat = Mesh::MESH_FORMAT_V1;
+	if(argc == 5 && strcmp(argv[4], "2") == 0) {
+		meshFormat = Mesh::MESH_FORMAT_V2;
+	}
+	
 	PHYSFS_init(argv[0]);
 	struct aiLogStream stream;
 	stream = aiGetPredefinedLogStream(aiDefaultLogStream_STDOUT,NULL);
@@ -186,7 +191,7 @@ int main(int argc, char **argv) {
 	printf("Loading %s...\n", argv[1]);
 	scene = aiImportFile(argv[1],aiProcessPreset_TargetRealtime_Quality);
 	if(scene) {
-		exportToFile(argv[2], strcmp(argv[3], "true") == 0);
+		exportToFile(argv[2], strcmp(argv[3], "true") == 0, meshFormat);
 	} else {
 		printf("Error opening scene...\n");
 	}